@@ -4,10 +4,17 @@
 
 #include "base/bitset.h"
 
+#include <algorithm>
 #include <cassert>
 #include <string>
 #include <string.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 
 //
@@ -15,32 +22,204 @@ using namespace std;
 // on all platforms. Note that the positions are numbered 1 through 64, with
 // a return value of 0 indicating that there are no set bits.
 //
-static int find_first_set64(uint64_t value) {
-    int bit;
+static inline int find_first_set64(uint64_t value) {
+    if (value == 0)
+        return 0;
+    return __builtin_ctzll(value) + 1;
+}
+
+static inline int find_first_clear64(uint64_t value) {
+    return find_first_set64(~value);
+}
+
+//
+// Return the number of set bits.
+//
+static inline int num_bits_set(uint64_t value) {
+    return __builtin_popcountll(value);
+}
+
+//
+// Vector kernels for the bulk operations.  Each kernel handles as many
+// blocks as possible kSimdBlocks at a time, and the remaining blocks one
+// at a time.  The loads and stores are unaligned since the blocks may be
+// inline in a BitSet.
+//
+#if defined(__AVX2__)
 
-    int lower = value;
-    if ((bit = ffs(lower)) > 0)
-        return bit;
+#define BITSET_SIMD_KERNEL "avx2"
+typedef __m256i simd_t;
+static const size_t kSimdBlocks = 4;
 
-    int upper = value >> 32;
-    if ((bit = ffs(upper)) > 0)
-        return 32 + bit;
+static inline simd_t simd_load(const uint64_t *src) {
+    return _mm256_loadu_si256(reinterpret_cast<const simd_t *>(src));
+}
 
-    return 0;
+static inline void simd_store(uint64_t *dst, simd_t value) {
+    _mm256_storeu_si256(reinterpret_cast<simd_t *>(dst), value);
 }
 
-static int find_first_clear64(uint64_t value) {
-    return find_first_set64(~value);
+static inline simd_t simd_and(simd_t lhs, simd_t rhs) {
+    return _mm256_and_si256(lhs, rhs);
+}
+
+static inline simd_t simd_or(simd_t lhs, simd_t rhs) {
+    return _mm256_or_si256(lhs, rhs);
+}
+
+// Return (lhs & ~rhs).
+static inline simd_t simd_andnot(simd_t lhs, simd_t rhs) {
+    return _mm256_andnot_si256(rhs, lhs);
+}
+
+static inline bool simd_zero(simd_t value) {
+    return _mm256_testz_si256(value, value);
+}
+
+#elif defined(__SSE2__)
+
+#define BITSET_SIMD_KERNEL "sse2"
+typedef __m128i simd_t;
+static const size_t kSimdBlocks = 2;
+
+static inline simd_t simd_load(const uint64_t *src) {
+    return _mm_loadu_si128(reinterpret_cast<const simd_t *>(src));
+}
+
+static inline void simd_store(uint64_t *dst, simd_t value) {
+    _mm_storeu_si128(reinterpret_cast<simd_t *>(dst), value);
+}
+
+static inline simd_t simd_and(simd_t lhs, simd_t rhs) {
+    return _mm_and_si128(lhs, rhs);
+}
+
+static inline simd_t simd_or(simd_t lhs, simd_t rhs) {
+    return _mm_or_si128(lhs, rhs);
+}
+
+// Return (lhs & ~rhs).
+static inline simd_t simd_andnot(simd_t lhs, simd_t rhs) {
+    return _mm_andnot_si128(rhs, lhs);
+}
+
+static inline bool simd_zero(simd_t value) {
+    simd_t cmp = _mm_cmpeq_epi32(value, _mm_setzero_si128());
+    return _mm_movemask_epi8(cmp) == 0xFFFF;
+}
+
+#else
+
+#define BITSET_SIMD_KERNEL "scalar"
+
+#endif
+
+//
+// Implement (dst = lhs & rhs).
+//
+static void and_blocks(uint64_t *dst, const uint64_t *lhs,
+                       const uint64_t *rhs, size_t count) {
+    size_t idx = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; idx + kSimdBlocks <= count; idx += kSimdBlocks) {
+        simd_store(dst + idx,
+                   simd_and(simd_load(lhs + idx), simd_load(rhs + idx)));
+    }
+#endif
+    for (; idx < count; idx++) {
+        dst[idx] = lhs[idx] & rhs[idx];
+    }
+}
+
+//
+// Implement (dst = lhs | rhs).
+//
+static void or_blocks(uint64_t *dst, const uint64_t *lhs,
+                      const uint64_t *rhs, size_t count) {
+    size_t idx = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; idx + kSimdBlocks <= count; idx += kSimdBlocks) {
+        simd_store(dst + idx,
+                   simd_or(simd_load(lhs + idx), simd_load(rhs + idx)));
+    }
+#endif
+    for (; idx < count; idx++) {
+        dst[idx] = lhs[idx] | rhs[idx];
+    }
+}
+
+//
+// Implement (dst = lhs & ~rhs).
+//
+static void andnot_blocks(uint64_t *dst, const uint64_t *lhs,
+                          const uint64_t *rhs, size_t count) {
+    size_t idx = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; idx + kSimdBlocks <= count; idx += kSimdBlocks) {
+        simd_store(dst + idx,
+                   simd_andnot(simd_load(lhs + idx), simd_load(rhs + idx)));
+    }
+#endif
+    for (; idx < count; idx++) {
+        dst[idx] = lhs[idx] & ~rhs[idx];
+    }
+}
+
+//
+// Return true if (lhs & rhs) has any set bits.
+//
+static bool and_any(const uint64_t *lhs, const uint64_t *rhs, size_t count) {
+    size_t idx = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; idx + kSimdBlocks <= count; idx += kSimdBlocks) {
+        if (!simd_zero(simd_and(simd_load(lhs + idx), simd_load(rhs + idx))))
+            return true;
+    }
+#endif
+    for (; idx < count; idx++) {
+        if (lhs[idx] & rhs[idx])
+            return true;
+    }
+    return false;
+}
+
+//
+// Return true if (lhs & ~rhs) has any set bits.
+//
+static bool andnot_any(const uint64_t *lhs, const uint64_t *rhs,
+                       size_t count) {
+    size_t idx = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; idx + kSimdBlocks <= count; idx += kSimdBlocks) {
+        simd_t temp = simd_andnot(simd_load(lhs + idx), simd_load(rhs + idx));
+        if (!simd_zero(temp))
+            return true;
+    }
+#endif
+    for (; idx < count; idx++) {
+        if (lhs[idx] & ~rhs[idx])
+            return true;
+    }
+    return false;
 }
 
 //
-// Return the number of set bits. K&R method.
+// Return the index of the first non-zero block in [start, count), or count
+// if all of them are 0.  Used to skip over empty blocks when looking for a
+// set bit in large sparse bitsets.
 //
-static int num_bits_set(uint64_t value) {
-    int count = 0;
-    while (value != 0) {
-        value &= value - 1;
-        count++;
+static size_t find_nonzero_block(const uint64_t *blocks, size_t start,
+                                 size_t count) {
+    size_t idx = start;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; idx + kSimdBlocks <= count; idx += kSimdBlocks) {
+        if (!simd_zero(simd_load(blocks + idx)))
+            break;
+    }
+#endif
+    for (; idx < count; idx++) {
+        if (blocks[idx] != 0)
+            return idx;
     }
     return count;
 }
@@ -61,6 +240,65 @@ static inline size_t bit_position(size_t idx, size_t offset) {
 }
 
 const size_t BitSet::npos;
+const size_t BitSet::BlockVector::kInlineBlocks;
+
+BitSet::BlockVector::BlockVector()
+    : data_(inline_), size_(0), capacity_(kInlineBlocks) {
+}
+
+BitSet::BlockVector::BlockVector(const BlockVector &rhs)
+    : data_(inline_), size_(rhs.size_), capacity_(kInlineBlocks) {
+    if (size_ > kInlineBlocks) {
+        data_ = new uint64_t[size_];
+        capacity_ = size_;
+    }
+    memcpy(data_, rhs.data_, size_ * sizeof(uint64_t));
+}
+
+BitSet::BlockVector::~BlockVector() {
+    if (!is_inline())
+        delete [] data_;
+}
+
+BitSet::BlockVector &BitSet::BlockVector::operator=(const BlockVector &rhs) {
+    if (this == &rhs)
+        return *this;
+    set_size(rhs.size_);
+    memcpy(data_, rhs.data_, size_ * sizeof(uint64_t));
+    return *this;
+}
+
+//
+// Grow the storage to hold at least capacity blocks.  The capacity is at
+// least doubled to keep the cost of growing a bitset one bit at a time low.
+//
+void BitSet::BlockVector::reserve(size_t capacity) {
+    if (capacity <= capacity_)
+        return;
+    capacity = std::max(capacity, 2 * static_cast<size_t>(capacity_));
+    uint64_t *data = new uint64_t[capacity];
+    memcpy(data, data_, size_ * sizeof(uint64_t));
+    if (!is_inline())
+        delete [] data_;
+    data_ = data;
+    capacity_ = capacity;
+}
+
+void BitSet::BlockVector::resize(size_t size) {
+    reserve(size);
+    if (size > size_)
+        memset(data_ + size_, 0, (size - size_) * sizeof(uint64_t));
+    size_ = size;
+}
+
+void BitSet::BlockVector::set_size(size_t size) {
+    reserve(size);
+    size_ = size;
+}
+
+const char *BitSet::SimdKernel() {
+    return BITSET_SIMD_KERNEL;
+}
 
 //
 // Set bit at given position, growing the vector if needed.
@@ -183,12 +421,10 @@ void BitSet::check_invariants() {
 // return value convention used by find_first_set64.
 //
 size_t BitSet::find_first() const {
-    for (size_t idx = 0; idx < blocks_.size(); idx++) {
-        int bit = find_first_set64(blocks_[idx]);
-        if (bit > 0)
-            return bit_position(idx, bit - 1);
-    }
-    return BitSet::npos;
+    size_t idx = find_nonzero_block(blocks_.data(), 0, blocks_.size());
+    if (idx >= blocks_.size())
+        return BitSet::npos;
+    return bit_position(idx, find_first_set64(blocks_[idx]) - 1);
 }
 
 //
@@ -211,14 +447,12 @@ size_t BitSet::find_next(size_t pos) const {
             return bit_position(idx, bit - 1);
     }
 
-    // Go through all blocks after the start block for the pos and see if
-    // there's a set bit.
-    for (idx++; idx < blocks_.size(); idx++) {
-        int bit = find_first_set64(blocks_[idx]);
-        if (bit > 0)
-            return bit_position(idx, bit - 1);
-    }
-    return BitSet::npos;
+    // Skip over the blocks after the start block for the pos that are 0
+    // and look for the first set bit in the next block.
+    idx = find_nonzero_block(blocks_.data(), idx + 1, blocks_.size());
+    if (idx >= blocks_.size())
+        return BitSet::npos;
+    return bit_position(idx, find_first_set64(blocks_[idx]) - 1);
 }
 
 //
@@ -277,11 +511,7 @@ size_t BitSet::find_next_clear(size_t pos) const {
 //
 bool BitSet::intersects(const BitSet &rhs) const {
     size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
-    for (size_t idx = 0; idx < minsize; idx++) {
-        if (blocks_[idx] & rhs.blocks_[idx])
-            return true;
-    }
-    return false;
+    return and_any(blocks_.data(), rhs.blocks_.data(), minsize);
 }
 
 //
@@ -293,11 +523,8 @@ bool BitSet::intersects(const BitSet &rhs) const {
 bool BitSet::operator==(const BitSet &rhs) const {
     if (blocks_.size() != rhs.blocks_.size())
         return false;
-    for (size_t idx = 0; idx < blocks_.size(); idx++) {
-        if (blocks_[idx] != rhs.blocks_[idx])
-            return false;
-    }
-    return true;
+    return memcmp(blocks_.data(), rhs.blocks_.data(),
+                  blocks_.size() * sizeof(uint64_t)) == 0;
 }
 
 //
@@ -321,25 +548,14 @@ BitSet BitSet::operator&(const BitSet &rhs) const {
 // Return (*this | rhs).
 //
 BitSet BitSet::operator|(const BitSet &rhs) const {
-    BitSet temp;
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
-    size_t maxsize = std::max(blocks_.size(), rhs.blocks_.size());
-    temp.blocks_.resize(maxsize);
-
-    // Process common blocks.
-    for (size_t idx = 0; idx < minsize; idx++) {
-        temp.blocks_[idx] = blocks_[idx] | rhs.blocks_[idx];
-    }
+    const BitSet &larger = blocks_.size() >= rhs.blocks_.size() ? *this : rhs;
+    const BitSet &smaller = blocks_.size() >= rhs.blocks_.size() ? rhs : *this;
+    BitSet temp(larger);
 
-    // Process blocks that exist in LHS only. It's a noop if RHS is bigger.
-    for (size_t idx = minsize; idx < blocks_.size(); idx++) {
-        temp.blocks_[idx] = blocks_[idx];
-    }
-
-    // Process blocks that exist in RHS only. It's a noop if LHS is bigger.
-    for (size_t idx = minsize; idx < rhs.blocks_.size(); idx++) {
-        temp.blocks_[idx] = rhs.blocks_[idx];
-    }
+    // Process common blocks.  The blocks that only exist in the larger
+    // bitset have already been copied.
+    or_blocks(temp.blocks_.data(), temp.blocks_.data(),
+              smaller.blocks_.data(), smaller.blocks_.size());
 
     temp.check_invariants();
     return temp;
@@ -348,17 +564,14 @@ BitSet BitSet::operator|(const BitSet &rhs) const {
 //
 // Implement (*this &= rhs).
 //
-// Note that we can't simply resize the vector to minsize since we may be
-// able to shrink it even more depending on the values in the blocks.
+// Note that we need to compact after truncating the vector to minsize since
+// we may be able to shrink it even more depending on the values in the
+// blocks.
 //
 BitSet &BitSet::operator&=(const BitSet &rhs) {
     size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
-    for (size_t idx = 0; idx < minsize; idx++) {
-        blocks_[idx] &= rhs.blocks_[idx];
-    }
-    for (size_t idx = minsize; idx < blocks_.size(); idx++) {
-        blocks_[idx] = 0;
-    }
+    blocks_.set_size(minsize);
+    and_blocks(blocks_.data(), blocks_.data(), rhs.blocks_.data(), minsize);
     compact();
     check_invariants();
     return *this;
@@ -373,9 +586,8 @@ BitSet &BitSet::operator&=(const BitSet &rhs) {
 BitSet &BitSet::operator|=(const BitSet &rhs) {
     if (blocks_.size() < rhs.blocks_.size())
         blocks_.resize(rhs.blocks_.size());
-    for (size_t idx = 0; idx < rhs.blocks_.size(); idx++) {
-        blocks_[idx] |= rhs.blocks_[idx];
-    }
+    or_blocks(blocks_.data(), blocks_.data(), rhs.blocks_.data(),
+              rhs.blocks_.size());
     check_invariants();
     return *this;
 }
@@ -393,9 +605,7 @@ void BitSet::Set(const BitSet &rhs) {
 //
 void BitSet::Reset(const BitSet &rhs) {
     size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
-    for (size_t idx = 0; idx < minsize; idx++) {
-        blocks_[idx] &= ~rhs.blocks_[idx];
-    }
+    andnot_blocks(blocks_.data(), blocks_.data(), rhs.blocks_.data(), minsize);
     compact();
     check_invariants();
 }
@@ -403,20 +613,22 @@ void BitSet::Reset(const BitSet &rhs) {
 //
 // Implement (*this = lhs & ~rhs).
 //
-// Note that we won't enter the second for loop at all if lhs is not bigger
-// than rhs.  Need to compact only for this case, but it is cheap enough to
+// Note that the blocks that exist in lhs only are copied as is.  Need to
+// compact only if lhs is not bigger than rhs, but it is cheap enough to
 // try (and do nothing) when lhs is bigger than rhs.
 //
+// Note that *this may be the same as lhs or rhs.
+//
 void BitSet::BuildComplement(const BitSet &lhs, const BitSet &rhs) {
-    blocks_.clear();
-    blocks_.resize(lhs.blocks_.size());
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
-    for (size_t idx = 0; idx < minsize; idx++) {
-        blocks_[idx] = lhs.blocks_[idx] & ~rhs.blocks_[idx];
-    }
-    for (size_t idx = minsize; idx < lhs.blocks_.size(); idx++) {
-        blocks_[idx] = lhs.blocks_[idx];
+    size_t lhs_size = lhs.blocks_.size();
+    size_t minsize = std::min(lhs_size, rhs.blocks_.size());
+    if (this != &lhs) {
+        blocks_.set_size(lhs_size);
+        memcpy(blocks_.data() + minsize, lhs.blocks_.data() + minsize,
+               (lhs_size - minsize) * sizeof(uint64_t));
     }
+    andnot_blocks(blocks_.data(), lhs.blocks_.data(), rhs.blocks_.data(),
+                  minsize);
     compact();
     check_invariants();
 }
@@ -424,33 +636,14 @@ void BitSet::BuildComplement(const BitSet &lhs, const BitSet &rhs) {
 //
 // Implement (*this = lhs & rhs).
 //
-// We avoid the need to compact or to resize multiple times by building
-// the blocks in reverse order.
-//
-// Note that the for loop does not handle idx 0 since the loop  variable
-// is unsigned.
+// Note that *this may be the same as lhs or rhs.
 //
 void BitSet::BuildIntersection(const BitSet &lhs, const BitSet &rhs) {
-    blocks_.clear();
     size_t minsize = std::min(lhs.blocks_.size(), rhs.blocks_.size());
-
-    if (minsize == 0)
-        return;
-
-    for (size_t idx = minsize - 1; idx > 0; idx--) {
-        if (lhs.blocks_[idx] & rhs.blocks_[idx]) {
-            if (blocks_.size() == 0)
-                blocks_.resize(idx + 1);
-            blocks_[idx] = lhs.blocks_[idx] & rhs.blocks_[idx];
-        }
-    }
-
-    if (lhs.blocks_[0] & rhs.blocks_[0]) {
-        if (blocks_.size() == 0)
-            blocks_.resize(1);
-        blocks_[0] = lhs.blocks_[0] & rhs.blocks_[0];
-    }
-
+    blocks_.set_size(minsize);
+    and_blocks(blocks_.data(), lhs.blocks_.data(), rhs.blocks_.data(),
+               minsize);
+    compact();
     check_invariants();
 }
 
@@ -460,11 +653,7 @@ void BitSet::BuildIntersection(const BitSet &lhs, const BitSet &rhs) {
 bool BitSet::Contains(const BitSet &rhs) const {
     if (blocks_.size() < rhs.blocks_.size())
         return false;
-    for (size_t idx = 0; idx < rhs.blocks_.size(); idx++) {
-        if (rhs.blocks_[idx] & ~blocks_[idx])
-            return false;
-    }
-    return true;
+    return !andnot_any(rhs.blocks_.data(), blocks_.data(), rhs.blocks_.size());
 }
 
 //
@@ -12,12 +12,23 @@
 //
 // BitSet automatically resizes the bit set when needed and allows for
 // logical operations between bitsets of different sizes.  Implemented
-// using a vector of uint64_t as the underlying storage.
+// using an array of uint64_t blocks as the underlying storage.
+//
+// Bitsets of up to BlockVector::kInlineBlocks blocks (128 bits) keep their
+// blocks inline in the object and never allocate memory.  This is the common
+// case for RibPeerSets and GroupPeerSets in small and medium deployments.
+//
+// The bulk logical operations and the scans for set bits use SSE2 or AVX2
+// kernels when the compiler targets those instruction sets, and fall back
+// to plain 64 bit operations otherwise.
 //
 class BitSet {
 public:
     static const size_t npos = static_cast<size_t>(-1);
 
+    // Name of the kernels selected at compile time.
+    static const char *SimdKernel();
+
     BitSet &set(size_t pos);
     BitSet &reset(size_t pos);
     bool test(size_t pos) const;
@@ -51,10 +62,45 @@ public:
 private:
     friend class BitSetTest;
 
+    //
+    // Resizable array of blocks with inline storage for small bitsets.
+    // Blocks that get added by resize are set to 0, while the ones added
+    // by set_size are left uninitialized and must be written by the caller.
+    // The heap storage is only released when the BlockVector is destroyed,
+    // which matches the behavior of the std::vector it replaces.
+    //
+    class BlockVector {
+    public:
+        static const size_t kInlineBlocks = 2;
+
+        BlockVector();
+        BlockVector(const BlockVector &rhs);
+        ~BlockVector();
+        BlockVector &operator=(const BlockVector &rhs);
+
+        size_t size() const { return size_; }
+        void resize(size_t size);
+        void set_size(size_t size);
+        void clear() { size_ = 0; }
+        uint64_t *data() { return data_; }
+        const uint64_t *data() const { return data_; }
+        uint64_t &operator[](size_t idx) { return data_[idx]; }
+        const uint64_t &operator[](size_t idx) const { return data_[idx]; }
+        bool is_inline() const { return data_ == inline_; }
+
+    private:
+        void reserve(size_t capacity);
+
+        uint64_t *data_;
+        uint32_t size_;
+        uint32_t capacity_;
+        uint64_t inline_[kInlineBlocks];
+    };
+
     void compact();
     void check_invariants();
 
-    std::vector<uint64_t> blocks_;
+    BlockVector blocks_;
 };
 
 #endif
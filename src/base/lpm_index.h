@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef LPM_INDEX_H
+#define LPM_INDEX_H
+
+#include <stdint.h>
+#include <cstring>
+#include <boost/noncopyable.hpp>
+
+//
+// Read optimized longest prefix match index for IPv4 prefixes, kept
+// alongside a Patricia::Tree that remains the authoritative table.
+//
+// The index is a multibit trie with a stride of 8 bits, i.e. one level per
+// address byte. A prefix is stored in the node of the level that holds its
+// last bit and is expanded into every slot of that node it covers; a slot
+// keeps the longest prefix of the level that covers it. A lookup indexes at
+// most 4 nodes, remembering the last prefix it saw on the way down.
+//
+// D is the type of the prefixes and K provides the same Length and ByteValue
+// accessors as the key class of the Patricia::Tree.
+//
+template <class D, class K>
+class LpmIndex : boost::noncopyable {
+public:
+    static const int kStride = 8;
+    static const int kLevels = 32 / kStride;
+    static const int kSlots = 1 << kStride;
+
+    LpmIndex() : root_(NULL), node_count_(0) {
+    }
+
+    ~LpmIndex() {
+        Clear();
+    }
+
+    // Add a prefix, or refresh it if it's already present.
+    void Insert(D *data) {
+        int plen = K::Length(data);
+        int level = Level(plen);
+        Node **node = &root_;
+        for (int idx = 0; idx < level; ++idx) {
+            if (*node == NULL)
+                *node = AllocNode();
+            Slot &slot = (*node)->slots[ByteValue(data, idx)];
+            if (slot.child == NULL && slot.data == NULL)
+                (*node)->count++;
+            node = &slot.child;
+        }
+        if (*node == NULL)
+            *node = AllocNode();
+
+        Node *leaf = *node;
+        int first, last;
+        SlotRange(data, level, plen, &first, &last);
+        for (int idx = first; idx < last; ++idx) {
+            Slot &slot = leaf->slots[idx];
+            if (slot.data == NULL) {
+                if (slot.child == NULL)
+                    leaf->count++;
+            } else if (leaf->plen[idx] > plen) {
+                continue;
+            }
+            slot.data = data;
+            leaf->plen[idx] = plen;
+        }
+    }
+
+    // Remove a prefix. The slots it covered revert to cover, the longest
+    // remaining prefix that covers it, which is found in the Patricia::Tree
+    // by the caller. The index only keeps cover in those slots if it belongs
+    // to the same level.
+    void Remove(D *data, D *cover) {
+        int plen = K::Length(data);
+        int level = Level(plen);
+        Node **path[kLevels];
+        Node **node = &root_;
+        for (int idx = 0; idx < level; ++idx) {
+            if (*node == NULL)
+                return;
+            path[idx] = node;
+            node = &(*node)->slots[ByteValue(data, idx)].child;
+        }
+        if (*node == NULL)
+            return;
+        path[level] = node;
+
+        if (cover != NULL && Level(K::Length(cover)) != level)
+            cover = NULL;
+        int cover_plen = cover ? K::Length(cover) : 0;
+
+        Node *leaf = *node;
+        int first, last;
+        SlotRange(data, level, plen, &first, &last);
+        for (int idx = first; idx < last; ++idx) {
+            Slot &slot = leaf->slots[idx];
+            if (slot.data != data)
+                continue;
+            slot.data = cover;
+            leaf->plen[idx] = cover_plen;
+            if (cover == NULL && slot.child == NULL)
+                leaf->count--;
+        }
+
+        // Release the nodes that are left empty, bottom up.
+        for (int idx = level; idx >= 0; --idx) {
+            Node **loc = path[idx];
+            if ((*loc)->count != 0)
+                break;
+            FreeNode(*loc);
+            *loc = NULL;
+            if (idx == 0)
+                break;
+            Node *parent = *path[idx - 1];
+            if (parent->slots[ByteValue(data, idx - 1)].data == NULL)
+                parent->count--;
+        }
+    }
+
+    // Find the longest prefix that matches a host order address.
+    D *LPMFind(uint32_t addr) const {
+        D *best = NULL;
+        const Node *node = root_;
+        for (int shift = 32 - kStride; node != NULL; shift -= kStride) {
+            const Slot &slot = node->slots[(addr >> shift) & (kSlots - 1)];
+            if (slot.data != NULL)
+                best = slot.data;
+            node = slot.child;
+        }
+        return best;
+    }
+
+    void Clear() {
+        FreeTree(root_);
+        root_ = NULL;
+    }
+
+    bool empty() const { return root_ == NULL; }
+    size_t node_count() const { return node_count_; }
+    size_t memory() const { return node_count_ * sizeof(Node); }
+
+private:
+    struct Node;
+
+    // The prefix and the child are looked up together, so keep them in the
+    // same cache line.
+    struct Slot {
+        D *data;
+        Node *child;
+    };
+
+    struct Node {
+        Node() : count(0) {
+            memset(slots, 0, sizeof(slots));
+            memset(plen, 0, sizeof(plen));
+        }
+        Slot slots[kSlots];
+        uint8_t plen[kSlots];
+        // Number of slots with either a prefix or a child.
+        int count;
+    };
+
+    // A /0 belongs to the first level, and a /8 expands to a single slot of
+    // it rather than to a full node of the second level.
+    static int Level(int plen) {
+        return plen == 0 ? 0 : (plen - 1) / kStride;
+    }
+
+    static int ByteValue(D *data, int idx) {
+        return static_cast<uint8_t>(K::ByteValue(data, idx));
+    }
+
+    static void SlotRange(D *data, int level, int plen, int *first,
+                          int *last) {
+        int bits = plen - level * kStride;
+        int span = 1 << (kStride - bits);
+        *first = ByteValue(data, level) & ~(span - 1);
+        *last = *first + span;
+    }
+
+    Node *AllocNode() {
+        node_count_++;
+        return new Node;
+    }
+
+    void FreeNode(Node *node) {
+        node_count_--;
+        delete node;
+    }
+
+    void FreeTree(Node *node) {
+        if (node == NULL)
+            return;
+        for (int idx = 0; idx < kSlots; ++idx) {
+            FreeTree(node->slots[idx].child);
+        }
+        FreeNode(node);
+    }
+
+    Node *root_;
+    size_t node_count_;
+};
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_mpsc_ring_h
+#define ctrlplane_mpsc_ring_h
+
+#include <stdint.h>
+#include <cassert>
+#include <vector>
+#include <tbb/atomic.h>
+
+#include "base/util.h"
+
+//
+// Bounded lock-free ring with multiple producers and a single consumer.
+//
+// Each cell carries a sequence number that tells whether it's free for the
+// producer that claims the next enqueue position or ready for the consumer
+// (D. Vyukov's bounded queue). Producers only contend on the enqueue index,
+// and a cell is never shared between a producer and the consumer at the
+// same time. The capacity is rounded up to a power of 2.
+//
+// TryPush fails instead of blocking when the ring is full. It's up to the
+// caller to apply back-pressure or to fall back to some other container.
+//
+template <typename T>
+class MpscRing {
+public:
+    explicit MpscRing(size_t capacity)
+        : cells_(RoundUp(capacity)), mask_(cells_.size() - 1) {
+        for (size_t idx = 0; idx < cells_.size(); ++idx) {
+            cells_[idx].sequence = idx;
+        }
+        enqueue_pos_ = 0;
+        dequeue_pos_ = 0;
+    }
+
+    // Concurrency: may be called by any number of producers.
+    bool TryPush(const T &value) {
+        Cell *cell;
+        size_t pos = enqueue_pos_;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence;
+            intptr_t diff = static_cast<intptr_t>(seq) -
+                            static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                size_t prev = enqueue_pos_.compare_and_swap(pos + 1, pos);
+                if (prev == pos)
+                    break;
+                pos = prev;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_;
+            }
+        }
+        cell->value = value;
+        cell->sequence = pos + 1;
+        return true;
+    }
+
+    // Concurrency: must only be called by the consumer.
+    bool TryPop(T *value) {
+        size_t pos = dequeue_pos_;
+        Cell *cell = &cells_[pos & mask_];
+        size_t seq = cell->sequence;
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0)
+            return false;
+        *value = cell->value;
+        cell->sequence = pos + mask_ + 1;
+        dequeue_pos_ = pos + 1;
+        return true;
+    }
+
+    // A position that has been claimed by a producer makes the ring non
+    // empty even if the value hasn't been stored yet. This ensures that the
+    // consumer does not go idle while an enqueue is in progress.
+    bool empty() const { return enqueue_pos_ == dequeue_pos_; }
+    size_t size() const { return enqueue_pos_ - dequeue_pos_; }
+    size_t capacity() const { return cells_.size(); }
+
+private:
+    struct Cell {
+        tbb::atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t RoundUp(size_t capacity) {
+        assert(capacity > 0);
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<Cell> cells_;
+    size_t mask_;
+
+    // Keep the producer and consumer indices on separate cache lines.
+    char pad0_[64];
+    tbb::atomic<size_t> enqueue_pos_;
+    char pad1_[64];
+    tbb::atomic<size_t> dequeue_pos_;
+
+    DISALLOW_COPY_AND_ASSIGN(MpscRing);
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/slab_allocator.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+#include "base/task.h"
+
+using namespace std;
+
+//
+// Blocks are aligned to the size of a pointer, which is also the minimum
+// block size since free blocks are linked through their first word. The
+// slab header is followed by at least one block.
+//
+SlabAllocator::SlabAllocator(size_t block_size, size_t slab_size,
+                             size_t shard_count)
+    : block_size_(max(block_size, sizeof(Block))),
+      header_size_(sizeof(Slab)),
+      shard_count_(max(shard_count, size_t(1))),
+      shards_(new Shard[shard_count_]) {
+    const size_t align = sizeof(void *);
+    block_size_ = (block_size_ + align - 1) & ~(align - 1);
+    header_size_ = (header_size_ + align - 1) & ~(align - 1);
+    slab_size_ = align;
+    while (slab_size_ < max(slab_size, header_size_ + block_size_)) {
+        slab_size_ <<= 1;
+    }
+}
+
+SlabAllocator::~SlabAllocator() {
+    for (set<Slab *>::iterator it = slabs_.begin(); it != slabs_.end(); ++it) {
+        free(*it);
+    }
+}
+
+size_t SlabAllocator::CurrentShard() {
+    Task *task = Task::Running();
+    if (!task || task->GetTaskInstance() < 0)
+        return 0;
+    return task->GetTaskInstance();
+}
+
+SlabAllocator::Slab *SlabAllocator::AllocSlab(size_t shard) {
+    void *ptr;
+    if (posix_memalign(&ptr, slab_size_, slab_size_) != 0)
+        throw std::bad_alloc();
+    Slab *slab = static_cast<Slab *>(ptr);
+    slab->prev = slab->next = NULL;
+    slab->shard = shard;
+    slab->in_use = 0;
+    slab->free_list = NULL;
+    slab->unused = reinterpret_cast<uint8_t *>(slab) + header_size_;
+    tbb::mutex::scoped_lock lock(slab_mutex_);
+    slabs_.insert(slab);
+    return slab;
+}
+
+void SlabAllocator::FreeSlab(Slab *slab) {
+    {
+        tbb::mutex::scoped_lock lock(slab_mutex_);
+        slabs_.erase(slab);
+    }
+    free(slab);
+}
+
+SlabAllocator::Slab *SlabAllocator::SlabOf(void *ptr) const {
+    uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+    return reinterpret_cast<Slab *>(addr & ~(uintptr_t(slab_size_) - 1));
+}
+
+bool SlabAllocator::IsFull(const Slab *slab) const {
+    const uint8_t *end = reinterpret_cast<const uint8_t *>(slab) + slab_size_;
+    return slab->free_list == NULL && slab->unused + block_size_ > end;
+}
+
+void SlabAllocator::Link(Shard *sp, Slab *slab) {
+    slab->prev = NULL;
+    slab->next = sp->available;
+    if (sp->available)
+        sp->available->prev = slab;
+    sp->available = slab;
+}
+
+void SlabAllocator::Unlink(Shard *sp, Slab *slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        sp->available = slab->next;
+    }
+    if (slab->next)
+        slab->next->prev = slab->prev;
+    slab->prev = slab->next = NULL;
+}
+
+//
+// Take a block from the first slab of the shard with free blocks, reusing
+// freed blocks before carving out new ones. Fall back to the spare slab of
+// the shard, and then to a new slab.
+//
+void *SlabAllocator::Alloc(size_t shard) {
+    shard %= shard_count_;
+    Shard *sp = &shards_[shard];
+    tbb::spin_mutex::scoped_lock lock(sp->mutex);
+    Slab *slab = sp->available;
+    if (!slab) {
+        if (sp->spare) {
+            slab = sp->spare;
+            sp->spare = NULL;
+        } else {
+            slab = AllocSlab(shard);
+        }
+        Link(sp, slab);
+    }
+
+    void *ptr;
+    if (slab->free_list) {
+        Block *block = slab->free_list;
+        slab->free_list = block->next;
+        ptr = block;
+    } else {
+        ptr = slab->unused;
+        slab->unused += block_size_;
+    }
+    slab->in_use++;
+    sp->allocated++;
+    if (IsFull(slab))
+        Unlink(sp, slab);
+    return ptr;
+}
+
+//
+// Return the block to its slab, on the shard that owns the slab. A slab
+// without blocks in use becomes the spare of the shard, or is returned to
+// the system if the shard already has a spare.
+//
+void SlabAllocator::Free(void *ptr) {
+    if (!ptr)
+        return;
+    Slab *slab = SlabOf(ptr);
+    Shard *sp = &shards_[slab->shard];
+    tbb::spin_mutex::scoped_lock lock(sp->mutex);
+    bool linked = !IsFull(slab);
+    Block *block = static_cast<Block *>(ptr);
+    block->next = slab->free_list;
+    slab->free_list = block;
+    slab->in_use--;
+    sp->allocated--;
+
+    if (slab->in_use == 0) {
+        if (linked)
+            Unlink(sp, slab);
+        if (sp->spare) {
+            FreeSlab(slab);
+        } else {
+            sp->spare = slab;
+        }
+    } else if (!linked) {
+        Link(sp, slab);
+    }
+}
+
+size_t SlabAllocator::allocated() const {
+    int64_t allocated = 0;
+    for (size_t idx = 0; idx < shard_count_; ++idx) {
+        allocated += shards_[idx].allocated;
+    }
+    return allocated;
+}
+
+size_t SlabAllocator::slab_count() const {
+    tbb::mutex::scoped_lock lock(slab_mutex_);
+    return slabs_.size();
+}
+
+size_t SlabAllocator::capacity() const {
+    return slab_count() * slab_size_;
+}
+
+SizeClassAllocator::SizeClassAllocator(size_t max_size)
+    : max_size_(max_size),
+      class_count_((max_size + kGranularity - 1) / kGranularity + 1),
+      allocators_(new tbb::atomic<SlabAllocator *>[class_count_]) {
+    for (size_t idx = 0; idx < class_count_; ++idx) {
+        allocators_[idx] = NULL;
+    }
+}
+
+SizeClassAllocator::~SizeClassAllocator() {
+    for (size_t idx = 0; idx < class_count_; ++idx) {
+        delete allocators_[idx];
+    }
+}
+
+//
+// Create the allocator for the size class if needed. If two threads race
+// to create it, the loser throws its copy away.
+//
+SlabAllocator *SizeClassAllocator::GetSlabAllocator(size_t size) {
+    size_t index = (size + kGranularity - 1) / kGranularity;
+    SlabAllocator *allocator = allocators_[index];
+    if (allocator)
+        return allocator;
+    allocator = new SlabAllocator(index * kGranularity);
+    SlabAllocator *prev = allocators_[index].compare_and_swap(allocator, NULL);
+    if (prev) {
+        delete allocator;
+        return prev;
+    }
+    return allocator;
+}
+
+void *SizeClassAllocator::Alloc(size_t size) {
+    if (size > max_size_)
+        return ::operator new(size);
+    return GetSlabAllocator(size)->Alloc();
+}
+
+void SizeClassAllocator::Free(void *ptr, size_t size) {
+    if (size > max_size_) {
+        ::operator delete(ptr);
+        return;
+    }
+    GetSlabAllocator(size)->Free(ptr);
+}
+
+size_t SizeClassAllocator::capacity() const {
+    size_t capacity = 0;
+    for (size_t idx = 0; idx < class_count_; ++idx) {
+        SlabAllocator *allocator = allocators_[idx];
+        if (allocator)
+            capacity += allocator->capacity();
+    }
+    return capacity;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_slab_allocator_h
+#define ctrlplane_slab_allocator_h
+
+#include <stdint.h>
+#include <set>
+#include <boost/scoped_array.hpp>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+#include <tbb/spin_mutex.h>
+
+#include "base/util.h"
+
+//
+// Allocator for fixed size blocks, carved out of large slabs. It's meant
+// for objects that are allocated in large numbers, where the per object
+// overhead and the rounding of the general purpose allocator add up.
+//
+// Slabs belong to one of a number of shards, each with its own lock. By
+// default the shard is picked by the instance of the running task, so that
+// the tasks for different DB partitions don't contend with each other when
+// allocating. A block always goes back to the shard of its slab when it is
+// freed, whichever task frees it, so that blocks don't drift between the
+// shards. The slab of a block is found by aligning the slabs to their size.
+//
+// Each shard keeps a list of its slabs that have free blocks, and keeps one
+// spare slab once all its blocks are freed. Any other slab is returned to
+// the system as soon as all its blocks are freed. The memory retained is
+// thus bounded by the slabs with blocks in use plus one slab per shard.
+//
+class SlabAllocator {
+public:
+    static const size_t kShardCount = 16;
+    static const size_t kSlabSize = 256 * 1024;
+
+    // The slab size is rounded up to a power of 2.
+    explicit SlabAllocator(size_t block_size, size_t slab_size = kSlabSize,
+                           size_t shard_count = kShardCount);
+    ~SlabAllocator();
+
+    void *Alloc() { return Alloc(CurrentShard()); }
+    void *Alloc(size_t shard);
+    void Free(void *ptr);
+
+    size_t block_size() const { return block_size_; }
+
+    // Number of blocks in use.
+    size_t allocated() const;
+
+    // Number of slabs and total bytes obtained from the system.
+    size_t slab_count() const;
+    size_t capacity() const;
+
+    // Instance of the running task, if any.
+    static size_t CurrentShard();
+
+private:
+    struct Block {
+        Block *next;
+    };
+
+    // Header at the start of each slab. Only touched with the lock of the
+    // shard that owns the slab held, except for the shard itself.
+    struct Slab {
+        Slab *prev;
+        Slab *next;
+        size_t shard;
+        size_t in_use;
+        Block *free_list;
+        uint8_t *unused;
+    };
+
+    struct Shard {
+        Shard() : available(NULL), spare(NULL), allocated(0) { }
+        tbb::spin_mutex mutex;
+        Slab *available;
+        Slab *spare;
+        int64_t allocated;
+    };
+
+    Slab *AllocSlab(size_t shard);
+    void FreeSlab(Slab *slab);
+    Slab *SlabOf(void *ptr) const;
+    bool IsFull(const Slab *slab) const;
+    void Link(Shard *sp, Slab *slab);
+    void Unlink(Shard *sp, Slab *slab);
+
+    size_t block_size_;
+    size_t slab_size_;
+    size_t header_size_;
+    size_t shard_count_;
+    boost::scoped_array<Shard> shards_;
+    mutable tbb::mutex slab_mutex_;
+    std::set<Slab *> slabs_;
+
+    DISALLOW_COPY_AND_ASSIGN(SlabAllocator);
+};
+
+//
+// Slab allocators for objects of up to a maximum size, one for each size
+// in multiples of kGranularity. The SlabAllocator for a size is created on
+// first use. Larger objects go to the general purpose allocator.
+//
+// Typically used from class specific operator new and delete of a class
+// hierarchy, since the size of each derived class is then known at delete
+// time when the destructor is virtual.
+//
+class SizeClassAllocator {
+public:
+    static const size_t kGranularity = 8;
+
+    explicit SizeClassAllocator(size_t max_size);
+    ~SizeClassAllocator();
+
+    void *Alloc(size_t size);
+    void Free(void *ptr, size_t size);
+
+    // Total bytes obtained from the system by the slab allocators.
+    size_t capacity() const;
+
+private:
+    SlabAllocator *GetSlabAllocator(size_t size);
+
+    size_t max_size_;
+    size_t class_count_;
+    boost::scoped_array<tbb::atomic<SlabAllocator *> > allocators_;
+
+    DISALLOW_COPY_AND_ASSIGN(SizeClassAllocator);
+};
+
+#endif
@@ -3,6 +3,7 @@
  */
 
 #include <assert.h>
+#include <time.h>
 #include <fstream>
 #include <map>
 #include <iostream>
@@ -17,6 +18,7 @@ using namespace std;
 using namespace tbb;
 
 class TaskEntry;
+class TaskPolicyDomain;
 struct TaskDeferEntryCmp;
 
 typedef tbb::enumerable_thread_specific<Task *> TaskInfo;
@@ -28,6 +30,18 @@ typedef std::vector<TaskEntry *> TaskEntryList;
 
 boost::scoped_ptr<TaskScheduler> TaskScheduler::singleton_;
 
+// Clock used to measure the wait and run times of tasks. It's read three
+// times per task, so it needs to be cheap.
+static inline uint64_t TaskTimestampUsec() {
+#ifdef __APPLE__
+    return UTCTimestampUsec();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+#endif
+}
+
 // Private class used to implement tbb::task
 // An object is created when task is ready for execution and 
 // registered with tbb::task
@@ -161,6 +175,10 @@ public:
     void ClearTaskGroupStats();
     void ClearTaskStats();
     void ClearTaskStats(int instance_id);
+    void RecordTaskTimes(Task *t);
+
+    TaskPolicyDomain *domain() const { return domain_; }
+    void set_domain(TaskPolicyDomain *domain) { domain_ = domain; }
 
     int task_id() const { return task_id_; }
     int deferq_size() const { return deferq_.size(); }
@@ -177,6 +195,7 @@ public:
 
 private:
     friend class TaskEntry;
+    friend class TaskScheduler;
     
     // Vector of Task Group policies
     typedef std::vector<TaskGroup *> TaskGroupPolicyList;
@@ -199,9 +218,69 @@ private:
     TaskEntryList           task_entry_db_;  // task-entries in this group
 
     TaskStats               stats_;
+    TaskHistogram           wait_histogram_;
+    TaskHistogram           run_histogram_;
+
+    // Policy domain the group belongs to. Only changes when SetPolicy()
+    // merges domains.
+    tbb::atomic<TaskPolicyDomain *> domain_;
     DISALLOW_COPY_AND_ASSIGN(TaskGroup);
 };
 
+// A set of task groups that are related through policy rules. The mutex
+// protects the scheduling state of all the groups in the domain, i.e. their
+// TaskEntry waitq_, deferq_ and run counts.
+//
+// stop_entry_ holds the TaskEntries of the domain that were enqueued while
+// the scheduler was stopped.
+//
+// Domains are merged, but never deleted until the scheduler is destroyed,
+// so a thread that looked up a stale domain can still lock it safely and
+// retry.
+class TaskPolicyDomain {
+public:
+    explicit TaskPolicyDomain(int id)
+        : id_(id), stop_entry_(new TaskEntry(-1)) {
+    }
+    ~TaskPolicyDomain() { delete stop_entry_; }
+
+    int id() const { return id_; }
+    tbb::mutex &mutex() { return mutex_; }
+    TaskEntry *stop_entry() { return stop_entry_; }
+
+private:
+    friend class TaskScheduler;
+    typedef std::vector<TaskGroup *> TaskGroupList;
+
+    int                     id_;
+    tbb::mutex              mutex_;
+    TaskGroupList           groups_;
+    TaskEntry               *stop_entry_;
+
+    DISALLOW_COPY_AND_ASSIGN(TaskPolicyDomain);
+};
+
+// Lock the policy domain of a task group. The group may be moved to another
+// domain while waiting for the lock, in which case the new domain is locked
+// instead.
+class TaskDomainLock {
+public:
+    explicit TaskDomainLock(TaskGroup *group) {
+        while (true) {
+            domain_ = group->domain();
+            domain_->mutex().lock();
+            if (domain_ == group->domain())
+                break;
+            domain_->mutex().unlock();
+        }
+    }
+    ~TaskDomainLock() { domain_->mutex().unlock(); }
+
+private:
+    TaskPolicyDomain *domain_;
+    DISALLOW_COPY_AND_ASSIGN(TaskDomainLock);
+};
+
 ////////////////////////////////////////////////////////////////////////////
 // Implementation for class TaskImpl 
 ////////////////////////////////////////////////////////////////////////////
@@ -213,7 +292,9 @@ tbb::task *TaskImpl::execute() {
     TaskInfo::reference running = task_running.local();
     running = parent_;
     try {
+        parent_->start_time_ = TaskTimestampUsec();
         bool is_complete = parent_->Run();
+        parent_->run_usecs_ = TaskTimestampUsec() - parent_->start_time_;
         running = NULL;
         if (is_complete == true) {
             parent_->SetTaskComplete();
@@ -275,11 +356,15 @@ int TaskScheduler::GetThreadCount() {
 // for task scheduling. But, in our case we dont want "main" thread to be
 // part of tbb. So, initialize TBB with one thread more than its default
 TaskScheduler::TaskScheduler() : 
-    task_scheduler_(GetThreadCount() + 1),
-    running_(true), seqno_(0), id_max_(0) {
+    task_scheduler_(GetThreadCount() + 1), id_max_(0) {
+    running_ = true;
+    seqno_ = 0;
     hw_thread_count_ = GetThreadCount();
-    task_group_db_.resize(TaskScheduler::kVectorGrowSize);
-    stop_entry_ = new TaskEntry(-1);
+    task_group_db_.resize(TaskScheduler::kMaxTaskGroups);
+    for (TaskGroupDb::iterator iter = task_group_db_.begin();
+         iter != task_group_db_.end(); ++iter) {
+        *iter = NULL;
+    }
 }
 
 // Free up the task_entry_db_ allocated for scheduler
@@ -299,8 +384,7 @@ TaskScheduler::~TaskScheduler() {
          id_map_.erase(loc++)) {
     }
 
-    delete stop_entry_;
-    stop_entry_ = NULL;
+    STLDeleteValues(&domains_);
     task_group_db_.clear();
 
     return;
@@ -318,23 +402,72 @@ TaskScheduler *TaskScheduler::GetInstance() {
     return singleton_.get();
 }
 
-// Get TaskGroup for a task_id. Grows task_entry_db_ if necessary
+// Get TaskGroup for a task_id. A new group is placed in a policy domain of
+// its own.
 TaskGroup *TaskScheduler::GetTaskGroup(int task_id) {
-    assert(task_id >= 0);
-    int size = task_group_db_.size();
-    if (size <= task_id) {
-        task_group_db_.resize(task_id + TaskScheduler::kVectorGrowSize);
+    assert(task_id >= 0 && task_id < kMaxTaskGroups);
+    TaskGroup *group = task_group_db_[task_id];
+    if (group != NULL) {
+        return group;
     }
 
-    TaskGroup *group = task_group_db_[task_id];
+    tbb::mutex::scoped_lock lock(group_mutex_);
+    group = task_group_db_[task_id];
     if (group == NULL) {
+        TaskPolicyDomain *domain = new TaskPolicyDomain(domains_.size());
+        domains_.push_back(domain);
         group = new TaskGroup(task_id);
+        group->set_domain(domain);
+        domain->groups_.push_back(group);
         task_group_db_[task_id] = group;
     }
 
     return group;
 }
 
+void TaskScheduler::GetDomains(TaskPolicyDomainList *domains) {
+    tbb::mutex::scoped_lock lock(group_mutex_);
+    *domains = domains_;
+}
+
+//
+// Move the groups of the smaller domain into the larger one. Tasks of either
+// domain may be running or waiting. Their scheduling state remains valid
+// since it only refers to TaskEntries of their own domain. Locks are taken
+// in the order of the domain ids.
+//
+// concurrency: called with mutex_ held, so domains are merged one at a time.
+void TaskScheduler::MergeDomains(TaskGroup *group, TaskGroup *other) {
+    TaskPolicyDomain *domain = group->domain();
+    TaskPolicyDomain *merged = other->domain();
+    if (domain == merged) {
+        return;
+    }
+    if (domain->groups_.size() < merged->groups_.size()) {
+        swap(domain, merged);
+    }
+
+    TaskPolicyDomain *first = (domain->id() < merged->id()) ? domain : merged;
+    TaskPolicyDomain *second = (first == domain) ? merged : domain;
+    tbb::mutex::scoped_lock lock1(first->mutex());
+    tbb::mutex::scoped_lock lock2(second->mutex());
+
+    for (TaskPolicyDomain::TaskGroupList::iterator it =
+         merged->groups_.begin(); it != merged->groups_.end(); ++it) {
+        (*it)->set_domain(domain);
+        domain->groups_.push_back(*it);
+    }
+    merged->groups_.clear();
+
+    // Entries enqueued while the scheduler was stopped.
+    TaskEntry *stop_entry = merged->stop_entry();
+    while (!stop_entry->deferq_->empty()) {
+        TaskEntry &entry = *stop_entry->deferq_->begin();
+        stop_entry->DeleteFromDeferQ(entry);
+        domain->stop_entry()->AddToDeferQ(&entry);
+    }
+}
+
 // Query TaskGroup for a task_id.Assumes valid entry is present for task_id
 TaskGroup *TaskScheduler::QueryTaskGroup(int task_id) {
     return task_group_db_[task_id];
@@ -361,10 +494,18 @@ TaskEntry *TaskScheduler::QueryTaskEntry(int task_id, int task_instance) {
 //      The symmetry of policy will result in following additional rules,
 //      task_db_[tid1] : Rule <tid0, -1> is added to policyq
 //      task_group_db_[tid2, inst2] : Rule <tid0, inst2> is added to policyq
+//
+//      The task groups in the policy are first moved into the policy domain
+//      of the task.
 void TaskScheduler::SetPolicy(int task_id, TaskPolicy &policy) {
     tbb::mutex::scoped_lock     lock(mutex_);
 
     TaskGroup *group = GetTaskGroup(task_id);
+    for (TaskPolicy::iterator it = policy.begin(); it != policy.end(); ++it) {
+        MergeDomains(group, GetTaskGroup(it->match_id));
+    }
+
+    TaskDomainLock domain_lock(group);
     TaskEntry *group_entry = group->GetTaskEntry(-1);
     group->PolicySet();
 
@@ -390,13 +531,17 @@ void TaskScheduler::SetPolicy(int task_id, TaskPolicy &policy) {
 // Enqueue a Task for running. Starts task if all policy rules are met else 
 // puts task in waitq
 void TaskScheduler::Enqueue(Task *t) {
-    tbb::mutex::scoped_lock     lock(mutex_);
+    TaskDomainLock lock(GetTaskGroup(t->GetTaskId()));
 
     EnqueueUnLocked(t);
 }
 
+// concurrency: called with the lock of the task's policy domain held.
 void TaskScheduler::EnqueueUnLocked(Task *t) {
-    t->SetSeqNo(++seqno_);
+    // The seqno only orders tasks within a domain, and is assigned under
+    // the domain lock.
+    t->SetSeqNo(seqno_.fetch_and_increment() + 1);
+    t->enqueue_time_ = TaskTimestampUsec();
     TaskGroup *group = GetTaskGroup(t->GetTaskId());
 
 
@@ -411,7 +556,7 @@ void TaskScheduler::EnqueueUnLocked(Task *t) {
     // TaskScheduler::Start() will run tasks from waitq_
     if (running_ == false) {
         entry->AddToWaitQ(t);
-        stop_entry_->AddToDeferQ(entry);
+        group->domain()->stop_entry()->AddToDeferQ(entry);
         return;
     }
 
@@ -436,7 +581,7 @@ void TaskScheduler::EnqueueUnLocked(Task *t) {
 // Cancel a Task that can be in RUN/WAIT state.
 // [Note]: The caller needs to ensure that the task exists when Cancel() is invoked. 
 TaskScheduler::CancelReturnCode TaskScheduler::Cancel(Task *t) {
-    tbb::mutex::scoped_lock  lock(mutex_);
+    TaskDomainLock lock(GetTaskGroup(t->GetTaskId()));
 
     // If the task is in RUN state, mark the task for cancellation and return.
     if (t->state_ == Task::RUN) {
@@ -486,10 +631,12 @@ TaskScheduler::CancelReturnCode TaskScheduler::Cancel(Task *t) {
 // Method invoked on exit of a Task.
 // Exit of a task can potentially start tasks in pendingq.
 void TaskScheduler::OnTaskExit(Task *t) {
-    tbb::mutex::scoped_lock lock(mutex_);
+    TaskGroup *group = GetTaskGroup(t->GetTaskId());
+    TaskDomainLock lock(group);
 
+    group->RecordTaskTimes(t);
     TaskEntry *entry = QueryTaskEntry(t->GetTaskId(), t->GetTaskInstance());
-    entry->TaskExited(t, GetTaskGroup(t->GetTaskId()));
+    entry->TaskExited(t, group);
 
     //
     // Delete the task it is not marked for recycling or already cancelled.
@@ -509,20 +656,41 @@ void TaskScheduler::OnTaskExit(Task *t) {
     EnqueueUnLocked(t);
 }
 
+// Tasks already past the running_ check complete their Enqueue before Stop()
+// returns, since each domain lock is acquired in turn.
 void TaskScheduler::Stop() {
-    tbb::mutex::scoped_lock             lock(mutex_);
-
     running_ = false;
+
+    TaskPolicyDomainList domains;
+    GetDomains(&domains);
+    for (TaskPolicyDomainList::iterator it = domains.begin();
+         it != domains.end(); ++it) {
+        tbb::mutex::scoped_lock lock((*it)->mutex());
+    }
 }
 
+// The tasks queued while the scheduler was stopped must run ahead of the
+// ones enqueued once it's started. All the domain locks are thus held, in
+// the order of the domain ids, until running_ is set. No domain is created
+// meanwhile, since group_mutex_ is held.
 void TaskScheduler::Start() {
-    tbb::mutex::scoped_lock             lock(mutex_);
+    tbb::mutex::scoped_lock lock(group_mutex_);
+    for (TaskPolicyDomainList::iterator it = domains_.begin();
+         it != domains_.end(); ++it) {
+        (*it)->mutex().lock();
+    }
 
+    // Run all tasks that may be suspended
+    for (TaskPolicyDomainList::iterator it = domains_.begin();
+         it != domains_.end(); ++it) {
+        (*it)->stop_entry()->RunDeferQ();
+    }
     running_ = true;
 
-    // Run all tasks that may be suspended
-    stop_entry_->RunDeferQ();
-    return;
+    for (TaskPolicyDomainList::iterator it = domains_.begin();
+         it != domains_.end(); ++it) {
+        (*it)->mutex().unlock();
+    }
 }
 
 void TaskScheduler::Print() {
@@ -543,13 +711,12 @@ void TaskScheduler::Print() {
 bool TaskScheduler::IsEmpty() {
     TaskGroup *group;
 
-    tbb::mutex::scoped_lock lock(mutex_);
-
     for (TaskGroupDb::iterator it = task_group_db_.begin();
          it != task_group_db_.end(); ++it) {
         if ((group = *it) == NULL) {
             continue;
         }
+        TaskDomainLock lock(group);
         if (group->TaskRunCount() || (false == group->IsWaitQEmpty())) {
             return false;
         }
@@ -601,6 +768,34 @@ void TaskScheduler::ClearTaskStats(int task_id, int instance_id) {
     group->ClearTaskStats(instance_id);
 }
 
+bool TaskScheduler::GetTaskGroupHistograms(int task_id, TaskHistogram *wait,
+                                           TaskHistogram *run) {
+    if (task_id < 0 || task_id >= kMaxTaskGroups)
+        return false;
+    TaskGroup *group = QueryTaskGroup(task_id);
+    if (group == NULL)
+        return false;
+
+    TaskDomainLock lock(group);
+    *wait = group->wait_histogram_;
+    *run = group->run_histogram_;
+    return true;
+}
+
+int TaskScheduler::GetPolicyDomainId(int task_id) {
+    TaskGroup *group = GetTaskGroup(task_id);
+    TaskDomainLock lock(group);
+    return group->domain()->id();
+}
+
+void TaskScheduler::GetTaskNames(std::vector<std::string> *names) {
+    tbb::reader_writer_lock::scoped_lock_read lock(id_map_mutex_);
+    for (TaskIdMap::const_iterator loc = id_map_.begin();
+         loc != id_map_.end(); ++loc) {
+        names->push_back(loc->first);
+    }
+}
+
 TaskStats *TaskScheduler::GetTaskGroupStats(int task_id) {
     TaskGroup *group = GetTaskGroup(task_id);
     if (group == NULL)
@@ -693,6 +888,7 @@ TaskGroup::TaskGroup(int task_id) : task_id_(task_id), policy_set_(false),
     task_entry_db_.resize(TaskGroup::kVectorGrowSize);
     task_entry_ = new TaskEntry(task_id);
     memset(&stats_, 0, sizeof(stats_));
+    domain_ = NULL;
 }
 
 TaskGroup::~TaskGroup() {
@@ -838,6 +1034,18 @@ bool TaskGroup::IsWaitQEmpty() {
 
 void TaskGroup::ClearTaskGroupStats() {
     memset(&stats_, 0, sizeof(stats_));
+    wait_histogram_.Clear();
+    run_histogram_.Clear();
+}
+
+// Record the time the task waited to be run and the time spent in Run().
+// Samples are dropped if the clock was stepped back in between.
+void TaskGroup::RecordTaskTimes(Task *t) {
+    if (t->start_time_ < t->enqueue_time_) {
+        return;
+    }
+    wait_histogram_.Record(t->start_time_ - t->enqueue_time_);
+    run_histogram_.Record(t->run_usecs_);
 }
 
 void TaskGroup::ClearTaskStats() {
@@ -1007,7 +1215,7 @@ void TaskEntry::RunWaitQ() {
 
 void TaskEntry::RunDeferEntry() {
     TaskScheduler *scheduler = TaskScheduler::GetInstance();
-    TaskGroup *group = scheduler->GetTaskGroup(task_id_);
+    TaskGroup *group = scheduler->QueryTaskGroup(task_id_);
 
     // Sanity check
     assert(waitq_.size());
@@ -1129,12 +1337,14 @@ int TaskEntry::GetTaskDeferEntrySeqno() const {
 ////////////////////////////////////////////////////////////////////////////
 Task::Task(int task_id, int task_instance) : task_id_(task_id),
     task_instance_(task_instance), task_impl_(NULL), state_(INIT), seqno_(0),
-    task_recycle_(false), task_cancel_(false) {
+    task_recycle_(false), task_cancel_(false), enqueue_time_(0),
+    start_time_(0), run_usecs_(0) {
 }
 
 Task::Task(int task_id) : task_id_(task_id),
     task_instance_(-1), task_impl_(NULL), state_(INIT), seqno_(0),
-    task_recycle_(false), task_cancel_(false) {
+    task_recycle_(false), task_cancel_(false), enqueue_time_(0),
+    start_time_(0), run_usecs_(0) {
 }
 
 // Start execution of task
@@ -1156,3 +1366,26 @@ ostream& operator<<(ostream& out, const Task &t) {
     return out;
 }
 
+////////////////////////////////////////////////////////////////////////////
+// Implementation for class TaskHistogram
+////////////////////////////////////////////////////////////////////////////
+
+void TaskHistogram::Clear() {
+    count_ = 0;
+    total_usecs_ = 0;
+    max_usecs_ = 0;
+    memset(buckets_, 0, sizeof(buckets_));
+}
+
+void TaskHistogram::Record(uint64_t usecs) {
+    int bucket = usecs ? 64 - __builtin_clzll(usecs) : 0;
+    if (bucket >= kBucketCount) {
+        bucket = kBucketCount - 1;
+    }
+    buckets_[bucket]++;
+    count_++;
+    total_usecs_ += usecs;
+    if (usecs > max_usecs_) {
+        max_usecs_ = usecs;
+    }
+}
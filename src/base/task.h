@@ -27,6 +27,11 @@
 //
 // When there are multiple tasks ready to run, they are scheduled in their
 // order of enqueue
+//
+// Task groups that are related by policy rules, directly or through other
+// groups, form a policy domain. Scheduling decisions only involve tasks in
+// the same domain, so each domain is protected by its own lock and tasks in
+// unrelated domains are enqueued and retired in parallel.
 
 #ifndef ctrlplane_task_h
 #define ctrlplane_task_h
@@ -34,6 +39,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <map>
 #include <vector>
+#include <tbb/atomic.h>
 #include <tbb/mutex.h>
 #include <tbb/reader_writer_lock.h>
 #include <tbb/task.h>
@@ -42,6 +48,7 @@
 
 class TaskGroup;
 class TaskEntry;
+class TaskPolicyDomain;
 
 struct TaskStats {
     int     wait_count_;
@@ -49,6 +56,25 @@ struct TaskStats {
     int     defer_count_;
 };
 
+// Histogram of task wait or run times. Bucket 0 counts samples under 1 usec
+// and bucket i samples in [2^(i-1), 2^i) usecs. The last bucket also counts
+// all the longer samples.
+struct TaskHistogram {
+    static const int kBucketCount = 24;
+
+    TaskHistogram() { Clear(); }
+    void Clear();
+    void Record(uint64_t usecs);
+
+    // Exclusive upper bound of a bucket, in usecs.
+    static uint64_t BucketLimit(int bucket) { return 1ULL << bucket; }
+
+    uint64_t count_;
+    uint64_t total_usecs_;
+    uint64_t max_usecs_;
+    uint64_t buckets_[kBucketCount];
+};
+
 struct TaskExclusion {
     TaskExclusion(int task_id) : match_id(task_id), match_instance(-1) {}
     TaskExclusion(int task_id, int instance_id)
@@ -94,6 +120,7 @@ public:
 
 private:
     friend class TaskEntry;
+    friend class TaskGroup;
     friend class TaskScheduler;
     friend class TaskImpl;
     void SetSeqNo(int seqno) {seqno_ = seqno;};
@@ -109,6 +136,9 @@ private:
     uint32_t            seqno_;
     bool                task_recycle_;
     bool                task_cancel_;
+    uint64_t            enqueue_time_;  // Time of the last Enqueue
+    uint64_t            start_time_;    // Time Run() was last invoked
+    uint64_t            run_usecs_;     // Duration of the last Run()
 
     DISALLOW_COPY_AND_ASSIGN(Task);
 };
@@ -155,6 +185,18 @@ public:
     void ClearTaskStats(int task_id);
     void ClearTaskStats(int task_id, int instance_id);
 
+    // Copy the wait and run time histograms of a task group. Returns false
+    // if no task with the given id has been enqueued.
+    bool GetTaskGroupHistograms(int task_id, TaskHistogram *wait,
+                                TaskHistogram *run);
+
+    // Id of the policy domain of a task group. Task groups that are linked
+    // by exclusion policies, directly or through other groups, share one.
+    int GetPolicyDomainId(int task_id);
+
+    // Names of the task ids allocated through GetTaskId().
+    void GetTaskNames(std::vector<std::string> *names);
+
     TaskGroup *GetTaskGroup(int task_id);
     TaskGroup *QueryTaskGroup(int task_id);
     TaskEntry *GetTaskEntry(int task_id, int instance_id);
@@ -175,10 +217,13 @@ public:
 
 private:
     friend class ConcurrencyScope;
-    typedef std::vector<TaskGroup *> TaskGroupDb;
+    typedef std::vector<tbb::atomic<TaskGroup *> > TaskGroupDb;
+    typedef std::vector<TaskPolicyDomain *> TaskPolicyDomainList;
     typedef std::map<std::string, int> TaskIdMap;
 
-    static const int        kVectorGrowSize = 16;
+    // The task group table is allocated upfront so that it can be read
+    // without holding a lock.
+    static const int        kMaxTaskGroups = 4096;
     static boost::scoped_ptr<TaskScheduler> singleton_;
 
     // XXX
@@ -189,13 +234,19 @@ private:
     void ClearRunningTask();
     void WaitForTerminateCompletion();
 
-    TaskEntry               *stop_entry_;
+    // Merge the policy domains of two task groups.
+    void MergeDomains(TaskGroup *group, TaskGroup *other);
+    void GetDomains(TaskPolicyDomainList *domains);
 
     tbb::task_scheduler_init task_scheduler_;
-    tbb::mutex              mutex_;
-    bool                    running_;
-    int                     seqno_;
+    tbb::mutex              mutex_;         // Serializes SetPolicy
+    tbb::atomic<bool>       running_;
+    tbb::atomic<int>        seqno_;
+
+    // Protects creation of task groups and policy domains
+    tbb::mutex              group_mutex_;
     TaskGroupDb             task_group_db_;
+    TaskPolicyDomainList    domains_;
 
     tbb::reader_writer_lock id_map_mutex_;
     TaskIdMap               id_map_;
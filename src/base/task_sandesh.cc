@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <vector>
+
+#include "base/task.h"
+#include "base/sandesh/task_types.h"
+
+using namespace std;
+
+static void FillHistogramInfo(const TaskHistogram &histogram,
+                              TaskHistogramInfo *info) {
+    vector<uint64_t> buckets(histogram.buckets_,
+                             histogram.buckets_ + TaskHistogram::kBucketCount);
+    info->set_count(histogram.count_);
+    info->set_total_usecs(histogram.total_usecs_);
+    info->set_max_usecs(histogram.max_usecs_);
+    info->set_buckets(buckets);
+}
+
+//
+// Statistics and wait/run time histograms of the task groups. An empty task
+// name selects all the task groups that have been run.
+//
+void TaskSchedulerInfoReq::HandleRequest() const {
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    vector<string> names;
+    scheduler->GetTaskNames(&names);
+
+    vector<TaskGroupInfo> task_groups;
+    for (vector<string>::const_iterator it = names.begin();
+         it != names.end(); ++it) {
+        if (!get_task_name().empty() && get_task_name() != *it)
+            continue;
+        int task_id = scheduler->GetTaskId(*it);
+        TaskHistogram wait, run;
+        if (!scheduler->GetTaskGroupHistograms(task_id, &wait, &run))
+            continue;
+        TaskStats *stats = scheduler->GetTaskGroupStats(task_id);
+
+        TaskGroupInfo info;
+        info.set_task_name(*it);
+        info.set_task_id(task_id);
+        info.set_policy_domain(scheduler->GetPolicyDomainId(task_id));
+        info.set_defer_count(stats->defer_count_);
+        TaskHistogramInfo wait_info, run_info;
+        FillHistogramInfo(wait, &wait_info);
+        FillHistogramInfo(run, &run_info);
+        info.set_wait_time(wait_info);
+        info.set_run_time(run_info);
+        task_groups.push_back(info);
+    }
+
+    TaskSchedulerInfoResp *resp = new TaskSchedulerInfoResp;
+    resp->set_thread_count(TaskScheduler::GetThreadCount());
+    resp->set_task_groups(task_groups);
+    resp->set_context(context());
+    resp->Response();
+}
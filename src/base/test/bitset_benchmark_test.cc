@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/bitset.h"
+
+#include <stdlib.h>
+#include <strings.h>
+#include <iostream>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/util.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+//
+// Microbenchmarks for the BitSet operations used for RibPeerSets,
+// GroupPeerSets and IFMap interest sets.  Each operation is compared with
+// the plain word by word loop over a vector of blocks that BitSet used to
+// be implemented with.
+//
+class BitSetBenchmarkTest : public ::testing::Test {
+protected:
+    typedef vector<uint64_t> Blocks;
+
+    static const int kSetCount = 64;
+
+    virtual void SetUp() {
+        cout << "BitSet kernel: " << BitSet::SimdKernel() << endl;
+    }
+
+    // Build kSetCount bitsets of the given size, with 1 in density bits set.
+    static void Build(int size, int density, vector<BitSet> *sets,
+                      vector<Blocks> *blocks) {
+        srand(size);
+        sets->resize(kSetCount);
+        blocks->resize(kSetCount);
+        for (int idx = 0; idx < kSetCount; idx++) {
+            (*blocks)[idx].resize((size + 63) / 64);
+            for (int pos = 0; pos < size; pos++) {
+                if (rand() % density != 0)
+                    continue;
+                (*sets)[idx].set(pos);
+                (*blocks)[idx][pos / 64] |= 1ULL << (pos % 64);
+            }
+        }
+    }
+
+    // Find the next set bit with ffs, the way BitSet::find_next used to.
+    static size_t FindNext(const Blocks &bset, size_t pos) {
+        for (size_t idx = pos / 64; idx < bset.size(); idx++) {
+            uint64_t value = bset[idx];
+            if (idx == pos / 64)
+                value &= ~((2ULL << (pos % 64)) - 1);
+            int bit = ffs(static_cast<int>(value));
+            if (bit > 0)
+                return idx * 64 + bit - 1;
+            bit = ffs(static_cast<int>(value >> 32));
+            if (bit > 0)
+                return idx * 64 + 32 + bit - 1;
+        }
+        return BitSet::npos;
+    }
+
+    static int Iterations(int size) {
+        return 64 * 1000 * 1000 / (size + 64);
+    }
+
+    static void Report(const char *name, int size, int density,
+                       int iterations, uint64_t bitset_usecs,
+                       uint64_t blocks_usecs) {
+        cout << name << " size " << size << " density 1/" << density
+             << ": bitset " << bitset_usecs * 1000 / iterations
+             << " nsecs/op, blocks " << blocks_usecs * 1000 / iterations
+             << " nsecs/op" << endl;
+    }
+
+    static void Intersection(int size, int density) {
+        vector<BitSet> sets;
+        vector<Blocks> blocks;
+        Build(size, density, &sets, &blocks);
+        int iterations = Iterations(size);
+
+        size_t bitset_count = 0;
+        uint64_t start = UTCTimestampUsec();
+        for (int idx = 0; idx < iterations; idx++) {
+            BitSet result;
+            result.BuildIntersection(sets[idx % kSetCount],
+                                     sets[(idx + 1) % kSetCount]);
+            bitset_count += result.empty() ? 0 : 1;
+        }
+        uint64_t bitset_usecs = UTCTimestampUsec() - start;
+
+        size_t blocks_count = 0;
+        start = UTCTimestampUsec();
+        for (int idx = 0; idx < iterations; idx++) {
+            const Blocks &lhs = blocks[idx % kSetCount];
+            const Blocks &rhs = blocks[(idx + 1) % kSetCount];
+            Blocks result(lhs.size());
+            bool empty = true;
+            for (size_t bidx = 0; bidx < lhs.size(); bidx++) {
+                result[bidx] = lhs[bidx] & rhs[bidx];
+                empty = empty && result[bidx] == 0;
+            }
+            blocks_count += empty ? 0 : 1;
+        }
+        uint64_t blocks_usecs = UTCTimestampUsec() - start;
+
+        EXPECT_EQ(blocks_count, bitset_count);
+        Report("BuildIntersection", size, density, iterations,
+               bitset_usecs, blocks_usecs);
+    }
+
+    static void Complement(int size, int density) {
+        vector<BitSet> sets;
+        vector<Blocks> blocks;
+        Build(size, density, &sets, &blocks);
+        int iterations = Iterations(size);
+
+        size_t bitset_count = 0;
+        uint64_t start = UTCTimestampUsec();
+        for (int idx = 0; idx < iterations; idx++) {
+            BitSet result;
+            result.BuildComplement(sets[idx % kSetCount],
+                                   sets[(idx + 1) % kSetCount]);
+            bitset_count += result.empty() ? 0 : 1;
+        }
+        uint64_t bitset_usecs = UTCTimestampUsec() - start;
+
+        size_t blocks_count = 0;
+        start = UTCTimestampUsec();
+        for (int idx = 0; idx < iterations; idx++) {
+            const Blocks &lhs = blocks[idx % kSetCount];
+            const Blocks &rhs = blocks[(idx + 1) % kSetCount];
+            Blocks result(lhs.size());
+            bool empty = true;
+            for (size_t bidx = 0; bidx < lhs.size(); bidx++) {
+                result[bidx] = lhs[bidx] & ~rhs[bidx];
+                empty = empty && result[bidx] == 0;
+            }
+            blocks_count += empty ? 0 : 1;
+        }
+        uint64_t blocks_usecs = UTCTimestampUsec() - start;
+
+        EXPECT_EQ(blocks_count, bitset_count);
+        Report("BuildComplement", size, density, iterations,
+               bitset_usecs, blocks_usecs);
+    }
+
+    static void Union(int size, int density) {
+        vector<BitSet> sets;
+        vector<Blocks> blocks;
+        Build(size, density, &sets, &blocks);
+        int iterations = Iterations(size);
+
+        BitSet bitset_result;
+        uint64_t start = UTCTimestampUsec();
+        for (int idx = 0; idx < iterations; idx++) {
+            bitset_result |= sets[idx % kSetCount];
+        }
+        uint64_t bitset_usecs = UTCTimestampUsec() - start;
+
+        Blocks blocks_result;
+        start = UTCTimestampUsec();
+        for (int idx = 0; idx < iterations; idx++) {
+            const Blocks &rhs = blocks[idx % kSetCount];
+            if (blocks_result.size() < rhs.size())
+                blocks_result.resize(rhs.size());
+            for (size_t bidx = 0; bidx < rhs.size(); bidx++) {
+                blocks_result[bidx] |= rhs[bidx];
+            }
+        }
+        uint64_t blocks_usecs = UTCTimestampUsec() - start;
+
+        EXPECT_EQ(blocks_result.empty(), bitset_result.empty());
+        Report("Union", size, density, iterations,
+               bitset_usecs, blocks_usecs);
+    }
+
+    static void Iterate(int size, int density) {
+        vector<BitSet> sets;
+        vector<Blocks> blocks;
+        Build(size, density, &sets, &blocks);
+        int iterations = Iterations(size) / 8;
+
+        size_t bitset_count = 0;
+        uint64_t start = UTCTimestampUsec();
+        for (int idx = 0; idx < iterations; idx++) {
+            const BitSet &bitset = sets[idx % kSetCount];
+            for (size_t pos = bitset.find_first(); pos != BitSet::npos;
+                 pos = bitset.find_next(pos)) {
+                bitset_count++;
+            }
+        }
+        uint64_t bitset_usecs = UTCTimestampUsec() - start;
+
+        size_t blocks_count = 0;
+        start = UTCTimestampUsec();
+        for (int idx = 0; idx < iterations; idx++) {
+            const Blocks &bset = blocks[idx % kSetCount];
+            size_t pos = (bset[0] & 1) ? 0 : FindNext(bset, 0);
+            for (; pos != BitSet::npos; pos = FindNext(bset, pos)) {
+                blocks_count++;
+            }
+        }
+        uint64_t blocks_usecs = UTCTimestampUsec() - start;
+
+        EXPECT_EQ(blocks_count, bitset_count);
+        Report("Iterate", size, density, iterations,
+               bitset_usecs, blocks_usecs);
+    }
+
+    static void Copy(int size, int density) {
+        vector<BitSet> sets;
+        vector<Blocks> blocks;
+        Build(size, density, &sets, &blocks);
+        int iterations = Iterations(size);
+
+        size_t bitset_count = 0;
+        uint64_t start = UTCTimestampUsec();
+        for (int idx = 0; idx < iterations; idx++) {
+            BitSet temp(sets[idx % kSetCount]);
+            bitset_count += temp.empty() ? 0 : 1;
+        }
+        uint64_t bitset_usecs = UTCTimestampUsec() - start;
+
+        size_t blocks_count = 0;
+        start = UTCTimestampUsec();
+        for (int idx = 0; idx < iterations; idx++) {
+            Blocks temp(blocks[idx % kSetCount]);
+            blocks_count += temp.empty() ? 0 : 1;
+        }
+        uint64_t blocks_usecs = UTCTimestampUsec() - start;
+
+        EXPECT_LE(bitset_count, blocks_count);
+        Report("Copy", size, density, iterations,
+               bitset_usecs, blocks_usecs);
+    }
+};
+
+static const int kSizes[] = { 64, 128, 1024, 4096 };
+static const int kDensities[] = { 2, 64 };
+
+TEST_F(BitSetBenchmarkTest, Intersection) {
+    for (size_t sidx = 0; sidx < sizeof(kSizes) / sizeof(int); sidx++) {
+        for (size_t didx = 0; didx < sizeof(kDensities) / sizeof(int);
+             didx++) {
+            Intersection(kSizes[sidx], kDensities[didx]);
+        }
+    }
+}
+
+TEST_F(BitSetBenchmarkTest, Complement) {
+    for (size_t sidx = 0; sidx < sizeof(kSizes) / sizeof(int); sidx++) {
+        for (size_t didx = 0; didx < sizeof(kDensities) / sizeof(int);
+             didx++) {
+            Complement(kSizes[sidx], kDensities[didx]);
+        }
+    }
+}
+
+TEST_F(BitSetBenchmarkTest, Union) {
+    for (size_t sidx = 0; sidx < sizeof(kSizes) / sizeof(int); sidx++) {
+        for (size_t didx = 0; didx < sizeof(kDensities) / sizeof(int);
+             didx++) {
+            Union(kSizes[sidx], kDensities[didx]);
+        }
+    }
+}
+
+TEST_F(BitSetBenchmarkTest, Iterate) {
+    for (size_t sidx = 0; sidx < sizeof(kSizes) / sizeof(int); sidx++) {
+        for (size_t didx = 0; didx < sizeof(kDensities) / sizeof(int);
+             didx++) {
+            Iterate(kSizes[sidx], kDensities[didx]);
+        }
+    }
+}
+
+TEST_F(BitSetBenchmarkTest, Copy) {
+    for (size_t sidx = 0; sidx < sizeof(kSizes) / sizeof(int); sidx++) {
+        for (size_t didx = 0; didx < sizeof(kDensities) / sizeof(int);
+             didx++) {
+            Copy(kSizes[sidx], kDensities[didx]);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
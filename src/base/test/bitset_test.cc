@@ -10,7 +10,9 @@ using namespace std;
 
 class BitSetTest : public ::testing::Test {
 protected:
-    vector<uint64_t> &get_blocks(BitSet &bitset) {
+    typedef BitSet::BlockVector BlockVector;
+
+    BlockVector &get_blocks(BitSet &bitset) {
         return bitset.blocks_;
     }
 };
@@ -26,7 +28,7 @@ static int num_bits_set(uint64_t value) {
 
 TEST_F(BitSetTest, Basic) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockVector &blocks = get_blocks(bitset);
     EXPECT_EQ(bitset.size(), 0);
     EXPECT_EQ(blocks.size(), 0);
 }
@@ -35,7 +37,7 @@ TEST_F(BitSetTest, Basic) {
 TEST_F(BitSetTest, set1) {
     for (int pos = 0; pos <= 63; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockVector &blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 1);
         EXPECT_EQ(blocks[0],  1LL << pos);
@@ -47,7 +49,7 @@ TEST_F(BitSetTest, set1) {
 TEST_F(BitSetTest, set2) {
     for (int pos = 128; pos <= 191; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockVector &blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 3);
         EXPECT_EQ(blocks[0], 0 );
@@ -61,7 +63,7 @@ TEST_F(BitSetTest, set2) {
 TEST_F(BitSetTest, set3)  {
     for (int pos = 0; pos <= 1023; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockVector &blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), pos / 64 + 1);
         EXPECT_EQ(blocks[pos / 64], 1LL << (pos % 64));
@@ -72,7 +74,7 @@ TEST_F(BitSetTest, set3)  {
 // Set all bits within block idx 1 and verify.
 TEST_F(BitSetTest, set4) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockVector &blocks = get_blocks(bitset);
     for (int pos = 64; pos <= 127; pos++) {
         bitset.set(pos);
     }
@@ -85,7 +87,7 @@ TEST_F(BitSetTest, set4) {
 TEST_F(BitSetTest, reset1) {
     for (int pos = 0; pos <= 63; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockVector &blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 1);
         bitset.reset(pos);
@@ -97,7 +99,7 @@ TEST_F(BitSetTest, reset1) {
 TEST_F(BitSetTest, reset2) {
     for (int pos = 64; pos <= 127; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockVector &blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 2);
         bitset.reset(pos);
@@ -109,7 +111,7 @@ TEST_F(BitSetTest, reset2) {
 TEST_F(BitSetTest, reset3) {
     for (int pos = 0; pos <= 1023; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockVector &blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), pos / 64 + 1);
         bitset.reset(pos);
@@ -121,7 +123,7 @@ TEST_F(BitSetTest, reset3) {
 TEST_F(BitSetTest, reset4)  {
     for (int pos = 64; pos <= 127; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockVector &blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 2);
         bitset.reset(128);
@@ -133,7 +135,7 @@ TEST_F(BitSetTest, reset4)  {
 //  Set bits 0-127 and reset 0-63.
 TEST_F(BitSetTest, reset5) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockVector &blocks = get_blocks(bitset);
     for (int pos = 0; pos <= 127; pos++) {
         bitset.set(pos);
     }
@@ -150,7 +152,7 @@ TEST_F(BitSetTest, reset5) {
 //  Set bits 0-127 and reset 64-127.
 TEST_F(BitSetTest, reset6) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockVector &blocks = get_blocks(bitset);
     for (int pos = 0; pos <= 127; pos++) {
         bitset.set(pos);
     }
@@ -169,7 +171,7 @@ TEST_F(BitSetTest, reset6) {
 // Clear an empty BitSet.
 TEST_F(BitSetTest, clear1) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockVector &blocks = get_blocks(bitset);
     bitset.clear();
     EXPECT_EQ(blocks.size(), 0);
 }
@@ -178,7 +180,7 @@ TEST_F(BitSetTest, clear1) {
 // Clear BitSet with first/last bit set in each idx.
 TEST_F(BitSetTest, clear2) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockVector &blocks = get_blocks(bitset);
 
     for (int idx = 0; idx < 32; idx++) {
         bitset.set(idx * 64);
@@ -198,7 +200,7 @@ TEST_F(BitSetTest, clear2) {
 // Clear BitSet with all bits set in idx 0 thru 15.
 TEST_F(BitSetTest, clear3) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockVector &blocks = get_blocks(bitset);
     for (int pos = 0; pos < 64 * 16 ; pos++) {
         bitset.set(pos);
     }
@@ -1814,6 +1816,137 @@ TEST_F(BitSetTest, Contains6b) {
     }
 }
 
+// Bitsets of up to 128 bits don't allocate memory.
+TEST_F(BitSetTest, InlineStorage1) {
+    BitSet bitset;
+    BlockVector &blocks = get_blocks(bitset);
+    EXPECT_TRUE(blocks.is_inline());
+    for (int pos = 0; pos <= 127; pos++) {
+        bitset.set(pos);
+        EXPECT_TRUE(blocks.is_inline());
+    }
+    bitset.set(128);
+    EXPECT_FALSE(blocks.is_inline());
+    EXPECT_EQ(blocks.size(), 3);
+    EXPECT_EQ(bitset.count(), 129);
+
+    // Shrinking doesn't move the blocks back inline.
+    bitset.reset(128);
+    EXPECT_FALSE(blocks.is_inline());
+    EXPECT_EQ(blocks.size(), 2);
+    EXPECT_EQ(bitset.count(), 128);
+}
+
+// Copy and assign bitsets with inline and heap storage.
+TEST_F(BitSetTest, InlineStorage2) {
+    BitSet small, large;
+    small.set(3);
+    small.set(100);
+    for (int pos = 0; pos <= 1023; pos += 3) {
+        large.set(pos);
+    }
+
+    BitSet copy1(small);
+    EXPECT_TRUE(get_blocks(copy1).is_inline());
+    EXPECT_EQ(copy1, small);
+
+    BitSet copy2(large);
+    EXPECT_FALSE(get_blocks(copy2).is_inline());
+    EXPECT_EQ(copy2, large);
+    copy2.reset(0);
+    EXPECT_NE(copy2, large);
+    EXPECT_TRUE(large.test(0));
+
+    copy1 = large;
+    EXPECT_EQ(copy1, large);
+    copy1 = small;
+    EXPECT_EQ(copy1, small);
+    BitSet &self = copy1;
+    copy1 = self;
+    EXPECT_EQ(copy1, small);
+}
+
+// Operations where the result is also one of the operands.
+TEST_F(BitSetTest, Alias) {
+    BitSet lhs, rhs, expected;
+    for (int pos = 0; pos <= 511; pos++) {
+        if (pos % 2 == 0) lhs.set(pos);
+        if (pos % 3 == 0) rhs.set(pos);
+    }
+
+    BitSet result(lhs);
+    expected = lhs & rhs;
+    result.BuildIntersection(result, rhs);
+    EXPECT_EQ(expected, result);
+
+    result = rhs;
+    result.BuildIntersection(lhs, result);
+    EXPECT_EQ(expected, result);
+
+    result = lhs;
+    expected.BuildComplement(lhs, rhs);
+    result.BuildComplement(result, rhs);
+    EXPECT_EQ(expected, result);
+
+    result = rhs;
+    result.BuildComplement(lhs, result);
+    EXPECT_EQ(expected, result);
+}
+
+// Compare the bulk operations with bit by bit results, for bitsets with
+// all combinations of sizes up to 17 blocks.  Exercises the vector kernels
+// as well as the leftover blocks.
+TEST_F(BitSetTest, BulkOps) {
+    for (int lhs_blocks = 0; lhs_blocks <= 17; lhs_blocks++) {
+        for (int rhs_blocks = 0; rhs_blocks <= 17; rhs_blocks++) {
+            BitSet lhs, rhs;
+            for (int pos = 0; pos < lhs_blocks * 64; pos += 5) {
+                lhs.set(pos);
+            }
+            for (int pos = 0; pos < rhs_blocks * 64; pos += 7) {
+                rhs.set(pos);
+            }
+
+            BitSet result_and = lhs & rhs;
+            BitSet result_or = lhs | rhs;
+            BitSet result_andnot;
+            result_andnot.BuildComplement(lhs, rhs);
+            BitSet result_reset(lhs);
+            result_reset.Reset(rhs);
+            bool intersects = false;
+            for (int pos = 0; pos < 17 * 64; pos++) {
+                bool lbit = lhs.test(pos), rbit = rhs.test(pos);
+                EXPECT_EQ(lbit && rbit, result_and.test(pos));
+                EXPECT_EQ(lbit || rbit, result_or.test(pos));
+                EXPECT_EQ(lbit && !rbit, result_andnot.test(pos));
+                EXPECT_EQ(lbit && !rbit, result_reset.test(pos));
+                intersects = intersects || (lbit && rbit);
+            }
+            EXPECT_EQ(intersects, lhs.intersects(rhs));
+            EXPECT_TRUE(result_or.Contains(lhs));
+            EXPECT_TRUE(result_or.Contains(rhs));
+            EXPECT_EQ(result_andnot.empty(), lhs.empty() || rhs.Contains(lhs));
+        }
+    }
+}
+
+// Find set bits in a sparse bitset with many empty blocks.
+TEST_F(BitSetTest, FindSparse) {
+    BitSet bitset;
+    bitset.set(5);
+    bitset.set(64 * 9 + 17);
+    bitset.set(64 * 10);
+    bitset.set(64 * 31 + 63);
+    EXPECT_EQ(bitset.find_first(), 5);
+    EXPECT_EQ(bitset.find_next(5), 64 * 9 + 17);
+    EXPECT_EQ(bitset.find_next(64 * 9 + 17), 64 * 10);
+    EXPECT_EQ(bitset.find_next(64 * 10), 64 * 31 + 63);
+    EXPECT_EQ(bitset.find_next(64 * 31 + 63), BitSet::npos);
+
+    bitset.reset(5);
+    EXPECT_EQ(bitset.find_first(), 64 * 9 + 17);
+}
+
 
 // Verify results for empty bitset.
 TEST_F(BitSetTest, String1) {
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/lpm_index.h"
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "base/patricia.h"
+#include "base/logging.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+class Prefix {
+public:
+    Prefix(uint32_t addr, int plen)
+        : addr_(plen ? addr & (0xFFFFFFFF << (32 - plen)) : 0), plen_(plen) {
+    }
+
+    uint32_t addr() const { return addr_; }
+    int plen() const { return plen_; }
+
+    class Key {
+    public:
+        static size_t Length(const Prefix *prefix) {
+            return prefix->plen_;
+        }
+        static char ByteValue(const Prefix *prefix, size_t idx) {
+            return static_cast<char>(prefix->addr_ >> (24 - idx * 8));
+        }
+    };
+
+    Patricia::Node node_;
+
+private:
+    uint32_t addr_;
+    int plen_;
+};
+
+typedef Patricia::Tree<Prefix, &Prefix::node_, Prefix::Key> PrefixTree;
+typedef LpmIndex<Prefix, Prefix::Key> PrefixIndex;
+
+class LpmIndexTest : public ::testing::Test {
+protected:
+    virtual void TearDown() {
+        for (vector<Prefix *>::iterator it = prefixes_.begin();
+             it != prefixes_.end(); ++it) {
+            tree_.Remove(*it);
+            delete *it;
+        }
+    }
+
+    Prefix *Add(uint32_t addr, int plen) {
+        Prefix *prefix = new Prefix(addr, plen);
+        if (!tree_.Insert(prefix)) {
+            delete prefix;
+            return NULL;
+        }
+        index_.Insert(prefix);
+        prefixes_.push_back(prefix);
+        return prefix;
+    }
+
+    // Remove the way Inet4UcRouteTable does, taking the cover from the tree.
+    void Delete(Prefix *prefix) {
+        tree_.Remove(prefix);
+        Prefix *cover = NULL;
+        if (prefix->plen() > 0) {
+            Prefix key(prefix->addr(), prefix->plen() - 1);
+            cover = tree_.LPMFind(&key);
+        }
+        index_.Remove(prefix, cover);
+        prefixes_.erase(find(prefixes_.begin(), prefixes_.end(), prefix));
+        delete prefix;
+    }
+
+    Prefix *TreeFind(uint32_t addr) {
+        Prefix key(addr, 32);
+        return tree_.LPMFind(&key);
+    }
+
+    // Subnets under 10.0.0.0/8 with their hosts, the way routes are laid
+    // out in a virtual network, plus a few aggregates and a default route.
+    void Populate(size_t count) {
+        Add(0, 0);
+        while (prefixes_.size() < count) {
+            uint32_t subnet = 0x0A000000 | ((rand() & 0xFFFF) << 8);
+            if (rand() % 16 == 0)
+                Add(subnet, 16);
+            if (Add(subnet, 24) == NULL)
+                continue;
+            for (int host = 1; host < 64 && prefixes_.size() < count;
+                 host++) {
+                Add(subnet | host, 32);
+            }
+        }
+    }
+
+    static uint32_t RandomAddr() {
+        uint32_t addr = (uint32_t(rand()) << 16) ^ uint32_t(rand());
+        if (rand() % 4 != 0)
+            addr = 0x0A000000 | (addr & 0xFFFF3F);
+        return addr;
+    }
+
+    static uint64_t Now() {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec * 1000000ULL + tv.tv_usec;
+    }
+
+    PrefixTree tree_;
+    PrefixIndex index_;
+    vector<Prefix *> prefixes_;
+};
+
+TEST_F(LpmIndexTest, Empty) {
+    EXPECT_TRUE(index_.empty());
+    EXPECT_TRUE(index_.LPMFind(0x0A000001) == NULL);
+}
+
+TEST_F(LpmIndexTest, Basic) {
+    Prefix *all = Add(0, 0);
+    Prefix *net8 = Add(0x0A000000, 8);
+    Prefix *net20 = Add(0x0A011000, 20);
+    Prefix *net22 = Add(0x0A011400, 22);
+    Prefix *host = Add(0x0A011401, 32);
+
+    EXPECT_EQ(all, index_.LPMFind(0x0B000000));
+    EXPECT_EQ(net8, index_.LPMFind(0x0AFFFFFF));
+    EXPECT_EQ(net20, index_.LPMFind(0x0A011001));
+    EXPECT_EQ(net22, index_.LPMFind(0x0A011402));
+    EXPECT_EQ(host, index_.LPMFind(0x0A011401));
+
+    // The /22 reverts to the /20 in the same level, the /20 to the /8 in
+    // the level above.
+    Delete(net22);
+    EXPECT_EQ(net20, index_.LPMFind(0x0A011402));
+    EXPECT_EQ(host, index_.LPMFind(0x0A011401));
+    Delete(net20);
+    EXPECT_EQ(net8, index_.LPMFind(0x0A011402));
+    Delete(host);
+    EXPECT_EQ(net8, index_.LPMFind(0x0A011401));
+    Delete(net8);
+    EXPECT_EQ(all, index_.LPMFind(0x0A011401));
+    EXPECT_EQ(1U, index_.node_count());
+    Delete(all);
+    EXPECT_TRUE(index_.empty());
+    EXPECT_EQ(0U, index_.node_count());
+}
+
+TEST_F(LpmIndexTest, Random) {
+    srand(1);
+    for (int round = 0; round < 20; round++) {
+        while (prefixes_.size() < 2000) {
+            Add(RandomAddr() & 0xFF0FFF0F, rand() % 33);
+        }
+        for (int idx = 0; idx < 10000; idx++) {
+            uint32_t addr = RandomAddr() & 0xFF0FFF0F;
+            ASSERT_EQ(TreeFind(addr), index_.LPMFind(addr));
+        }
+        while (prefixes_.size() > 500) {
+            Delete(prefixes_[rand() % prefixes_.size()]);
+        }
+    }
+    while (!prefixes_.empty()) {
+        Delete(prefixes_.back());
+    }
+    EXPECT_TRUE(index_.empty());
+    EXPECT_EQ(0U, index_.node_count());
+}
+
+//
+// Compare the lookup rate with the patricia tree. Not part of the regular
+// run, use --gtest_also_run_disabled_tests to run it.
+//
+TEST_F(LpmIndexTest, DISABLED_Benchmark) {
+    static const size_t kRouteCounts[] = { 10000, 100000, 1000000 };
+    static const int kLookups = 1000000;
+
+    for (size_t run = 0; run < sizeof(kRouteCounts) / sizeof(size_t); run++) {
+        srand(run);
+        Populate(kRouteCounts[run]);
+        vector<uint32_t> addrs;
+        for (int idx = 0; idx < kLookups; idx++) {
+            addrs.push_back(RandomAddr());
+        }
+
+        uint64_t start = Now();
+        size_t tree_found = 0;
+        for (int idx = 0; idx < kLookups; idx++) {
+            tree_found += (TreeFind(addrs[idx])->plen() == 32);
+        }
+        uint64_t tree_usec = Now() - start;
+
+        start = Now();
+        size_t index_found = 0;
+        for (int idx = 0; idx < kLookups; idx++) {
+            index_found += (index_.LPMFind(addrs[idx])->plen() == 32);
+        }
+        uint64_t index_usec = Now() - start;
+        EXPECT_EQ(tree_found, index_found);
+
+        cout << prefixes_.size() << " routes: patricia "
+             << kLookups * 1000000ULL / (tree_usec + 1) << " lookups/sec, "
+             << "index " << kLookups * 1000000ULL / (index_usec + 1)
+             << " lookups/sec, " << index_.memory() / 1024 << " KB" << endl;
+        TearDown();
+        prefixes_.clear();
+        index_.Clear();
+    }
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
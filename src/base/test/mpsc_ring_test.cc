@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/mpsc_ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "base/logging.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+class MpscRingTest : public ::testing::Test {
+protected:
+    static const int kProducerCount = 4;
+    static const int kValueCount = 100000;
+
+    struct ProducerArgs {
+        MpscRing<uint64_t> *ring;
+        uint64_t producer;
+    };
+
+    // Encode the producer id in the upper bits of the value.
+    static void *Produce(void *arg) {
+        ProducerArgs *args = static_cast<ProducerArgs *>(arg);
+        for (uint64_t idx = 0; idx < kValueCount; ++idx) {
+            uint64_t value = (args->producer << 32) | idx;
+            while (!args->ring->TryPush(value)) {
+                sched_yield();
+            }
+        }
+        return NULL;
+    }
+};
+
+TEST_F(MpscRingTest, Basic) {
+    MpscRing<int> ring(3);
+    EXPECT_EQ(4, ring.capacity());
+    EXPECT_TRUE(ring.empty());
+
+    int value;
+    EXPECT_FALSE(ring.TryPop(&value));
+    for (int idx = 0; idx < 4; ++idx) {
+        EXPECT_TRUE(ring.TryPush(idx));
+    }
+    EXPECT_FALSE(ring.TryPush(4));
+    EXPECT_EQ(4, ring.size());
+
+    for (int idx = 0; idx < 4; ++idx) {
+        EXPECT_TRUE(ring.TryPop(&value));
+        EXPECT_EQ(idx, value);
+    }
+    EXPECT_FALSE(ring.TryPop(&value));
+    EXPECT_TRUE(ring.empty());
+}
+
+// Push and pop past the capacity several times.
+TEST_F(MpscRingTest, WrapAround) {
+    MpscRing<int> ring(8);
+    int value;
+    for (int idx = 0; idx < 100; ++idx) {
+        EXPECT_TRUE(ring.TryPush(idx));
+        EXPECT_TRUE(ring.TryPush(idx + 1000));
+        EXPECT_TRUE(ring.TryPop(&value));
+        EXPECT_EQ(idx, value);
+        EXPECT_TRUE(ring.TryPop(&value));
+        EXPECT_EQ(idx + 1000, value);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+// Values from each producer must be seen in the order they were pushed.
+TEST_F(MpscRingTest, MultipleProducers) {
+    MpscRing<uint64_t> ring(1024);
+    ProducerArgs args[kProducerCount];
+    pthread_t thread_ids[kProducerCount];
+    for (int idx = 0; idx < kProducerCount; ++idx) {
+        args[idx].ring = &ring;
+        args[idx].producer = idx;
+        pthread_create(&thread_ids[idx], NULL, &MpscRingTest::Produce,
+                       &args[idx]);
+    }
+
+    vector<uint64_t> next(kProducerCount, 0);
+    int count = 0;
+    while (count < kProducerCount * kValueCount) {
+        uint64_t value;
+        if (!ring.TryPop(&value)) {
+            sched_yield();
+            continue;
+        }
+        uint64_t producer = value >> 32;
+        ASSERT_LT(producer, static_cast<uint64_t>(kProducerCount));
+        EXPECT_EQ(next[producer], value & 0xFFFFFFFF);
+        next[producer] = (value & 0xFFFFFFFF) + 1;
+        count++;
+    }
+    for (int idx = 0; idx < kProducerCount; ++idx) {
+        pthread_join(thread_ids[idx], NULL);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/slab_allocator.h"
+
+#include <pthread.h>
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include "base/logging.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+TEST(SlabAllocatorTest, BlockSize) {
+    SlabAllocator small(1);
+    EXPECT_EQ(sizeof(void *), small.block_size());
+    SlabAllocator odd(61);
+    EXPECT_EQ(64U, odd.block_size());
+}
+
+TEST(SlabAllocatorTest, SlabSize) {
+    SlabAllocator allocator(48, 48 * 10);
+    EXPECT_EQ(0U, allocator.capacity());
+    allocator.Free(allocator.Alloc(0));
+    EXPECT_EQ(512U, allocator.capacity());
+}
+
+TEST(SlabAllocatorTest, AllocFree) {
+    SlabAllocator allocator(48, 48 * 10);
+    set<void *> blocks;
+    for (int idx = 0; idx < 25; idx++) {
+        void *ptr = allocator.Alloc(0);
+        EXPECT_TRUE(blocks.insert(ptr).second);
+        memset(ptr, 0xa5, 48);
+    }
+    EXPECT_EQ(25U, allocator.allocated());
+    EXPECT_EQ(3U, allocator.slab_count());
+
+    // Freed blocks are reused before carving out new ones.
+    void *ptr = *blocks.begin();
+    allocator.Free(ptr);
+    EXPECT_EQ(ptr, allocator.Alloc(0));
+
+    // Empty slabs are returned to the system, except for one spare.
+    for (set<void *>::iterator it = blocks.begin(); it != blocks.end(); ++it) {
+        allocator.Free(*it);
+    }
+    EXPECT_EQ(0U, allocator.allocated());
+    EXPECT_EQ(1U, allocator.slab_count());
+
+    // The spare gets used again.
+    ptr = allocator.Alloc(0);
+    EXPECT_EQ(1U, allocator.slab_count());
+    allocator.Free(ptr);
+}
+
+// A block goes back to the shard it was allocated from, whatever the shard
+// of the task that frees it.
+TEST(SlabAllocatorTest, CrossShardFree) {
+    SlabAllocator allocator(32, 32 * 4, 4);
+    void *ptr = allocator.Alloc(1);
+    allocator.Free(ptr);
+    EXPECT_EQ(0U, allocator.allocated());
+    EXPECT_EQ(1U, allocator.slab_count());
+
+    // Shards carve out their own slabs.
+    void *ptr2 = allocator.Alloc(2);
+    EXPECT_NE(ptr, ptr2);
+    EXPECT_EQ(2U, allocator.slab_count());
+    EXPECT_EQ(ptr, allocator.Alloc(1));
+    EXPECT_EQ(2U, allocator.slab_count());
+    allocator.Free(ptr);
+    allocator.Free(ptr2);
+    EXPECT_EQ(0U, allocator.allocated());
+}
+
+TEST(SizeClassAllocatorTest, Basic) {
+    SizeClassAllocator allocator(64);
+    EXPECT_EQ(0U, allocator.capacity());
+
+    void *p1 = allocator.Alloc(40);
+    void *p2 = allocator.Alloc(36);
+    void *p3 = allocator.Alloc(64);
+    EXPECT_EQ(SlabAllocator::kSlabSize * 2, allocator.capacity());
+    EXPECT_EQ(40, reinterpret_cast<char *>(p2) - reinterpret_cast<char *>(p1));
+
+    // Larger sizes go to the general purpose allocator.
+    void *p4 = allocator.Alloc(65);
+    EXPECT_EQ(SlabAllocator::kSlabSize * 2, allocator.capacity());
+
+    allocator.Free(p1, 40);
+    allocator.Free(p2, 36);
+    allocator.Free(p3, 64);
+    allocator.Free(p4, 65);
+    EXPECT_EQ(p2, allocator.Alloc(40));
+}
+
+class SlabAllocatorThreadTest : public ::testing::Test {
+protected:
+    static const int kThreadCount = 4;
+    static const int kBlockCount = 10000;
+    static const int kIterations = 20;
+
+    struct ThreadArgs {
+        SlabAllocatorThreadTest *test;
+        int shard;
+    };
+
+    SlabAllocatorThreadTest() : allocator_(24), max_slab_count_(0) {
+        pthread_barrier_init(&barrier_, NULL, kThreadCount);
+        for (int idx = 0; idx < kThreadCount; idx++) {
+            blocks_[idx].resize(kBlockCount);
+        }
+    }
+
+    ~SlabAllocatorThreadTest() {
+        pthread_barrier_destroy(&barrier_);
+    }
+
+    // Each thread allocates a batch of blocks on its own shard, and then
+    // frees the batch of the next thread, as when entries are created by
+    // one DB partition task and deleted by another.
+    static void *AllocFree(void *arg) {
+        ThreadArgs *args = static_cast<ThreadArgs *>(arg);
+        SlabAllocatorThreadTest *test = args->test;
+        vector<uint64_t *> &own = test->blocks_[args->shard];
+        vector<uint64_t *> &next =
+            test->blocks_[(args->shard + 1) % kThreadCount];
+        for (int iter = 0; iter < kIterations; iter++) {
+            for (int idx = 0; idx < kBlockCount; idx++) {
+                own[idx] = static_cast<uint64_t *>(
+                    test->allocator_.Alloc(args->shard));
+                *own[idx] = args->shard;
+            }
+            pthread_barrier_wait(&test->barrier_);
+            if (args->shard == 0) {
+                test->max_slab_count_ = max(test->max_slab_count_,
+                                            test->allocator_.slab_count());
+            }
+            for (int idx = 0; idx < kBlockCount; idx++) {
+                EXPECT_EQ(uint64_t((args->shard + 1) % kThreadCount),
+                          *next[idx]);
+                test->allocator_.Free(next[idx]);
+            }
+            pthread_barrier_wait(&test->barrier_);
+        }
+        return NULL;
+    }
+
+    SlabAllocator allocator_;
+    vector<uint64_t *> blocks_[kThreadCount];
+    pthread_barrier_t barrier_;
+    size_t max_slab_count_;
+};
+
+TEST_F(SlabAllocatorThreadTest, CrossShardChurn) {
+    pthread_t thread_ids[kThreadCount];
+    ThreadArgs args[kThreadCount];
+    for (int idx = 0; idx < kThreadCount; idx++) {
+        args[idx].test = this;
+        args[idx].shard = idx;
+        pthread_create(&thread_ids[idx], NULL, &AllocFree, &args[idx]);
+    }
+    for (int idx = 0; idx < kThreadCount; idx++) {
+        pthread_join(thread_ids[idx], NULL);
+    }
+    EXPECT_EQ(0U, allocator_.allocated());
+
+    // Each shard holds no more than the slabs for one batch, and keeps a
+    // single spare once it is all freed.
+    size_t batch_bytes = kBlockCount * allocator_.block_size();
+    size_t batch_slabs = batch_bytes / SlabAllocator::kSlabSize + 2;
+    EXPECT_LE(max_slab_count_, kThreadCount * batch_slabs);
+    EXPECT_EQ(size_t(kThreadCount), allocator_.slab_count());
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <map>
+#include <set>
+#include <vector>
+#include <boost/assign/list_of.hpp>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/test/task_test_util.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+//
+// Records the order in which tasks are started, and the number of times
+// that tasks of two excluded task groups run at the same time.
+//
+class TaskRecorder {
+public:
+    TaskRecorder() {
+        overlap_ = 0;
+    }
+
+    void AddExclusion(int task_id, int other_id) {
+        exclusions_.insert(make_pair(task_id, other_id));
+        exclusions_.insert(make_pair(other_id, task_id));
+    }
+
+    void Start(int task_id, int val) {
+        tbb::mutex::scoped_lock lock(mutex_);
+        for (map<int, int>::const_iterator it = running_.begin();
+             it != running_.end(); ++it) {
+            if (it->second && exclusions_.count(make_pair(task_id, it->first)))
+                overlap_++;
+        }
+        running_[task_id]++;
+        order_.push_back(val);
+    }
+
+    void Finish(int task_id) {
+        tbb::mutex::scoped_lock lock(mutex_);
+        running_[task_id]--;
+    }
+
+    tbb::atomic<int> overlap_;
+    vector<int> order_;
+
+private:
+    set<pair<int, int> > exclusions_;
+    map<int, int> running_;
+    tbb::mutex mutex_;
+};
+
+class RecordTask : public Task {
+public:
+    RecordTask(int task_id, int instance, TaskRecorder *recorder, int val)
+        : Task(task_id, instance), recorder_(recorder), val_(val) {
+    }
+
+    virtual bool Run() {
+        recorder_->Start(GetTaskId(), val_);
+        usleep(100);
+        recorder_->Finish(GetTaskId());
+        return true;
+    }
+
+private:
+    TaskRecorder *recorder_;
+    int val_;
+};
+
+class TaskPolicyTest : public ::testing::Test {
+protected:
+    TaskPolicyTest() : scheduler_(TaskScheduler::GetInstance()) {
+    }
+
+    virtual void TearDown() {
+        task_util::WaitForIdle();
+    }
+
+    void SetExclusion(int task_id, int other_id) {
+        TaskPolicy policy = boost::assign::list_of(TaskExclusion(other_id));
+        scheduler_->SetPolicy(task_id, policy);
+    }
+
+    TaskScheduler *scheduler_;
+};
+
+//
+// Groups linked by policies, directly or through other groups, end up in
+// the same policy domain. Other groups keep a domain of their own.
+//
+TEST_F(TaskPolicyTest, MergeDomains) {
+    int a = scheduler_->GetTaskId("TaskPolicyTest::MergeA");
+    int b = scheduler_->GetTaskId("TaskPolicyTest::MergeB");
+    int c = scheduler_->GetTaskId("TaskPolicyTest::MergeC");
+    int d = scheduler_->GetTaskId("TaskPolicyTest::MergeD");
+    int e = scheduler_->GetTaskId("TaskPolicyTest::MergeE");
+    EXPECT_NE(scheduler_->GetPolicyDomainId(a),
+              scheduler_->GetPolicyDomainId(b));
+
+    SetExclusion(a, b);
+    SetExclusion(c, d);
+    EXPECT_EQ(scheduler_->GetPolicyDomainId(a),
+              scheduler_->GetPolicyDomainId(b));
+    EXPECT_EQ(scheduler_->GetPolicyDomainId(c),
+              scheduler_->GetPolicyDomainId(d));
+    EXPECT_NE(scheduler_->GetPolicyDomainId(a),
+              scheduler_->GetPolicyDomainId(c));
+
+    SetExclusion(b, c);
+    int domain = scheduler_->GetPolicyDomainId(a);
+    EXPECT_EQ(domain, scheduler_->GetPolicyDomainId(b));
+    EXPECT_EQ(domain, scheduler_->GetPolicyDomainId(c));
+    EXPECT_EQ(domain, scheduler_->GetPolicyDomainId(d));
+    EXPECT_NE(domain, scheduler_->GetPolicyDomainId(e));
+}
+
+//
+// Tasks of excluded groups never run at the same time, with tasks enqueued
+// before and after the domains of the groups are merged.
+//
+TEST_F(TaskPolicyTest, MergeWhileRunning) {
+    static const int kTaskCount = 200;
+    int a = scheduler_->GetTaskId("TaskPolicyTest::RunA");
+    int b = scheduler_->GetTaskId("TaskPolicyTest::RunB");
+    int c = scheduler_->GetTaskId("TaskPolicyTest::RunC");
+    SetExclusion(b, c);
+
+    TaskRecorder recorder;
+    recorder.AddExclusion(a, b);
+    recorder.AddExclusion(b, c);
+    for (int idx = 0; idx < kTaskCount; idx++) {
+        scheduler_->Enqueue(new RecordTask(b, -1, &recorder, idx));
+        scheduler_->Enqueue(new RecordTask(c, -1, &recorder, idx));
+        if (idx == kTaskCount / 2)
+            SetExclusion(a, b);
+        if (idx > kTaskCount / 2)
+            scheduler_->Enqueue(new RecordTask(a, -1, &recorder, idx));
+    }
+    task_util::WaitForIdle();
+    EXPECT_EQ(kTaskCount * 3 - kTaskCount / 2 - 1, recorder.order_.size());
+    EXPECT_EQ(0, recorder.overlap_);
+    EXPECT_EQ(scheduler_->GetPolicyDomainId(a),
+              scheduler_->GetPolicyDomainId(c));
+}
+
+struct EnqueueArgs {
+    TaskScheduler *scheduler;
+    pthread_barrier_t *barrier;
+    int task_id;
+    int count;
+    TaskRecorder *recorder;
+};
+
+static void *EnqueueTasks(void *arg) {
+    EnqueueArgs *args = static_cast<EnqueueArgs *>(arg);
+    pthread_barrier_wait(args->barrier);
+    for (int idx = 0; idx < args->count; idx++) {
+        args->scheduler->Enqueue(
+            new RecordTask(args->task_id, -1, args->recorder, -1));
+    }
+    return NULL;
+}
+
+//
+// Tasks queued while the scheduler is stopped are started ahead of the tasks
+// of an excluded group that are enqueued while the scheduler is started.
+//
+TEST_F(TaskPolicyTest, StopStart) {
+    static const int kTaskCount = 32;
+    int s = scheduler_->GetTaskId("TaskPolicyTest::Stopped");
+    int t = scheduler_->GetTaskId("TaskPolicyTest::Started");
+    SetExclusion(s, t);
+
+    TaskRecorder recorder;
+    recorder.AddExclusion(s, t);
+    scheduler_->Stop();
+    for (int idx = 0; idx < kTaskCount; idx++) {
+        scheduler_->Enqueue(new RecordTask(s, -1, &recorder, idx));
+    }
+    usleep(10000);
+    EXPECT_EQ(0, recorder.order_.size());
+
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, 2);
+    EnqueueArgs args = { scheduler_, &barrier, t, kTaskCount, &recorder };
+    pthread_t thread_id;
+    pthread_create(&thread_id, NULL, &EnqueueTasks, &args);
+    pthread_barrier_wait(&barrier);
+    scheduler_->Start();
+    pthread_join(thread_id, NULL);
+    pthread_barrier_destroy(&barrier);
+    task_util::WaitForIdle();
+
+    ASSERT_EQ(2 * kTaskCount, recorder.order_.size());
+    for (int idx = 0; idx < kTaskCount; idx++) {
+        EXPECT_NE(-1, recorder.order_[idx]);
+    }
+    EXPECT_EQ(0, recorder.overlap_);
+}
+
+TEST_F(TaskPolicyTest, HistogramBuckets) {
+    TaskHistogram histogram;
+    histogram.Record(0);
+    histogram.Record(1);
+    histogram.Record(2);
+    histogram.Record(3);
+    histogram.Record(1000);
+    histogram.Record(1ULL << 40);
+
+    EXPECT_EQ(6U, histogram.count_);
+    EXPECT_EQ(1006 + (1ULL << 40), histogram.total_usecs_);
+    EXPECT_EQ(1ULL << 40, histogram.max_usecs_);
+    EXPECT_EQ(1U, histogram.buckets_[0]);
+    EXPECT_EQ(1U, histogram.buckets_[1]);
+    EXPECT_EQ(2U, histogram.buckets_[2]);
+    EXPECT_EQ(1U, histogram.buckets_[10]);
+    EXPECT_EQ(1U, histogram.buckets_[TaskHistogram::kBucketCount - 1]);
+
+    // Each sample is below the limit of its bucket, and at or above the
+    // limit of the previous one.
+    EXPECT_GT(TaskHistogram::BucketLimit(10), 1000U);
+    EXPECT_LE(TaskHistogram::BucketLimit(9), 1000U);
+
+    histogram.Clear();
+    EXPECT_EQ(0U, histogram.count_);
+    EXPECT_EQ(0U, histogram.max_usecs_);
+    EXPECT_EQ(0U, histogram.buckets_[2]);
+}
+
+TEST_F(TaskPolicyTest, GroupHistograms) {
+    static const int kTaskCount = 50;
+    int task_id = scheduler_->GetTaskId("TaskPolicyTest::Histogram");
+    TaskHistogram wait, run;
+    EXPECT_FALSE(scheduler_->GetTaskGroupHistograms(task_id, &wait, &run));
+
+    TaskRecorder recorder;
+    for (int idx = 0; idx < kTaskCount; idx++) {
+        scheduler_->Enqueue(new RecordTask(task_id, idx % 4, &recorder, idx));
+    }
+    task_util::WaitForIdle();
+
+    EXPECT_TRUE(scheduler_->GetTaskGroupHistograms(task_id, &wait, &run));
+    EXPECT_EQ(uint64_t(kTaskCount), wait.count_);
+    EXPECT_EQ(uint64_t(kTaskCount), run.count_);
+    uint64_t total = 0;
+    for (int idx = 0; idx < TaskHistogram::kBucketCount; idx++) {
+        total += run.buckets_[idx];
+    }
+    EXPECT_EQ(uint64_t(kTaskCount), total);
+
+    // Each task sleeps for 100 usecs.
+    EXPECT_GE(run.total_usecs_, uint64_t(kTaskCount) * 100);
+    EXPECT_EQ(0U, run.buckets_[0]);
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+    TaskScheduler::GetInstance()->Terminate();
+    return result;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <tbb/atomic.h>
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/util.h"
+#include "base/test/task_test_util.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+static tbb::atomic<long> run_count;
+
+class StressTask : public Task {
+public:
+    StressTask(int task_id, int instance) : Task(task_id, instance) { }
+
+    virtual bool Run() {
+        run_count++;
+        return true;
+    }
+};
+
+//
+// Measure the rate at which tasks are scheduled as producer threads are
+// added. Producers either enqueue tasks of a task id of their own, which
+// are in separate policy domains, or tasks of a shared task id with one
+// instance per producer. The number of tbb worker threads is set with
+// TBB_THREAD_COUNT, and the number of tasks per producer with
+// TASK_STRESS_COUNT.
+//
+class TaskStressTest : public ::testing::Test {
+protected:
+    static const int kTaskCount = 100 * 1000;
+
+    struct ProducerArgs {
+        int task_id;
+        int instance;
+        int count;
+    };
+
+    TaskStressTest() : scheduler_(TaskScheduler::GetInstance()) {
+        task_count_ = kTaskCount;
+        char *count_str = getenv("TASK_STRESS_COUNT");
+        if (count_str) {
+            task_count_ = strtol(count_str, NULL, 0);
+        }
+    }
+
+    static void *Produce(void *arg) {
+        ProducerArgs *args = static_cast<ProducerArgs *>(arg);
+        TaskScheduler *scheduler = TaskScheduler::GetInstance();
+        for (int idx = 0; idx < args->count; ++idx) {
+            scheduler->Enqueue(new StressTask(args->task_id, args->instance));
+        }
+        return NULL;
+    }
+
+    int TaskId(const string &prefix, int producer) {
+        ostringstream oss;
+        oss << prefix << producer;
+        return scheduler_->GetTaskId(oss.str());
+    }
+
+    // Returns the number of tasks run per second.
+    uint64_t Run(int producers, bool shared) {
+        vector<ProducerArgs> args(producers);
+        vector<pthread_t> thread_ids(producers);
+        run_count = 0;
+
+        uint64_t start = UTCTimestampUsec();
+        for (int idx = 0; idx < producers; ++idx) {
+            args[idx].task_id = shared ?
+                scheduler_->GetTaskId("stress::Shared") :
+                TaskId("stress::Producer", idx);
+            args[idx].instance = shared ? idx : Task::kTaskInstanceAny;
+            args[idx].count = task_count_;
+            pthread_create(&thread_ids[idx], NULL, &TaskStressTest::Produce,
+                           &args[idx]);
+        }
+        for (int idx = 0; idx < producers; ++idx) {
+            pthread_join(thread_ids[idx], NULL);
+        }
+        long total = long(producers) * task_count_;
+        while (run_count != total) {
+            usleep(100);
+        }
+        uint64_t elapsed = max(UTCTimestampUsec() - start, uint64_t(1));
+        task_util::WaitForIdle();
+        return uint64_t(total) * 1000000 / elapsed;
+    }
+
+    void RunBenchmark(bool shared) {
+        int max_producers = max(scheduler_->HardwareThreadCount(), 1) * 2;
+        for (int producers = 1; producers <= max_producers; producers *= 2) {
+            uint64_t rate = Run(producers, shared);
+            cout << (shared ? "Shared" : "Independent")
+                 << " producers: " << producers
+                 << " threads: " << TaskScheduler::GetThreadCount()
+                 << " rate: " << rate << " tasks/sec" << endl;
+        }
+    }
+
+    TaskScheduler *scheduler_;
+    int task_count_;
+};
+
+TEST_F(TaskStressTest, Independent) {
+    RunBenchmark(false);
+}
+
+TEST_F(TaskStressTest, Shared) {
+    RunBenchmark(true);
+}
+
+// Every task that ran must be accounted for in the histograms.
+TEST_F(TaskStressTest, Histograms) {
+    int task_id = scheduler_->GetTaskId("stress::Histogram");
+    scheduler_->ClearTaskGroupStats(task_id);
+    task_count_ = 1000;
+    ProducerArgs args = { task_id, Task::kTaskInstanceAny, task_count_ };
+    run_count = 0;
+    Produce(&args);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(task_count_, run_count);
+
+    TaskHistogram wait, run;
+    EXPECT_TRUE(scheduler_->GetTaskGroupHistograms(task_id, &wait, &run));
+    EXPECT_EQ(task_count_, wait.count_);
+    EXPECT_EQ(task_count_, run.count_);
+    uint64_t wait_count = 0, run_total = 0;
+    for (int idx = 0; idx < TaskHistogram::kBucketCount; ++idx) {
+        wait_count += wait.buckets_[idx];
+        run_total += run.buckets_[idx];
+    }
+    EXPECT_EQ(wait.count_, wait_count);
+    EXPECT_EQ(run.count_, run_total);
+    EXPECT_GE(wait.total_usecs_, wait.max_usecs_);
+
+    // Task ids that were never enqueued have no histograms.
+    int unused_id = scheduler_->GetTaskId("stress::Unused");
+    EXPECT_FALSE(scheduler_->GetTaskGroupHistograms(unused_id, &wait, &run));
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
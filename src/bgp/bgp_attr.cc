@@ -144,25 +144,32 @@ int BgpMpNlri::CompareTo(const BgpAttribute &rhs_attr) const {
 void BgpMpNlri::ToCanonical(BgpAttr *attr) {
 }
 
-int BgpAttrOList::CompareTo(const BgpAttribute &rhs_attr) const {
+int BgpOListSpec::CompareTo(const BgpAttribute &rhs_attr) const {
     int ret = BgpAttribute::CompareTo(rhs_attr);
     if (ret != 0) return ret;
-    KEY_COMPARE(olist.get(),
-            static_cast<const BgpAttrOList &>(rhs_attr).olist.get());
+    KEY_COMPARE(elements,
+            static_cast<const BgpOListSpec &>(rhs_attr).elements);
     return 0;
 }
 
-void BgpAttrOList::ToCanonical(BgpAttr *attr) {
-    attr->set_olist(olist);
+void BgpOListSpec::ToCanonical(BgpAttr *attr) {
+    attr->set_olist(this);
 }
 
-std::string BgpAttrOList::ToString() const {
+std::string BgpOListSpec::ToString() const {
     char repr[80];
-    snprintf(repr, sizeof(repr), "OList <subcode: %d> : %p",
-             subcode, olist.get());
+    snprintf(repr, sizeof(repr), "OList <subcode: %d> : %d",
+             subcode, (uint32_t)elements.size());
     return std::string(repr);
 }
 
+void BgpOList::Remove() {
+    olist_db_->Delete(this);
+}
+
+BgpOListDB::BgpOListDB(BgpServer *server) : server_(server) {
+}
+
 int BgpAttrLabelBlock::CompareTo(const BgpAttribute &rhs_attr) const {
     int ret = BgpAttribute::CompareTo(rhs_attr);
     if (ret != 0) return ret;
@@ -274,6 +281,14 @@ void BgpAttr::set_olist(BgpOListPtr olist) {
     olist_ = olist;
 }
 
+void BgpAttr::set_olist(const BgpOListSpec *olist_spec) {
+    if (olist_spec) {
+        olist_ = attr_db_->server()->olist_db()->Locate(*olist_spec);
+    } else {
+        olist_ = NULL;
+    }
+}
+
 // TODO: Return the left-most AS number in the path.
 uint32_t BgpAttr::neighbor_as() const {
     return 0;
@@ -319,31 +334,37 @@ int BgpAttr::CompareTo(const BgpAttr &rhs) const {
     return 0;
 }
 
+static void HashAddress(size_t *hash, const IpAddress &address) {
+    if (address.is_v4()) {
+        boost::hash_combine(*hash, address.to_v4().to_ulong());
+    } else {
+        Ip6Address::bytes_type bytes = address.to_v6().to_bytes();
+        boost::hash_range(*hash, bytes.begin(), bytes.end());
+    }
+}
+
+//
+// The as path, communities, extended communities and olist are themselves
+// interned, so attributes with equal contents share the same pointers. Hash
+// the pointers rather than the contents.
+//
 std::size_t hash_value(BgpAttr const &attr) {
     size_t hash = 0;
 
     boost::hash_combine(hash, attr.origin_);
-    boost::hash_combine(hash, attr.nexthop_.to_string());
+    HashAddress(&hash, attr.nexthop_);
     boost::hash_combine(hash, attr.med_);
     boost::hash_combine(hash, attr.local_pref_);
     boost::hash_combine(hash, attr.atomic_aggregate_);
     boost::hash_combine(hash, attr.aggregator_as_num_);
-    boost::hash_combine(hash, attr.aggregator_address_.to_string());
-    boost::hash_combine(hash, attr.source_rd_.ToString());
-
-    if (attr.label_block_) {
-        boost::hash_combine(hash, attr.label_block_->first());
-        boost::hash_combine(hash, attr.label_block_->last());
-    }
-
-    if (attr.olist_) {
-        boost::hash_range(hash, attr.olist_->elements.begin(),
-                          attr.olist_->elements.end());
-    }
-
-    if (attr.as_path_) boost::hash_combine(hash, *attr.as_path_);
-    if (attr.community_) boost::hash_combine(hash, *attr.community_);
-    if (attr.ext_community_) boost::hash_combine(hash, *attr.ext_community_);
+    HashAddress(&hash, attr.aggregator_address_);
+    boost::hash_range(hash, attr.source_rd_.GetData(),
+                      attr.source_rd_.GetData() + RouteDistinguisher::kSize);
+    boost::hash_combine(hash, attr.label_block_.get());
+    boost::hash_combine(hash, attr.olist_.get());
+    boost::hash_combine(hash, attr.as_path_.get());
+    boost::hash_combine(hash, attr.community_.get());
+    boost::hash_combine(hash, attr.ext_community_.get());
 
     return hash;
 }
@@ -354,31 +375,31 @@ BgpAttrDB::BgpAttrDB(BgpServer *server) : server_(server) {
 // Return a clone of attribute with updated extended community.
 BgpAttrPtr BgpAttrDB::ReplaceExtCommunityAndLocate(const BgpAttr *attr, 
                                                    ExtCommunityPtr extcomm) {
-    BgpAttr *clone = new BgpAttr(*attr);
-    clone->set_ext_community(extcomm);
+    BgpAttr clone(*attr);
+    clone.set_ext_community(extcomm);
     return Locate(clone);
 }
 
 // Return a clone of attribute with updated local preference.
 BgpAttrPtr BgpAttrDB::ReplaceLocalPreferenceAndLocate(const BgpAttr *attr, 
                                                       uint32_t local_pref) {
-    BgpAttr *clone = new BgpAttr(*attr);
-    clone->set_local_pref(local_pref);
+    BgpAttr clone(*attr);
+    clone.set_local_pref(local_pref);
     return Locate(clone);
 }
 
 // Return a clone of attribute with updated source rd.
 BgpAttrPtr BgpAttrDB::ReplaceSourceRdAndLocate(const BgpAttr *attr,
                                                RouteDistinguisher source_rd) {
-    BgpAttr *clone = new BgpAttr(*attr);
-    clone->set_source_rd(source_rd);
+    BgpAttr clone(*attr);
+    clone.set_source_rd(source_rd);
     return Locate(clone);
 }
 
 // Return a clone of attribute with updated nexthop.
 BgpAttrPtr BgpAttrDB::UpdateNexthopAndLocate(const BgpAttr *attr, uint16_t afi,
                                              uint8_t safi, IpAddress &addr) {
-    BgpAttr *clone = new BgpAttr(*attr);
-    clone->set_nexthop(addr);
+    BgpAttr clone(*attr);
+    clone.set_nexthop(addr);
     return Locate(clone);
 }
@@ -28,6 +28,7 @@
 
 class BgpAttr;
 class AsPathDB;
+class BgpOListDB;
 
 struct BgpAttrOrigin : public BgpAttribute {
     static const int kSize = 1;
@@ -162,9 +163,14 @@ public:
         : address(address), label(label) {
     }
 
+    bool operator<(const BgpOListElem &rhs) const {
+        if (address != rhs.address) return address < rhs.address;
+        return label < rhs.label;
+    }
+
     friend std::size_t hash_value(BgpOListElem const &elem) {
         size_t hash = 0;
-        boost::hash_combine(hash, elem.address.to_string());
+        boost::hash_combine(hash, elem.address.to_ulong());
         boost::hash_combine(hash, elem.label);
         return hash;
     }
@@ -173,42 +179,78 @@ public:
     uint32_t label;
 };
 
+struct BgpOListSpec : public BgpAttribute {
+    static const int kSize = 0;
+    BgpOListSpec() : BgpAttribute(0, BgpAttribute::OList, 0) {}
+    BgpOListSpec(const BgpAttribute &rhs) : BgpAttribute(rhs) {}
+    std::vector<BgpOListElem> elements;
+    virtual int CompareTo(const BgpAttribute &rhs_attr) const;
+    virtual void ToCanonical(BgpAttr *attr);
+    virtual std::string ToString() const;
+};
+
 class BgpOList {
 public:
-    BgpOList() { refcount_ = 0; }
+    explicit BgpOList(BgpOListDB *olist_db, const BgpOListSpec &spec)
+        : olist_db_(olist_db), elements_(spec.elements) {
+        refcount_ = 0;
+    }
+    explicit BgpOList(const BgpOList &rhs)
+        : olist_db_(rhs.olist_db_), elements_(rhs.elements_) {
+        refcount_ = 0;
+    }
+    virtual ~BgpOList() { }
+    virtual void Remove();
+    int CompareTo(const BgpOList &rhs) const {
+        KEY_COMPARE(elements_, rhs.elements_);
+        return 0;
+    }
+    const std::vector<BgpOListElem> &elements() const { return elements_; }
 
-    std::vector<BgpOListElem> elements;
+    friend std::size_t hash_value(BgpOList const &olist) {
+        size_t hash = 0;
+        boost::hash_range(hash, olist.elements_.begin(),
+                          olist.elements_.end());
+        return hash;
+    }
 
 private:
-    friend void intrusive_ptr_add_ref(BgpOList *olist);
-    friend void intrusive_ptr_release(BgpOList *olist);
+    friend int intrusive_ptr_add_ref(const BgpOList *colist);
+    friend int intrusive_ptr_del_ref(const BgpOList *colist);
+    friend void intrusive_ptr_release(const BgpOList *colist);
 
-    tbb::atomic<int> refcount_;
+    mutable tbb::atomic<int> refcount_;
+    BgpOListDB *olist_db_;
+    std::vector<BgpOListElem> elements_;
 };
 
-inline void intrusive_ptr_add_ref(BgpOList *olist) {
-    olist->refcount_.fetch_and_increment();
+inline int intrusive_ptr_add_ref(const BgpOList *colist) {
+    return colist->refcount_.fetch_and_increment();
+}
+
+inline int intrusive_ptr_del_ref(const BgpOList *colist) {
+    return colist->refcount_.fetch_and_decrement();
 }
 
-inline void intrusive_ptr_release(BgpOList *olist) {
-    int prev = olist->refcount_.fetch_and_decrement();
+inline void intrusive_ptr_release(const BgpOList *colist) {
+    int prev = colist->refcount_.fetch_and_decrement();
     if (prev == 1) {
+        BgpOList *olist = const_cast<BgpOList *>(colist);
+        olist->Remove();
+        assert(olist->refcount_ == 0);
         delete olist;
     }
 }
 
-typedef boost::intrusive_ptr<BgpOList> BgpOListPtr;
+typedef boost::intrusive_ptr<const BgpOList> BgpOListPtr;
 
-struct BgpAttrOList : public BgpAttribute {
-    static const int kSize = 0;
-    BgpAttrOList() : BgpAttribute(0, BgpAttribute::OList, 0) {}
-    BgpAttrOList(const BgpAttribute &rhs) : BgpAttribute(rhs) {}
-    BgpAttrOList(BgpOList *olist) :
-        BgpAttribute(0, BgpAttribute::OList, 0), olist(olist) {}
-    BgpOListPtr olist;
-    virtual int CompareTo(const BgpAttribute &rhs_attr) const;
-    virtual void ToCanonical(BgpAttr *attr);
-    virtual std::string ToString() const;
+class BgpOListDB : public BgpPathAttributeDB<BgpOList, BgpOListPtr,
+                                             BgpOListSpec, BgpOListDB> {
+public:
+    explicit BgpOListDB(BgpServer *server);
+
+private:
+    BgpServer *server_;
 };
 
 struct BgpAttrUnknown : public BgpAttribute {
@@ -258,6 +300,7 @@ public:
     void set_ext_community(const ExtCommunitySpec *extcomm);
     void set_label_block(LabelBlockPtr label_block);
     void set_olist(BgpOListPtr olist);
+    void set_olist(const BgpOListSpec *olist_spec);
     friend std::size_t hash_value(BgpAttr const &attr);
 
     BgpAttrOrigin::OriginType origin() const { return origin_; }
@@ -320,14 +363,8 @@ inline void intrusive_ptr_release(const BgpAttr *cattrp) {
 
 typedef boost::intrusive_ptr<const BgpAttr> BgpAttrPtr;
 
-struct BgpAttrCompare {
-    bool operator()(const BgpAttr *lhs, const BgpAttr *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class BgpAttrDB : public BgpPathAttributeDB<BgpAttr, BgpAttrPtr, BgpAttrSpec,
-                                            BgpAttrCompare, BgpAttrDB> {
+                                            BgpAttrDB> {
 public:
     BgpAttrDB(BgpServer *server);
     BgpAttrPtr ReplaceExtCommunityAndLocate(const BgpAttr *attr,
@@ -7,7 +7,7 @@
 
 #include <boost/functional/hash.hpp>
 #include <boost/scoped_array.hpp>
-#include <set>
+#include <algorithm>
 #include <string>
 #include <tbb/mutex.h>
 #include <vector>
@@ -69,99 +69,202 @@ struct BgpProtoPrefix : public ParseObject {
 // Base class to manage BGP Path Attributes database. This class provides
 // thread safe access to the data base.
 //
-// Lock contention can be tuned by varying the hash table size passed to the
-// constructor.
+// Attributes are interned in an open addressing hash table with linear
+// probing. Each slot records the hash of the attribute it holds, so a lookup
+// only compares the contents of attributes whose hash matches. The table is
+// split into partitions, each with its own mutex. Lock contention can be
+// tuned by varying the number of partitions passed to the constructor.
 //
-// Attribute contents must be hashable via hash_value() and hashed using
-// boost::hash_combine() to partition the attribute database.
-template <class Type, class TypePtr, class TypeSpec, typename TypeCompare,
-          class TypeDB>
+// Attribute contents must be hashable via hash_value(). Type must also be
+// copy constructible, so that an attribute built from a spec can be looked
+// up on the stack and copied to the heap only if it's not in the database.
+template <class Type, class TypePtr, class TypeSpec, class TypeDB>
 class BgpPathAttributeDB {
 public:
     BgpPathAttributeDB(int hash_size = GetHashSize()) :
-            hash_size_(hash_size), set_(new Set[hash_size]),
-            mutex_(new tbb::mutex[hash_size]) {
+            hash_size_(std::max(hash_size, 1)),
+            partitions_(new Partition[hash_size_]) {
     }
 
     size_t Size() {
         size_t size = 0;
 
         for (size_t i = 0; i < hash_size_; i++) {
-            tbb::mutex::scoped_lock lock(mutex_[i]);
-            size += set_[i].size();
+            tbb::mutex::scoped_lock lock(partitions_[i].mutex);
+            size += partitions_[i].size();
         }
         return size;
     }
 
     void Delete(Type *attr) {
         size_t hash = HashCompute(attr);
+        Partition &partition = partitions_[hash % hash_size_];
 
-        tbb::mutex::scoped_lock lock(mutex_[hash]);
-        set_[hash].erase(attr);
+        tbb::mutex::scoped_lock lock(partition.mutex);
+        partition.Remove(hash / hash_size_, attr);
     }
 
     // Locate passed in attribute in the data base based on the attr ptr.
+    // The attribute is freed if an identical one is already present.
     TypePtr Locate(Type *attr) {
-        return LocateInternal(attr);
+        return LocateInternal(attr, true);
+    }
+
+    // Locate a copy of the passed in attribute in the data base. The copy is
+    // made only if the attribute is not already present.
+    TypePtr Locate(const Type &attr) {
+        return LocateInternal(const_cast<Type *>(&attr), false);
     }
 
     // Locate passed in attribute in the data base, based on the attr spec.
     TypePtr Locate(const TypeSpec &spec) {
-        Type *attr = new Type(static_cast<TypeDB *>(this), spec);
-        return LocateInternal(attr);
+        Type attr(static_cast<TypeDB *>(this), spec);
+        return LocateInternal(&attr, false);
     }
 
 private:
-    const size_t HashCompute(Type *attr) const {
-        if (hash_size_ <= 1) return 0;
+    static const size_t kDefaultHashSize = 16;
+
+    struct Slot {
+        Slot() : hash(0), attr(NULL) { }
+        size_t hash;
+        Type *attr;
+    };
 
-        size_t hash = 0;
-        boost::hash_combine(hash, *attr);
-        return hash % hash_size_;
+    // Open addressing hash table with linear probing. Slots are freed by
+    // shifting later entries of the probe sequence back, so there are no
+    // tombstones to clean up under churn.
+    class Partition {
+    public:
+        Partition() : size_(0), slots_(kMinCapacity) { }
+
+        size_t size() const { return size_; }
+
+        Type *Find(size_t hash, const Type *attr) const {
+            size_t mask = slots_.size() - 1;
+            for (size_t idx = hash & mask; slots_[idx].attr != NULL;
+                 idx = (idx + 1) & mask) {
+                if (slots_[idx].hash == hash &&
+                    slots_[idx].attr->CompareTo(*attr) == 0) {
+                    return slots_[idx].attr;
+                }
+            }
+            return NULL;
+        }
+
+        void Insert(size_t hash, Type *attr) {
+            if ((size_ + 1) * 4 > slots_.size() * 3) {
+                Resize(slots_.size() * 2);
+            }
+            InsertSlot(hash, attr);
+            size_++;
+        }
+
+        void Remove(size_t hash, const Type *attr) {
+            size_t mask = slots_.size() - 1;
+            size_t idx = hash & mask;
+            while (slots_[idx].attr != attr) {
+                assert(slots_[idx].attr != NULL);
+                idx = (idx + 1) & mask;
+            }
+
+            // Move back entries that can no longer be reached from their
+            // home slot once this slot is empty.
+            for (size_t next = (idx + 1) & mask; slots_[next].attr != NULL;
+                 next = (next + 1) & mask) {
+                size_t home = slots_[next].hash & mask;
+                if (((next - home) & mask) >= ((next - idx) & mask)) {
+                    slots_[idx] = slots_[next];
+                    idx = next;
+                }
+            }
+            slots_[idx] = Slot();
+            size_--;
+
+            if (slots_.size() > kMinCapacity && size_ * 8 < slots_.size()) {
+                Resize(slots_.size() / 2);
+            }
+        }
+
+        tbb::mutex mutex;
+
+    private:
+        static const size_t kMinCapacity = 16;
+
+        void InsertSlot(size_t hash, Type *attr) {
+            size_t mask = slots_.size() - 1;
+            size_t idx = hash & mask;
+            while (slots_[idx].attr != NULL) {
+                idx = (idx + 1) & mask;
+            }
+            slots_[idx].hash = hash;
+            slots_[idx].attr = attr;
+        }
+
+        void Resize(size_t capacity) {
+            std::vector<Slot> slots(capacity);
+            slots_.swap(slots);
+            for (size_t i = 0; i < slots.size(); i++) {
+                if (slots[i].attr != NULL) {
+                    InsertSlot(slots[i].hash, slots[i].attr);
+                }
+            }
+        }
+
+        size_t size_;
+        std::vector<Slot> slots_;
+    };
+
+    // The hash_value() implementations combine member hashes with
+    // boost::hash_combine(), which leaves the low order bits poorly mixed
+    // for integer members. Mix the result since the low order bits select
+    // the slot.
+    size_t HashCompute(const Type *attr) const {
+        size_t value = 0;
+        boost::hash_combine(value, *attr);
+        uint64_t hash = value;
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return hash;
     }
 
     static size_t GetHashSize() {
         char *str = getenv("BGP_PATH_ATTRIBUTE_DB_HASH_SIZE");
-
-        // Use just one bucket for now.
-        if (!str) return 1;
+        if (!str) return kDefaultHashSize;
         return strtoul(str, NULL, 0);
     }
 
     // This template safely retrieves an attribute entry from its data base.
-    // If the entry is not found, it is inserted into the database.
+    // If the entry is not found, it is inserted into the database. The entry
+    // inserted is the passed in attribute if it's owned by the caller, or a
+    // copy of it otherwise.
     //
-    // If the entry is already present, then passed in entry is freed and
-    // existing entry is returned.
-    TypePtr LocateInternal(Type *attr) {
-
-        // Hash attribute contents to to avoid potential mutex contention.
+    // If the entry is already present, then passed in entry is freed if it's
+    // owned by the caller, and existing entry is returned.
+    TypePtr LocateInternal(Type *attr, bool owned) {
         size_t hash = HashCompute(attr);
+        Partition &partition = partitions_[hash % hash_size_];
+        hash /= hash_size_;
+
+        TypePtr ptr;
         while (true) {
 
             // Grab mutex to keep db access thread safe.
-            tbb::mutex::scoped_lock lock(mutex_[hash]);
-            std::pair<typename Set::iterator, bool> ret;
-
-            // Try to insert the passed entry into the database.
-            ret = set_[hash].insert(attr);
+            tbb::mutex::scoped_lock lock(partition.mutex);
+            Type *current = partition.Find(hash, attr);
+            if (current == NULL) {
+                if (!owned) {
+                    attr = new Type(*attr);
+                }
+                partition.Insert(hash, attr);
+                return TypePtr(attr);
+            }
 
             // Take a reference to prevent this entry from getting deleted.
             // Counter is automatically incremented, hence we get thread safety
             // here.
-            int prev = intrusive_ptr_add_ref(*ret.first);
-
-            // Check if passed in entry did get into the data base.
-            if (ret.second) {
-
-                // Take intrusive pointer, thereby incrementing the refcount.
-                TypePtr ptr = TypePtr(*ret.first);
-
-                // Release redundant refcount taken above to protect this entry
-                // from getting deleted, as we have now bumped up refcount above
-                intrusive_ptr_del_ref(*ret.first);
-                return ptr;
-            }
+            int prev = intrusive_ptr_add_ref(current);
 
             // Make sure that this entry, though in the database is not
             // undergoing deletion. This can happen because attribute intrusive
@@ -169,36 +272,32 @@ private:
             //
             // If the previous refcount is 0, it implies that this entry is
             // about to get deleted (after we release the mutex). In such
-            // cases, we retry inserting the passed attribute pointer into the
-            // data base.
+            // cases, we retry until the entry has been removed.
             if (prev > 0) {
 
-                // Free passed in attribute, as it is already in the database.
-                delete attr;
-
                 // Take intrusive pointer, thereby incrementing the refcount.
-                TypePtr ptr = TypePtr(*ret.first);
+                ptr = TypePtr(current);
 
                 // Release redundant refcount taken above to protect this entry
                 // from getting deleted, as we have now bumped up refcount above
-                intrusive_ptr_del_ref(*ret.first);
-                return ptr;
+                intrusive_ptr_del_ref(current);
+                break;
             }
 
             // Decrement the counter bumped up above as we can't use this entry
-            // which is above to be deleted. Instead, retry inserting the passed
-            // entry again, into the database.
-            intrusive_ptr_del_ref(*ret.first);
+            // which is about to be deleted.
+            intrusive_ptr_del_ref(current);
         }
 
-        assert(false);
-        return NULL;
+        // Free passed in attribute, as it is already in the database.
+        if (owned) {
+            delete attr;
+        }
+        return ptr;
     }
 
-    typedef std::set<Type *, TypeCompare> Set;
     size_t hash_size_;
-    boost::scoped_array<Set> set_;
-    boost::scoped_array<tbb::mutex> mutex_;
+    boost::scoped_array<Partition> partitions_;
 };
 
 #endif
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_damping.h"
+
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+//
+// Defaults recommended by RFC 2439 and used by most implementations.
+//
+BgpDampingConfig::BgpDampingConfig()
+    : enabled(false),
+      half_life(15 * 60),
+      reuse_limit(750),
+      suppress_limit(2000),
+      max_suppress_time(60 * 60),
+      withdraw_penalty(1000),
+      change_penalty(500) {
+}
+
+BgpDamping::BgpDamping(const BgpDampingConfig &config) {
+    set_config(config);
+}
+
+BgpDamping::~BgpDamping() {
+}
+
+//
+// The penalty is stored in 16 bits, so the ceiling is capped at 65535.
+//
+void BgpDamping::set_config(const BgpDampingConfig &config) {
+    config_ = config;
+    if (config_.half_life == 0)
+        config_.half_life = 1;
+    double ceiling = config_.reuse_limit *
+        pow(2.0, double(config_.max_suppress_time) / config_.half_life);
+    ceiling_ = static_cast<uint32_t>(min(ceiling, 65535.0));
+}
+
+uint32_t BgpDamping::Now() const {
+    return UTCTimestampUsec() / 1000000;
+}
+
+uint32_t BgpDamping::Penalty(const BgpDampingState &state,
+                             uint32_t now) const {
+    if (state.penalty_ == 0 || now <= state.time_)
+        return state.penalty_;
+    double elapsed = now - state.time_;
+    return static_cast<uint32_t>(
+        state.penalty_ * pow(2.0, -elapsed / config_.half_life));
+}
+
+//
+// A re-advertisement doesn't add to the penalty since the flap has been
+// accounted for when the path was withdrawn.
+//
+bool BgpDamping::Update(BgpDampingState *state, Event event, bool suppressed,
+                        uint32_t now) const {
+    uint32_t penalty = Penalty(*state, now);
+    if (event == WITHDRAW) {
+        penalty += config_.withdraw_penalty;
+    } else if (event == CHANGE) {
+        penalty += config_.change_penalty;
+    }
+    state->penalty_ = min(penalty, ceiling_);
+    state->time_ = now;
+
+    if (suppressed)
+        return state->penalty_ >= config_.reuse_limit;
+    return state->penalty_ >= config_.suppress_limit;
+}
+
+bool BgpDamping::CanReuse(const BgpDampingState &state, uint32_t now) const {
+    return Penalty(state, now) < config_.reuse_limit;
+}
+
+bool BgpDamping::CanDiscard(const BgpDampingState &state,
+                            uint32_t now) const {
+    return Penalty(state, now) < config_.reuse_limit / 2;
+}
+
+uint32_t BgpDamping::ReuseTime(const BgpDampingState &state) const {
+    return DecayTime(state, config_.reuse_limit);
+}
+
+uint32_t BgpDamping::DiscardTime(const BgpDampingState &state) const {
+    return DecayTime(state, config_.reuse_limit / 2);
+}
+
+//
+// Time at which the penalty decays below the limit. Rounded up, so that
+// the penalty is always below the limit at the returned time.
+//
+uint32_t BgpDamping::DecayTime(const BgpDampingState &state,
+                               uint32_t limit) const {
+    if (state.penalty_ < limit)
+        return state.time_;
+    double ratio = double(state.penalty_) / max(limit, 1U);
+    double elapsed = config_.half_life * log(ratio) / log(2.0);
+    return state.time_ + static_cast<uint32_t>(elapsed) + 1;
+}
+
+BgpDampingReuseList::BgpDampingReuseList(uint32_t now, uint32_t granularity,
+                                         size_t slot_count)
+    : granularity_(max(granularity, 1U)),
+      current_(now / granularity_),
+      slots_(max(slot_count, size_t(2))) {
+}
+
+void BgpDampingReuseList::Add(BgpRoute *route, uint32_t time) {
+    RouteMap::iterator loc = routes_.find(route);
+    if (loc != routes_.end()) {
+        if (loc->second.time <= time)
+            return;
+        loc->second.time = time;
+        Insert(route, &loc->second);
+        return;
+    }
+    Entry entry;
+    entry.time = time;
+    Insert(route, &entry);
+    routes_.insert(make_pair(route, entry));
+}
+
+//
+// Place the route in the slot for its time. Routes that are already due
+// go in the next slot and routes beyond the span go in the last slot.
+//
+void BgpDampingReuseList::Insert(BgpRoute *route, Entry *entry) {
+    uint32_t tick = entry->time / granularity_;
+    tick = max(tick, current_ + 1);
+    tick = min(tick, current_ + uint32_t(slots_.size()) - 1);
+    entry->tick = tick;
+    slots_[tick % slots_.size()].push_back(route);
+}
+
+void BgpDampingReuseList::Remove(BgpRoute *route) {
+    routes_.erase(route);
+}
+
+//
+// If the wheel has fallen behind by more than its span, e.g. because the
+// system clock moved, all the routes are placed again.
+//
+void BgpDampingReuseList::Advance(uint32_t now, RouteList *routes) {
+    uint32_t target = now / granularity_;
+    if (target >= current_ + slots_.size()) {
+        for (size_t idx = 0; idx < slots_.size(); ++idx) {
+            slots_[idx].clear();
+        }
+        current_ = target;
+        for (RouteMap::iterator it = routes_.begin(), next = it;
+             it != routes_.end(); it = next) {
+            ++next;
+            if (it->second.time <= now) {
+                routes->push_back(it->first);
+                routes_.erase(it);
+            } else {
+                Insert(it->first, &it->second);
+            }
+        }
+        return;
+    }
+
+    while (current_ < target) {
+        current_++;
+        RouteList slot;
+        slot.swap(slots_[current_ % slots_.size()]);
+        for (RouteList::iterator it = slot.begin(); it != slot.end(); ++it) {
+            RouteMap::iterator loc = routes_.find(*it);
+            if (loc == routes_.end() || loc->second.tick != current_)
+                continue;
+            if (loc->second.time <= now) {
+                routes->push_back(*it);
+                routes_.erase(loc);
+            } else {
+                Insert(*it, &loc->second);
+            }
+        }
+    }
+}
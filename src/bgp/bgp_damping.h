@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_bgp_damping_h
+#define ctrlplane_bgp_damping_h
+
+#include <map>
+#include <vector>
+
+#include "base/util.h"
+
+class BgpRoute;
+
+//
+// Route flap damping (RFC 2439) parameters. Times are in seconds.
+//
+// The penalty of a path is incremented when the path is withdrawn or when
+// its attributes change, and decays exponentially with the given half life.
+// A path is suppressed when its penalty goes above the suppress limit, and
+// is reused when the penalty decays below the reuse limit. The penalty is
+// capped so that a path is never suppressed for more than the max suppress
+// time after its last flap.
+//
+struct BgpDampingConfig {
+    BgpDampingConfig();
+
+    bool enabled;
+    uint32_t half_life;
+    uint32_t reuse_limit;
+    uint32_t suppress_limit;
+    uint32_t max_suppress_time;
+    uint32_t withdraw_penalty;
+    uint32_t change_penalty;
+};
+
+//
+// Damping state kept on each BgpPath. The penalty is the value at the
+// time of the last update; the current value is computed on demand.
+//
+class BgpDampingState {
+public:
+    BgpDampingState() : time_(0), penalty_(0) {
+    }
+    BgpDampingState(uint32_t time, uint16_t penalty)
+        : time_(time), penalty_(penalty) {
+    }
+
+    uint32_t time() const { return time_; }
+    uint32_t penalty() const { return penalty_; }
+    bool empty() const { return penalty_ == 0; }
+
+private:
+    friend class BgpDamping;
+
+    uint32_t time_;
+    uint16_t penalty_;
+};
+
+//
+// Penalty computations for a damping configuration.
+//
+class BgpDamping {
+public:
+    enum Event {
+        WITHDRAW,
+        READVERTISE,
+        CHANGE,
+    };
+
+    explicit BgpDamping(const BgpDampingConfig &config = BgpDampingConfig());
+    virtual ~BgpDamping();
+
+    // Must only be called when there are no paths with damping state.
+    void set_config(const BgpDampingConfig &config);
+    const BgpDampingConfig &config() const { return config_; }
+    bool enabled() const { return config_.enabled; }
+    uint32_t ceiling() const { return ceiling_; }
+
+    // Current time in seconds. Tests override it to control the clock.
+    virtual uint32_t Now() const;
+
+    // Penalty of the state at the given time.
+    uint32_t Penalty(const BgpDampingState &state, uint32_t now) const;
+
+    // Apply the penalty for the event. Returns true if the path should be
+    // suppressed, given whether it is currently suppressed.
+    bool Update(BgpDampingState *state, Event event, bool suppressed,
+                uint32_t now) const;
+
+    // A suppressed path can be reused once the penalty is below the reuse
+    // limit. The history of a withdrawn path can be discarded once the
+    // penalty is below half the reuse limit.
+    bool CanReuse(const BgpDampingState &state, uint32_t now) const;
+    bool CanDiscard(const BgpDampingState &state, uint32_t now) const;
+    uint32_t ReuseTime(const BgpDampingState &state) const;
+    uint32_t DiscardTime(const BgpDampingState &state) const;
+
+private:
+    uint32_t DecayTime(const BgpDampingState &state, uint32_t limit) const;
+
+    BgpDampingConfig config_;
+    uint32_t ceiling_;
+
+    DISALLOW_COPY_AND_ASSIGN(BgpDamping);
+};
+
+//
+// Timer wheel of routes with suppressed or withdrawn paths, ordered by the
+// time at which they need to be looked at again. There's one per table
+// partition and it is only accessed from the db::DBTable task for that
+// partition.
+//
+// Each slot covers granularity seconds. Routes that are due beyond the
+// span of the wheel are parked in the last slot and moved when the wheel
+// gets there. A route is on the wheel at most once; adding it again with
+// an earlier time moves it, and the stale slot entry is skipped.
+//
+class BgpDampingReuseList {
+public:
+    static const uint32_t kGranularity = 5;
+    static const size_t kSlotCount = 1024;
+
+    typedef std::vector<BgpRoute *> RouteList;
+
+    BgpDampingReuseList(uint32_t now, uint32_t granularity = kGranularity,
+                        size_t slot_count = kSlotCount);
+
+    // Schedule the route at the given time, unless it is already scheduled
+    // at an earlier time.
+    void Add(BgpRoute *route, uint32_t time);
+
+    // Must be called before the route is deleted.
+    void Remove(BgpRoute *route);
+
+    // Move the wheel forward and return the routes that are due.
+    void Advance(uint32_t now, RouteList *routes);
+
+    bool empty() const { return routes_.empty(); }
+    size_t size() const { return routes_.size(); }
+
+private:
+    struct Entry {
+        uint32_t time;
+        uint32_t tick;
+    };
+    typedef std::map<BgpRoute *, Entry> RouteMap;
+
+    void Insert(BgpRoute *route, Entry *entry);
+
+    uint32_t granularity_;
+    uint32_t current_;
+    std::vector<RouteList> slots_;
+    RouteMap routes_;
+
+    DISALLOW_COPY_AND_ASSIGN(BgpDampingReuseList);
+};
+
+#endif
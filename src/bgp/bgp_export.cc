@@ -9,9 +9,12 @@
 #include "bgp/bgp_ribout.h"
 #include "bgp/bgp_ribout_updates.h"
 #include "bgp/bgp_route.h"
+#include "bgp/bgp_server.h"
 #include "bgp/bgp_table.h"
 #include "bgp/bgp_update.h"
 #include "bgp/bgp_update_monitor.h"
+#include "bgp/routing-instance/routing_instance.h"
+#include "bgp/routing-instance/rtarget_group_mgr.h"
 #include "bgp/scheduling_group.h"
 #include "db/db_table_partition.h"
 
@@ -19,6 +22,30 @@ BgpExport::BgpExport(RibOut *ribout)
     : ribout_(ribout) {
 }
 
+//
+// Run export policy for the route. VPN routes are not sent to peers that
+// negotiated route target constraint unless they asked for one of the
+// route targets of the route. Such peers get withdraws if the route was
+// advertised to them earlier.
+//
+bool BgpExport::RunExportPolicy(BgpRoute *route, const RibPeerSet &peerset,
+        UpdateInfoSList &uinfo_slist) {
+    BgpTable *table = ribout_->table();
+    Address::Family family = table->family();
+    RoutingInstance *instance = table->routing_instance();
+    if ((family != Address::INETVPN && family != Address::EVPN) ||
+        instance == NULL) {
+        return table->Export(ribout_, route, peerset, uinfo_slist);
+    }
+
+    RTargetGroupMgr *mgr = instance->server()->rtarget_group_mgr();
+    RibPeerSet filtered(peerset);
+    mgr->FilterPeerSet(ribout_, route, &filtered);
+    if (filtered.empty())
+        return false;
+    return table->Export(ribout_, route, filtered, uinfo_slist);
+}
+
 //
 // The AdvertiseSList contains state that has been sent to a set of peers,
 // while the UpdateInfoSList represents state that we intend to send to a
@@ -166,8 +193,7 @@ void BgpExport::Export(DBTablePartBase *root, DBEntryBase *db_entry) {
     BgpRoute *route = static_cast<BgpRoute *>(db_entry);
     bool reach = false;
     if (!db_entry->IsDeleted() && !ribout_->PeerSet().empty()) {
-        reach = ribout_->table()->Export(ribout_, route, ribout_->PeerSet(),
-                uinfo_slist);
+        reach = RunExportPolicy(route, ribout_->PeerSet(), uinfo_slist);
     }
     assert(!reach || !uinfo_slist->empty());
 
@@ -252,6 +278,7 @@ void BgpExport::Export(DBTablePartBase *root, DBEntryBase *db_entry) {
             // If the history is empty and the route is not reachable, there
             // is nothing to withdraw. Get rid of the RouteUpdate and return.
             if (rt_update->History()->empty() && !reach) {
+                updates->InvalidateCache(db_entry);
                 db_entry->ClearState(root->parent(), ribout_->listener_id());
                 delete rt_update;
                 return;
@@ -326,8 +353,7 @@ bool BgpExport::Join(DBTablePartBase *root, const RibPeerSet &mjoin,
     // Run export policy to generate the update infos.
     BgpRoute *route = static_cast<BgpRoute *>(db_entry);
     UpdateInfoSList uinfo_slist;
-    bool reach = ribout_->table()->Export(ribout_, route, mjoin_subset,
-            uinfo_slist);
+    bool reach = RunExportPolicy(route, mjoin_subset, uinfo_slist);
     assert(!reach || !uinfo_slist->empty());
     if (!reach) {
         return true;
@@ -7,11 +7,13 @@
 
 #include <memory>
 
+class BgpRoute;
 class BgpTable;
 class DBEntryBase;
 class DBTablePartBase;
 class RibOut;
 class RibPeerSet;
+class UpdateInfoSList;
 
 class BgpExport {
 public:
@@ -33,6 +35,9 @@ public:
                DBEntryBase *db_entry);
 
 private:
+    bool RunExportPolicy(BgpRoute *route, const RibPeerSet &peerset,
+                         UpdateInfoSList &uinfo_slist);
+
     RibOut *ribout_;
 };
 
@@ -7,6 +7,9 @@
 template <>
 BgpObjectFactory *Factory<BgpObjectFactory>::singleton_ = NULL;
 
+#include "bgp/bgp_damping.h"
+FACTORY_STATIC_REGISTER(BgpObjectFactory, BgpDamping, BgpDamping);
+
 #include "bgp/bgp_export.h"
 FACTORY_STATIC_REGISTER(BgpObjectFactory, BgpExport, BgpExport);
 
@@ -8,6 +8,7 @@
 #include <boost/function.hpp>
 #include "base/factory.h"
 
+class BgpDamping;
 class BgpExport;
 class BgpInstanceConfig;
 class BgpNeighborConfig;
@@ -28,6 +29,7 @@ class RoutingInstanceMgr;
 class StateMachine;
 
 class BgpObjectFactory : public Factory<BgpObjectFactory> {
+    FACTORY_TYPE_N0(BgpObjectFactory, BgpDamping);
     FACTORY_TYPE_N1(BgpObjectFactory, BgpExport, RibOut *);
     FACTORY_TYPE_N1(BgpObjectFactory, McastTreeManager, InetMcastTable *);
     FACTORY_TYPE_N1(BgpObjectFactory, PeerCloseManager, IPeer *);
@@ -149,16 +149,15 @@ UpdateInfo *McastForwarder::GetUpdateInfo(InetMcastTable *table) {
     if (tree_links_.empty() || label_ == 0)
         return NULL;
 
-    BgpOList *olist = new BgpOList;
+    BgpOListSpec olist_spec;
     for (McastForwarderList::const_iterator it = tree_links_.begin();
          it != tree_links_.end(); ++it) {
         BgpOListElem elem((*it)->address(), (*it)->label());
-        olist->elements.push_back(elem);
+        olist_spec.elements.push_back(elem);
     }
 
-    BgpAttrOList olist_attr(olist);
     BgpAttrSpec attr_spec;
-    attr_spec.push_back(&olist_attr);
+    attr_spec.push_back(&olist_spec);
 
     BgpServer *server = table->routing_instance()->server();
     BgpAttrPtr attr = server->attr_db()->Locate(attr_spec);
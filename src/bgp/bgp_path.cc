@@ -5,36 +5,62 @@
 #include "bgp/bgp_path.h"
 #include "bgp/bgp_server.h"
 
+#include "base/slab_allocator.h"
+
+//
+// Intentionally never destroyed, since paths may still be freed while
+// static objects are being destroyed at exit.
+//
+static SizeClassAllocator *PathAllocator() {
+    static SizeClassAllocator *allocator = new SizeClassAllocator(128);
+    return allocator;
+}
+
+void *BgpPath::operator new(size_t size) {
+    return PathAllocator()->Alloc(size);
+}
+
+void BgpPath::operator delete(void *ptr, size_t size) {
+    PathAllocator()->Free(ptr, size);
+}
+
+size_t BgpPath::AllocatedBytes() {
+    return PathAllocator()->capacity();
+}
+
 std::string BgpPath::PathIdString(uint32_t path_id) {
     Ip4Address addr(path_id);
     return addr.to_string();
 }
 
-BgpPath::BgpPath() : peer_(NULL), path_id_(0), source_(BGP_XMPP), 
-    flags_(0), label_(0) {
+BgpPath::BgpPath()
+    : peer_(NULL), path_id_(0), label_(0), damping_time_(0),
+      damping_penalty_(0), flags_(0), source_(BGP_XMPP) {
 }
 
 BgpPath::BgpPath(const IPeer *peer, uint32_t path_id, PathSource src, 
                  const BgpAttrPtr ptr, uint32_t flags, uint32_t label)
-    : peer_(peer), path_id_(path_id), source_(src), attr_(ptr), 
-      flags_(flags), label_(label) {
+    : peer_(peer), attr_(ptr), path_id_(path_id), label_(label),
+      damping_time_(0), damping_penalty_(0), flags_(flags), source_(src) {
 }
 
 BgpPath::BgpPath(const IPeer *peer, PathSource src, const BgpAttrPtr ptr, 
         uint32_t flags, uint32_t label)
-    : peer_(peer), path_id_(0), source_(src), attr_(ptr), 
-      flags_(flags), label_(label) {
+    : peer_(peer), attr_(ptr), path_id_(0), label_(label),
+      damping_time_(0), damping_penalty_(0), flags_(flags), source_(src) {
 }
 
 BgpPath::BgpPath(uint32_t path_id, PathSource src, const BgpAttrPtr ptr,
         uint32_t flags, uint32_t label)
-    : peer_(NULL), path_id_(path_id), source_(src), attr_(ptr), 
-      flags_(flags), label_(label) {
+    : peer_(NULL), attr_(ptr), path_id_(path_id), label_(label),
+      damping_time_(0), damping_penalty_(0), flags_(flags), source_(src) {
 }
 
 BgpPath::BgpPath(const BgpPath &rhs) 
-    : peer_(rhs.peer_), path_id_(rhs.path_id_), source_(rhs.source_), 
-      attr_(rhs.attr_), flags_(rhs.flags_), label_(rhs.label_) {
+    : peer_(rhs.peer_), attr_(rhs.attr_), path_id_(rhs.path_id_),
+      label_(rhs.label_), damping_time_(rhs.damping_time_),
+      damping_penalty_(rhs.damping_penalty_), flags_(rhs.flags_),
+      source_(rhs.source_) {
     set_time_stamp_usecs(rhs.time_stamp_usecs());
 }
 
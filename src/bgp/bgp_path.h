@@ -9,6 +9,7 @@
 #include "route/path.h"
 #include "bgp/bgp_peer.h"
 #include "bgp/bgp_attr.h"
+#include "bgp/bgp_damping.h"
 
 class BgpTable;
 class BgpRoute;
@@ -20,6 +21,8 @@ public:
         NoNeighborAs = 1 << 1,
         Stale = 1 << 2,
         NoTunnelEncap = 1 << 3,
+        Dampened = 1 << 4,
+        History = 1 << 5,
     };
  
     // Ordered in the ascending order of path preference 
@@ -30,7 +33,11 @@ public:
     };
 
     static const uint32_t INFEASIBLE_MASK =
-        (AsPathLooped|NoNeighborAs|NoTunnelEncap);
+        (AsPathLooped|NoNeighborAs|NoTunnelEncap|Dampened|History);
+
+    // Flags that are maintained by route flap damping, as opposed to the
+    // ones that come with the route.
+    static const uint32_t DAMPING_MASK = (Dampened|History);
 
     static std::string PathIdString(uint32_t path_id);
 
@@ -76,7 +83,7 @@ public:
     }
 
     PathSource GetSource() const {
-        return source_;
+        return static_cast<PathSource>(source_);
     }
 
     // Check if the path is stale
@@ -94,6 +101,26 @@ public:
         flags_ &= ~Stale;
     }
 
+    // Check if the path is suppressed by route flap damping
+    bool IsDampened() const {
+        return ((flags_ & Dampened) != 0);
+    }
+
+    // Check if the path has been withdrawn and is only kept for its
+    // damping state
+    bool IsHistory() const {
+        return ((flags_ & History) != 0);
+    }
+
+    BgpDampingState damping_state() const {
+        return BgpDampingState(damping_time_, damping_penalty_);
+    }
+
+    void set_damping_state(const BgpDampingState &state) {
+        damping_time_ = state.time();
+        damping_penalty_ = state.penalty();
+    }
+
     virtual std::string ToString() const {
         // Dump the peer name
         return peer_ ? peer_->ToString() : "Nil";
@@ -105,13 +132,24 @@ public:
     // Select one path over other
     int PathCompare(const BgpPath &rhs, bool allow_ecmp) const;
 
+    // Paths are allocated from slabs, one per size of the derived classes.
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
+    // Bytes obtained from the system for paths.
+    static size_t AllocatedBytes();
+
 private:
+    // There are as many paths as routes times peers, so the fields are laid
+    // out without any padding.
     const IPeer *peer_;
-    uint32_t path_id_;
-    PathSource source_;
     const BgpAttrPtr attr_;
-    uint32_t flags_;
+    uint32_t path_id_;
     uint32_t label_;
+    uint32_t damping_time_;
+    uint16_t damping_penalty_;
+    uint16_t flags_ : 12;
+    uint16_t source_ : 4;
 };
 
 class BgpSecondaryPath : public BgpPath {
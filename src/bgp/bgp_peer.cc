@@ -19,6 +19,7 @@
 #include "bgp/bgp_path.h"
 #include "bgp/bgp_peer_membership.h"
 #include "bgp/bgp_proto.h"
+#include "bgp/bgp_route_stats.h"
 #include "bgp/bgp_server.h"
 #include "bgp/bgp_session.h"
 #include "bgp/state_machine.h"
@@ -30,6 +31,8 @@
 #include "bgp/l3vpn/inetvpn_table.h"
 #include "bgp/routing-instance/peer_manager.h"
 #include "bgp/routing-instance/routing_instance.h"
+#include "bgp/rtarget/rtarget_table.h"
+#include "db/db.h"
 #include "io/event_manager.h"
 #include "net/address.h"
 #include "net/bgp_af.h"
@@ -124,7 +127,7 @@ private:
 class BgpPeer::PeerStats : public IPeerDebugStats {
 public:
     explicit PeerStats(BgpPeer *peer)
-        : peer_(peer) {
+        : peer_(peer), route_change_stats_(DB::PartitionCount()) {
     }
 
     // Printable name
@@ -193,6 +196,8 @@ public:
             stats.blocked_count = socket_stats.write_blocked;
             stats.blocked_duration_usecs =
                 socket_stats.write_blocked_duration_usecs;
+            stats.syscalls = socket_stats.write_syscalls;
+            stats.syscall_bytes = socket_stats.write_syscall_bytes;
         }
     }
 
@@ -203,11 +208,17 @@ public:
     virtual void UpdateTxReachRoute(uint32_t count) {
         update_stats_[1].reach += count;
     }
+
+    virtual RouteChangeStats *route_change_stats() {
+        return &route_change_stats_;
+    }
+
 private:
     friend class BgpPeer;
     BgpPeer *peer_;
     ProtoStats proto_stats_[2];
     UpdateStats update_stats_[2];
+    RouteChangeStats route_change_stats_;
 };
 
 class BgpPeer::DeleteActor : public LifetimeActor {
@@ -293,6 +304,7 @@ BgpPeer::BgpPeer(BgpServer *server, RoutingInstance *instance,
           last_flap_(0) {
 
     refcount_ = 0;
+    rtarget_filter_ = false;
     BOOST_FOREACH(string family, config->address_families()) {
         Address::Family fmly = Address::FamilyFromString(family);
         assert(fmly != Address::UNSPEC);
@@ -427,6 +439,9 @@ bool BgpPeer::IsFamilySupported(Address::Family family) {
     case Address::EVPN:
         return MpNlriAllowed(BgpAf::L2Vpn, BgpAf::EVpn);
         break;
+    case Address::RTARGET:
+        return MpNlriAllowed(BgpAf::IPv4, BgpAf::RTarget);
+        break;
     default:
         break;
     }
@@ -543,6 +558,11 @@ void BgpPeer::RegisterAllTables() {
     PeerRibMembershipManager *membership_mgr = server_->membership_mgr();
     RoutingInstance *instance = GetRoutingInstance();
 
+    // Set before joining the VPN tables, since their RibOuts note whether
+    // the peer filters on route target membership when it joins.
+    rtarget_filter_ = IsFamilySupported(Address::RTARGET) &&
+        instance->GetTable(Address::RTARGET) != NULL;
+
     if (IsFamilySupported(Address::INET)) {
         BgpTable *table = instance->GetTable(Address::INET);
         BGP_LOG_TABLE_PEER(this, SandeshLevel::SYS_DEBUG, BGP_LOG_FLAG_TRACE,
@@ -575,6 +595,18 @@ void BgpPeer::RegisterAllTables() {
             membership_req_pending_++;
         }
     }
+
+    if (IsFamilySupported(Address::RTARGET)) {
+        BgpTable *rtarget_table = instance->GetTable(Address::RTARGET);
+        BGP_LOG_TABLE_PEER(this, SandeshLevel::SYS_DEBUG, BGP_LOG_FLAG_TRACE,
+                           rtarget_table, "Register peer with the table");
+        if (rtarget_table) {
+            membership_mgr->Register(this, rtarget_table, policy_, -1,
+             boost::bind(&BgpPeer::MembershipRequestCallback, this, _1, _2));
+            membership_req_pending_++;
+        }
+    }
+
     BgpPeerInfoData peer_info;
     peer_info.set_name(ToUVEKey());
     peer_info.set_send_state("not advertising");
@@ -589,10 +621,11 @@ void BgpPeer::SendOpen(TcpSession *session) {
     openmsg.as_num = server->autonomous_system();
     openmsg.holdtime = state_machine_->hold_time();
     openmsg.identifier = local_bgp_id_;
-    static const uint8_t cap_mp[3][4] = {
+    static const uint8_t cap_mp[4][4] = {
         { 0, BgpAf::IPv4,  0, BgpAf::Unicast },
         { 0, BgpAf::IPv4,  0, BgpAf::Vpn },
         { 0, BgpAf::L2Vpn, 0, BgpAf::EVpn },
+        { 0, BgpAf::IPv4,  0, BgpAf::RTarget },
     };
 
     BgpProto::OpenMessage::OptParam *opt_param =
@@ -619,6 +652,13 @@ void BgpPeer::SendOpen(TcpSession *session) {
                         cap_mp[2], 4);
         opt_param->capabilities.push_back(cap);
     }
+    if (LookupFamily(Address::RTARGET)) {
+        BgpProto::OpenMessage::Capability *cap =
+                new BgpProto::OpenMessage::Capability(
+                        BgpProto::OpenMessage::Capability::MpExtension,
+                        cap_mp[3], 4);
+        opt_param->capabilities.push_back(cap);
+    }
 
     if (opt_param->capabilities.size()) {
         openmsg.opt_params.push_back(opt_param);
@@ -918,6 +958,27 @@ void BgpPeer::ProcessUpdate(const BgpProto::Update *msg) {
             }
             break;
         }
+
+        case BgpAf::RTarget: {
+            RTargetTable *table =
+              static_cast<RTargetTable *>(instance->GetTable(Address::RTARGET));
+            assert(table);
+            BGP_LOG_TABLE_PEER(this, SandeshLevel::SYS_DEBUG,
+                               BGP_LOG_FLAG_SYSLOG, table,
+                               "Process BgpMpNlri::RTarget routes");
+
+            vector<BgpProtoPrefix *>::const_iterator it;
+            for (it = nlri->nlri.begin(); it < nlri->nlri.end(); it++) {
+                DBRequest req;
+                req.oper = oper;
+                if (oper == DBRequest::DB_ENTRY_ADD_CHANGE)
+                    req.data.reset(new RTargetTable::RequestData(attr, flags, 0));
+                req.key.reset(new RTargetTable::RequestKey(RTargetPrefix(**it),
+                                                           this));
+                table->Enqueue(&req);
+            }
+            break;
+        }
         default:
             continue;
         }
@@ -1073,6 +1134,11 @@ BgpAttrPtr BgpPeer::GetMpNlriNexthop(BgpMpNlri *nlri, BgpAttrPtr attr) {
             std::copy(nlri->nexthop.begin() + rdsize,
                       nlri->nexthop.end(), bt.begin());
             update_nh = true;
+        } else if (nlri->safi == BgpAf::RTarget &&
+                   nlri->nexthop.size() == bt.size()) {
+            std::copy(nlri->nexthop.begin(), nlri->nexthop.end(),
+                      bt.begin());
+            update_nh = true;
         }
     } else if (nlri->afi == BgpAf::L2Vpn) {
         if (nlri->safi == BgpAf::EVpn) {
@@ -1143,6 +1209,11 @@ static void FillSocketStats(IPeerDebugStats::SocketStats &socket_stats,
             socket_stats.blocked_duration_usecs/socket_stats.blocked_count);
         peer_socket_stats.average_blocked_duration = os.str();
     }
+    if (socket_stats.syscalls) {
+        peer_socket_stats.set_syscalls(socket_stats.syscalls);
+        peer_socket_stats.set_average_syscall_bytes(
+            socket_stats.syscall_bytes/socket_stats.syscalls);
+    }
 }
 
 void BgpPeer::FillBgpNeighborDebugState(BgpNeighborResp &resp, 
@@ -190,6 +190,10 @@ public:
 
     bool IsControlNode() const { return control_node_; }
 
+    // True if route target constraint was negotiated with the peer. VPN
+    // routes are then only advertised for the route targets it asked for.
+    bool IsRTargetFilterEnabled() const { return rtarget_filter_; }
+
 private:
     friend class BgpPeerTest;
     friend class StateMachineTest;
@@ -270,6 +274,7 @@ private:
     boost::scoped_ptr<DeleteActor> deleter_;
     LifetimeRef<BgpPeer> instance_delete_ref_;
     tbb::atomic<int> refcount_;
+    tbb::atomic<bool> rtarget_filter_;
     uint32_t flap_count_;
     uint64_t last_flap_;
 
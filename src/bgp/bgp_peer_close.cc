@@ -313,6 +313,12 @@ void PeerCloseManager::ProcessRibIn(DBTablePartBase *root, BgpRoute *rt,
         return;
     }
 
+    // History paths are only kept for route flap damping, there's nothing
+    // to retain for them.
+    if (path->IsHistory()) {
+        action = MembershipRequest::RIBIN_DELETE;
+    }
+
     switch (action) {
         case MembershipRequest::RIBIN_SWEEP:
 
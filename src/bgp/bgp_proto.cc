@@ -792,7 +792,8 @@ public:
         bool match(const BgpMpNlri *obj) {
             return 
                 (((obj->afi == BgpAf::IPv4) && (obj->safi == BgpAf::Unicast)) ||
-                 ((obj->afi == BgpAf::IPv4) && (obj->safi == BgpAf::Vpn)));
+                 ((obj->afi == BgpAf::IPv4) && (obj->safi == BgpAf::Vpn)) ||
+                 ((obj->afi == BgpAf::IPv4) && (obj->safi == BgpAf::RTarget)));
         }
     };
 
@@ -863,6 +864,9 @@ public:
             if ((obj->afi == BgpAf::IPv4) && (obj->safi == BgpAf::Vpn)) {
                 value = 0;
             }
+            if ((obj->afi == BgpAf::IPv4) && (obj->safi == BgpAf::RTarget)) {
+                value = 0;
+            }
         }
 
         static int get(BgpMpNlri *obj) {
@@ -875,6 +879,9 @@ public:
             if ((obj->afi == BgpAf::IPv4) && (obj->safi == BgpAf::Vpn)) {
                 return 0;
             }
+            if ((obj->afi == BgpAf::IPv4) && (obj->safi == BgpAf::RTarget)) {
+                return 0;
+            }
             return -1;
         }
     };
@@ -1045,8 +1052,302 @@ public:
     typedef mpl::list<BgpMarker, BgpMsgLength, BgpMsgType> Sequence;
 };
 
+//
+// Fast path decoder for UPDATE messages.
+//
+// The generic decoder walks the mpl sequences above for every element of the
+// message. It pushes a ParseContext frame for every sequence and allocates
+// a temporary BgpAttribute for every path attribute, which then gets copied
+// into the real one. UPDATEs make up almost all the messages received during
+// a full table load, so they are decoded in a single pass by the code below
+// when they only contain the common path attributes and inet-vpn or evpn
+// MP_REACH_NLRI/MP_UNREACH_NLRI. Each object in the resulting Update is
+// allocated exactly once, and the prefix lists are sized up front.
+//
+// Anything else, including all malformed messages, is left to the generic
+// decoder, which also builds the error context. The fast path must never
+// accept a message that the generic decoder rejects, and must produce the
+// same Update for the messages that it accepts.
+//
+
+//
+// Decode a list of prefixes encoded as length in bits followed by the bytes
+// of the prefix. Used for withdrawn routes, NLRI and inet-vpn MP NLRI.
+//
+static bool DecodeFastPrefixes(const uint8_t *data, size_t size,
+                               vector<BgpProtoPrefix *> *list) {
+    size_t count = 0;
+    for (size_t offset = 0; offset < size; count++) {
+        offset += 1 + (data[offset] + 7) / 8;
+        if (offset > size)
+            return false;
+    }
+
+    list->reserve(count);
+    while (size > 0) {
+        size_t bytes = (data[0] + 7) / 8;
+        BgpProtoPrefix *prefix = new BgpProtoPrefix;
+        prefix->prefixlen = data[0];
+        prefix->prefix.assign(data + 1, data + 1 + bytes);
+        list->push_back(prefix);
+        data += 1 + bytes;
+        size -= 1 + bytes;
+    }
+    return true;
+}
+
+//
+// Decode a list of evpn prefixes encoded as route type, length in bytes and
+// the bytes of the prefix.
+//
+static bool DecodeFastEvpnPrefixes(const uint8_t *data, size_t size,
+                                   vector<BgpProtoPrefix *> *list) {
+    size_t count = 0;
+    for (size_t offset = 0; offset < size; count++) {
+        if (offset + 2 > size)
+            return false;
+        offset += 2 + data[offset + 1];
+        if (offset > size)
+            return false;
+    }
+
+    list->reserve(count);
+    while (size > 0) {
+        size_t bytes = data[1];
+        BgpProtoPrefix *prefix = new BgpProtoPrefix;
+        prefix->type = data[0];
+        prefix->prefixlen = bytes * 8;
+        prefix->prefix.assign(data + 2, data + 2 + bytes);
+        list->push_back(prefix);
+        data += 2 + bytes;
+        size -= 2 + bytes;
+    }
+    return true;
+}
+
+template <class C>
+static bool FastFlagsMatch(const BgpAttribute &attr) {
+    return (attr.flags & BgpAttribute::FLAG_MASK) == C::kFlags;
+}
+
+static BgpAttribute *DecodeFastMpNlri(const BgpAttribute &attr,
+                                      const uint8_t *data, size_t size) {
+    if (!FastFlagsMatch<BgpMpNlri>(attr) || size < 3)
+        return NULL;
+    uint16_t afi = get_short(data);
+    uint8_t safi = data[2];
+    bool evpn = (afi == BgpAf::L2Vpn && safi == BgpAf::EVpn);
+    if (!evpn && (afi != BgpAf::IPv4 || safi != BgpAf::Vpn))
+        return NULL;
+    data += 3;
+    size -= 3;
+
+    // Next hop and reserved byte.
+    size_t nh_size = 0;
+    if (attr.code == BgpAttribute::MPReachNlri) {
+        if (size < 1 || size < 2 + (size_t) data[0])
+            return NULL;
+        nh_size = data[0];
+    }
+
+    BgpMpNlri *nlri = new BgpMpNlri(attr);
+    nlri->afi = afi;
+    nlri->safi = safi;
+    if (attr.code == BgpAttribute::MPReachNlri) {
+        nlri->nexthop.assign(data + 1, data + 1 + nh_size);
+        data += 2 + nh_size;
+        size -= 2 + nh_size;
+    }
+
+    bool success = evpn ?
+        DecodeFastEvpnPrefixes(data, size, &nlri->nlri) :
+        DecodeFastPrefixes(data, size, &nlri->nlri);
+    if (!success) {
+        delete nlri;
+        return NULL;
+    }
+    return nlri;
+}
+
+static BgpAttribute *DecodeFastAsPath(const BgpAttribute &attr,
+                                      const uint8_t *data, size_t size) {
+    if (!FastFlagsMatch<AsPathSpec>(attr))
+        return NULL;
+    for (size_t offset = 0; offset < size; ) {
+        if (offset + 2 > size)
+            return NULL;
+        offset += 2 + data[offset + 1] * sizeof(as_t);
+        if (offset > size)
+            return NULL;
+    }
+
+    AsPathSpec *path = new AsPathSpec(attr);
+    while (size > 0) {
+        AsPathSpec::PathSegment *segment = new AsPathSpec::PathSegment;
+        segment->path_segment_type = data[0];
+        size_t count = data[1];
+        segment->path_segment.reserve(count);
+        for (size_t idx = 0; idx < count; idx++) {
+            segment->path_segment.push_back(get_short(data + 2 + idx * 2));
+        }
+        path->path_segments.push_back(segment);
+        data += 2 + count * sizeof(as_t);
+        size -= 2 + count * sizeof(as_t);
+    }
+    return path;
+}
+
+//
+// Decode the value of a path attribute. Returns NULL if the attribute is
+// not handled by the fast path, or if it would be rejected by the generic
+// decoder.
+//
+static BgpAttribute *DecodeFastAttribute(const BgpAttribute &attr,
+                                         const uint8_t *data, size_t size) {
+    switch (attr.code) {
+    case BgpAttribute::Origin: {
+        if (!FastFlagsMatch<BgpAttrOrigin>(attr) || size != 1)
+            return NULL;
+        if (data[0] != BgpAttrOrigin::IGP && data[0] != BgpAttrOrigin::EGP &&
+            data[0] != BgpAttrOrigin::INCOMPLETE)
+            return NULL;
+        BgpAttrOrigin *origin = new BgpAttrOrigin(attr);
+        origin->origin = data[0];
+        return origin;
+    }
+    case BgpAttribute::AsPath:
+        return DecodeFastAsPath(attr, data, size);
+    case BgpAttribute::NextHop: {
+        if (!FastFlagsMatch<BgpAttrNextHop>(attr) || size != 4)
+            return NULL;
+        uint32_t value = get_value(data, 4);
+        if (value == 0)
+            return NULL;
+        BgpAttrNextHop *nexthop = new BgpAttrNextHop(attr);
+        nexthop->nexthop = value;
+        return nexthop;
+    }
+    case BgpAttribute::MultiExitDisc: {
+        if (!FastFlagsMatch<BgpAttrMultiExitDisc>(attr) || size != 4)
+            return NULL;
+        BgpAttrMultiExitDisc *med = new BgpAttrMultiExitDisc(attr);
+        med->med = get_value(data, 4);
+        return med;
+    }
+    case BgpAttribute::LocalPref: {
+        if (!FastFlagsMatch<BgpAttrLocalPref>(attr) || size != 4)
+            return NULL;
+        BgpAttrLocalPref *local_pref = new BgpAttrLocalPref(attr);
+        local_pref->local_pref = get_value(data, 4);
+        return local_pref;
+    }
+    case BgpAttribute::Communities: {
+        if (!FastFlagsMatch<CommunitySpec>(attr) || size % 4 != 0)
+            return NULL;
+        CommunitySpec *community = new CommunitySpec(attr);
+        community->communities.reserve(size / 4);
+        for (size_t offset = 0; offset < size; offset += 4) {
+            community->communities.push_back(get_value(data + offset, 4));
+        }
+        return community;
+    }
+    case BgpAttribute::ExtendedCommunities: {
+        if (!FastFlagsMatch<ExtCommunitySpec>(attr) || size % 8 != 0)
+            return NULL;
+        ExtCommunitySpec *ext_community = new ExtCommunitySpec(attr);
+        ext_community->communities.reserve(size / 8);
+        for (size_t offset = 0; offset < size; offset += 8) {
+            ext_community->communities.push_back(get_value(data + offset, 8));
+        }
+        return ext_community;
+    }
+    case BgpAttribute::MPReachNlri:
+    case BgpAttribute::MPUnreachNlri:
+        return DecodeFastMpNlri(attr, data, size);
+    case BgpAttribute::AtomicAggregate:
+    case BgpAttribute::Aggregator:
+        return NULL;
+    default: {
+        if (!(attr.flags & BgpAttribute::Optional))
+            return NULL;
+        BgpAttrUnknown *unknown = new BgpAttrUnknown(attr);
+        unknown->value.assign(data, data + size);
+        return unknown;
+    }
+    }
+}
+
+static bool DecodeFastPathAttributes(const uint8_t *data, size_t size,
+                                     vector<BgpAttribute *> *list) {
+    while (size > 0) {
+        if (size < 3)
+            return false;
+        BgpAttribute attr(data[1], data[0]);
+        size_t lensize = (attr.flags & BgpAttribute::ExtendedLength) ? 2 : 1;
+        if (size < 2 + lensize)
+            return false;
+        size_t length = get_value(data + 2, lensize);
+        data += 2 + lensize;
+        size -= 2 + lensize;
+        if (length > size)
+            return false;
+
+        BgpAttribute *value = DecodeFastAttribute(attr, data, length);
+        if (!value)
+            return false;
+        list->push_back(value);
+        data += length;
+        size -= length;
+    }
+    return true;
+}
+
+BgpProto::Update *BgpProto::Update::Decode(const uint8_t *data, size_t size) {
+    if (size < (size_t) kMinMessageSize + 4 ||
+        size > (size_t) kMaxMessageSize ||
+        get_short(data + 16) != size || data[18] != UPDATE) {
+        return NULL;
+    }
+    for (int idx = 0; idx < 16; idx++) {
+        if (data[idx] != 0xff)
+            return NULL;
+    }
+    data += kMinMessageSize;
+    size -= kMinMessageSize;
+
+    size_t withdrawn_size = get_short(data);
+    if (withdrawn_size + 4 > size)
+        return NULL;
+    size_t attr_size = get_short(data + 2 + withdrawn_size);
+    if (withdrawn_size + attr_size + 4 > size)
+        return NULL;
+    const uint8_t *withdrawn = data + 2;
+    const uint8_t *attr = withdrawn + withdrawn_size + 2;
+    const uint8_t *nlri = attr + attr_size;
+    size_t nlri_size = size - withdrawn_size - attr_size - 4;
+
+    Update *update = new Update;
+    if (!DecodeFastPrefixes(withdrawn, withdrawn_size,
+                            &update->withdrawn_routes) ||
+        !DecodeFastPathAttributes(attr, attr_size,
+                                  &update->path_attributes) ||
+        !DecodeFastPrefixes(nlri, nlri_size, &update->nlri)) {
+        delete update;
+        return NULL;
+    }
+    return update;
+}
+
 BgpProto::BgpMessage *BgpProto::Decode(const uint8_t *data, size_t size,
-                                       ParseErrorContext *ec) {
+                                       ParseErrorContext *ec,
+                                       bool update_fast_path) {
+    if (update_fast_path && size > (size_t) kMinMessageSize &&
+        data[18] == UPDATE) {
+        Update *update = Update::Decode(data, size);
+        if (update)
+            return update;
+    }
+
     ParseContext context;
     int result = BgpProtocol::Parse(data, size, &context, (void *) NULL);
     if (result < 0) {
@@ -278,6 +278,12 @@ public:
     	~Update();
         int Validate(const BgpPeer *, std::string &data);
         int CompareTo(const Update &rhs) const;
+
+        // Fast path decoder for a complete UPDATE message, header included.
+        // Returns NULL if the message uses attributes or address families
+        // that the fast path doesn't handle, or if it's malformed in any
+        // way. The generic decoder must then be used to decode the message
+        // or to find out what's wrong with it.
         static BgpProto::Update *Decode(const uint8_t *data, size_t size);
 
         std::vector <BgpProtoPrefix *> withdrawn_routes;
@@ -289,8 +295,11 @@ public:
     static const int kMinMessageSize = 19;
     static const int kMaxMessageSize = 4096;
 
+    // UPDATE messages are decoded with Update::Decode if possible. The
+    // fast path can be turned off to always use the generic decoder.
     static BgpMessage *Decode(const uint8_t *data, size_t size,
-                              ParseErrorContext *ec = NULL);
+                              ParseErrorContext *ec = NULL,
+                              bool update_fast_path = true);
 
     static int Encode(const BgpMessage *msg, uint8_t *data, size_t size,
                       EncodeOffsets *offsets = NULL);
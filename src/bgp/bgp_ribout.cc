@@ -9,6 +9,7 @@
 #include "bgp/bgp_ribout_updates.h"
 #include "bgp/bgp_export.h"
 #include "bgp/bgp_factory.h"
+#include "bgp/bgp_peer.h"
 #include "bgp/bgp_route.h"
 #include "bgp/bgp_table.h"
 #include "bgp/bgp_update.h"
@@ -223,10 +224,21 @@ void RibOut::RegisterListener() {
 // to an existing SchedulingGroup or multiple SchedulingGroup could be
 // merged.
 //
+// A BGP peer that negotiated the route target family only gets the VPN
+// routes it has interest in. Note it here once, so that the export path
+// does not need to figure it out again for each route.
+//
 void RibOut::Register(IPeerUpdate *peer) {
     PeerState *ps = state_map_.Locate(peer);
     assert(ps != NULL);
     active_peerset_.set(ps->index);
+    if (IsEncodingBgp()) {
+        BgpPeer *bgp_peer = dynamic_cast<BgpPeer *>(peer);
+        if (bgp_peer && bgp_peer->IsRTargetFilterEnabled()) {
+            ps->rtarget_peer = bgp_peer;
+            rtarget_peerset_.set(ps->index);
+        }
+    }
     mgr_->Join(this, peer);
 }
 
@@ -242,6 +254,7 @@ void RibOut::Unregister(IPeerUpdate *peer) {
     PeerState *ps = state_map_.Find(peer);
     assert(ps != NULL);
     assert(!active_peerset_.test(ps->index));
+    rtarget_peerset_.reset(ps->index);
     state_map_.Remove(peer, ps->index);
     mgr_->Leave(this, peer);
 
@@ -314,6 +327,26 @@ const RibPeerSet &RibOut::PeerSet() const {
     return active_peerset_;
 }
 
+//
+// Return the RibPeerSet of the peers that filter routes on their route
+// target membership.
+//
+const RibPeerSet &RibOut::RTargetFilterPeerSet() const {
+    return rtarget_peerset_;
+}
+
+//
+// Return the peer whose route target membership filters the routes sent
+// to the specified bit index, or NULL if there's no filtering for it.
+//
+const IPeer *RibOut::GetRTargetFilterPeer(int index) const {
+    PeerState *ps = state_map_.At(index);
+    if (ps != NULL) {
+        return ps->rtarget_peer;
+    }
+    return NULL;
+}
+
 //
 // Return the peer corresponding to the specified bit index.
 //
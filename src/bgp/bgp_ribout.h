@@ -107,6 +107,7 @@ public:
     bool IsReachable() const { return attr_out_.get() != NULL; }
     bool operator==(const RibOutAttr &rhs) const { return CompareTo(rhs) == 0; }
     bool operator!=(const RibOutAttr &rhs) const { return CompareTo(rhs) != 0; }
+    int CompareTo(const RibOutAttr &rhs) const;
 
     const NextHopList &nexthop_list() const { return nexthop_list_; }
     const BgpAttr *attr() const { return attr_out_.get(); }
@@ -121,8 +122,6 @@ public:
     }
 
 private:
-    int CompareTo(const RibOutAttr &rhs) const;
-
     BgpAttrPtr attr_out_;
     NextHopList nexthop_list_;
 };
@@ -340,6 +339,11 @@ public:
     // Returns a bitmask with all the peers that are advertising this RibOut.
     const RibPeerSet &PeerSet() const;
 
+    // Returns a bitmask with the peers that filter routes on their route
+    // target membership, and the peer to look up that membership for.
+    const RibPeerSet &RTargetFilterPeerSet() const;
+    const IPeer *GetRTargetFilterPeer(int index) const;
+
     BgpTable* table() const { return table_; }
     
     const RibExportPolicy &ExportPolicy() const { return policy_; }
@@ -362,11 +366,13 @@ public:
 
 private:
     struct PeerState {
-        PeerState(IPeerUpdate *key) : peer(key), index(-1) {
+        PeerState(IPeerUpdate *key)
+            : peer(key), index(-1), rtarget_peer(NULL) {
         }
         void set_index(int idx) { index = idx; }
         IPeerUpdate *peer;
         int index;
+        const IPeer *rtarget_peer;
     };
     typedef IndexMap<IPeerUpdate *, PeerState, RibPeerSet> PeerStateMap;
     BgpTable *table_;
@@ -374,6 +380,7 @@ private:
     RibExportPolicy policy_;
     PeerStateMap state_map_;
     RibPeerSet active_peerset_;
+    RibPeerSet rtarget_peerset_;
     int listener_id_;
     boost::scoped_ptr<RibOutUpdates> updates_;
     boost::scoped_ptr<BgpExport> bgp_export_;
@@ -4,29 +4,40 @@
 
 #include "bgp/bgp_ribout_updates.h"
 
+#include <boost/bind.hpp>
+
 #include "base/logging.h"
 #include "base/task_annotations.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_peer.h"
 #include "bgp/bgp_route.h"
+#include "bgp/bgp_server.h"
+#include "bgp/bgp_table.h"
 #include "bgp/bgp_update_queue.h"
 #include "bgp/bgp_update_monitor.h"
 #include "bgp/message_builder.h"
 #include "bgp/scheduling_group.h"
+#include "bgp/routing-instance/routing_instance.h"
 
+using boost::shared_ptr;
 using namespace std;
 
 //
 // Create a new RibOutUpdates.  Also create the necessary UpdateQueue and
 // add them to the vector.
 //
-RibOutUpdates::RibOutUpdates(RibOut *ribout) : ribout_(ribout) {
+RibOutUpdates::RibOutUpdates(RibOut *ribout)
+    : ribout_(ribout), cache_(NULL), cache_generation_(0) {
     for (int i = 0; i < QCOUNT; i++) {
-        UpdateQueue *queue = new UpdateQueue(i);
+        UpdateQueue *queue =
+            new UpdateQueue(i, ribout->table()->dwell_stats());
         queue_vec_.push_back(queue);
     }
     monitor_.reset(new RibUpdateMonitor(ribout, &queue_vec_));
     builder_ = MessageBuilder::GetInstance(ribout->ExportPolicy().encoding);
+    RoutingInstance *rtinstance = ribout->table()->routing_instance();
+    if (rtinstance && rtinstance->server())
+        cache_ = rtinstance->server()->update_cache();
 }
 
 //
@@ -105,11 +116,38 @@ bool RibOutUpdates::DequeueCommon(UpdateMarker *marker, RouteUpdate *rt_update,
             continue;
         }
 
-        // Generate the update and merge additional updates into that message.
-        auto_ptr<Message> message(
-            builder_->Create(table, &uinfo->roattr, rt_update->route()));
-        UpdatePack(rt_update->queue_id(), message.get(), uinfo, msgset);
-        message->Finish();
+        // Use a cached message if it has the same updates that we would
+        // pack into a new one.  Otherwise generate the update and merge
+        // additional updates into that message.
+        shared_ptr<Message> message;
+        UpdateCache::EntryPtr entry;
+        RibExportPolicy::Encoding encoding = ribout_->ExportPolicy().encoding;
+        if (cache_) {
+            entry = cache_->Find(encoding, rt_update->route(), uinfo->roattr);
+        }
+        if (entry && UpdateCachePack(rt_update->queue_id(), uinfo, msgset,
+                                     entry->packed)) {
+            message = entry->message;
+        } else {
+            uint64_t generation = 0;
+            if (cache_) {
+                tbb::mutex::scoped_lock lock(cache_mutex_);
+                generation = cache_generation_;
+            }
+            UpdateCache::RouteAttrList packed;
+            message.reset(
+                builder_->Create(table, &uinfo->roattr, rt_update->route()));
+            UpdatePack(rt_update->queue_id(), message.get(), uinfo, msgset,
+                       cache_ ? &packed : NULL);
+            message->Finish();
+            if (cache_) {
+                tbb::mutex::scoped_lock lock(cache_mutex_);
+                if (generation == cache_generation_) {
+                    cache_->Add(encoding, rt_update->route(), uinfo->roattr,
+                                message, packed);
+                }
+            }
+        }
 
         // Send the message to the target RibPeerSet.
         RibPeerSet msg_blocked;
@@ -338,8 +376,12 @@ bool RibOutUpdates::PeerDequeue(int queue_id, IPeerUpdate *peer,
 // caller, we should only add prefixes that need to go to all the peers in
 // the msgset.
 //
+// The routes that get added are appended to the packed list, if one is
+// provided, so that the message can be added to the UpdateCache.
+//
 void RibOutUpdates::UpdatePack(int queue_id, Message *message,
-        UpdateInfo *start_uinfo, const RibPeerSet &msgset) {
+        UpdateInfo *start_uinfo, const RibPeerSet &msgset,
+        UpdateCache::RouteAttrList *packed) {
     CHECK_CONCURRENCY("bgp::SendTask");
 
     UpdateInfo *uinfo, *next_uinfo;
@@ -367,6 +409,10 @@ void RibOutUpdates::UpdatePack(int queue_id, Message *message,
         if (!success) {
             break;
         }
+        if (packed) {
+            packed->push_back(
+                UpdateCache::RouteAttr(update->route(), uinfo->roattr));
+        }
 
         // First clear the advertised bits as represented by msgset from
         // the target RibPeerSet in the UpdateInfo. If the target is now
@@ -382,6 +428,74 @@ void RibOutUpdates::UpdatePack(int queue_id, Message *message,
     }
 }
 
+//
+// Concurrency: Called in the context of the scheduling group task.
+//
+// Counterpart of UpdatePack for a message from the UpdateCache.  Go through
+// the UpdateInfo elements with the same attribute as start_uinfo and check
+// that the ones that need to go to all peers in the msgset are the routes in
+// the packed list of the cached message, in the same order.  If they are,
+// clear the advertised bits for them as if they had been packed into the
+// message.
+//
+// The RouteUpdates are kept locked till they have all been checked, so that
+// the export processing can't dequeue them in the meantime.
+//
+// Return false if the cached message can't be used, in which case none of
+// the UpdateInfo elements are modified.
+//
+bool RibOutUpdates::UpdateCachePack(int queue_id, UpdateInfo *start_uinfo,
+        const RibPeerSet &msgset, const UpdateCache::RouteAttrList &packed) {
+    CHECK_CONCURRENCY("bgp::SendTask");
+
+    vector<RouteUpdatePtr *> update_list;
+    vector<UpdateInfo *> uinfo_list;
+    RouteUpdatePtr *skipped = NULL;
+    UpdateCache::RouteAttrList::const_iterator it = packed.begin();
+    UpdateInfo *uinfo = start_uinfo;
+    while (it != packed.end()) {
+
+        // Release a skipped RouteUpdate only after moving past it.
+        UpdateInfo *next_uinfo;
+        RouteUpdatePtr *update = new RouteUpdatePtr(
+            monitor_->GetAttrNext(queue_id, uinfo, &next_uinfo));
+        delete skipped;
+        skipped = NULL;
+        if (update->get() == NULL) {
+            delete update;
+            break;
+        }
+        uinfo = next_uinfo;
+        if (!uinfo->target.Contains(msgset)) {
+            skipped = update;
+            continue;
+        }
+        update_list.push_back(update);
+        uinfo_list.push_back(uinfo);
+        if ((*update)->route() != it->route || uinfo->roattr != it->roattr)
+            break;
+        ++it;
+    }
+
+    delete skipped;
+
+    bool match = (it == packed.end());
+    for (size_t idx = 0; idx < update_list.size(); ++idx) {
+        RouteUpdatePtr *update = update_list[idx];
+        if (match) {
+            UpdateInfo *packed_uinfo = uinfo_list[idx];
+            bool empty =
+                ClearAdvertisedBits(update->get(), packed_uinfo, msgset);
+            if (empty && (*update)->RemoveUpdateInfo(packed_uinfo)) {
+                ClearUpdate(update);
+            }
+        }
+        delete update;
+    }
+
+    return match;
+}
+
 //
 // Concurrency: Called in the context of the scheduling group task.
 //
@@ -389,16 +503,68 @@ void RibOutUpdates::UpdatePack(int queue_id, Message *message,
 // message to each of them.  Update the blocked RibPeerSet with peers that
 // become blocked after sending the message.
 //
+// If the SchedulingGroup has multiple send workers and there are enough
+// peers, the peers are divided into shards based on their index and the
+// shards are sent to in parallel.  This returns only after the message has
+// been sent to all peers, so the order of messages to each peer is the same
+// as with a single worker.
+//
 void RibOutUpdates::UpdateSend(Message *message, const RibPeerSet &dst,
         RibPeerSet *blocked) {
     CHECK_CONCURRENCY("bgp::SendTask");
 
+    SchedulingGroup *group = ribout_->GetSchedulingGroup();
+    int count = group ? group->SendShardCount(dst) : 1;
+    if (count == 1) {
+        UpdateSendPeers(message, dst, NULL, blocked);
+        return;
+    }
+
+    vector<RibPeerSet> shard_dst(count);
+    vector<RibPeerSet> shard_blocked(count);
+    for (size_t bit = dst.find_first(); bit != RibPeerSet::npos;
+         bit = dst.find_next(bit)) {
+        shard_dst[bit % count].set(bit);
+    }
+    group->SendShards(count, boost::bind(&RibOutUpdates::UpdateSendShard,
+        this, message, &shard_dst, &shard_blocked, _1));
+    for (int idx = 0; idx < count; idx++) {
+        *blocked |= shard_blocked[idx];
+    }
+}
+
+//
+// Concurrency: Called in the context of the scheduling group task or one of
+// its send workers.
+//
+void RibOutUpdates::UpdateSendShard(Message *message,
+        const vector<RibPeerSet> *shard_dst, vector<RibPeerSet> *shard_blocked,
+        int shard) {
+    string buffer;
+    UpdateSendPeers(message, shard_dst->at(shard), &buffer,
+                    &shard_blocked->at(shard));
+}
+
+//
+// Send the message to the peers in the RibPeerSet.  If a buffer is given,
+// the message is formatted into the buffer for each peer so that it can be
+// sent to other peers at the same time.
+//
+void RibOutUpdates::UpdateSendPeers(Message *message, const RibPeerSet &dst,
+        string *buffer, RibPeerSet *blocked) {
+    CHECK_CONCURRENCY("bgp::SendTask");
+
     RibOut::PeerIterator iter(ribout_, dst);
     while (iter.HasNext()) {
         int ix_current = iter.index();
         IPeerUpdate *peer = iter.Next();
         size_t msgsize;
-        const uint8_t *data = message->GetData(peer, &msgsize);
+        const uint8_t *data;
+        if (buffer) {
+            data = message->GetDataBuffered(peer, &msgsize, buffer);
+        } else {
+            data = message->GetData(peer, &msgsize);
+        }
         bool more = peer->SendUpdate(data, msgsize);
         if (!more) {
             blocked->set(ix_current);
@@ -571,3 +737,19 @@ void RibOutUpdates::QueueLeave(int queue_id, int bit) {
     UpdateQueue *queue = queue_vec_[queue_id];
     queue->Leave(bit);
 }
+
+//
+// Concurrency: Called in the context of the routing table partition task or
+// the scheduling group task.
+//
+// Remove the cached messages that contain the route.  Must be called before
+// the listener state for the route is cleared, since the route can get freed
+// after that.
+//
+void RibOutUpdates::InvalidateCache(DBEntryBase *db_entry) {
+    if (!cache_)
+        return;
+    tbb::mutex::scoped_lock lock(cache_mutex_);
+    cache_generation_++;
+    cache_->Invalidate(static_cast<BgpRoute *>(db_entry));
+}
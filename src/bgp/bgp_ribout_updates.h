@@ -5,7 +5,10 @@
 #ifndef ctrlplane_bgp_ribout_updates_h
 #define ctrlplane_bgp_ribout_updates_h
 
+#include <tbb/mutex.h>
+
 #include "bgp/bgp_ribout.h"
+#include "bgp/bgp_update_cache.h"
 
 class BgpTable;
 class Message;
@@ -30,6 +33,12 @@ struct UpdateMarker;
 // all the concurrency constraints.  There's an exception for UpdateMarker
 // which are accessed directly through the UpdateQueue.
 //
+// Messages that get built are added to the UpdateCache of the BgpServer, if
+// there's one, so that they can be reused by other RibOuts or by peers that
+// dequeue the same updates later.  The cache entries for a route must be
+// invalidated via InvalidateCache before the listener state for the route
+// gets cleared.
+//
 class RibOutUpdates {
 public:
     typedef std::vector<UpdateQueue *> QueueVec;
@@ -64,8 +73,14 @@ public:
 
     QueueVec &queue_vec() { return queue_vec_; }
 
+    UpdateCache *update_cache() { return cache_; }
+
+    // Remove all cached messages that contain the route.
+    void InvalidateCache(DBEntryBase *db_entry);
+
     // Testing only
     void SetMessageBuilder(MessageBuilder *builder) { builder_ = builder; }
+    void SetUpdateCache(UpdateCache *cache) { cache_ = cache; }
 
 private:
     friend class RibOutUpdatesTest;
@@ -75,11 +90,22 @@ private:
     
     // Add additional updates.
     void UpdatePack(int queue_id, Message *message, UpdateInfo *start_uinfo,
-                    const RibPeerSet &isect);
+                    const RibPeerSet &isect,
+                    UpdateCache::RouteAttrList *packed);
+
+    // Clear the advertised bits for the updates packed into a cached message.
+    bool UpdateCachePack(int queue_id, UpdateInfo *start_uinfo,
+                         const RibPeerSet &msgset,
+                         const UpdateCache::RouteAttrList &packed);
 
     // Transmit the updates to a set of peers.
     void UpdateSend(Message *message, const RibPeerSet &dst,
                     RibPeerSet *blocked);
+    void UpdateSendShard(Message *message,
+                         const std::vector<RibPeerSet> *shard_dst,
+                         std::vector<RibPeerSet> *shard_blocked, int shard);
+    void UpdateSendPeers(Message *message, const RibPeerSet &dst,
+                         std::string *buffer, RibPeerSet *blocked);
 
     // Remove the advertised bits on an update. This updates the history
     // information. Returns true if the UpdateInfo should be deleted.
@@ -95,8 +121,14 @@ private:
 
     RibOut *ribout_;
     MessageBuilder *builder_;
+    UpdateCache *cache_;
     QueueVec queue_vec_;
     boost::scoped_ptr<RibUpdateMonitor> monitor_;
+
+    // Incremented on every cache invalidation, so that messages built while
+    // the state for one of their routes got cleared are not cached.
+    tbb::mutex cache_mutex_;
+    uint64_t cache_generation_;
     DISALLOW_COPY_AND_ASSIGN(RibOutUpdates);
 };
 
@@ -10,14 +10,16 @@
 #include <sandesh/sandesh.h>
 
 #include "bgp/bgp_attr.h"
+#include "bgp/bgp_damping.h"
 #include "bgp/bgp_path.h"
 #include "bgp/bgp_peer_types.h"
+#include "bgp/bgp_server.h"
 #include "bgp/bgp_table.h"
 #include "bgp/origin-vn/origin_vn.h"
 #include "bgp/routing-instance/routing_instance.h"
 #include "bgp/security_group/security_group.h"
 #include "bgp/tunnel_encap/tunnel_encap.h"
-
+#include "base/slab_allocator.h"
 
 BgpRoute::BgpRoute() {
 }
@@ -25,6 +27,26 @@ BgpRoute::BgpRoute() {
 BgpRoute::~BgpRoute() {
 }
 
+//
+// Intentionally never destroyed, like the one for paths.
+//
+static SizeClassAllocator *RouteAllocator() {
+    static SizeClassAllocator *allocator = new SizeClassAllocator(256);
+    return allocator;
+}
+
+void *BgpRoute::operator new(size_t size) {
+    return RouteAllocator()->Alloc(size);
+}
+
+void BgpRoute::operator delete(void *ptr, size_t size) {
+    RouteAllocator()->Free(ptr, size);
+}
+
+size_t BgpRoute::AllocatedBytes() {
+    return RouteAllocator()->capacity();
+}
+
 //
 // Return the best path for this route.
 //
@@ -309,6 +331,12 @@ void BgpRoute::FillRouteInfo(BgpTable *table, ShowRoute *show_route) {
         srp.set_next_hop(attr->nexthop().to_string());
         srp.set_label(path->GetLabel());
         srp.set_flags(path->GetFlags());
+        if (!path->damping_state().empty()) {
+            const BgpDamping *damping =
+                table->routing_instance()->server()->damping();
+            srp.set_damping_penalty(damping->Penalty(path->damping_state(),
+                                                     damping->Now()));
+        }
         srp.set_last_modified(integerToString(UTCUsecToPTime(path->time_stamp_usecs())));
         if (path->IsReplicated()) {
             const BgpSecondaryPath *replicated;
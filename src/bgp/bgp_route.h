@@ -114,6 +114,14 @@ public:
 
     // Fill info needed for introspect
     void FillRouteInfo(BgpTable *table, ShowRoute *show_route);
+
+    // Routes are allocated from slabs, one per size of the derived classes.
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
+    // Bytes obtained from the system for routes.
+    static size_t AllocatedBytes();
+
 private:
 
     DISALLOW_COPY_AND_ASSIGN(BgpRoute);
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_route_stats.h"
+
+RouteChangeStats::Counters::Counters() {
+    for (int op = 0; op < OPERATION_COUNT; op++) {
+        count[op] = 0;
+    }
+}
+
+RouteChangeStats::RouteChangeStats(int partition_count)
+    : partitions_(partition_count), last_sample_usecs_(0) {
+}
+
+void RouteChangeStats::GetCounters(Counters *counters) const {
+    *counters = Counters();
+    for (std::vector<Partition>::const_iterator it = partitions_.begin();
+         it != partitions_.end(); ++it) {
+        for (int op = 0; op < OPERATION_COUNT; op++) {
+            counters->count[op] += it->counters.count[op];
+        }
+    }
+}
+
+//
+// The rates are 0 for the first sample.
+//
+void RouteChangeStats::Sample(uint64_t now_usecs, Counters *counters,
+                              Counters *rates) {
+    GetCounters(counters);
+    *rates = Counters();
+    if (last_sample_usecs_ != 0 && now_usecs > last_sample_usecs_) {
+        uint64_t elapsed_usecs = now_usecs - last_sample_usecs_;
+        for (int op = 0; op < OPERATION_COUNT; op++) {
+            uint64_t delta = counters->count[op] - last_counters_.count[op];
+            rates->count[op] = delta * 1000000 / elapsed_usecs;
+        }
+    }
+    last_counters_ = *counters;
+    last_sample_usecs_ = now_usecs;
+}
+
+UpdateDwellStats::UpdateDwellStats()
+    : last_samples_(0), last_total_usecs_(0) {
+    samples_ = 0;
+    total_usecs_ = 0;
+    max_usecs_ = 0;
+}
+
+void UpdateDwellStats::Record(uint64_t dwell_usecs) {
+    samples_++;
+    total_usecs_ += dwell_usecs;
+    uint64_t max_usecs = max_usecs_;
+    while (dwell_usecs > max_usecs) {
+        uint64_t prev = max_usecs_.compare_and_swap(dwell_usecs, max_usecs);
+        if (prev == max_usecs)
+            break;
+        max_usecs = prev;
+    }
+}
+
+void UpdateDwellStats::Sample(Snapshot *snapshot) {
+    uint64_t samples = samples_;
+    uint64_t total_usecs = total_usecs_;
+    snapshot->samples = samples - last_samples_;
+    snapshot->average_usecs = snapshot->samples ?
+        (total_usecs - last_total_usecs_) / snapshot->samples : 0;
+    snapshot->max_usecs = max_usecs_.fetch_and_store(0);
+    last_samples_ = samples;
+    last_total_usecs_ = total_usecs;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_bgp_route_stats_h
+#define ctrlplane_bgp_route_stats_h
+
+#include <vector>
+
+#include <tbb/atomic.h>
+
+#include "base/util.h"
+
+//
+// Counters of route adds, changes and deletes, e.g. for a table or for the
+// paths of a peer.
+//
+// The counters are kept per DB partition. All the partitions with the same
+// index, across all tables, are processed by the same db::DBTable task
+// instance, which never runs concurrently with itself. So the counters are
+// updated with plain increments, and each partition is on a separate cache
+// line. Readers sum up the partitions without locking; the totals may lag
+// behind by a few updates.
+//
+class RouteChangeStats {
+public:
+    enum Operation {
+        ADD,
+        CHANGE,
+        DELETE,
+        OPERATION_COUNT
+    };
+
+    struct Counters {
+        Counters();
+        uint64_t count[OPERATION_COUNT];
+    };
+
+    explicit RouteChangeStats(int partition_count);
+
+    void Increment(int part_id, Operation op) {
+        partitions_[part_id].counters.count[op]++;
+    }
+
+    void GetCounters(Counters *counters) const;
+
+    // Get the counters, and the rates per second since the previous call.
+    // Must only be called from one task, typically the periodic logger.
+    void Sample(uint64_t now_usecs, Counters *counters, Counters *rates);
+
+private:
+    static const size_t kCacheLineSize = 64;
+
+    struct Partition {
+        Counters counters;
+        char padding[kCacheLineSize - sizeof(Counters)];
+    };
+
+    std::vector<Partition> partitions_;
+    Counters last_counters_;
+    uint64_t last_sample_usecs_;
+
+    DISALLOW_COPY_AND_ASSIGN(RouteChangeStats);
+};
+
+//
+// Time spent by RouteUpdates on the UpdateQueues of a table. Each queue
+// only samples one in every kSampleInterval dequeues, which keeps reading
+// the clock off the common path. The queues of a table are dequeued from
+// different bgp::SendTask instances, hence the atomics.
+//
+class UpdateDwellStats {
+public:
+    static const uint32_t kSampleInterval = 16;
+
+    struct Snapshot {
+        Snapshot() : samples(0), average_usecs(0), max_usecs(0) { }
+        uint64_t samples;
+        uint64_t average_usecs;
+        uint64_t max_usecs;
+    };
+
+    UpdateDwellStats();
+
+    void Record(uint64_t dwell_usecs);
+
+    // Get the statistics for the samples since the previous call. Must only
+    // be called from one task, typically the periodic logger.
+    void Sample(Snapshot *snapshot);
+
+private:
+    tbb::atomic<uint64_t> samples_;
+    tbb::atomic<uint64_t> total_usecs_;
+    tbb::atomic<uint64_t> max_usecs_;
+    uint64_t last_samples_;
+    uint64_t last_total_usecs_;
+
+    DISALLOW_COPY_AND_ASSIGN(UpdateDwellStats);
+};
+
+#endif
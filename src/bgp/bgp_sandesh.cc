@@ -20,6 +20,7 @@
 #include "bgp/bgp_sandesh.h"
 #include "bgp/bgp_session_manager.h"
 #include "bgp/bgp_table.h"
+#include "bgp/bgp_update_cache.h"
 #include "bgp/bgp_xmpp_channel.h"
 #include "bgp/inet/inet_route.h"
 #include "bgp/inet/inet_table.h"
@@ -29,6 +30,8 @@
 #include "bgp/origin-vn/origin_vn.h"
 #include "bgp/security_group/security_group.h"
 #include "bgp/tunnel_encap/tunnel_encap.h"
+#include "db/db_partition.h"
+#include "db/db_table_walker.h"
 #include "db/db_table_partition.h"
 #include "xmpp/xmpp_server.h"
 
@@ -364,6 +367,17 @@ void ShowNeighborHandler::FillXmppNeighborInfo(
     
     BgpPeer::FillBgpNeighborDebugState(resp, channel->Peer()->peer_stats());
 
+    const BgpXmppChannel::IngestStats &ingest = channel->ingest_stats();
+    PeerIngestStats ingest_stats;
+    ingest_stats.set_batches(ingest.batches);
+    ingest_stats.set_requests(ingest.requests);
+    ingest_stats.set_max_batch_size(ingest.max_batch_size);
+    ingest_stats.set_average_enqueue_usecs(ingest.batches ?
+        ingest.total_enqueue_usecs / ingest.batches : 0);
+    ingest_stats.set_requests_per_sec(ingest.requests_per_sec);
+    ingest_stats.set_max_requests_per_sec(ingest.max_requests_per_sec);
+    resp.set_rx_ingest_stats(ingest_stats);
+
     mgr->FillPeerMembershipInfo(channel->Peer(), resp);
     nbr_list->push_back(resp);
 }
@@ -615,6 +629,8 @@ public:
         rit.secondary_paths = table->GetSecondaryPathCount();
         rit.infeasible_paths = table->GetInfeasiblePathCount();
         rit.paths = rit.primary_paths + rit.secondary_paths;
+        rit.set_damped_paths(table->GetDampedPathCount());
+        rit.set_damped_updates(table->GetDampedUpdateCount());
     }
 
     static void FillRoutingInstanceInfo(const RequestPipeline::StageData *sd,
@@ -1290,6 +1306,11 @@ public:
                 peer_socket_stats.average_bytes =
                     socket_stats.read_bytes/socket_stats.read_calls;
             }
+
+            // Each read call is a single system call.
+            peer_socket_stats.syscalls = socket_stats.read_calls;
+            peer_socket_stats.average_syscall_bytes =
+                peer_socket_stats.average_bytes;
         }
 
         static void GetTxSocketStats(TcpServer *server,
@@ -1304,6 +1325,12 @@ public:
                     socket_stats.write_bytes/socket_stats.write_calls;
             }
             peer_socket_stats.blocked_count = socket_stats.write_blocked;
+            peer_socket_stats.syscalls = socket_stats.write_syscalls;
+            if (socket_stats.write_syscalls) {
+                peer_socket_stats.average_syscall_bytes =
+                    socket_stats.write_syscall_bytes/
+                    socket_stats.write_syscalls;
+            }
             peer_socket_stats.blocked_duration = duration_usecs_to_string(
                 socket_stats.write_blocked_duration_usecs);
             if (socket_stats.write_blocked) {
@@ -1334,6 +1361,16 @@ public:
         GetTxSocketStats(bsc->bgp_server->session_manager(), peer_socket_stats);
         resp->set_tx_socket_stats(peer_socket_stats);
 
+        const UpdateCache *cache = bsc->bgp_server->update_cache();
+        ShowUpdateCacheStats cache_stats;
+        cache_stats.set_entries(cache->size());
+        cache_stats.set_max_entries(cache->max_entries());
+        cache_stats.set_hits(cache->hits());
+        cache_stats.set_misses(cache->misses());
+        cache_stats.set_evictions(cache->evictions());
+        cache_stats.set_invalidations(cache->invalidations());
+        resp->set_update_cache_stats(cache_stats);
+
         resp->set_context(req->context());
         resp->Response();
         return true;
@@ -1393,3 +1430,135 @@ void ShowXmppServerReq::HandleRequest() const {
     ps.stages_ = list_of(s1);
     RequestPipeline rp(ps);
 }
+
+//
+// Per partition load of the BGP DB. The entry count is the number of entries
+// across all tables that hash to the partition, and shows how evenly tables
+// are sharded.
+//
+class ShowDbPartitionStatsHandler {
+public:
+    static void FillPartitionStats(DB *db, int index,
+                                   ShowDbPartitionStats *stats) {
+        uint64_t entry_count = 0;
+        for (DB::iterator it = db->begin(); it != db->end(); ++it) {
+            DBTable *table = dynamic_cast<DBTable *>(it->second);
+            if (!table || index >= table->PartitionCount())
+                continue;
+            DBTablePartition *tpart =
+                static_cast<DBTablePartition *>(table->GetTablePartition(index));
+            entry_count += tpart->size();
+        }
+
+        DBPartition::QueueStats queue_stats;
+        db->GetPartition(index)->GetQueueStats(&queue_stats);
+        uint64_t count = queue_stats.total_request_count;
+        stats->set_partition_id(index);
+        stats->set_entry_count(entry_count);
+        stats->set_request_queue_len(queue_stats.request_queue_len);
+        stats->set_max_request_queue_len(queue_stats.max_request_queue_len);
+        stats->set_total_request_count(count);
+        stats->set_overflow_request_count(queue_stats.overflow_request_count);
+        stats->set_average_enqueue_usecs(
+            count ? queue_stats.total_enqueue_usecs / count : 0);
+        stats->set_max_enqueue_usecs(queue_stats.max_enqueue_usecs);
+        stats->set_average_wait_usecs(
+            count ? queue_stats.total_wait_usecs / count : 0);
+        stats->set_max_wait_usecs(queue_stats.max_wait_usecs);
+        stats->set_total_batch_count(queue_stats.total_batch_count);
+    }
+
+    static bool CallbackS1(const Sandesh *sr,
+            const RequestPipeline::PipeSpec ps, int stage, int instNum,
+            RequestPipeline::InstData *data) {
+        const ShowDbPartitionStatsReq *req =
+            static_cast<const ShowDbPartitionStatsReq *>(ps.snhRequest_.get());
+        BgpSandeshContext *bsc =
+            static_cast<BgpSandeshContext *>(req->client_context());
+        DB *db = bsc->bgp_server->database();
+
+        std::vector<ShowDbPartitionStats> partitions;
+        for (int i = 0; i < db->PartitionCount(); i++) {
+            ShowDbPartitionStats stats;
+            FillPartitionStats(db, i, &stats);
+            partitions.push_back(stats);
+        }
+
+        ShowDbPartitionStatsResp *resp = new ShowDbPartitionStatsResp;
+        resp->set_partition_count(db->PartitionCount());
+        resp->set_partitions(partitions);
+        resp->set_context(req->context());
+        resp->Response();
+        return true;
+    }
+};
+
+void ShowDbPartitionStatsReq::HandleRequest() const {
+    RequestPipeline::PipeSpec ps(this);
+
+    // Request pipeline has single stage to collect partition stats
+    // and respond to the request
+    RequestPipeline::StageSpec s1;
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    s1.taskId_ = scheduler->GetTaskId("bgp::ShowCommand");
+    s1.cbFn_ = ShowDbPartitionStatsHandler::CallbackS1;
+    s1.instances_.push_back(0);
+    ps.stages_ = list_of(s1);
+    RequestPipeline rp(ps);
+}
+
+//
+// Totals of the DB table walks along with the most recent walks.
+//
+class ShowDbTableWalkerHandler {
+public:
+    static bool CallbackS1(const Sandesh *sr,
+            const RequestPipeline::PipeSpec ps, int stage, int instNum,
+            RequestPipeline::InstData *data) {
+        const ShowDbTableWalkerReq *req =
+            static_cast<const ShowDbTableWalkerReq *>(ps.snhRequest_.get());
+        BgpSandeshContext *bsc =
+            static_cast<BgpSandeshContext *>(req->client_context());
+        DBTableWalker *walker = bsc->bgp_server->database()->GetWalker();
+
+        DBTableWalker::WalkStatsList history;
+        walker->GetWalkHistory(&history);
+        std::vector<ShowDbTableWalk> walks;
+        for (DBTableWalker::WalkStatsList::const_iterator it = history.begin();
+             it != history.end(); ++it) {
+            ShowDbTableWalk walk;
+            walk.set_table_name(it->table_name);
+            walk.set_start_time(it->start_time);
+            walk.set_duration_usecs(it->duration_usecs);
+            walk.set_entry_count(it->entry_count);
+            walk.set_ranges(it->ranges);
+            walk.set_cancelled(it->cancelled);
+            walks.push_back(walk);
+        }
+
+        ShowDbTableWalkerResp *resp = new ShowDbTableWalkerResp;
+        resp->set_walk_request_count(walker->walk_request_count());
+        resp->set_walk_complete_count(walker->walk_complete_count());
+        resp->set_walk_cancel_count(walker->walk_cancel_count());
+        resp->set_walk_entry_count(walker->walk_entry_count());
+        resp->set_walk_duration_usecs(walker->walk_duration_usecs());
+        resp->set_walks(walks);
+        resp->set_context(req->context());
+        resp->Response();
+        return true;
+    }
+};
+
+void ShowDbTableWalkerReq::HandleRequest() const {
+    RequestPipeline::PipeSpec ps(this);
+
+    // Request pipeline has single stage to collect walker stats
+    // and respond to the request
+    RequestPipeline::StageSpec s1;
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    s1.taskId_ = scheduler->GetTaskId("bgp::ShowCommand");
+    s1.cbFn_ = ShowDbTableWalkerHandler::CallbackS1;
+    s1.instances_.push_back(0);
+    ps.stages_ = list_of(s1);
+    RequestPipeline rp(ps);
+}
@@ -11,16 +11,19 @@
 #include "base/task_annotations.h"
 #include "bgp/bgp_config.h"
 #include "bgp/bgp_condition_listener.h"
+#include "bgp/bgp_damping.h"
 #include "bgp/bgp_factory.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_peer.h"
 #include "bgp/bgp_peer_membership.h"
 #include "bgp/bgp_session.h"
 #include "bgp/bgp_session_manager.h"
+#include "bgp/bgp_update_cache.h"
 #include "bgp/scheduling_group.h"
 #include "bgp/routing-instance/peer_manager.h"
 #include "bgp/routing-instance/routing_instance.h"
 #include "bgp/routing-instance/routepath_replicator.h"
+#include "bgp/routing-instance/rtarget_group_mgr.h"
 #include "bgp/routing-instance/service_chaining.h"
 #include "io/event_manager.h"
 
@@ -174,7 +177,10 @@ BgpServer::BgpServer(EventManager *evm)
       aspath_db_(new AsPathDB(this)),
       comm_db_(new CommunityDB(this)),
       extcomm_db_(new ExtCommunityDB(this)),
+      olist_db_(new BgpOListDB(this)),
       attr_db_(new BgpAttrDB(this)),
+      update_cache_(new UpdateCache),
+      damping_(BgpObjectFactory::Create<BgpDamping>()),
       session_mgr_(BgpObjectFactory::Create<BgpSessionManager>(evm, this)),
       sched_mgr_(new SchedulingGroupManager),
       inst_mgr_(BgpObjectFactory::Create<RoutingInstanceMgr>(this)),
@@ -182,6 +188,7 @@ BgpServer::BgpServer(EventManager *evm)
       condition_listener_(new BgpConditionListener(this)),
       inetvpn_replicator_(new RoutePathReplicator(this, Address::INETVPN)),
       evpn_replicator_(new RoutePathReplicator(this, Address::EVPN)),
+      rtarget_group_mgr_(new RTargetGroupMgr(this)),
       service_chain_mgr_(new ServiceChainMgr(this)),
       config_mgr_(new BgpConfigManager),
       updater_(new ConfigUpdater(this)) {
@@ -19,6 +19,8 @@ class AsPathDB;
 class BgpAttrDB;
 class BgpConditionListener;
 class BgpConfigManager;
+class BgpDamping;
+class BgpOListDB;
 class BgpPeer;
 struct BgpPeerKey;
 class BgpSessionManager;
@@ -29,8 +31,10 @@ class LifetimeManager;
 class PeerRibMembershipManager;
 class RoutePathReplicator;
 class RoutingInstanceMgr;
+class RTargetGroupMgr;
 class SchedulingGroupManager;
 class ServiceChainMgr;
+class UpdateCache;
 
 class BgpServer {
 public:
@@ -72,12 +76,16 @@ public:
         assert(false);
         return NULL;
     }
+    RTargetGroupMgr *rtarget_group_mgr() { return rtarget_group_mgr_.get(); }
 
     PeerRibMembershipManager *membership_mgr() { return membership_mgr_.get(); }
     AsPathDB *aspath_db() { return aspath_db_.get(); }
     BgpAttrDB *attr_db() { return attr_db_.get(); }
     CommunityDB *comm_db() { return comm_db_.get(); }
     ExtCommunityDB *extcomm_db() { return extcomm_db_.get(); }
+    BgpOListDB *olist_db() { return olist_db_.get(); }
+    UpdateCache *update_cache() { return update_cache_.get(); }
+    BgpDamping *damping() { return damping_.get(); }
 
     bool IsReadyForDeletion();
     DB *database() { return &db_; }
@@ -128,7 +136,10 @@ private:
     boost::scoped_ptr<AsPathDB> aspath_db_;
     boost::scoped_ptr<CommunityDB> comm_db_;
     boost::scoped_ptr<ExtCommunityDB> extcomm_db_;
+    boost::scoped_ptr<BgpOListDB> olist_db_;
     boost::scoped_ptr<BgpAttrDB> attr_db_;
+    boost::scoped_ptr<UpdateCache> update_cache_;
+    boost::scoped_ptr<BgpDamping> damping_;
 
     // sessions and state managers
     BgpSessionManager *session_mgr_;
@@ -138,6 +149,7 @@ private:
     boost::scoped_ptr<BgpConditionListener> condition_listener_;
     boost::scoped_ptr<RoutePathReplicator> inetvpn_replicator_;
     boost::scoped_ptr<RoutePathReplicator> evpn_replicator_;
+    boost::scoped_ptr<RTargetGroupMgr> rtarget_group_mgr_;
     boost::scoped_ptr<ServiceChainMgr> service_chain_mgr_;
 
     // configuration
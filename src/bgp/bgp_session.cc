@@ -43,6 +43,7 @@ BgpSession::BgpSession(BgpSessionManager *session, Socket *socket)
       peer_(NULL),
       reader_(new BgpMessageReader(this,
               boost::bind(&BgpSession::ReceiveMsg, this, _1, _2))) {
+    SetWriteCoalesceWindow(kWriteCoalesceWindow);
 }
 
 BgpSession::~BgpSession() {
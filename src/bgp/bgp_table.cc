@@ -4,13 +4,17 @@
 
 #include "bgp/bgp_table.h"
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include "base/task_annotations.h"
+#include "base/timer.h"
 
 #include <sandesh/sandesh_types.h>
 #include <sandesh/sandesh.h>
 
+#include "db/db.h"
 #include "db/db_table_partition.h"
+#include "bgp/bgp_damping.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_path.h"
 #include "bgp/bgp_peer_types.h"
@@ -54,16 +58,62 @@ class BgpTable::DeleteActor : public LifetimeActor {
     BgpTable *table_;
 };
 
+//
+// Route flap damping reuse list for a table partition. The timer runs in
+// the db::DBTable task for the partition, so it's exclusive with the
+// processing of requests for the partition.
+//
+class BgpTable::DampingPartition {
+public:
+    DampingPartition(BgpTable *table, int part_id)
+        : reuse_list_(table->rtinstance_->server()->damping()->Now()),
+          timer_(TimerManager::CreateTimer(
+              *table->rtinstance_->server()->ioservice(),
+              "BGP damping reuse timer",
+              TaskScheduler::GetInstance()->GetTaskId("db::DBTable"),
+              part_id)),
+          handler_(boost::bind(&BgpTable::ProcessDampingReuse, table,
+                               part_id)) {
+    }
+    ~DampingPartition() {
+        timer_->Cancel();
+        TimerManager::DeleteTimer(timer_);
+    }
+
+    // The timer can't be started from its own handler. The handler keeps
+    // it running as long as the reuse list is not empty.
+    void Add(BgpRoute *rt, uint32_t time) {
+        reuse_list_.Add(rt, time);
+        if (!timer_->running() && !timer_->fired()) {
+            timer_->Start(BgpDampingReuseList::kGranularity * 1000, handler_);
+        }
+    }
+
+    BgpDampingReuseList *reuse_list() { return &reuse_list_; }
+
+private:
+    BgpDampingReuseList reuse_list_;
+    Timer *timer_;
+    Timer::Handler handler_;
+
+    DISALLOW_COPY_AND_ASSIGN(DampingPartition);
+};
+
 BgpTable::BgpTable(DB *db, const string &name)
         : RouteTable(db, name),
           rtinstance_(NULL),
-          instance_delete_ref_(this, NULL) {
+          instance_delete_ref_(this, NULL),
+          damping_partitions_(DB::PartitionCount()),
+          route_change_stats_(DB::PartitionCount()) {
 	primary_path_count_ = 0;
 	secondary_path_count_ = 0;
 	infeasible_path_count_ = 0;
+	damped_path_count_ = 0;
+	damped_update_count_ = 0;
 }
 
 BgpTable::~BgpTable() {
+    STLDeleteValues(&damping_partitions_);
 
     // remove the table from the instance dependents before attempting to
     // destroy the DeleteActor which can have its Delete() method be called
@@ -233,11 +283,18 @@ bool BgpTable::PathSelection(const Path &path1, const Path &path2) {
     return res;
 }
 
+//
+// Route flap damping applies to updates received from peers i.e. when there
+// is a request. Requests generated internally, e.g. when a peer closes, do
+// not affect the penalty, but retain the damping state of the path.
+//
 void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
                            const IPeer *peer, DBRequest *req,
                            DBRequest::DBOperation oper, BgpAttrPtr attrs,
                            uint32_t flags, uint32_t label) {
     bool is_stale = false;
+    BgpDamping *damping = (req && peer) ? GetDamping() : NULL;
+    flags &= ~BgpPath::DAMPING_MASK;
 
     switch (oper) {
     case DBRequest::DB_ENTRY_ADD_CHANGE: {
@@ -245,6 +302,10 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
         // Skip if this peer is down/deleted.
         if (peer && !peer->IsReady()) return;
 
+        BgpDampingState damping_state;
+        uint32_t damping_flags = 0;
+        bool was_dampened = false;
+        RouteChangeStats::Operation op = RouteChangeStats::ADD;
         if (rt) {
 
             // The entry may currently be marked as deleted.
@@ -252,11 +313,24 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
 
             // Check whether peer already has a path
             if (path != NULL) {
-                if ((path->GetAttr() != attrs.get()) || 
-                    (path->GetFlags() != flags) ||
+                if (path->IsHistory() ||
+                    (path->GetAttr() != attrs.get()) || 
+                    ((path->GetFlags() & ~BgpPath::DAMPING_MASK) != flags) ||
                     (path->GetLabel() != label)) {
                     // Update Attributes and notify (if needed)
+                    if (!path->IsHistory())
+                        op = RouteChangeStats::CHANGE;
                     is_stale = path->IsStale();
+                    damping_state = path->damping_state();
+                    was_dampened = path->IsDampened();
+                    damping_flags = path->GetFlags() & BgpPath::Dampened;
+                    if (damping) {
+                        BgpDamping::Event event = path->IsHistory() ?
+                            BgpDamping::READVERTISE : BgpDamping::CHANGE;
+                        bool suppress = damping->Update(&damping_state, event,
+                            was_dampened, damping->Now());
+                        damping_flags = suppress ? BgpPath::Dampened : 0;
+                    }
                     rt->DeletePath(path);
                 } else {
 
@@ -274,7 +348,9 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
         }
 
         BgpPath *new_path;
-        new_path = new BgpPath(peer, BgpPath::BGP_XMPP, attrs, flags, label);
+        new_path = new BgpPath(peer, BgpPath::BGP_XMPP, attrs,
+                               flags | damping_flags, label);
+        new_path->set_damping_state(damping_state);
 
         //
         // If the path is being staled (by bringing down the local pref,
@@ -285,6 +361,19 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
         }
 
         rt->InsertPath(new_path);
+        RecordRouteChange(root, peer, op);
+        if (damping && damping_flags) {
+            DampingSchedule(root, rt, damping->ReuseTime(damping_state));
+        }
+
+        //
+        // A path that stays suppressed is not advertised, so there's no
+        // need to notify listeners.
+        //
+        if (was_dampened && damping_flags) {
+            damped_update_count_++;
+            break;
+        }
         root->Notify(rt);
         break;
     }
@@ -292,12 +381,23 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
     case DBRequest::DB_ENTRY_DELETE: {
         if (rt && !rt->IsDeleted()) {
             BGP_LOG_ROUTE(this, peer, rt, "Delete BGP path");
+            if (path && !path->IsHistory())
+                RecordRouteChange(root, peer, RouteChangeStats::DELETE);
+
+            // Keep the damping state of the path, if needed.
+            if (damping && path) {
+                if (path->IsHistory())
+                    break;
+                if (DampingWithdraw(root, rt, path, damping))
+                    break;
+            }
 
             // Remove the Path from the route
             rt->RemovePath(peer, BgpPath::BGP_XMPP);
 
             if (rt->front() == NULL) {
                 // Delete the route only if all paths are gone
+                DampingUnschedule(root, rt);
                 root->Delete(rt);
             } else {
                root->Notify(rt);
@@ -313,6 +413,153 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
     }
 }
 
+BgpDamping *BgpTable::GetDamping() const {
+    if (!rtinstance_ || !rtinstance_->server())
+        return NULL;
+    BgpDamping *damping = rtinstance_->server()->damping();
+    return damping->enabled() ? damping : NULL;
+}
+
+//
+// Replace a withdrawn path with a history path that keeps its damping
+// state. The history path is infeasible, and it is removed once the
+// penalty has decayed enough. Returns false if there's no need to keep
+// the state.
+//
+bool BgpTable::DampingWithdraw(DBTablePartBase *root, BgpRoute *rt,
+                               BgpPath *path, BgpDamping *damping) {
+    uint32_t now = damping->Now();
+    BgpDampingState damping_state = path->damping_state();
+    bool was_dampened = path->IsDampened();
+    bool suppress = damping->Update(&damping_state, BgpDamping::WITHDRAW,
+                                    was_dampened, now);
+    if (damping->CanDiscard(damping_state, now))
+        return false;
+
+    uint32_t flags = path->GetFlags() & ~(BgpPath::Stale | BgpPath::Dampened);
+    flags |= BgpPath::History | (suppress ? BgpPath::Dampened : 0);
+    BgpPath *history_path = new BgpPath(path->GetPeer(), path->GetSource(),
+        BgpAttrPtr(path->GetAttr()), flags, path->GetLabel());
+    history_path->set_damping_state(damping_state);
+    rt->DeletePath(path);
+    rt->InsertPath(history_path);
+    DampingSchedule(root, rt, damping->DiscardTime(damping_state));
+
+    if (was_dampened) {
+        damped_update_count_++;
+    } else {
+        root->Notify(rt);
+    }
+    return true;
+}
+
+void BgpTable::DampingSchedule(DBTablePartBase *root, BgpRoute *rt,
+                               uint32_t time) {
+    DampingPartition *dpart = damping_partitions_[root->index()];
+    if (!dpart) {
+        dpart = new DampingPartition(this, root->index());
+        damping_partitions_[root->index()] = dpart;
+    }
+    dpart->Add(rt, time);
+}
+
+void BgpTable::DampingUnschedule(DBTablePartBase *root, BgpRoute *rt) {
+    DampingPartition *dpart = damping_partitions_[root->index()];
+    if (dpart)
+        dpart->reuse_list()->Remove(rt);
+}
+
+//
+// Timer handler for the reuse list of a partition. Returns true to keep
+// the timer running.
+//
+bool BgpTable::ProcessDampingReuse(int part_id) {
+    CHECK_CONCURRENCY("db::DBTable");
+    DampingPartition *dpart = damping_partitions_[part_id];
+    DBTablePartBase *root = GetTablePartition(part_id);
+    uint32_t now = rtinstance_->server()->damping()->Now();
+
+    BgpDampingReuseList::RouteList routes;
+    dpart->reuse_list()->Advance(now, &routes);
+    for (BgpDampingReuseList::RouteList::iterator it = routes.begin();
+         it != routes.end(); ++it) {
+        DampingReuse(root, *it, now);
+    }
+    return !dpart->reuse_list()->empty();
+}
+
+//
+// Reuse the suppressed paths and discard the history paths of the route
+// whose penalty has decayed enough, and schedule the route again for the
+// remaining ones.
+//
+void BgpTable::DampingReuse(DBTablePartBase *root, BgpRoute *rt,
+                            uint32_t now) {
+    const BgpDamping *damping = rtinstance_->server()->damping();
+    vector<BgpPath *> paths;
+    for (Route::PathList::iterator it = rt->GetPathList().begin();
+         it != rt->GetPathList().end(); ++it) {
+        BgpPath *path = static_cast<BgpPath *>(it.operator->());
+        if ((path->GetFlags() & BgpPath::DAMPING_MASK) != 0)
+            paths.push_back(path);
+    }
+
+    bool notify = false;
+    uint32_t next = 0;
+    for (vector<BgpPath *>::iterator it = paths.begin();
+         it != paths.end(); ++it) {
+        BgpPath *path = *it;
+        const BgpDampingState &damping_state = path->damping_state();
+        uint32_t time;
+        if (path->IsHistory()) {
+            if (damping->CanDiscard(damping_state, now)) {
+                rt->DeletePath(path);
+                continue;
+            }
+            time = damping->DiscardTime(damping_state);
+        } else {
+            if (damping->CanReuse(damping_state, now)) {
+                BgpPath *new_path = new BgpPath(path->GetPeer(),
+                    path->GetSource(), BgpAttrPtr(path->GetAttr()),
+                    path->GetFlags() & ~BgpPath::Dampened, path->GetLabel());
+                new_path->set_damping_state(damping_state);
+                rt->DeletePath(path);
+                rt->InsertPath(new_path);
+                notify = true;
+                continue;
+            }
+            time = damping->ReuseTime(damping_state);
+        }
+        if (next == 0 || time < next)
+            next = time;
+    }
+
+    if (rt->front() == NULL) {
+        root->Delete(rt);
+        return;
+    }
+    if (notify)
+        root->Notify(rt);
+    if (next)
+        DampingSchedule(root, rt, next);
+}
+
+//
+// Concurrency: called from the db::DBTable task for the partition, which
+// keeps the per partition counters exclusive.
+//
+void BgpTable::RecordRouteChange(DBTablePartBase *root, const IPeer *peer,
+                                 RouteChangeStats::Operation op) {
+    route_change_stats_.Increment(root->index(), op);
+    if (!peer)
+        return;
+    IPeerDebugStats *peer_stats = const_cast<IPeer *>(peer)->peer_stats();
+    RouteChangeStats *stats =
+        peer_stats ? peer_stats->route_change_stats() : NULL;
+    if (stats)
+        stats->Increment(root->index(), op);
+}
+
 void BgpTable::Input(DBTablePartition *root, DBClient *client, DBRequest *req) {
     BgpRoute *rt = NULL;
     const IPeer *peer = (static_cast<RequestKey *>(req->key.get()))->GetPeer();
@@ -423,4 +670,8 @@ void BgpTable::UpdatePathCount(const BgpPath *path, int count) {
     if (!path->IsFeasible()) {
         infeasible_path_count_ += count;
     }
+
+    if ((path->GetFlags() & BgpPath::DAMPING_MASK) != 0) {
+        damped_path_count_ += count;
+    }
 }
@@ -6,6 +6,7 @@
 #define ctrlplane_bgp_table_h
 
 #include <map>
+#include <vector>
 #include <tbb/atomic.h>
 
 #include "base/lifetime.h"
@@ -13,9 +14,11 @@
 #include "bgp/bgp_update.h"
 #include "route/table.h"
 #include "bgp/bgp_path.h"
+#include "bgp/bgp_route_stats.h"
 #include "bgp_ribout.h"
 #include "db/db_table_walker.h"
 
+class BgpDamping;
 class BgpServer;
 class BgpRoute;
 class BgpPath;
@@ -94,12 +97,36 @@ public:
     const uint64_t GetInfeasiblePathCount() const {
         return infeasible_path_count_;
     }
+    const uint64_t GetDampedPathCount() const { return damped_path_count_; }
+
+    // Number of updates that were not propagated because the path was
+    // suppressed by route flap damping.
+    const uint64_t GetDampedUpdateCount() const {
+        return damped_update_count_;
+    }
+
+    RouteChangeStats *route_change_stats() { return &route_change_stats_; }
+    UpdateDwellStats *dwell_stats() { return &dwell_stats_; }
 
 private:
     class DeleteActor;
+    class DampingPartition;
     friend class BgpTableTest;
+    friend class BgpDampingTableTest;
     virtual BgpRoute *TableFind(DBTablePartition *rtp,
             const DBRequestKey *prefix) = 0;
+
+    BgpDamping *GetDamping() const;
+    bool DampingWithdraw(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
+                         BgpDamping *damping);
+    void DampingSchedule(DBTablePartBase *root, BgpRoute *rt, uint32_t time);
+    void DampingUnschedule(DBTablePartBase *root, BgpRoute *rt);
+    bool ProcessDampingReuse(int part_id);
+    void DampingReuse(DBTablePartBase *root, BgpRoute *rt, uint32_t now);
+
+    void RecordRouteChange(DBTablePartBase *root, const IPeer *peer,
+                           RouteChangeStats::Operation op);
+
     RoutingInstance *rtinstance_;
     RibOutMap ribout_map_;
 
@@ -108,6 +135,11 @@ private:
     tbb::atomic<uint64_t> primary_path_count_;
     tbb::atomic<uint64_t> secondary_path_count_;
     tbb::atomic<uint64_t> infeasible_path_count_;
+    tbb::atomic<uint64_t> damped_path_count_;
+    tbb::atomic<uint64_t> damped_update_count_;
+    std::vector<DampingPartition *> damping_partitions_;
+    RouteChangeStats route_change_stats_;
+    UpdateDwellStats dwell_stats_;
 
     DISALLOW_COPY_AND_ASSIGN(BgpTable);
 };
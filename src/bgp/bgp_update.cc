@@ -292,6 +292,21 @@ void RouteUpdate::set_tstamp_now() {
 #endif
 }
 
+uint64_t RouteUpdate::tstamp_elapsed_usecs() const {
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    uint64_t elapsed = mach_absolute_time() - tstamp_;
+    return elapsed * timebase.numer / timebase.denom / 1000;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now = ts.tv_sec * 1000000000 + ts.tv_nsec;
+    return now > tstamp_ ? (now - tstamp_) / 1000 : 0;
+#endif
+}
+
 //
 // Set the given AdvertiseSList in the UpdateList to the given value.
 //
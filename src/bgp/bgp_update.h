@@ -231,6 +231,9 @@ public:
     uint64_t tstamp() const { return tstamp_; }
     void set_tstamp_now();
 
+    // Time since the timestamp was set, in microseconds.
+    uint64_t tstamp_elapsed_usecs() const;
+
     bool empty() const { return updates_->empty(); }
 
 private:
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_update_cache.h"
+
+#include "bgp/message_builder.h"
+
+using boost::shared_ptr;
+using tbb::mutex;
+
+bool UpdateCache::Key::operator<(const Key &rhs) const {
+    if (encoding != rhs.encoding) {
+        return encoding < rhs.encoding;
+    }
+    if (route != rhs.route) {
+        return route < rhs.route;
+    }
+    return roattr.CompareTo(rhs.roattr) < 0;
+}
+
+UpdateCache::UpdateCache(size_t max_entries) : max_entries_(max_entries) {
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+    invalidations_ = 0;
+}
+
+UpdateCache::~UpdateCache() {
+    Clear();
+}
+
+UpdateCache::EntryPtr UpdateCache::Find(RibExportPolicy::Encoding encoding,
+        const BgpRoute *route, const RibOutAttr &roattr) {
+    mutex::scoped_lock lock(mutex_);
+    EntryMap::iterator loc = entry_map_.find(Key(encoding, route, roattr));
+    if (loc == entry_map_.end()) {
+        misses_++;
+        return EntryPtr();
+    }
+    hits_++;
+    return loc->second->entry;
+}
+
+//
+// Add an entry for a message that has been built and finished. An existing
+// entry for the same key is replaced, since the new message is more likely
+// to be reused.
+//
+void UpdateCache::Add(RibExportPolicy::Encoding encoding,
+        const BgpRoute *route, const RibOutAttr &roattr,
+        shared_ptr<Message> message, const RouteAttrList &packed) {
+    if (max_entries_ == 0)
+        return;
+
+    Entry *entry = new Entry;
+    entry->message = message;
+    entry->packed = packed;
+
+    mutex::scoped_lock lock(mutex_);
+    EntryMap::iterator loc = entry_map_.find(Key(encoding, route, roattr));
+    if (loc != entry_map_.end()) {
+        RemoveNode(loc->second);
+    } else if (entry_map_.size() >= max_entries_) {
+        RemoveNode(node_list_.front());
+        evictions_++;
+    }
+
+    Node *node = new Node;
+    node->entry.reset(entry);
+    node->map_iter = entry_map_.insert(
+        std::make_pair(Key(encoding, route, roattr), node)).first;
+    node->list_iter = node_list_.insert(node_list_.end(), node);
+    node->index_iters.push_back(
+        route_index_.insert(std::make_pair(route, node)));
+    for (RouteAttrList::const_iterator iter = packed.begin();
+         iter != packed.end(); ++iter) {
+        node->index_iters.push_back(
+            route_index_.insert(std::make_pair(iter->route, node)));
+    }
+}
+
+void UpdateCache::Invalidate(const BgpRoute *route) {
+    mutex::scoped_lock lock(mutex_);
+    RouteIndex::iterator loc;
+    while ((loc = route_index_.find(route)) != route_index_.end()) {
+        RemoveNode(loc->second);
+        invalidations_++;
+    }
+}
+
+void UpdateCache::Clear() {
+    mutex::scoped_lock lock(mutex_);
+    while (!node_list_.empty()) {
+        RemoveNode(node_list_.front());
+    }
+}
+
+size_t UpdateCache::size() const {
+    mutex::scoped_lock lock(mutex_);
+    return entry_map_.size();
+}
+
+void UpdateCache::RemoveNode(Node *node) {
+    entry_map_.erase(node->map_iter);
+    node_list_.erase(node->list_iter);
+    for (std::vector<RouteIndex::iterator>::iterator iter =
+         node->index_iters.begin(); iter != node->index_iters.end(); ++iter) {
+        route_index_.erase(*iter);
+    }
+    delete node;
+}
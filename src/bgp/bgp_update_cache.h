@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_bgp_update_cache_h
+#define ctrlplane_bgp_update_cache_h
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+
+#include "bgp/bgp_ribout.h"
+
+class BgpRoute;
+class Message;
+
+//
+// Cache of update messages that have been built for a RibOut, so that other
+// RibOuts, or other sets of peers in the same RibOut, can send the same
+// message without building it again. This happens when RibOuts for the same
+// table compute the same attributes for a route, and when peers that were
+// split from the tail marker catch up.
+//
+// An entry is keyed by the encoding, the first route in the message and its
+// RibOutAttr. It also keeps the list of routes that were packed after the
+// first one. The entry can only be used if the same routes would be packed
+// again, in the same order. Entries are immutable once added, and are handed
+// out as shared pointers so that they stay valid if they get evicted while
+// the message is being sent.
+//
+// Entries refer to routes by pointer. All the entries that refer to a route
+// must be removed with Invalidate before any RibOut clears its state on the
+// route, since the route may get deleted right after that and the memory
+// reused for a different route.
+//
+// The cache holds at most max_entries entries. The oldest entry is evicted
+// when a new one gets added to a full cache.
+//
+// Messages that format per-peer data in GetData must only be shared by the
+// RibOuts of a single scheduling group. This is the case for XMPP messages
+// since there's a single XMPP RibOut per table.
+//
+class UpdateCache {
+public:
+    static const size_t kDefaultMaxEntries = 1024;
+
+    struct RouteAttr {
+        RouteAttr(const BgpRoute *route, const RibOutAttr &roattr)
+            : route(route), roattr(roattr) {
+        }
+        const BgpRoute *route;
+        RibOutAttr roattr;
+    };
+    typedef std::vector<RouteAttr> RouteAttrList;
+
+    struct Entry {
+        boost::shared_ptr<Message> message;
+        RouteAttrList packed;
+    };
+    typedef boost::shared_ptr<const Entry> EntryPtr;
+
+    explicit UpdateCache(size_t max_entries = kDefaultMaxEntries);
+    ~UpdateCache();
+
+    EntryPtr Find(RibExportPolicy::Encoding encoding, const BgpRoute *route,
+                  const RibOutAttr &roattr);
+    void Add(RibExportPolicy::Encoding encoding, const BgpRoute *route,
+             const RibOutAttr &roattr, boost::shared_ptr<Message> message,
+             const RouteAttrList &packed);
+
+    // Remove all entries that contain the route.
+    void Invalidate(const BgpRoute *route);
+    void Clear();
+
+    size_t size() const;
+    size_t max_entries() const { return max_entries_; }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+    uint64_t evictions() const { return evictions_; }
+    uint64_t invalidations() const { return invalidations_; }
+
+private:
+    struct Key {
+        Key(RibExportPolicy::Encoding encoding, const BgpRoute *route,
+            const RibOutAttr &roattr)
+            : encoding(encoding), route(route), roattr(roattr) {
+        }
+        bool operator<(const Key &rhs) const;
+
+        RibExportPolicy::Encoding encoding;
+        const BgpRoute *route;
+        RibOutAttr roattr;
+    };
+
+    struct Node;
+    typedef std::map<Key, Node *> EntryMap;
+    typedef std::multimap<const BgpRoute *, Node *> RouteIndex;
+    typedef std::list<Node *> NodeList;
+
+    struct Node {
+        EntryPtr entry;
+        EntryMap::iterator map_iter;
+        NodeList::iterator list_iter;
+        std::vector<RouteIndex::iterator> index_iters;
+    };
+
+    void RemoveNode(Node *node);
+
+    mutable tbb::mutex mutex_;
+    size_t max_entries_;
+    EntryMap entry_map_;
+    RouteIndex route_index_;
+    NodeList node_list_;
+    tbb::atomic<uint64_t> hits_;
+    tbb::atomic<uint64_t> misses_;
+    tbb::atomic<uint64_t> evictions_;
+    tbb::atomic<uint64_t> invalidations_;
+
+    DISALLOW_COPY_AND_ASSIGN(UpdateCache);
+};
+
+#endif
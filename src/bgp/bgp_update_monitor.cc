@@ -130,6 +130,7 @@ DBState *RibUpdateMonitor::GetUpdateListAndDequeue(DBEntryBase *db_entry,
     if (dbstate) {
         db_entry->SetState(ribout_->table(), ribout_->listener_id(), dbstate);
     } else {
+        ribout_->updates()->InvalidateCache(db_entry);
         db_entry->ClearState(ribout_->table(), ribout_->listener_id());
     }
     return dbstate;
@@ -597,6 +598,7 @@ void RibUpdateMonitor::RouteStateClearPeerSet(DBEntryBase *db_entry,
 
     // Get rid of the RouteState itself if it's empty.
     if (rstate->Advertised()->empty()) {
+        ribout_->updates()->InvalidateCache(db_entry);
         db_entry->ClearState(ribout_->table(), ribout_->listener_id());
         delete rstate;
     }
@@ -645,6 +647,7 @@ bool RibUpdateMonitor::RouteUpdateClearPeerSet(DBEntryBase *db_entry,
         // No more scheduled or current updates.  Dequeue the RouteUpdate,
         // clear the state on the DBEntry and get rid of the RouteUpdate.
         DequeueUpdateUnlocked(rt_update);
+        ribout_->updates()->InvalidateCache(db_entry);
         db_entry->ClearState(ribout_->table(), ribout_->listener_id());
     }
 
@@ -712,6 +715,7 @@ bool RibUpdateMonitor::UpdateListClearPeerSet(DBEntryBase *db_entry,
 
         // There's no RouteUpdates on the UpdateList and the history is
         // empty. Clear state on the DBEntry and get rid of UpdateList.
+        ribout_->updates()->InvalidateCache(db_entry);
         db_entry->ClearState(ribout_->table(), ribout_->listener_id());
     }
 
@@ -999,5 +1003,6 @@ void RibUpdateMonitor::ClearEntryState(DBEntryBase *db_entry) {
     CHECK_CONCURRENCY("bgp::SendTask");
 
     mutex::scoped_lock lock(mutex_);
+    ribout_->updates()->InvalidateCache(db_entry);
     db_entry->ClearState(ribout_->table(), ribout_->listener_id());
 }
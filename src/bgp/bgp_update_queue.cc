@@ -5,14 +5,16 @@
 #include "bgp/bgp_update_queue.h"
 
 #include "base/logging.h"
+#include "bgp/bgp_route_stats.h"
 
 using namespace tbb;
 
 //
 // Initialize the UpdateQueue and add the tail marker to the FIFO.
 //
-UpdateQueue::UpdateQueue(int queue_id)
-    : queue_id_(queue_id), marker_count_(0) {
+UpdateQueue::UpdateQueue(int queue_id, UpdateDwellStats *dwell_stats)
+    : queue_id_(queue_id), marker_count_(0), dwell_stats_(dwell_stats),
+      dequeue_count_(0) {
     queue_.push_back(tail_marker_);
 }
 
@@ -56,9 +58,14 @@ bool UpdateQueue::Enqueue(RouteUpdate *rt_update) {
 //
 // Dequeue the specified RouteUpdate from the UpdateQueue.  All UpdateInfo
 // elements for the RouteUpdate are removed from the set container.
+// Also samples the time that the RouteUpdate spent on the queue.
 //
 void UpdateQueue::Dequeue(RouteUpdate *rt_update) {
     mutex::scoped_lock lock(mutex_);
+    if (dwell_stats_ &&
+        ++dequeue_count_ % UpdateDwellStats::kSampleInterval == 0) {
+        dwell_stats_->Record(rt_update->tstamp_elapsed_usecs());
+    }
     queue_.erase(queue_.iterator_to(*rt_update));
     UpdateInfoSList &uinfo_slist = rt_update->Updates();
     for (UpdateInfoSList::List::iterator iter = uinfo_slist->begin();
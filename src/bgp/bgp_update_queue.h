@@ -8,6 +8,8 @@
 #include <tbb/mutex.h>
 #include "bgp/bgp_update.h"
 
+class UpdateDwellStats;
+
 //
 // Comparator used to order UpdateInfos in the UpdateQueue set container.
 // Looks at the BgpAttr, Timestamp and the associated RouteUpdate but not
@@ -68,6 +70,10 @@ struct UpdateByAttrCmp {
 // it's UpdateMarker. Note that it's possible for multiple peers to point
 // to the same marker.
 //
+// If an UpdateDwellStats is provided, the time spent by RouteUpdates on
+// the queue is recorded for one in every UpdateDwellStats::kSampleInterval
+// dequeues.
+//
 // A special UpdateMarker called the tail marker is used as an easy way to
 // keep track of whether the list is empty.  The tail marker is always the
 // last marker in the list.  Another way to think about this is that all
@@ -99,7 +105,7 @@ public:
     
     typedef std::map<int, UpdateMarker *> MarkerMap;
 
-    explicit UpdateQueue(int queue_id);
+    explicit UpdateQueue(int queue_id, UpdateDwellStats *dwell_stats = NULL);
     ~UpdateQueue();
     
     bool Enqueue(RouteUpdate *rt_update);
@@ -136,6 +142,8 @@ private:
     mutable tbb::mutex mutex_;
     int queue_id_;
     size_t marker_count_;
+    UpdateDwellStats *dwell_stats_;
+    uint32_t dequeue_count_;
     UpdatesByOrder queue_;
     UpdatesByAttr attr_set_;
     MarkerMap markers_;
@@ -19,6 +19,7 @@
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_peer_membership.h"
 #include "bgp/bgp_ribout.h"
+#include "bgp/bgp_route_stats.h"
 #include "bgp/bgp_server.h"
 #include "bgp/inet/inet_table.h"
 #include "bgp/inetmcast/inetmcast_table.h"
@@ -28,6 +29,7 @@
 #include "bgp/routing-instance/routing_instance.h"
 #include "bgp/scheduling_group.h"
 #include "bgp/security_group/security_group.h"
+#include "db/db.h"
 
 #include "net/bgp_af.h"
 #include "net/mac_address.h"
@@ -51,6 +53,12 @@ BgpXmppChannel::Stats::Stats()
     : rt_updates(0), reach(0), unreach(0) {
 }
 
+BgpXmppChannel::IngestStats::IngestStats()
+    : batches(0), requests(0), max_batch_size(0), total_enqueue_usecs(0),
+      requests_per_sec(0), max_requests_per_sec(0), interval_start(0),
+      interval_requests(0) {
+}
+
 class BgpXmppChannel::PeerClose : public IPeerClose {
 public:
     PeerClose(BgpXmppChannel *channel)
@@ -118,7 +126,7 @@ private:
 class BgpXmppChannel::PeerStats : public IPeerDebugStats {
 public:
     explicit PeerStats(BgpXmppChannel *peer)
-        : peer_(peer) {
+        : peer_(peer), route_change_stats_(DB::PartitionCount()) {
     }
 
     // Printable name
@@ -203,6 +211,8 @@ public:
             stats.blocked_count = socket_stats.write_blocked;
             stats.blocked_duration_usecs =
                 socket_stats.write_blocked_duration_usecs;
+            stats.syscalls = socket_stats.write_syscalls;
+            stats.syscall_bytes = socket_stats.write_syscall_bytes;
         }
     }
 
@@ -214,8 +224,13 @@ public:
         peer_->stats_[1].reach += count;
     }
 
+    virtual RouteChangeStats *route_change_stats() {
+        return &route_change_stats_;
+    }
+
 private:
     BgpXmppChannel *peer_;
+    RouteChangeStats route_change_stats_;
 };
 
 
@@ -375,6 +390,7 @@ BgpXmppChannel::~BgpXmppChannel() {
     if (manager_)
         manager_->RemoveChannel(channel_);
     STLDeleteElements(&defer_q_);
+    assert(request_batch_.empty());
     assert(peer_->IsDeleted());
     channel_->UnRegisterReceive(peer_id_);
 }
@@ -627,7 +643,7 @@ void BgpXmppChannel::ProcessMcastItem(std::string vrf_name,
                                << " from peer:" << peer_->ToString() << 
                                " is enqueued for " <<
                                (add_change ? "add/change" : "delete")); 
-    table->Enqueue(&req);
+    BatchRequest(table, &req);
 }
 
 void BgpXmppChannel::ProcessItem(string vrf_name,
@@ -842,7 +858,7 @@ void BgpXmppChannel::ProcessItem(string vrf_name,
                                << " and label " << label
                                <<  " is enqueued for "
                                << (add_change ? "add/change" : "delete"));
-    table->Enqueue(&req);
+    BatchRequest(table, &req);
 }
 
 void BgpXmppChannel::ProcessEnetItem(string vrf_name,
@@ -1025,7 +1041,7 @@ void BgpXmppChannel::ProcessEnetItem(string vrf_name,
                                << " and label " << label
                                <<  " is enqueued for "
                                << (add_change ? "add/change" : "delete"));
-    table->Enqueue(&req);
+    BatchRequest(table, &req);
 }
 
 void BgpXmppChannel::DequeueRequest(const string &table_name,
@@ -1067,6 +1083,53 @@ void BgpXmppChannel::DequeueRequest(const string &table_name,
     table->Enqueue(ptr.get());
 }
 
+//
+// Add the request to the batch for the table. The batches are enqueued
+// when the publish message has been processed.
+//
+void BgpXmppChannel::BatchRequest(BgpTable *table, DBRequest *req) {
+    DBRequest *request = new DBRequest();
+    request->Swap(req);
+    request_batch_[table].push_back(request);
+}
+
+void BgpXmppChannel::FlushRequestBatch() {
+    if (request_batch_.empty())
+        return;
+
+    uint64_t start = UTCTimestampUsec();
+    uint64_t count = 0;
+    for (RequestBatch::iterator it = request_batch_.begin();
+         it != request_batch_.end(); ++it) {
+        uint64_t size = it->second.size();
+        count += size;
+        if (size > ingest_stats_.max_batch_size)
+            ingest_stats_.max_batch_size = size;
+        it->first->EnqueueBatch(&it->second);
+        ingest_stats_.batches++;
+    }
+    request_batch_.clear();
+
+    uint64_t now = UTCTimestampUsec();
+    ingest_stats_.requests += count;
+    ingest_stats_.total_enqueue_usecs += now - start;
+    ingest_stats_.interval_requests += count;
+    if (ingest_stats_.interval_start == 0)
+        ingest_stats_.interval_start = start;
+    uint64_t elapsed = now - ingest_stats_.interval_start;
+    if (elapsed >= kIngestRateIntervalUsecs) {
+        ingest_stats_.requests_per_sec =
+            ingest_stats_.interval_requests * 1000000 / elapsed;
+        if (ingest_stats_.requests_per_sec >
+            ingest_stats_.max_requests_per_sec) {
+            ingest_stats_.max_requests_per_sec =
+                ingest_stats_.requests_per_sec;
+        }
+        ingest_stats_.interval_start = now;
+        ingest_stats_.interval_requests = 0;
+    }
+}
+
 bool BgpXmppChannel::ResumeClose() {
     peer_->Close();
     return true;
@@ -1237,6 +1300,8 @@ void BgpXmppChannel::ProcessDeferredSubscribeRequest(std::string vrf_name,
             //Do not register to inetvpn table
             continue;
         }
+        if (table->family() == Address::RTARGET)
+            continue;
 
         RegisterTable(table, instance_id);
 
@@ -1296,6 +1361,8 @@ void BgpXmppChannel::ProcessSubscriptionRequest(
             continue;
         if (table->family() == Address::EVPN)
             continue;
+        if (table->family() == Address::RTARGET)
+            continue;
 
         if (add_change) {
             RoutingTableMembershipRequestMap::iterator loc =
@@ -1392,27 +1459,29 @@ void BgpXmppChannel::ReceiveUpdate(const XmppStanza::XmppMessage *msg) {
                 XmlBase *impl = msg->dom.get();
                 stats_[0].rt_updates++;
                 XmlPugi *pugi = reinterpret_cast<XmlPugi *>(impl);
+
+                // All items in the message are for the same address family.
+                std::string id(iq->as_node.c_str());
+                char *str = const_cast<char *>(id.c_str());
+                char *saveptr;
+                char *af_str = strtok_r(str, "/", &saveptr);
+                char *safi_str = strtok_r(NULL, "/", &saveptr);
+                int af = af_str ? atoi(af_str) : 0;
+                int safi = safi_str ? atoi(safi_str) : 0;
+
                 for (xml_node item = pugi->FindNode("item"); item;
                     item = item.next_sibling()) {
                     if (strcmp(item.name(), "item") != 0) continue;
 
-                        std::string id(iq->as_node.c_str());
-                        char *str = const_cast<char *>(id.c_str());
-                        char *saveptr;
-                        char *af = strtok_r(str, "/", &saveptr);
-                        char *safi = strtok_r(NULL, "/", &saveptr);
-
-                        if (atoi(af) == BgpAf::IPv4 &&
-                            atoi(safi) == BgpAf::Unicast) {
-                            ProcessItem(iq->node, item, iq->is_as_node);
-                        } else if (atoi(af) == BgpAf::IPv4 &&
-                            atoi(safi) == BgpAf::Mcast) {
-                            ProcessMcastItem(iq->node, item, iq->is_as_node);
-                        } else if (atoi(af) == BgpAf::L2Vpn &&
-                                   atoi(safi) == BgpAf::Enet) {
-                            ProcessEnetItem(iq->node, item, iq->is_as_node);
-                        }
+                    if (af == BgpAf::IPv4 && safi == BgpAf::Unicast) {
+                        ProcessItem(iq->node, item, iq->is_as_node);
+                    } else if (af == BgpAf::IPv4 && safi == BgpAf::Mcast) {
+                        ProcessMcastItem(iq->node, item, iq->is_as_node);
+                    } else if (af == BgpAf::L2Vpn && safi == BgpAf::Enet) {
+                        ProcessEnetItem(iq->node, item, iq->is_as_node);
+                    }
                 }
+                FlushRequestBatch();
             }
         }
     }
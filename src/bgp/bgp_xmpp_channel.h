@@ -7,6 +7,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include <boost/function.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -22,6 +23,7 @@ class xml_node;
 }
 
 class BgpServer;
+class BgpTable;
 struct DBRequest;
 class IPeer;
 class PeerCloseManager;
@@ -41,6 +43,23 @@ public:
         int unreach;
     };
 
+    // Route ingest statistics. Route requests from a publish message are
+    // enqueued to each table in one batch. The rate is measured over the
+    // last complete interval of kIngestRateIntervalUsecs.
+    struct IngestStats {
+        IngestStats();
+        uint64_t batches;
+        uint64_t requests;
+        uint64_t max_batch_size;
+        uint64_t total_enqueue_usecs;
+        uint64_t requests_per_sec;
+        uint64_t max_requests_per_sec;
+        uint64_t interval_start;
+        uint64_t interval_requests;
+    };
+
+    static const uint64_t kIngestRateIntervalUsecs = 1000000;
+
     BgpXmppChannel(XmppChannel *, BgpServer *, BgpXmppChannelManager *);
     virtual ~BgpXmppChannel();
 
@@ -55,6 +74,7 @@ public:
     const XmppSession *GetSession() const;
     const Stats &rx_stats() const { return stats_[0]; }
     const Stats &tx_stats() const { return stats_[1]; }
+    const IngestStats &ingest_stats() const { return ingest_stats_; }
     void set_deleted(bool deleted) { deleted_ = deleted; }
     bool deleted() { return deleted_; }
     void RoutingInstanceCreateCallback(std::string vrf_name);
@@ -96,6 +116,9 @@ private:
     typedef std::pair<const std::string, const std::string> VrfTableName;
     typedef std::multimap<VrfTableName, DBRequest *> DeferQ;
 
+    // Route requests built from a publish message, grouped by table.
+    typedef std::map<BgpTable *, std::vector<DBRequest *> > RequestBatch;
+
     virtual void ReceiveUpdate(const XmppStanza::XmppMessage *msg);
 
     void ProcessItem(std::string rt_instance, const pugi::xml_node &item,
@@ -113,6 +136,8 @@ private:
     bool MembershipResponseHandler(std::string table_name);
     void MembershipRequestCallback(IPeer *ipeer, BgpTable *table);
     void DequeueRequest(const std::string &table_name, DBRequest *request);
+    void BatchRequest(BgpTable *table, DBRequest *req);
+    void FlushRequestBatch();
     bool XmppDecodeAddress(int af, const std::string &address,
                            IpAddress *addrp);
     bool ResumeClose();
@@ -131,6 +156,9 @@ private:
     // DB Requests pending membership request response.
     DeferQ defer_q_;
 
+    // DB Requests for the publish message being processed.
+    RequestBatch request_batch_;
+
     RoutingTableMembershipRequestMap routingtable_membership_request_map_;
     VrfMembershipRequestMap vrf_membership_request_map_;
     BgpXmppChannelManager *manager_;
@@ -140,6 +168,7 @@ private:
 
     // statistics
     Stats stats_[2];
+    IngestStats ingest_stats_;
 
     // Label block manager for multicast labels.
     LabelBlockManagerPtr lb_mgr_;
@@ -28,7 +28,7 @@ std::string CommunitySpec::ToString() const {
     return std::string(repr);
 }
 
-Community::Community(CommunityDB *comm_db, const CommunitySpec spec)
+Community::Community(CommunityDB *comm_db, const CommunitySpec &spec)
     : comm_db_(comm_db), communities_(spec.communities) {
     refcount_ = 0;
     std::sort(communities_.begin(), communities_.end());
@@ -122,7 +122,7 @@ void ExtCommunity::RemoveOriginVn() {
 }
 
 ExtCommunity::ExtCommunity(ExtCommunityDB *extcomm_db,
-        const ExtCommunitySpec spec) : extcomm_db_(extcomm_db) {
+        const ExtCommunitySpec &spec) : extcomm_db_(extcomm_db) {
     refcount_ = 0;
     for (std::vector<uint64_t>::const_iterator it = spec.communities.begin();
          it < spec.communities.end(); it++) {
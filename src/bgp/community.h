@@ -46,7 +46,13 @@ public:
     };
 
     Community(CommunityDB *comm_db) : comm_db_(comm_db) { refcount_ = 0; }
-    explicit Community(CommunityDB *comm_db, const CommunitySpec spec);
+    explicit Community(CommunityDB *comm_db, const CommunitySpec &spec);
+
+    // Copy constructor
+    explicit Community(const Community &rhs)
+        : comm_db_(rhs.comm_db_), communities_(rhs.communities_) {
+        refcount_ = 0;
+    }
 
     virtual ~Community() { }
     virtual void Remove();
@@ -90,15 +96,8 @@ inline void intrusive_ptr_release(const Community *ccomm) {
 
 typedef boost::intrusive_ptr<const Community> CommunityPtr;
 
-struct CommunityCompare {
-    bool operator()(const Community *lhs, const Community *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class CommunityDB : public BgpPathAttributeDB<Community, CommunityPtr,
-                                              CommunitySpec, CommunityCompare,
-                                              CommunityDB> {
+                                              CommunitySpec, CommunityDB> {
 public:
     CommunityDB(BgpServer *server);
     virtual ~CommunityDB() { }
@@ -140,7 +139,7 @@ public:
     }
 
     explicit ExtCommunity(ExtCommunityDB *extcomm_db,
-                          const ExtCommunitySpec spec);
+                          const ExtCommunitySpec &spec);
     virtual ~ExtCommunity() { }
     virtual void Remove();
     int CompareTo(const ExtCommunity &rhs) const;
@@ -226,15 +225,8 @@ inline void intrusive_ptr_release(const ExtCommunity *cextcomm) {
 
 typedef boost::intrusive_ptr<const ExtCommunity> ExtCommunityPtr;
 
-struct ExtCommunityCompare {
-    bool operator()(const ExtCommunity *lhs, const ExtCommunity *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class ExtCommunityDB : public BgpPathAttributeDB<ExtCommunity, ExtCommunityPtr,
                                                  ExtCommunitySpec,
-                                                 ExtCommunityCompare,
                                                  ExtCommunityDB> {
 public:
     ExtCommunityDB(BgpServer *server);
@@ -45,13 +45,13 @@ std::auto_ptr<DBEntry> EnetTable::AllocEntryStr(
 size_t EnetTable::Hash(const DBRequestKey *key) const {
     const RequestKey *rkey = static_cast<const RequestKey *>(key);
     size_t value = HashFunction(rkey->prefix);
-    return value % DB::PartitionCount();
+    return value;
 }
 
 size_t EnetTable::Hash(const DBEntry *entry) const {
     const EnetRoute *rt_entry = static_cast<const EnetRoute *>(entry);
     size_t value = HashFunction(rt_entry->GetPrefix());
-    return value % DB::PartitionCount();
+    return value;
 }
 
 BgpRoute *EnetTable::TableFind(DBTablePartition *rtp,
@@ -46,13 +46,13 @@ std::auto_ptr<DBEntry> EvpnTable::AllocEntryStr(
 size_t EvpnTable::Hash(const DBRequestKey *key) const {
     const RequestKey *rkey = static_cast<const RequestKey *>(key);
     size_t value = HashFunction(rkey->prefix);
-    return value % DB::PartitionCount();
+    return value;
 }
 
 size_t EvpnTable::Hash(const DBEntry *entry) const {
     const EvpnRoute *rt_entry = static_cast<const EvpnRoute *>(entry);
     size_t value = HashFunction(rt_entry->GetPrefix());
-    return value % DB::PartitionCount();
+    return value;
 }
 
 BgpRoute *EvpnTable::TableFind(DBTablePartition *rtp,
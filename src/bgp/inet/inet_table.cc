@@ -34,13 +34,13 @@ std::auto_ptr<DBEntry> InetTable::AllocEntryStr(const std::string &key_str) cons
 size_t InetTable::Hash(const DBEntry *entry) const {
     const InetRoute *rt_entry = static_cast<const InetRoute *>(entry);
     size_t value = HashFunction(rt_entry->GetPrefix());
-    return value % DB::PartitionCount();
+    return value;
 }
 
 size_t InetTable::Hash(const DBRequestKey *key) const {
     const RequestKey *rkey = static_cast<const RequestKey *>(key);
     size_t value = HashFunction(rkey->prefix);
-    return value % DB::PartitionCount();
+    return value;
 }
 
 BgpRoute *InetTable::TableFind(DBTablePartition *rtp, const DBRequestKey *prefix) {
@@ -43,13 +43,13 @@ std::auto_ptr<DBEntry> InetMcastTable::AllocEntryStr(
 size_t InetMcastTable::Hash(const DBRequestKey *key) const {
     const RequestKey *rkey = static_cast<const RequestKey *>(key);
     size_t value = HashFunction(rkey->prefix);
-    return value % DB::PartitionCount();
+    return value;
 }
 
 size_t InetMcastTable::Hash(const DBEntry *entry) const {
     const InetMcastRoute *rt_entry = static_cast<const InetMcastRoute *>(entry);
     size_t value = HashFunction(rt_entry->GetPrefix());
-    return value % DB::PartitionCount();
+    return value;
 }
 
 BgpRoute *InetMcastTable::TableFind(DBTablePartition *rtp,
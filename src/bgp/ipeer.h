@@ -10,6 +10,7 @@
 
 class BgpServer;
 class PeerCloseManager;
+class RouteChangeStats;
 
 class IPeerUpdate {
 public:
@@ -53,12 +54,15 @@ public:
 
     struct SocketStats {
         SocketStats() : calls(0), bytes(0), blocked_count(0),
-                        blocked_duration_usecs(0) {
+                        blocked_duration_usecs(0), syscalls(0),
+                        syscall_bytes(0) {
         }
         uint64_t calls;
         uint64_t bytes;
         uint64_t blocked_count;
         uint64_t blocked_duration_usecs;
+        uint64_t syscalls;
+        uint64_t syscall_bytes;
     };
 
     virtual ~IPeerDebugStats() { }
@@ -87,6 +91,9 @@ public:
 
     virtual void UpdateTxReachRoute(uint32_t count) = 0;
     virtual void UpdateTxUnreachRoute(uint32_t count) = 0;
+
+    // Adds, changes and deletes of the peer's paths in the tables.
+    virtual RouteChangeStats *route_change_stats() { return NULL; }
 };
 
 class IPeerClose {
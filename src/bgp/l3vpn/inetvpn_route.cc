@@ -9,7 +9,7 @@
 using namespace std;
 
 InetVpnRoute::InetVpnRoute(const InetVpnPrefix &prefix)
-    : prefix_(prefix) {
+    : prefix_(prefix), index_node_(NULL) {
 }
 
 int InetVpnRoute::CompareTo(const Route &rhs) const {
@@ -43,8 +43,12 @@ public:
     virtual u_int8_t Safi() const { return BgpAf::Vpn; }
     virtual bool IsMoreSpecific(const std::string &match) const;
 
+    virtual void *index_node() const { return index_node_; }
+    virtual void set_index_node(void *node) { index_node_ = node; }
+
 private:
     InetVpnPrefix prefix_;
+    void *index_node_;
     DISALLOW_COPY_AND_ASSIGN(InetVpnRoute);
 };
 
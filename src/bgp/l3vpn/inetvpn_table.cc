@@ -37,14 +37,14 @@ size_t InetVpnTable::Hash(const DBEntry *entry) const {
     const InetVpnPrefix &inetvpnprefix = rt_entry->GetPrefix();
     Ip4Prefix prefix(inetvpnprefix.addr(), inetvpnprefix.prefixlen());
     size_t value = InetTable::HashFunction(prefix);
-    return value % DB::PartitionCount();
+    return value;
 }
 
 size_t InetVpnTable::Hash(const DBRequestKey *key) const {
     const RequestKey *rkey = static_cast<const RequestKey *>(key);
     Ip4Prefix prefix(rkey->prefix.addr(), rkey->prefix.prefixlen());
     size_t value = InetTable::HashFunction(prefix);
-    return value % DB::PartitionCount();
+    return value;
 }
 
 BgpRoute *InetVpnTable::TableFind(DBTablePartition *rtp, const DBRequestKey *prefix) {
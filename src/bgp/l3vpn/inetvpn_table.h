@@ -31,6 +31,10 @@ public:
 
     virtual Address::Family family() const { return Address::INETVPN; }
 
+    // The VPN table holds the routes of all the VRFs, and is searched and
+    // walked far more than any other table.
+    virtual IndexType index_type() const { return INDEX_BTREE; }
+
     virtual size_t Hash(const DBEntry *entry) const;
     virtual size_t Hash(const DBRequestKey *key) const;
 
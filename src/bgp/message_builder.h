@@ -5,6 +5,8 @@
 #ifndef ctrlplane_message_builder_h
 #define ctrlplane_message_builder_h
 
+#include <string>
+
 #include "bgp/bgp_ribout.h"
 
 class BgpRoute;
@@ -18,6 +20,13 @@ public:
     virtual bool AddRoute(const BgpRoute *route, const RibOutAttr *roattr) = 0;
     virtual void Finish() = 0;
     virtual const uint8_t *GetData(IPeerUpdate *peer_update, size_t *lenp) = 0;
+    // Variant of GetData that can be called for different peers at the same
+    // time.  Any per-peer data is formatted into the buffer instead of the
+    // message itself.
+    virtual const uint8_t *GetDataBuffered(IPeerUpdate *peer_update,
+                                           size_t *lenp, std::string *buffer) {
+        return GetData(peer_update, lenp);
+    }
     uint32_t num_reach_routes() const { 
         return num_reach_route_; 
     }
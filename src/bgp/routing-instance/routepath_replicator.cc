@@ -23,6 +23,7 @@
 #include "bgp/origin-vn/origin_vn.h"
 #include "bgp/routing-instance/routing_instance.h"
 #include "bgp/routing-instance/rtarget_group.h"
+#include "bgp/routing-instance/rtarget_group_mgr.h"
 #include "bgp/routing-instance/routing_instance_analytics_types.h"
 #include "db/db_table_partition.h"
 #include "db/db_table_walker.h"
@@ -220,6 +221,9 @@ void RoutePathReplicator::Join(BgpTable *table, const RouteTarget &rt,
 
     RPR_TRACE(TableJoin, table->name(), rt.ToString(), import);
     if (import) {
+        // Ask peers for the routes that are imported by local instances.
+        if (!table->routing_instance()->IsDefaultRoutingInstance())
+            server()->rtarget_group_mgr()->AddRouteTarget(rt);
         BOOST_FOREACH(BgpTable *bgptable, group->GetExportTables()) {
             RequestWalk(bgptable);
         }
@@ -256,6 +260,8 @@ void RoutePathReplicator::Leave(BgpTable *table, const RouteTarget &rt,
 
     if (import) {
         group->RemoveImportTable(table);
+        if (!table->routing_instance()->IsDefaultRoutingInstance())
+            server()->rtarget_group_mgr()->RemoveRouteTarget(rt);
         BOOST_FOREACH(BgpTable *bgptable, group->GetExportTables()) {
             RequestWalk(bgptable);
         }
@@ -11,10 +11,13 @@
 #include "bgp/bgp_config.h"
 #include "bgp/bgp_factory.h"
 #include "bgp/bgp_log.h"
+#include "bgp/bgp_route_stats.h"
 #include "bgp/bgp_server.h"
+#include "bgp/bgp_table.h"
 #include "bgp/routing-instance/peer_manager.h"
 #include "bgp/routing-instance/routepath_replicator.h"
 #include "bgp/routing-instance/routing_instance_trace.h"
+#include "bgp/routing-instance/rtarget_group_mgr.h"
 #include "bgp/routing-instance/service_chaining.h"
 #include "bgp/routing-instance/static_route.h"
 #include "db/db_table.h"
@@ -400,6 +403,24 @@ void RoutingInstanceMgr::DestroyRoutingInstance(RoutingInstance *rtinstance) {
     }
 }
 
+//
+// Concurrency: Called from BGP config task manager
+//
+// Send the statistics UVE for all routing instances. This is invoked
+// periodically, and the rates in the UVE are for the interval since the
+// previous invocation.
+//
+void RoutingInstanceMgr::SendStatsUve() {
+    CHECK_CONCURRENCY("bgp::Config");
+
+    uint64_t now_usecs = UTCTimestampUsec();
+    for (RoutingInstanceIterator it = begin(); it != end(); ++it) {
+        RoutingInstanceStatsData data;
+        it->FillStatsInfo(&data, now_usecs);
+        RoutingInstanceStats::Send(data);
+    }
+}
+
 class RoutingInstance::DeleteActor : public LifetimeActor {
 public:
     DeleteActor(BgpServer *server, RoutingInstance *parent)
@@ -462,6 +483,8 @@ void RoutingInstance::ProcessConfig(BgpServer *server) {
     if (name_ == BgpConfigManager::kMasterInstance) {
         InetVpnTableCreate(server);
         EvpnTableCreate(server);
+        RTargetTableCreate(server);
+        server->rtarget_group_mgr()->RegisterTables(this);
 
         BgpTable *table_inet = static_cast<BgpTable *>(
                 server->database()->CreateTable("inet.0"));
@@ -709,6 +732,8 @@ void RoutingInstance::ManagedDelete() {
 
 void RoutingInstance::Shutdown() {
     CHECK_CONCURRENCY("bgp::Config");
+    if (IsDefaultRoutingInstance())
+        server()->rtarget_group_mgr()->UnregisterTables();
     ClearRouteTarget();
 
     server()->service_chain_mgr()->StopServiceChain(this);
@@ -815,6 +840,23 @@ BgpTable *RoutingInstance::EvpnTableCreate(BgpServer *server) {
     return vpntbl;
 }
 
+//
+// The route target table is only created if the rtarget library has been
+// linked in.
+//
+BgpTable *RoutingInstance::RTargetTableCreate(BgpServer *server) {
+    BgpTable *rtargettbl = static_cast<BgpTable *>(
+            server->database()->CreateTable("bgp.rtarget.0"));
+    if (rtargettbl == NULL)
+        return NULL;
+
+    ROUTING_INSTANCE_TRACE(TableCreate, server, name(), rtargettbl->name(),
+                           Address::FamilyToString(Address::RTARGET));
+
+    AddTable(rtargettbl);
+    return rtargettbl;
+}
+
 void RoutingInstance::AddTable(BgpTable *tbl) {
     vrf_table_.insert(std::make_pair(tbl->name(), tbl));
     tbl->set_routing_instance(this);
@@ -867,6 +909,8 @@ std::string RoutingInstance::GetTableNameFromVrf(std::string name,
         table_name = "bgp.l3vpn.0";
     } else if (fmly == Address::EVPN) {
         table_name = "bgp.evpn.0";
+    } else if (fmly == Address::RTARGET) {
+        table_name = "bgp.rtarget.0";
     } else if (name == BgpConfigManager::kMasterInstance) {
         table_name = Address::FamilyToString(fmly) + ".0";
     } else {
@@ -903,6 +947,50 @@ RoutingInstanceInfo RoutingInstance::GetDataCollection(const char *operation) {
     return info;
 }
 
+void RoutingInstance::FillStatsInfo(RoutingInstanceStatsData *data,
+                                    uint64_t now_usecs) {
+    data->set_name(name_);
+    if (deleted()) {
+        data->set_deleted(true);
+        return;
+    }
+
+    RouteChangeStats::Counters total_rates;
+    vector<RoutingTableStats> table_stats_list;
+    for (RouteTableList::iterator it = vrf_table_.begin();
+         it != vrf_table_.end(); ++it) {
+        BgpTable *table = it->second;
+        RouteChangeStats::Counters counters, rates;
+        table->route_change_stats()->Sample(now_usecs, &counters, &rates);
+        UpdateDwellStats::Snapshot dwell;
+        table->dwell_stats()->Sample(&dwell);
+
+        RoutingTableStats table_stats;
+        table_stats.set_name(table->name());
+        table_stats.set_adds(counters.count[RouteChangeStats::ADD]);
+        table_stats.set_changes(counters.count[RouteChangeStats::CHANGE]);
+        table_stats.set_deletes(counters.count[RouteChangeStats::DELETE]);
+        table_stats.set_adds_per_sec(rates.count[RouteChangeStats::ADD]);
+        table_stats.set_changes_per_sec(
+            rates.count[RouteChangeStats::CHANGE]);
+        table_stats.set_deletes_per_sec(
+            rates.count[RouteChangeStats::DELETE]);
+        table_stats.set_dwell_samples(dwell.samples);
+        table_stats.set_average_dwell_usecs(dwell.average_usecs);
+        table_stats.set_max_dwell_usecs(dwell.max_usecs);
+        table_stats_list.push_back(table_stats);
+
+        for (int op = 0; op < RouteChangeStats::OPERATION_COUNT; op++) {
+            total_rates.count[op] += rates.count[op];
+        }
+    }
+
+    data->set_adds_per_sec(total_rates.count[RouteChangeStats::ADD]);
+    data->set_changes_per_sec(total_rates.count[RouteChangeStats::CHANGE]);
+    data->set_deletes_per_sec(total_rates.count[RouteChangeStats::DELETE]);
+    data->set_table_stats(table_stats_list);
+}
+
 //
 // Return true if one of the route targets in the ExtCommunity is in the
 // set of export RouteTargets for this RoutingInstance.
@@ -36,6 +36,7 @@ class BgpTable;
 class RouteDistinguisher;
 class RoutingInstanceMgr;
 class RoutingInstanceInfo;
+class RoutingInstanceStatsData;
 class BgpNeighborResp;
 class LifetimeActor;
 class PeerManager;
@@ -102,6 +103,7 @@ public:
 
     const RoutingInstanceMgr *manager() const { return mgr_; }
     RoutingInstanceInfo GetDataCollection(const char *operation);
+    void FillStatsInfo(RoutingInstanceStatsData *data, uint64_t now_usecs);
 
     BgpServer *server();
 
@@ -120,6 +122,7 @@ private:
 
     BgpTable *InetVpnTableCreate(BgpServer *server);
     BgpTable *EvpnTableCreate(BgpServer *server);
+    BgpTable *RTargetTableCreate(BgpServer *server);
 
     std::string name_;
     int index_;
@@ -232,6 +235,8 @@ public:
 
     void DestroyRoutingInstance(RoutingInstance *rtinstance);
 
+    void SendStatsUve();
+
     size_t count() const { return instances_.count(); }
     BgpServer *server() { return server_; }
     LifetimeActor *deleter();
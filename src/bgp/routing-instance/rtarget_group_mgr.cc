@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/routing-instance/rtarget_group_mgr.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+#include "base/task.h"
+#include "base/task_annotations.h"
+#include "base/task_trigger.h"
+#include "bgp/bgp_attr.h"
+#include "bgp/bgp_path.h"
+#include "bgp/bgp_route.h"
+#include "bgp/bgp_server.h"
+#include "bgp/bgp_table.h"
+#include "bgp/community.h"
+#include "bgp/routing-instance/routing_instance.h"
+#include "bgp/rtarget/rtarget_route.h"
+#include "bgp/rtarget/rtarget_table.h"
+#include "db/db_table_partition.h"
+
+using namespace std;
+
+RTargetGroupMgr::RTargetGroupMgr(BgpServer *server)
+    : server_(server),
+      rtarget_table_(NULL),
+      rtarget_listener_id_(DBTableBase::kInvalidId),
+      pending_trigger_(new TaskTrigger(
+          boost::bind(&RTargetGroupMgr::ProcessPending, this),
+          TaskScheduler::GetInstance()->GetTaskId("bgp::Config"), 0)) {
+}
+
+RTargetGroupMgr::~RTargetGroupMgr() {
+}
+
+void RTargetGroupMgr::RegisterTables(RoutingInstance *master) {
+    CHECK_CONCURRENCY("bgp::Config");
+
+    BgpTable *table = master->GetTable(Address::RTARGET);
+    if (table == NULL || rtarget_table_ != NULL)
+        return;
+
+    rtarget_table_ = table;
+    rtarget_partitions_.resize(table->PartitionCount());
+    rtarget_listener_id_ = table->Register(
+        boost::bind(&RTargetGroupMgr::RTargetRouteListener, this, _1, _2));
+
+    static const Address::Family kVpnFamilies[] = {
+        Address::INETVPN, Address::EVPN
+    };
+    for (size_t idx = 0;
+         idx < sizeof(kVpnFamilies) / sizeof(kVpnFamilies[0]); ++idx) {
+        BgpTable *vpn_table = master->GetTable(kVpnFamilies[idx]);
+        if (vpn_table == NULL)
+            continue;
+        VpnTableState *ts = new VpnTableState;
+        ts->partitions.resize(vpn_table->PartitionCount());
+        vpn_tables_.insert(make_pair(vpn_table, ts));
+        ts->id = vpn_table->Register(
+            boost::bind(&RTargetGroupMgr::VpnRouteListener, this, _1, _2));
+    }
+
+    for (LocalRouteTargetMap::const_iterator it = local_rtargets_.begin();
+         it != local_rtargets_.end(); ++it) {
+        EnqueueLocalRoute(it->first, true);
+    }
+}
+
+//
+// Withdraw the local route targets and stop listening to the tables of
+// the master instance, so that they can be deleted.
+//
+void RTargetGroupMgr::UnregisterTables() {
+    CHECK_CONCURRENCY("bgp::Config");
+
+    if (rtarget_table_ == NULL)
+        return;
+
+    for (LocalRouteTargetMap::const_iterator it = local_rtargets_.begin();
+         it != local_rtargets_.end(); ++it) {
+        EnqueueLocalRoute(it->first, false);
+    }
+
+    rtarget_table_->Unregister(rtarget_listener_id_);
+    rtarget_listener_id_ = DBTableBase::kInvalidId;
+    rtarget_partitions_.clear();
+    rtarget_table_ = NULL;
+
+    for (VpnTableMap::iterator it = vpn_tables_.begin();
+         it != vpn_tables_.end(); ++it) {
+        it->first->Unregister(it->second->id);
+        delete it->second;
+    }
+    vpn_tables_.clear();
+
+    {
+        tbb::spin_rw_mutex::scoped_lock lock(rw_mutex_, true);
+        interest_.clear();
+    }
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        pending_.clear();
+    }
+}
+
+void RTargetGroupMgr::AddRouteTarget(const RouteTarget &rtarget) {
+    CHECK_CONCURRENCY("bgp::Config");
+
+    if (local_rtargets_[rtarget]++ == 0)
+        EnqueueLocalRoute(rtarget, true);
+}
+
+void RTargetGroupMgr::RemoveRouteTarget(const RouteTarget &rtarget) {
+    CHECK_CONCURRENCY("bgp::Config");
+
+    LocalRouteTargetMap::iterator loc = local_rtargets_.find(rtarget);
+    assert(loc != local_rtargets_.end());
+    if (--loc->second == 0) {
+        local_rtargets_.erase(loc);
+        EnqueueLocalRoute(rtarget, false);
+    }
+}
+
+void RTargetGroupMgr::EnqueueLocalRoute(const RouteTarget &rtarget,
+                                        bool add) {
+    if (rtarget_table_ == NULL)
+        return;
+
+    DBRequest req;
+    RTargetPrefix prefix(server_->autonomous_system(), rtarget);
+    req.key.reset(new RTargetTable::RequestKey(prefix, NULL));
+    if (add) {
+        req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        BgpAttrSpec attrs;
+        BgpAttrOrigin origin(BgpAttrOrigin::IGP);
+        attrs.push_back(&origin);
+        BgpAttrNextHop nexthop(server_->bgp_identifier());
+        attrs.push_back(&nexthop);
+        BgpAttrPtr attr = server_->attr_db()->Locate(attrs);
+        req.data.reset(new RTargetTable::RequestData(attr, 0, 0));
+    } else {
+        req.oper = DBRequest::DB_ENTRY_DELETE;
+    }
+    rtarget_table_->Enqueue(&req);
+}
+
+//
+// Caller must hold the lock on the interest map.
+//
+bool RTargetGroupMgr::HasInterest(const IPeer *peer,
+                                  const RouteTarget &rtarget) const {
+    InterestMap::const_iterator loc = interest_.find(rtarget);
+    if (loc == interest_.end())
+        return false;
+    return loc->second.find(peer) != loc->second.end();
+}
+
+bool RTargetGroupMgr::IsInterested(const IPeer *peer,
+                                   const RouteTarget &rtarget) const {
+    tbb::spin_rw_mutex::scoped_lock lock(rw_mutex_, false);
+    return HasInterest(peer, RouteTarget()) || HasInterest(peer, rtarget);
+}
+
+void RTargetGroupMgr::FilterPeerSet(RibOut *ribout, const BgpRoute *route,
+                                    RibPeerSet *peerset) const {
+    RibPeerSet candidates;
+    candidates.BuildIntersection(*peerset, ribout->RTargetFilterPeerSet());
+    if (candidates.empty())
+        return;
+
+    const BgpPath *path = route->BestPath();
+    const ExtCommunity *ext_community =
+        path ? path->GetAttr()->ext_community() : NULL;
+
+    tbb::spin_rw_mutex::scoped_lock lock(rw_mutex_, false);
+    for (size_t index = candidates.find_first();
+         index != RibPeerSet::npos; index = candidates.find_next(index)) {
+        const IPeer *peer = ribout->GetRTargetFilterPeer(index);
+        if (HasInterest(peer, RouteTarget()))
+            continue;
+
+        bool interested = false;
+        if (ext_community) {
+            BOOST_FOREACH(const ExtCommunity::ExtCommunityValue &comm,
+                          ext_community->communities()) {
+                if (!ExtCommunity::is_route_target(comm))
+                    continue;
+                if (HasInterest(peer, RouteTarget(comm))) {
+                    interested = true;
+                    break;
+                }
+            }
+        }
+        if (!interested)
+            peerset->reset(index);
+    }
+}
+
+void RTargetGroupMgr::UpdateInterest(const RouteTarget &rtarget,
+        const PeerList &old_peers, const PeerList &new_peers) {
+    PeerList added, removed;
+    set_difference(new_peers.begin(), new_peers.end(),
+                   old_peers.begin(), old_peers.end(), back_inserter(added));
+    set_difference(old_peers.begin(), old_peers.end(),
+                   new_peers.begin(), new_peers.end(), back_inserter(removed));
+
+    bool changed = false;
+    {
+        tbb::spin_rw_mutex::scoped_lock lock(rw_mutex_, true);
+        PeerRefMap &peer_map = interest_[rtarget];
+        BOOST_FOREACH(const IPeer *peer, added) {
+            if (peer_map[peer]++ == 0)
+                changed = true;
+        }
+        BOOST_FOREACH(const IPeer *peer, removed) {
+            PeerRefMap::iterator loc = peer_map.find(peer);
+            assert(loc != peer_map.end());
+            if (--loc->second == 0) {
+                peer_map.erase(loc);
+                changed = true;
+            }
+        }
+        if (peer_map.empty())
+            interest_.erase(rtarget);
+    }
+
+    if (!changed)
+        return;
+
+    tbb::mutex::scoped_lock lock(mutex_);
+    pending_.insert(rtarget);
+    pending_trigger_->Set();
+}
+
+//
+// Track the BGP peers with a feasible path for the route target membership
+// route. Paths without a peer are for local route targets.
+//
+bool RTargetGroupMgr::RTargetRouteListener(DBTablePartBase *root,
+                                           DBEntryBase *entry) {
+    RTargetRoute *rt = static_cast<RTargetRoute *>(entry);
+    RTargetRouteMap &route_map = rtarget_partitions_[root->index()];
+
+    PeerList peers;
+    if (!entry->IsDeleted()) {
+        for (Route::PathList::iterator it = rt->GetPathList().begin();
+             it != rt->GetPathList().end(); ++it) {
+            BgpPath *path = static_cast<BgpPath *>(it.operator->());
+            const IPeer *peer = path->GetPeer();
+            if (!path->IsFeasible() || peer == NULL || peer->IsXmppPeer())
+                continue;
+            peers.push_back(peer);
+        }
+        sort(peers.begin(), peers.end());
+        peers.erase(unique(peers.begin(), peers.end()), peers.end());
+    }
+
+    PeerList old_peers;
+    RTargetRouteMap::iterator loc = route_map.find(rt);
+    if (loc != route_map.end())
+        old_peers.swap(loc->second);
+    if (peers.empty()) {
+        if (loc != route_map.end())
+            route_map.erase(loc);
+    } else {
+        route_map[rt] = peers;
+    }
+
+    if (old_peers != peers)
+        UpdateInterest(rt->GetPrefix().rtarget(), old_peers, peers);
+    return true;
+}
+
+//
+// Index the VPN routes by the route targets of their best path.
+//
+bool RTargetGroupMgr::VpnRouteListener(DBTablePartBase *root,
+                                       DBEntryBase *entry) {
+    BgpTable *table = static_cast<BgpTable *>(root->parent());
+    VpnTableMap::iterator tloc = vpn_tables_.find(table);
+    assert(tloc != vpn_tables_.end());
+    VpnPartition &partition = tloc->second->partitions[root->index()];
+    BgpRoute *rt = static_cast<BgpRoute *>(entry);
+
+    const BgpPath *path = rt->BestPath();
+    bool live = !entry->IsDeleted() && path && path->IsFeasible();
+    RouteTargetList rtargets;
+    if (live && path->GetAttr()->ext_community()) {
+        BOOST_FOREACH(const ExtCommunity::ExtCommunityValue &comm,
+                      path->GetAttr()->ext_community()->communities()) {
+            if (ExtCommunity::is_route_target(comm))
+                rtargets.push_back(RouteTarget(comm));
+        }
+        sort(rtargets.begin(), rtargets.end());
+        rtargets.erase(unique(rtargets.begin(), rtargets.end()),
+                       rtargets.end());
+    }
+
+    VpnRouteMap::iterator loc = partition.routes.find(rt);
+    if (loc != partition.routes.end()) {
+        if (live && loc->second == rtargets)
+            return true;
+        BOOST_FOREACH(const RouteTarget &rtarget, loc->second) {
+            VpnRouteIndex::iterator iloc = partition.index.find(rtarget);
+            assert(iloc != partition.index.end());
+            iloc->second.erase(rt);
+            if (iloc->second.empty())
+                partition.index.erase(iloc);
+        }
+        partition.routes.erase(loc);
+    }
+
+    if (!live)
+        return true;
+
+    BOOST_FOREACH(const RouteTarget &rtarget, rtargets) {
+        partition.index[rtarget].insert(rt);
+    }
+    partition.routes.insert(make_pair(rt, rtargets));
+    return true;
+}
+
+//
+// Notify the VPN routes for the route targets whose set of interested peers
+// changed, so that export policy runs again for them. A change for the
+// default route target affects all VPN routes.
+//
+bool RTargetGroupMgr::ProcessPending() {
+    CHECK_CONCURRENCY("bgp::Config");
+
+    set<RouteTarget> pending;
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        pending.swap(pending_);
+    }
+
+    BOOST_FOREACH(const RouteTarget &rtarget, pending) {
+        for (VpnTableMap::iterator it = vpn_tables_.begin();
+             it != vpn_tables_.end(); ++it) {
+            BgpTable *table = it->first;
+            vector<VpnPartition> &partitions = it->second->partitions;
+            for (size_t idx = 0; idx < partitions.size(); ++idx) {
+                DBTablePartBase *tpart = table->GetTablePartition(idx);
+                if (rtarget.IsNull()) {
+                    for (VpnRouteMap::iterator rloc =
+                         partitions[idx].routes.begin();
+                         rloc != partitions[idx].routes.end(); ++rloc) {
+                        tpart->Notify(rloc->first);
+                    }
+                    continue;
+                }
+                VpnRouteIndex::iterator iloc =
+                    partitions[idx].index.find(rtarget);
+                if (iloc == partitions[idx].index.end())
+                    continue;
+                BOOST_FOREACH(BgpRoute *route, iloc->second) {
+                    tpart->Notify(route);
+                }
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_rtarget_group_mgr_h
+#define ctrlplane_rtarget_group_mgr_h
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+#include <tbb/mutex.h>
+#include <tbb/spin_rw_mutex.h>
+
+#include "base/util.h"
+#include "bgp/bgp_ribout.h"
+#include "bgp/rtarget/rtarget_address.h"
+#include "db/db_table.h"
+
+class BgpRoute;
+class BgpServer;
+class BgpTable;
+class IPeer;
+class RoutingInstance;
+class TaskTrigger;
+
+//
+// Route target constraint (RFC 4684) state for the master instance.
+//
+// The manager listens to bgp.rtarget.0 and keeps track of the set of BGP
+// peers that are interested in each route target. A peer that advertised
+// the default route target prefix is interested in all route targets. VPN
+// routes are only advertised to a peer that negotiated the route target
+// family if the peer is interested in one of the route targets carried by
+// the route. Peers that didn't negotiate the family get all VPN routes.
+//
+// The manager also listens to the VPN tables and indexes the routes by
+// route target, so that only the routes for a route target get notified
+// when the set of peers that are interested in it changes.
+//
+// The route targets imported by local routing instances are originated
+// into bgp.rtarget.0, so that peers advertise the routes that are needed
+// locally.
+//
+// Concurrency: the table listeners run in the db::DBTable task, and only
+// touch the state for their own partition. The interest map is shared by
+// all partitions, and is also read when running export policy, so it is
+// protected by a reader writer lock. Pending notifications are processed
+// in the bgp::Config task, which is exclusive with the db::DBTable task.
+//
+class RTargetGroupMgr {
+public:
+    explicit RTargetGroupMgr(BgpServer *server);
+    ~RTargetGroupMgr();
+
+    // Register with bgp.rtarget.0 and the VPN tables of the master instance.
+    void RegisterTables(RoutingInstance *master);
+    void UnregisterTables();
+
+    // Route targets imported by local routing instances.
+    void AddRouteTarget(const RouteTarget &rtarget);
+    void RemoveRouteTarget(const RouteTarget &rtarget);
+
+    // Remove the peers that are not interested in the route from peerset.
+    void FilterPeerSet(RibOut *ribout, const BgpRoute *route,
+                       RibPeerSet *peerset) const;
+
+    bool IsInterested(const IPeer *peer, const RouteTarget &rtarget) const;
+
+private:
+    typedef std::vector<const IPeer *> PeerList;
+    typedef std::map<BgpRoute *, PeerList> RTargetRouteMap;
+    typedef std::vector<RouteTarget> RouteTargetList;
+    typedef std::map<BgpRoute *, RouteTargetList> VpnRouteMap;
+    typedef std::map<RouteTarget, std::set<BgpRoute *> > VpnRouteIndex;
+    typedef std::map<const IPeer *, int> PeerRefMap;
+    typedef std::map<RouteTarget, PeerRefMap> InterestMap;
+    typedef std::map<RouteTarget, int> LocalRouteTargetMap;
+
+    struct VpnPartition {
+        VpnRouteMap routes;
+        VpnRouteIndex index;
+    };
+
+    struct VpnTableState {
+        DBTableBase::ListenerId id;
+        std::vector<VpnPartition> partitions;
+    };
+    typedef std::map<BgpTable *, VpnTableState *> VpnTableMap;
+
+    bool RTargetRouteListener(DBTablePartBase *root, DBEntryBase *entry);
+    bool VpnRouteListener(DBTablePartBase *root, DBEntryBase *entry);
+    bool ProcessPending();
+
+    void UpdateInterest(const RouteTarget &rtarget, const PeerList &old_peers,
+                        const PeerList &new_peers);
+    bool HasInterest(const IPeer *peer, const RouteTarget &rtarget) const;
+    void EnqueueLocalRoute(const RouteTarget &rtarget, bool add);
+
+    BgpServer *server_;
+    BgpTable *rtarget_table_;
+    DBTableBase::ListenerId rtarget_listener_id_;
+    std::vector<RTargetRouteMap> rtarget_partitions_;
+    VpnTableMap vpn_tables_;
+
+    mutable tbb::spin_rw_mutex rw_mutex_;
+    InterestMap interest_;
+
+    tbb::mutex mutex_;
+    std::set<RouteTarget> pending_;
+    boost::scoped_ptr<TaskTrigger> pending_trigger_;
+
+    LocalRouteTargetMap local_rtargets_;
+
+    DISALLOW_COPY_AND_ASSIGN(RTargetGroupMgr);
+};
+
+#endif
@@ -41,7 +41,20 @@ ServiceChain::ServiceChain(RoutingInstance *src, RoutingInstance *dest,
         error_code ec;
         Ip4Prefix ipam_subnet = Ip4Prefix::FromString(*it, &ec);
         assert(ec == 0);
+        if (prefix_to_routelist_map_.find(ipam_subnet) !=
+            prefix_to_routelist_map_.end()) {
+            continue;
+        }
         prefix_to_routelist_map_[ipam_subnet] = RouteList();
+        aggregate_tree_.Insert(new AggregateNode(ipam_subnet));
+    }
+}
+
+ServiceChain::~ServiceChain() {
+    AggregateNode *node;
+    while ((node = aggregate_tree_.GetNext(NULL)) != NULL) {
+        aggregate_tree_.Remove(node);
+        delete node;
     }
 }
 
@@ -188,32 +201,27 @@ bool ServiceChain::Match(BgpServer *server, BgpTable *table,
     return true;
 }
 
+bool ServiceChain::FindAggregateMatch(const Ip4Prefix &prefix,
+                                      Ip4Prefix *aggregate_match) {
+    AggregateNode key(prefix);
+    AggregateNode *node = aggregate_tree_.LPMFind(&key);
+    if (node == NULL || node->prefix.prefixlen() == prefix.prefixlen()) {
+        return false;
+    }
+    *aggregate_match = node->prefix;
+    return true;
+}
+
 bool ServiceChain::is_more_specific(BgpRoute *route, 
                                     Ip4Prefix *aggregate_match) {
-    unsigned long broadcast = 0xFFFFFFFF;
     InetRoute *inet_route = dynamic_cast<InetRoute *>(route);
-    Ip4Address address = inet_route->GetPrefix().ip4_addr();
-    for(PrefixToRouteListMap::iterator it = prefix_to_route_list_map()->begin();
-        it != prefix_to_route_list_map()->end(); it++) {
-        unsigned long shift_mask = (32 - it->first.prefixlen());
-        if ((it->first.prefixlen() != inet_route->GetPrefix().prefixlen()) &&
-            ((address.to_ulong() & (broadcast << shift_mask)) == 
-             (it->first.ip4_addr().to_ulong() & (broadcast << shift_mask)))) {
-            *aggregate_match = it->first;
-            return true;
-        }
-    }
-    return false;
+    return FindAggregateMatch(inet_route->GetPrefix(), aggregate_match);
 }
 
 bool ServiceChain::is_aggregate(BgpRoute *route) {
     InetRoute *inet_route = dynamic_cast<InetRoute *>(route);
-    for (PrefixToRouteListMap::iterator it = prefix_to_route_list_map()->begin();
-        it != prefix_to_route_list_map()->end(); it++) {
-        if (it->first == inet_route->GetPrefix())
-            return true;
-    }
-    return false;
+    AggregateNode key(inet_route->GetPrefix());
+    return (aggregate_tree_.Find(&key) != NULL);
 }
 
 // RemoveServiceChainRoute
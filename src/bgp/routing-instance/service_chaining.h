@@ -10,6 +10,7 @@
 #include <set>
 
 #include <boost/shared_ptr.hpp>
+#include <base/patricia.h>
 #include <base/queue_task.h>
 
 #include <sandesh/sandesh_types.h>
@@ -49,6 +50,7 @@ public:
 
     ServiceChain(RoutingInstance *src, RoutingInstance *dest, 
                  const std::vector<std::string> &subnets, IpAddress addr);
+    virtual ~ServiceChain();
 
     // Compare config and return whether cfg has updated
     bool CompareServiceChainCfg(const autogen::ServiceChainInfo &cfg);
@@ -143,6 +145,11 @@ public:
     virtual bool Match(BgpServer *server, BgpTable *table, 
                        BgpRoute *route, bool deleted);
 
+    // Find the longest aggregate prefix that is less specific than the
+    // given prefix. A prefix that is itself an aggregate has no match.
+    bool FindAggregateMatch(const Ip4Prefix &prefix,
+                            Ip4Prefix *aggregate_match);
+
     void FillServiceChainInfo(ShowServicechainInfo &info) const; 
 
     void src_table_unregistered() {
@@ -190,12 +197,40 @@ public:
     }
 
 private:
+    //
+    // Node in the prefix tree of the aggregate prefixes. The tree gives the
+    // longest prefix match for routes in the destination table, instead of
+    // a scan of all aggregates.
+    //
+    struct AggregateNode {
+        explicit AggregateNode(const Ip4Prefix &prefix)
+            : prefix(prefix), bytes(prefix.ip4_addr().to_bytes()) {
+        }
+
+        class Key {
+        public:
+            static std::size_t Length(const AggregateNode *node) {
+                return node->prefix.prefixlen();
+            }
+            static char ByteValue(const AggregateNode *node, std::size_t i) {
+                return static_cast<char>(node->bytes[i]);
+            }
+        };
+
+        Ip4Prefix prefix;
+        Ip4Address::bytes_type bytes;
+        Patricia::Node node;
+    };
+    typedef Patricia::Tree<AggregateNode, &AggregateNode::node,
+                           AggregateNode::Key> AggregateTree;
+
     RoutingInstance *src_;
     RoutingInstance *dest_;
     ConnectedPathIdList connected_path_ids_;
     BgpRoute *connected_route_;
     IpAddress service_chain_addr_;
     PrefixToRouteListMap prefix_to_routelist_map_;
+    AggregateTree aggregate_tree_;
     // List of routes from Destination VN for external connectivity
     ExtConnectRouteList ext_connect_routes_;
     bool src_table_unregistered_;
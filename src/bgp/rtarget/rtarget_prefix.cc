@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/rtarget/rtarget_prefix.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+using boost::system::error_code;
+
+// Route Target Membership NLRI Format
+//
+// +---------------------------------------+
+// |      Origin AS (4 octets)             |
+// +---------------------------------------+
+// |      Route Target (8 octets)          |
+// +---------------------------------------+
+//
+// The prefix length is 0 for the default route target, or 96 for a full
+// route target.  Prefixes of any other length cover a range of route
+// targets.  They are treated like the default, which may result in more
+// routes being sent to the peer, but never fewer.
+
+RTargetPrefix::RTargetPrefix(const BgpProtoPrefix &prefix) : as_(0) {
+    if (prefix.prefixlen != kPrefixLen)
+        return;
+    assert(prefix.prefix.size() == kPrefixLen / 8);
+
+    as_ = get_value(&prefix.prefix[0], 4);
+    RouteTarget::bytes_type data;
+    copy(prefix.prefix.begin() + 4, prefix.prefix.end(), data.begin());
+    rtarget_ = RouteTarget(data);
+}
+
+void RTargetPrefix::BuildProtoPrefix(BgpProtoPrefix *prefix) const {
+    prefix->prefix.clear();
+    if (IsDefault()) {
+        prefix->prefixlen = 0;
+        return;
+    }
+
+    prefix->prefixlen = kPrefixLen;
+    prefix->prefix.resize(kPrefixLen / 8, 0);
+    put_value(&prefix->prefix[0], 4, as_);
+    const RouteTarget::bytes_type &data = rtarget_.GetExtCommunity();
+    copy(data.begin(), data.end(), prefix->prefix.begin() + 4);
+}
+
+// Format is <as>:<route-target> e.g. 64512:target:64512:1. The default
+// prefix is 0:target:0:0.
+RTargetPrefix RTargetPrefix::FromString(const string &str, error_code *errorp) {
+    RTargetPrefix prefix;
+
+    size_t pos = str.find(':');
+    if (pos == string::npos) {
+        if (errorp != NULL) {
+            *errorp = make_error_code(boost::system::errc::invalid_argument);
+        }
+        return prefix;
+    }
+
+    string as_str = str.substr(0, pos);
+    char *endptr;
+    unsigned long as = strtoul(as_str.c_str(), &endptr, 10);
+    if (as_str.empty() || *endptr != '\0' || as > 0xFFFFFFFF) {
+        if (errorp != NULL) {
+            *errorp = make_error_code(boost::system::errc::invalid_argument);
+        }
+        return prefix;
+    }
+
+    string rtarget_str = str.substr(pos + 1);
+    if (as == 0 && rtarget_str == "target:0:0")
+        return prefix;
+
+    error_code rtarget_err;
+    RouteTarget rtarget = RouteTarget::FromString(rtarget_str, &rtarget_err);
+    if (rtarget_err != 0) {
+        if (errorp != NULL) {
+            *errorp = rtarget_err;
+        }
+        return prefix;
+    }
+
+    prefix.as_ = as;
+    prefix.rtarget_ = rtarget;
+    return prefix;
+}
+
+string RTargetPrefix::ToString() const {
+    char temp[16];
+    snprintf(temp, sizeof(temp), "%u:", as_);
+    return string(temp) + rtarget_.ToString();
+}
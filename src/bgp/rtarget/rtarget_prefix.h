@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_rtarget_prefix_h
+#define ctrlplane_rtarget_prefix_h
+
+#include <string>
+#include <boost/system/error_code.hpp>
+
+#include "bgp/bgp_attr_base.h"
+#include "bgp/rtarget/rtarget_address.h"
+
+//
+// Route target membership NLRI (RFC 4684). A prefix is the origin AS of the
+// speaker that is interested in the route target, followed by the route
+// target itself. The default prefix, with a null route target, signals an
+// interest in all route targets.
+//
+class RTargetPrefix {
+public:
+    static const int kPrefixLen = (4 + RouteTarget::kSize) * 8;
+
+    RTargetPrefix() : as_(0) { }
+    explicit RTargetPrefix(const BgpProtoPrefix &prefix);
+    RTargetPrefix(uint32_t as, const RouteTarget &rtarget)
+        : as_(as), rtarget_(rtarget) {
+    }
+
+    void BuildProtoPrefix(BgpProtoPrefix *prefix) const;
+
+    static RTargetPrefix FromString(const std::string &str,
+            boost::system::error_code *errorp = NULL);
+    std::string ToString() const;
+
+    bool IsDefault() const { return as_ == 0 && rtarget_.IsNull(); }
+
+    uint32_t as() const { return as_; }
+    const RouteTarget &rtarget() const { return rtarget_; }
+
+private:
+    uint32_t as_;
+    RouteTarget rtarget_;
+};
+
+#endif
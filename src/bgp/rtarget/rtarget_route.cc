@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/rtarget/rtarget_route.h"
+
+#include "bgp/rtarget/rtarget_table.h"
+
+using namespace std;
+
+RTargetRoute::RTargetRoute(const RTargetPrefix &prefix)
+    : prefix_(prefix) {
+}
+
+int RTargetRoute::CompareTo(const Route &rhs) const {
+    const RTargetRoute &other = static_cast<const RTargetRoute &>(rhs);
+    KEY_COMPARE(prefix_.as(), other.prefix_.as());
+    KEY_COMPARE(prefix_.rtarget().GetExtCommunityValue(),
+                other.prefix_.rtarget().GetExtCommunityValue());
+
+    return 0;
+}
+
+string RTargetRoute::ToString() const {
+    return prefix_.ToString();
+}
+
+void RTargetRoute::SetKey(const DBRequestKey *reqkey) {
+    const RTargetTable::RequestKey *key =
+        static_cast<const RTargetTable::RequestKey *>(reqkey);
+    prefix_ = key->prefix;
+}
+
+void RTargetRoute::BuildProtoPrefix(BgpProtoPrefix *prefix,
+        uint32_t label) const {
+    prefix_.BuildProtoPrefix(prefix);
+}
+
+void RTargetRoute::BuildBgpProtoNextHop(vector<uint8_t> &nh,
+        IpAddress nexthop) const {
+    nh.resize(4);
+    const Ip4Address::bytes_type &addr_bytes = nexthop.to_v4().to_bytes();
+    std::copy(addr_bytes.begin(), addr_bytes.end(), nh.begin());
+}
+
+DBEntryBase::KeyPtr RTargetRoute::GetDBRequestKey() const {
+    RTargetTable::RequestKey *key =
+        new RTargetTable::RequestKey(GetPrefix(), NULL);
+    return KeyPtr(key);
+}
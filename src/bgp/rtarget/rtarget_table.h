@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_rtarget_table_h
+#define ctrlplane_rtarget_table_h
+
+#include "bgp/bgp_attr.h"
+#include "bgp/bgp_table.h"
+#include "bgp/rtarget/rtarget_prefix.h"
+#include "bgp/rtarget/rtarget_route.h"
+
+class BgpServer;
+class BgpRoute;
+
+//
+// Route target membership table (bgp.rtarget.0). Routes in this table are
+// not replicated to or from routing instances. They are used to restrict
+// the VPN routes that get advertised to each peer.
+//
+class RTargetTable : public BgpTable {
+public:
+    struct RequestKey : BgpTable::RequestKey {
+        RequestKey(const RTargetPrefix &prefix, const IPeer *ipeer)
+            : prefix(prefix), peer(ipeer) {
+        }
+        RTargetPrefix prefix;
+        const IPeer *peer;
+        virtual const IPeer *GetPeer() const { return peer; }
+    };
+
+    RTargetTable(DB *db, const std::string &name);
+
+    virtual std::auto_ptr<DBEntry> AllocEntry(const DBRequestKey *key) const;
+    virtual std::auto_ptr<DBEntry> AllocEntryStr(const std::string &key) const;
+
+    virtual Address::Family family() const { return Address::RTARGET; }
+
+    virtual size_t Hash(const DBEntry *entry) const;
+    virtual size_t Hash(const DBRequestKey *key) const;
+
+    virtual BgpRoute *RouteReplicate(BgpServer *server, BgpTable *src_table,
+                                     BgpRoute *src_rt, const BgpPath *path,
+                                     ExtCommunityPtr ptr);
+
+    virtual bool Export(RibOut *ribout, Route *route,
+                        const RibPeerSet &peerset,
+                        UpdateInfoSList &info_slist);
+    static DBTableBase *CreateTable(DB *db, const std::string &name);
+
+private:
+    static size_t HashFunction(const RTargetPrefix &prefix);
+    virtual BgpRoute *TableFind(DBTablePartition *rtp,
+                                const DBRequestKey *prefix);
+
+    DISALLOW_COPY_AND_ASSIGN(RTargetTable);
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/rtarget/rtarget_prefix.h"
+
+#include "base/logging.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+class RTargetPrefixTest : public ::testing::Test {
+};
+
+TEST_F(RTargetPrefixTest, Build) {
+    boost::system::error_code ec;
+    RouteTarget rtarget(RouteTarget::FromString("target:64512:1", &ec));
+    EXPECT_EQ(0, ec.value());
+    RTargetPrefix prefix(64512, rtarget);
+    EXPECT_EQ("64512:target:64512:1", prefix.ToString());
+    EXPECT_EQ(64512U, prefix.as());
+    EXPECT_EQ("target:64512:1", prefix.rtarget().ToString());
+    EXPECT_FALSE(prefix.IsDefault());
+}
+
+TEST_F(RTargetPrefixTest, Default) {
+    RTargetPrefix prefix;
+    EXPECT_TRUE(prefix.IsDefault());
+    EXPECT_EQ("0:target:0:0", prefix.ToString());
+}
+
+TEST_F(RTargetPrefixTest, Parse) {
+    boost::system::error_code ec;
+    RTargetPrefix prefix(
+        RTargetPrefix::FromString("64512:target:1.2.3.4:5", &ec));
+    EXPECT_EQ(0, ec.value());
+    EXPECT_EQ("64512:target:1.2.3.4:5", prefix.ToString());
+    EXPECT_EQ(64512U, prefix.as());
+    EXPECT_EQ("target:1.2.3.4:5", prefix.rtarget().ToString());
+}
+
+TEST_F(RTargetPrefixTest, ParseDefault) {
+    boost::system::error_code ec;
+    RTargetPrefix prefix(RTargetPrefix::FromString("0:target:0:0", &ec));
+    EXPECT_EQ(0, ec.value());
+    EXPECT_TRUE(prefix.IsDefault());
+}
+
+TEST_F(RTargetPrefixTest, ParseError) {
+    boost::system::error_code ec;
+    RTargetPrefix::FromString("64512", &ec);
+    EXPECT_NE(0, ec.value());
+
+    ec = boost::system::error_code();
+    RTargetPrefix::FromString("as:target:64512:1", &ec);
+    EXPECT_NE(0, ec.value());
+
+    ec = boost::system::error_code();
+    RTargetPrefix::FromString("4294967296:target:64512:1", &ec);
+    EXPECT_NE(0, ec.value());
+
+    ec = boost::system::error_code();
+    RTargetPrefix::FromString("64512:target:64512", &ec);
+    EXPECT_NE(0, ec.value());
+}
+
+TEST_F(RTargetPrefixTest, ProtoPrefix) {
+    boost::system::error_code ec;
+    RTargetPrefix prefix(
+        RTargetPrefix::FromString("64512:target:64512:1", &ec));
+    BgpProtoPrefix proto_prefix;
+    prefix.BuildProtoPrefix(&proto_prefix);
+    EXPECT_EQ(96, proto_prefix.prefixlen);
+    ASSERT_EQ(12U, proto_prefix.prefix.size());
+    EXPECT_EQ(0, proto_prefix.prefix[0]);
+    EXPECT_EQ(0, proto_prefix.prefix[1]);
+    EXPECT_EQ(0xfc, proto_prefix.prefix[2]);
+    EXPECT_EQ(0x00, proto_prefix.prefix[3]);
+
+    RTargetPrefix prefix2(proto_prefix);
+    EXPECT_EQ(prefix.ToString(), prefix2.ToString());
+}
+
+TEST_F(RTargetPrefixTest, ProtoPrefixDefault) {
+    RTargetPrefix prefix;
+    BgpProtoPrefix proto_prefix;
+    prefix.BuildProtoPrefix(&proto_prefix);
+    EXPECT_EQ(0, proto_prefix.prefixlen);
+    EXPECT_TRUE(proto_prefix.prefix.empty());
+
+    RTargetPrefix prefix2(proto_prefix);
+    EXPECT_TRUE(prefix2.IsDefault());
+}
+
+// Partial prefixes are treated like the default.
+TEST_F(RTargetPrefixTest, ProtoPrefixPartial) {
+    BgpProtoPrefix proto_prefix;
+    proto_prefix.prefixlen = 48;
+    proto_prefix.prefix.resize(6, 0xff);
+    RTargetPrefix prefix(proto_prefix);
+    EXPECT_TRUE(prefix.IsDefault());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+    return result;
+}
@@ -6,6 +6,11 @@
 
 #include <boost/bind.hpp>
 #include <boost/iterator/iterator_facade.hpp>
+#include <boost/shared_ptr.hpp>
+#include <tbb/atomic.h>
+#ifndef _LIBCPP_VERSION
+#include <tbb/compat/condition_variable>
+#endif
 
 #include "base/logging.h"
 #include "base/task.h"
@@ -444,7 +449,69 @@ private:
     SchedulingGroup *group_;
 };
 
-SchedulingGroup::SchedulingGroup() : running_(false), worker_task_(NULL) {
+//
+// This class keeps track of the shards of a parallel send. The Worker and
+// the SendWorker tasks claim shards by incrementing next_ until all of them
+// have been claimed.  Since the Worker runs any shard that hasn't been
+// claimed by a SendWorker, it only ever waits for shards that are already
+// running, and doesn't depend on SendWorkers getting scheduled at all.
+//
+class SchedulingGroup::SendBatch {
+public:
+    SendBatch(int count, SendShardFn fn) : count_(count), fn_(fn), done_(0) {
+        next_ = 0;
+    }
+
+    void Run() {
+        while (true) {
+            int shard = next_.fetch_and_increment();
+            if (shard >= count_)
+                break;
+            fn_(shard);
+            mutex::scoped_lock lock(mutex_);
+            if (++done_ == count_)
+                cond_var_.notify_all();
+        }
+    }
+
+    void Wait() {
+        std::unique_lock<tbb::mutex> lock(mutex_);
+        while (done_ < count_) {
+            cond_var_.wait(lock);
+        }
+    }
+
+private:
+    int count_;
+    SendShardFn fn_;
+    tbb::atomic<int> next_;
+    tbb::mutex mutex_;
+    std::condition_variable cond_var_;
+    int done_;
+};
+
+//
+// A SendWorker may only get to run after the SendBatch is done, so it keeps
+// a reference to the SendBatch instead of assuming that it's still valid.
+//
+class SchedulingGroup::SendWorker : public Task {
+public:
+    explicit SendWorker(boost::shared_ptr<SendBatch> batch)
+        : Task(send_task_id_), batch_(batch) {
+    }
+
+    virtual bool Run() {
+        CHECK_CONCURRENCY("bgp::SendTask");
+        batch_->Run();
+        return true;
+    }
+
+private:
+    boost::shared_ptr<SendBatch> batch_;
+};
+
+SchedulingGroup::SchedulingGroup()
+    : running_(false), worker_task_(NULL), send_workers_(1) {
     if (send_task_id_ == -1) {
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
         send_task_id_ = scheduler->GetTaskId("bgp::SendTask");
@@ -845,6 +912,42 @@ void SchedulingGroup::WorkEnqueue(WorkBase *wentry) {
     }
 }
 
+void SchedulingGroup::set_send_workers(int send_workers) {
+    send_workers_ = send_workers > 1 ? send_workers : 1;
+}
+
+//
+// Return the number of shards to be used to send a message to the peers
+// in the RibPeerSet. Each shard gets at least kMinPeersPerShard peers.
+//
+int SchedulingGroup::SendShardCount(const RibPeerSet &dst) const {
+    if (send_workers_ == 1)
+        return 1;
+    int count = dst.count() / kMinPeersPerShard;
+    if (count > send_workers_)
+        return send_workers_;
+    return count > 1 ? count : 1;
+}
+
+//
+// Concurrency: called from bgp send task.
+//
+// Enqueue a SendWorker for each additional shard and run shards in the
+// context of the calling task till they've all been claimed. Then wait for
+// the shards that are being run by SendWorkers.
+//
+void SchedulingGroup::SendShards(int count, SendShardFn fn) {
+    CHECK_CONCURRENCY("bgp::SendTask");
+
+    boost::shared_ptr<SendBatch> batch(new SendBatch(count, fn));
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    for (int idx = 1; idx < count; idx++) {
+        scheduler->Enqueue(new SendWorker(batch));
+    }
+    batch->Run();
+    batch->Wait();
+}
+
 //
 // Build the RibPeerSet of IPeers for the RibOut that are in sync and out of
 // sync. Note that we need to use bit indices that are specific to the RibOut,
@@ -1137,6 +1240,7 @@ struct WorkQueueDelete<IPeerUpdate *> {
 // Constructor for SchedulingGroupManager. Initialize send ready WorkQueue.
 //
 SchedulingGroupManager::SchedulingGroupManager() :
+    send_workers_(1),
     send_ready_queue_(
             TaskScheduler::GetInstance()->GetTaskId("bgp::SendReadyTask"), 0,
             boost::bind(&SchedulingGroupManager::SendReadyCallback, this, _1)) {
@@ -1146,6 +1250,18 @@ SchedulingGroupManager::~SchedulingGroupManager() {
     STLDeleteValues(&groups_);
 }
 
+//
+// Set the number of parallel send workers for existing and future groups.
+// Should be called before any peers join RibOuts.
+//
+void SchedulingGroupManager::set_send_workers(int send_workers) {
+    send_workers_ = send_workers > 1 ? send_workers : 1;
+    for (GroupList::iterator iter = groups_.begin(); iter != groups_.end();
+         ++iter) {
+        (*iter)->set_send_workers(send_workers_);
+    }
+}
+
 
 //
 // Return the SchedulingGroup for the specified IPeerUpdate.
@@ -1183,6 +1299,7 @@ void SchedulingGroupManager::Join(RibOut *ribout, IPeerUpdate *peer) {
         if (i2 == ribout_map_.end()) {
             // Create new empty group
             sg = new SchedulingGroup();
+            sg->set_send_workers(send_workers_);
             groups_.push_back(sg);
             ribout_map_.insert(make_pair(ribout, sg));
         } else {
@@ -1331,6 +1448,7 @@ void SchedulingGroupManager::Split(
     CHECK_CONCURRENCY("bgp::PeerMembership");
 
     SchedulingGroup *sg2 = new SchedulingGroup();
+    sg2->set_send_workers(send_workers_);
     groups_.push_back(sg2);
 
     // Note that calling the Split method results in the creation of all
@@ -8,6 +8,7 @@
 #include <list>
 #include <map>
 #include <vector>
+#include <boost/function.hpp>
 #include <boost/ptr_container/ptr_deque.hpp>
 #include <tbb/mutex.h>
 
@@ -54,10 +55,22 @@ class GroupPeerSet : public BitSet {
 // WorkRibOut entry after adding a RouteUpdate to an empty UpdateQueue, and
 // the IPeer class which create a WorkPeer entry when it becomes unblocked.
 //
+// The Worker can send each update message to the peers in parallel with the
+// help of additional SendWorker tasks.  The peers are divided into shards by
+// their bit index in the RibOut, so a given peer is always handled by the
+// same shard.  The Worker waits for all shards to be done before it looks at
+// the blocked peers and moves on to the next message, so marker split/merge
+// stays in the Worker and the order of updates sent to a peer is preserved.
+//
 class SchedulingGroup {
 public:
     typedef std::vector<RibOut *> RibOutList;
     typedef std::vector<IPeerUpdate *> PeerList;
+    typedef boost::function<void(int)> SendShardFn;
+
+    // Minimum number of peers per shard that makes a parallel send worth
+    // the cost of handing work to other tasks.
+    static const int kMinPeersPerShard = 32;
 
     SchedulingGroup();
     ~SchedulingGroup();
@@ -102,6 +115,16 @@ public:
     void clear();
     bool empty() const;
 
+    int send_workers() const { return send_workers_; }
+    void set_send_workers(int send_workers);
+
+    // Number of shards to use to send a message to the peers in the set.
+    int SendShardCount(const RibPeerSet &dst) const;
+
+    // Run the function for shards [0, count) in parallel and wait for all of
+    // them to be done.
+    void SendShards(int count, SendShardFn fn);
+
 private:
     friend class RibOutUpdatesTest;
     friend class BgpUpdateTest;
@@ -119,6 +142,8 @@ private:
     typedef IndexMap<IPeerUpdate *, PeerState, GroupPeerSet> PeerStateMap;
     typedef IndexMap<RibOut *, RibState> RibStateMap;
     class Worker;
+    class SendBatch;
+    class SendWorker;
 
     class PeerIterator;
 
@@ -153,6 +178,7 @@ private:
     WorkQueue work_queue_;
     bool running_;
     Worker *worker_task_;
+    int send_workers_;
 
     PeerStateMap peer_state_imap_;
     RibStateMap rib_state_imap_;
@@ -204,6 +230,10 @@ public:
     // Number of SchedulingGroups.
     int size() const { return groups_.size(); }
 
+    // Number of parallel send workers for each SchedulingGroup.
+    int send_workers() const { return send_workers_; }
+    void set_send_workers(int send_workers);
+
 private:
     // Merge two existing scheduling groups.
     SchedulingGroup *Merge(SchedulingGroup *sg1, SchedulingGroup *sg2);
@@ -217,6 +247,7 @@ private:
     GroupList groups_;
     PeerMap peer_map_;
     RibOutMap ribout_map_;
+    int send_workers_;
 
     // Deferred send ready processing.
     WorkQueue<IPeerUpdate *> send_ready_queue_;
@@ -4,11 +4,14 @@
 
 #include <boost/foreach.hpp>
 #include <pthread.h>
+#include <iostream>
+#include <set>
 #include "bgp/bgp_attr.h"
 
 #include "base/logging.h"
 #include "base/task.h"
 #include "base/test/task_test_util.h"
+#include "base/util.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_server.h"
 #include "control-node/control_node.h"
@@ -22,7 +25,8 @@ protected:
           attr_db_(server_.attr_db()),
           aspath_db_(server_.aspath_db()),
           comm_db_(server_.comm_db()),
-          extcomm_db_(server_.extcomm_db()) {
+          extcomm_db_(server_.extcomm_db()),
+          olist_db_(server_.olist_db()) {
     }
 
     void TearDown() {
@@ -36,6 +40,7 @@ protected:
     AsPathDB *aspath_db_;
     CommunityDB *comm_db_;
     ExtCommunityDB *extcomm_db_;
+    BgpOListDB *olist_db_;
 };
 
 TEST_F(BgpAttrTest, UnknownCode) {
@@ -403,6 +408,83 @@ TEST_F(BgpAttrTest, BgpAttrDB) {
     STLDeleteValues(&spec);
 }
 
+TEST_F(BgpAttrTest, BgpOListDB) {
+    BgpOListSpec olist_spec1;
+    olist_spec1.elements.push_back(
+        BgpOListElem(Ip4Address::from_string("10.1.1.1"), 1000));
+    olist_spec1.elements.push_back(
+        BgpOListElem(Ip4Address::from_string("10.1.1.2"), 1001));
+    BgpOListSpec olist_spec2;
+    olist_spec2.elements = olist_spec1.elements;
+    olist_spec2.elements[1].label = 1002;
+
+    BgpAttrSpec spec1;
+    spec1.push_back(&olist_spec1);
+    BgpAttrSpec spec2;
+    spec2.push_back(&olist_spec2);
+
+    // Attributes built from separate but identical olists are the same.
+    BgpAttrPtr ptr1 = attr_db_->Locate(spec1);
+    BgpOListSpec olist_spec3;
+    olist_spec3.elements = olist_spec1.elements;
+    BgpAttrSpec spec3;
+    spec3.push_back(&olist_spec3);
+    BgpAttrPtr ptr2 = attr_db_->Locate(spec3);
+    EXPECT_EQ(ptr1.get(), ptr2.get());
+    EXPECT_EQ(1, olist_db_->Size());
+    EXPECT_EQ(2, ptr1->olist()->elements().size());
+
+    BgpAttrPtr ptr3 = attr_db_->Locate(spec2);
+    EXPECT_NE(ptr1.get(), ptr3.get());
+    EXPECT_NE(ptr1->olist().get(), ptr3->olist().get());
+    EXPECT_EQ(2, attr_db_->Size());
+    EXPECT_EQ(2, olist_db_->Size());
+
+    ptr1.reset();
+    ptr2.reset();
+    ptr3.reset();
+    EXPECT_EQ(0, attr_db_->Size());
+    EXPECT_EQ(0, olist_db_->Size());
+}
+
+//
+// Add and remove enough entries to grow and shrink the hash table a number
+// of times. Entries must remain reachable as their neighbours are removed.
+//
+TEST_F(BgpAttrTest, CommunityDBGrowAndShrink) {
+    static const int kCount = 20000;
+    std::vector<CommunityPtr> ptrs;
+    for (int idx = 0; idx < kCount; idx++) {
+        CommunitySpec spec;
+        spec.communities.push_back(idx);
+        ptrs.push_back(comm_db_->Locate(spec));
+    }
+    EXPECT_EQ(kCount, comm_db_->Size());
+
+    // Remove every entry but one in 16.
+    for (int idx = 0; idx < kCount; idx++) {
+        if (idx % 16 != 0)
+            ptrs[idx].reset();
+    }
+    EXPECT_EQ(kCount / 16, comm_db_->Size());
+
+    for (int idx = 0; idx < kCount; idx++) {
+        CommunitySpec spec;
+        spec.communities.push_back(idx);
+        CommunityPtr ptr = comm_db_->Locate(spec);
+        if (idx % 16 == 0) {
+            EXPECT_EQ(ptrs[idx].get(), ptr.get());
+        } else {
+            EXPECT_EQ(1, ptr->communities().size());
+            EXPECT_EQ(idx, ptr->communities()[0]);
+        }
+    }
+    EXPECT_EQ(kCount / 16, comm_db_->Size());
+
+    ptrs.clear();
+    EXPECT_EQ(0, comm_db_->Size());
+}
+
 // ----- Test multi-threaded issues in path attributes db.
 // Launch a number of threads, that add and delete the same attribute content.
 // Since many threads are launched, we get to uncover most of the concurrency
@@ -462,6 +544,8 @@ template void ConcurrencyTest<Community, CommunityPtr, CommunityDB,
                               CommunitySpec>(CommunityDB *);
 template void ConcurrencyTest<ExtCommunity, ExtCommunityPtr, ExtCommunityDB,
                               ExtCommunitySpec>(ExtCommunityDB *);
+template void ConcurrencyTest<BgpOList, BgpOListPtr, BgpOListDB,
+                              BgpOListSpec>(BgpOListDB *);
 
 TEST_F(BgpAttrTest, BgpAttrDBConcurrency) {
     ConcurrencyTest<BgpAttr, BgpAttrPtr, BgpAttrDB, BgpAttrSpec>(attr_db_);
@@ -481,6 +565,211 @@ TEST_F(BgpAttrTest, ExtCommunityDBConcurrency) {
                     ExtCommunitySpec>(extcomm_db_);
 }
 
+TEST_F(BgpAttrTest, BgpOListDBConcurrency) {
+    ConcurrencyTest<BgpOList, BgpOListPtr, BgpOListDB,
+                    BgpOListSpec>(olist_db_);
+}
+
+//
+// Compare the hash table used by BgpPathAttributeDB with the design it
+// replaced, a std::set protected by a mutex. BenchAttr has about as much
+// content as the scalar fields of a BgpAttr.
+//
+struct BenchAttrSpec {
+    static const int kWords = 8;
+    explicit BenchAttrSpec(uint32_t seed) {
+        for (int i = 0; i < kWords; i++) {
+            values[i] = (i == kWords - 1) ? seed : i;
+        }
+    }
+    uint32_t values[kWords];
+};
+
+class BenchAttrDB;
+class BenchAttrSetDB;
+
+class BenchAttr {
+public:
+    BenchAttr(BenchAttrDB *db, const BenchAttrSpec &spec)
+        : db_(db), set_db_(NULL), spec_(spec) {
+        refcount_ = 0;
+    }
+    BenchAttr(BenchAttrSetDB *set_db, const BenchAttrSpec &spec)
+        : db_(NULL), set_db_(set_db), spec_(spec) {
+        refcount_ = 0;
+    }
+    explicit BenchAttr(const BenchAttr &rhs)
+        : db_(rhs.db_), set_db_(rhs.set_db_), spec_(rhs.spec_) {
+        refcount_ = 0;
+    }
+    virtual ~BenchAttr() { }
+    virtual void Remove();
+
+    int CompareTo(const BenchAttr &rhs) const {
+        for (int i = 0; i < BenchAttrSpec::kWords; i++) {
+            KEY_COMPARE(spec_.values[i], rhs.spec_.values[i]);
+        }
+        return 0;
+    }
+
+    friend std::size_t hash_value(BenchAttr const &attr) {
+        size_t hash = 0;
+        boost::hash_range(hash, attr.spec_.values,
+                          attr.spec_.values + BenchAttrSpec::kWords);
+        return hash;
+    }
+
+private:
+    friend int intrusive_ptr_add_ref(const BenchAttr *cattr);
+    friend int intrusive_ptr_del_ref(const BenchAttr *cattr);
+    friend void intrusive_ptr_release(const BenchAttr *cattr);
+
+    mutable tbb::atomic<int> refcount_;
+    BenchAttrDB *db_;
+    BenchAttrSetDB *set_db_;
+    BenchAttrSpec spec_;
+};
+
+inline int intrusive_ptr_add_ref(const BenchAttr *cattr) {
+    return cattr->refcount_.fetch_and_increment();
+}
+
+inline int intrusive_ptr_del_ref(const BenchAttr *cattr) {
+    return cattr->refcount_.fetch_and_decrement();
+}
+
+inline void intrusive_ptr_release(const BenchAttr *cattr) {
+    int prev = cattr->refcount_.fetch_and_decrement();
+    if (prev == 1) {
+        BenchAttr *attr = const_cast<BenchAttr *>(cattr);
+        attr->Remove();
+        delete attr;
+    }
+}
+
+typedef boost::intrusive_ptr<const BenchAttr> BenchAttrPtr;
+
+class BenchAttrDB : public BgpPathAttributeDB<BenchAttr, BenchAttrPtr,
+                                              BenchAttrSpec, BenchAttrDB> {
+};
+
+// The previous BgpPathAttributeDB, with its default of a single bucket.
+class BenchAttrSetDB {
+public:
+    size_t Size() {
+        tbb::mutex::scoped_lock lock(mutex_);
+        return set_.size();
+    }
+
+    void Delete(BenchAttr *attr) {
+        tbb::mutex::scoped_lock lock(mutex_);
+        set_.erase(attr);
+    }
+
+    BenchAttrPtr Locate(const BenchAttrSpec &spec) {
+        BenchAttr *attr = new BenchAttr(this, spec);
+        while (true) {
+            tbb::mutex::scoped_lock lock(mutex_);
+            std::pair<Set::iterator, bool> ret = set_.insert(attr);
+            int prev = intrusive_ptr_add_ref(*ret.first);
+            if (ret.second || prev > 0) {
+                if (!ret.second)
+                    delete attr;
+                BenchAttrPtr ptr(*ret.first);
+                intrusive_ptr_del_ref(*ret.first);
+                return ptr;
+            }
+            intrusive_ptr_del_ref(*ret.first);
+        }
+    }
+
+private:
+    struct Compare {
+        bool operator()(const BenchAttr *lhs, const BenchAttr *rhs) const {
+            return lhs->CompareTo(*rhs) < 0;
+        }
+    };
+    typedef std::set<BenchAttr *, Compare> Set;
+
+    tbb::mutex mutex_;
+    Set set_;
+};
+
+void BenchAttr::Remove() {
+    if (db_) {
+        db_->Delete(this);
+    } else {
+        set_db_->Delete(this);
+    }
+}
+
+class BgpAttrDBBenchmarkTest : public ::testing::Test {
+protected:
+    struct Result {
+        uint64_t insert_usecs;
+        uint64_t locate_usecs;
+        uint64_t delete_usecs;
+    };
+
+    //
+    // Insert count distinct attributes, locate each of them again while
+    // they are still referenced, which is what happens for most updates
+    // received from peers, and finally release them all.
+    //
+    template <typename DBType>
+    static Result RunDB(DBType *db, size_t count) {
+        Result result;
+        std::vector<BenchAttrPtr> ptrs;
+        ptrs.reserve(count);
+        uint64_t start = UTCTimestampUsec();
+        for (size_t i = 0; i < count; i++) {
+            ptrs.push_back(db->Locate(BenchAttrSpec(i)));
+        }
+        result.insert_usecs = UTCTimestampUsec() - start;
+        EXPECT_EQ(count, db->Size());
+
+        start = UTCTimestampUsec();
+        size_t found = 0;
+        for (size_t i = 0; i < count; i++) {
+            BenchAttrPtr ptr = db->Locate(BenchAttrSpec(i));
+            if (ptr == ptrs[i])
+                found++;
+        }
+        result.locate_usecs = UTCTimestampUsec() - start;
+        EXPECT_EQ(count, found);
+
+        start = UTCTimestampUsec();
+        ptrs.clear();
+        result.delete_usecs = UTCTimestampUsec() - start;
+        EXPECT_EQ(0, db->Size());
+        return result;
+    }
+
+    static void Print(const char *name, size_t count, const Result &result) {
+        std::cout << name << " " << count << " attributes:"
+                  << " insert " << result.insert_usecs << " usecs,"
+                  << " locate " << result.locate_usecs << " usecs,"
+                  << " delete " << result.delete_usecs << " usecs"
+                  << std::endl;
+    }
+
+    static void Run(size_t count) {
+        BenchAttrSetDB set_db;
+        Print("Set      ", count, RunDB(&set_db, count));
+        BenchAttrDB db;
+        Print("HashTable", count, RunDB(&db, count));
+    }
+};
+
+// Not part of the regular run, use --gtest_also_run_disabled_tests to run it.
+TEST_F(BgpAttrDBBenchmarkTest, DISABLED_Benchmark) {
+    Run(10 * 1000);
+    Run(100 * 1000);
+    if (getenv("BGP_ATTR_BENCHMARK_LARGE")) {
+        Run(1000 * 1000);
+    }
+}
+
 static void SetUp() {
     bgp_log_test::init();
     ControlNode::SetDefaultSchedulingPolicy();
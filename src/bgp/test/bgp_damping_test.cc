@@ -0,0 +1,614 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_damping.h"
+
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/functional/factory.hpp>
+#include <tbb/atomic.h>
+
+#include "base/logging.h"
+#include "base/task_annotations.h"
+#include "base/test/task_test_util.h"
+#include "bgp/bgp_attr.h"
+#include "bgp/bgp_config.h"
+#include "bgp/bgp_factory.h"
+#include "bgp/bgp_log.h"
+#include "bgp/bgp_path.h"
+#include "bgp/bgp_peer_close.h"
+#include "bgp/bgp_peer_membership.h"
+#include "bgp/bgp_server.h"
+#include "bgp/bgp_table.h"
+#include "bgp/inet/inet_route.h"
+#include "bgp/inet/inet_table.h"
+#include "bgp/routing-instance/routing_instance.h"
+#include "control-node/control_node.h"
+#include "db/db_table.h"
+#include "io/event_manager.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+class BgpDampingTest : public ::testing::Test {
+protected:
+    static const uint32_t kStart = 1000000;
+
+    BgpDampingTest() {
+        config_.enabled = true;
+        damping_.set_config(config_);
+    }
+
+    virtual void TearDown() {
+        STLDeleteValues(&routes_);
+    }
+
+    void CreateRoutes(int count) {
+        for (int idx = 0; idx < count; idx++) {
+            Ip4Prefix prefix(Ip4Address(0x0a000000 + (idx << 8)), 24);
+            routes_.push_back(new InetRoute(prefix));
+            index_.insert(make_pair(routes_.back(), idx));
+        }
+    }
+
+    BgpDampingConfig config_;
+    BgpDamping damping_;
+    vector<BgpRoute *> routes_;
+    map<BgpRoute *, int> index_;
+};
+
+const uint32_t BgpDampingTest::kStart;
+
+TEST_F(BgpDampingTest, PenaltyDecay) {
+    BgpDampingState state;
+    EXPECT_TRUE(state.empty());
+    EXPECT_FALSE(damping_.Update(&state, BgpDamping::WITHDRAW, false,
+                                 kStart));
+    EXPECT_EQ(1000U, state.penalty());
+    EXPECT_EQ(kStart, state.time());
+
+    // Halved after every half life.
+    EXPECT_EQ(1000U, damping_.Penalty(state, kStart));
+    EXPECT_EQ(500U, damping_.Penalty(state, kStart + config_.half_life));
+    EXPECT_EQ(250U, damping_.Penalty(state, kStart + 2 * config_.half_life));
+
+    // A re-advertisement doesn't add to the decayed penalty.
+    EXPECT_FALSE(damping_.Update(&state, BgpDamping::READVERTISE, false,
+                                 kStart + config_.half_life));
+    EXPECT_EQ(500U, state.penalty());
+
+    // An attribute change does.
+    EXPECT_FALSE(damping_.Update(&state, BgpDamping::CHANGE, false,
+                                 kStart + config_.half_life));
+    EXPECT_EQ(1000U, state.penalty());
+}
+
+TEST_F(BgpDampingTest, SuppressAndReuse) {
+    BgpDampingState state;
+    EXPECT_FALSE(damping_.Update(&state, BgpDamping::WITHDRAW, false,
+                                 kStart));
+    EXPECT_FALSE(damping_.Update(&state, BgpDamping::CHANGE, false,
+                                 kStart));
+    EXPECT_TRUE(damping_.Update(&state, BgpDamping::WITHDRAW, false,
+                                kStart));
+    EXPECT_EQ(2500U, state.penalty());
+
+    // Stays suppressed till the penalty goes below the reuse limit.
+    uint32_t reuse_time = damping_.ReuseTime(state);
+    EXPECT_GT(reuse_time, kStart);
+    EXPECT_FALSE(damping_.CanReuse(state, reuse_time - 2));
+    EXPECT_TRUE(damping_.CanReuse(state, reuse_time));
+    EXPECT_TRUE(damping_.Update(&state, BgpDamping::READVERTISE, true,
+                                reuse_time - 2));
+    EXPECT_FALSE(damping_.Update(&state, BgpDamping::READVERTISE, true,
+                                 reuse_time));
+
+    // The history can be discarded later.
+    uint32_t discard_time = damping_.DiscardTime(state);
+    EXPECT_GT(discard_time, reuse_time);
+    EXPECT_LE(discard_time, reuse_time + config_.half_life + 1);
+    EXPECT_FALSE(damping_.CanDiscard(state, discard_time - 2));
+    EXPECT_TRUE(damping_.CanDiscard(state, discard_time));
+}
+
+TEST_F(BgpDampingTest, MaxSuppressTime) {
+    EXPECT_EQ(12000U, damping_.ceiling());
+
+    BgpDampingState state;
+    for (int idx = 0; idx < 100; idx++) {
+        damping_.Update(&state, BgpDamping::WITHDRAW, true, kStart + idx);
+    }
+    EXPECT_EQ(damping_.ceiling(), state.penalty());
+    uint32_t reuse_time = damping_.ReuseTime(state);
+    EXPECT_LE(reuse_time, kStart + 99 + config_.max_suppress_time + 1);
+    EXPECT_TRUE(damping_.CanReuse(state, reuse_time));
+
+    // The ceiling fits in the state.
+    BgpDampingConfig config;
+    config.max_suppress_time = 10 * config.half_life;
+    BgpDamping damping(config);
+    EXPECT_EQ(65535U, damping.ceiling());
+}
+
+TEST_F(BgpDampingTest, ReuseListBasic) {
+    CreateRoutes(4);
+    BgpDampingReuseList reuse_list(kStart, 10, 16);
+    BgpDampingReuseList::RouteList due;
+
+    reuse_list.Add(routes_[0], kStart + 25);
+    reuse_list.Add(routes_[1], kStart + 45);
+    reuse_list.Add(routes_[2], kStart + 5);
+    EXPECT_EQ(3U, reuse_list.size());
+
+    // A later time doesn't move the route, an earlier one does.
+    reuse_list.Add(routes_[1], kStart + 100);
+    reuse_list.Add(routes_[0], kStart + 15);
+    EXPECT_EQ(3U, reuse_list.size());
+
+    reuse_list.Advance(kStart + 9, &due);
+    EXPECT_TRUE(due.empty());
+    reuse_list.Advance(kStart + 10, &due);
+    ASSERT_EQ(1U, due.size());
+    EXPECT_EQ(routes_[2], due[0]);
+
+    due.clear();
+    reuse_list.Advance(kStart + 20, &due);
+    ASSERT_EQ(1U, due.size());
+    EXPECT_EQ(routes_[0], due[0]);
+
+    // A removed route isn't returned.
+    reuse_list.Remove(routes_[1]);
+    due.clear();
+    reuse_list.Advance(kStart + 60, &due);
+    EXPECT_TRUE(due.empty());
+    EXPECT_TRUE(reuse_list.empty());
+}
+
+TEST_F(BgpDampingTest, ReuseListSpan) {
+    CreateRoutes(4);
+    BgpDampingReuseList reuse_list(kStart, 10, 16);
+    BgpDampingReuseList::RouteList due;
+
+    // Beyond the 160 second span of the wheel.
+    reuse_list.Add(routes_[0], kStart + 500);
+    reuse_list.Add(routes_[1], kStart + 1000);
+    for (uint32_t now = kStart; now < kStart + 500; now += 10) {
+        reuse_list.Advance(now, &due);
+        EXPECT_TRUE(due.empty());
+    }
+    reuse_list.Advance(kStart + 500, &due);
+    ASSERT_EQ(1U, due.size());
+    EXPECT_EQ(routes_[0], due[0]);
+
+    // The wheel falls behind by more than its span.
+    due.clear();
+    reuse_list.Add(routes_[2], kStart + 5000);
+    reuse_list.Advance(kStart + 2000, &due);
+    ASSERT_EQ(1U, due.size());
+    EXPECT_EQ(routes_[1], due[0]);
+    EXPECT_EQ(1U, reuse_list.size());
+
+    due.clear();
+    reuse_list.Advance(kStart + 4990, &due);
+    EXPECT_TRUE(due.empty());
+    reuse_list.Advance(kStart + 5000, &due);
+    ASSERT_EQ(1U, due.size());
+    EXPECT_EQ(routes_[2], due[0]);
+}
+
+//
+// Damping with a clock that the tests move forward.
+//
+class BgpDampingTestClock : public BgpDamping {
+public:
+    static const uint32_t kStart = 1000000;
+
+    BgpDampingTestClock() : now_(kStart) {
+    }
+    virtual uint32_t Now() const { return now_; }
+    void Advance(uint32_t seconds) { now_ += seconds; }
+    void set_now(uint32_t now) { now_ = now; }
+
+private:
+    uint32_t now_;
+};
+
+class BgpPeerMock : public IPeer {
+public:
+    BgpPeerMock(const string &name, BgpServer *server)
+        : name_(name), server_(server) {
+    }
+    virtual string ToString() const { return name_; }
+    virtual string ToUVEKey() const { return name_; }
+    virtual bool SendUpdate(const uint8_t *msg, size_t msgsize) {
+        return true;
+    }
+    virtual BgpServer *server() { return server_; }
+    virtual IPeerClose *peer_close() { return NULL; }
+    virtual IPeerDebugStats *peer_stats() { return NULL; }
+    virtual bool IsReady() const { return true; }
+    virtual bool IsXmppPeer() const { return false; }
+    virtual void Close() { }
+    virtual BgpProto::BgpPeerType PeerType() const { return BgpProto::IBGP; }
+    virtual uint32_t bgp_identifier() const { return 0; }
+    virtual const string GetStateName() const { return "Established"; }
+    virtual void UpdateRefCount(int count) { }
+    virtual tbb::atomic<int> GetRefCount() const {
+        tbb::atomic<int> count;
+        count = 0;
+        return count;
+    }
+
+private:
+    string name_;
+    BgpServer *server_;
+};
+
+//
+// Flap routes from two peers through the requests to a BgpTable and check
+// what gets advertised to the table listeners. The event manager isn't run,
+// so the reuse timers never fire on their own; the tests run the timer
+// handlers once they have moved the clock forward.
+//
+class BgpDampingTableTest : public ::testing::Test {
+protected:
+    BgpDampingTableTest()
+        : server_(&evm_),
+          instance_config_(BgpConfigManager::kMasterInstance),
+          peer_a_("peer-a", &server_),
+          peer_b_("peer-b", &server_),
+          table_(NULL),
+          listener_id_(DBTable::kInvalidId) {
+        notify_count_ = 0;
+    }
+
+    virtual void SetUp() {
+        ConcurrencyScope scope("bgp::Config");
+        BgpDampingConfig config;
+        config.enabled = true;
+        clock()->set_config(config);
+        RoutingInstance *rti =
+            server_.routing_instance_mgr()->CreateRoutingInstance(
+                &instance_config_);
+        table_ = rti->GetTable(Address::INET);
+        listener_id_ = table_->Register(
+            boost::bind(&BgpDampingTableTest::RouteNotify, this, _1, _2));
+    }
+
+    virtual void TearDown() {
+        table_->Unregister(listener_id_);
+        server_.Shutdown();
+        task_util::WaitForIdle();
+    }
+
+    BgpDampingTestClock *clock() {
+        return static_cast<BgpDampingTestClock *>(server_.damping());
+    }
+
+    void RouteNotify(DBTablePartBase *root, DBEntryBase *entry) {
+        notify_count_++;
+    }
+
+    void AddRoute(IPeer *peer, const string &prefix, uint32_t local_pref) {
+        DBRequest request;
+        request.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        request.key.reset(
+            new InetTable::RequestKey(Ip4Prefix::FromString(prefix), peer));
+        BgpAttrSpec attr_spec;
+        BgpAttrLocalPref lpref(local_pref);
+        attr_spec.push_back(&lpref);
+        BgpAttrPtr attr = server_.attr_db()->Locate(attr_spec);
+        request.data.reset(new BgpTable::RequestData(attr, 0, 0));
+        table_->Enqueue(&request);
+        task_util::WaitForIdle();
+    }
+
+    void DeleteRoute(IPeer *peer, const string &prefix) {
+        DBRequest request;
+        request.oper = DBRequest::DB_ENTRY_DELETE;
+        request.key.reset(
+            new InetTable::RequestKey(Ip4Prefix::FromString(prefix), peer));
+        table_->Enqueue(&request);
+        task_util::WaitForIdle();
+    }
+
+    BgpRoute *FindRoute(const string &prefix) {
+        InetTable::RequestKey key(Ip4Prefix::FromString(prefix), NULL);
+        return static_cast<BgpRoute *>(table_->Find(&key));
+    }
+
+    BgpPath *FindPath(IPeer *peer, const string &prefix) {
+        BgpRoute *rt = FindRoute(prefix);
+        return rt ? rt->FindPath(peer) : NULL;
+    }
+
+    const IPeer *BestPeer(const string &prefix) {
+        BgpRoute *rt = FindRoute(prefix);
+        const BgpPath *path = rt ? rt->BestPath() : NULL;
+        return (path && path->IsFeasible()) ? path->GetPeer() : NULL;
+    }
+
+    size_t ReuseListSize() {
+        size_t size = 0;
+        for (size_t part_id = 0; part_id < table_->damping_partitions_.size();
+             part_id++) {
+            BgpTable::DampingPartition *dpart =
+                table_->damping_partitions_[part_id];
+            if (dpart)
+                size += dpart->reuse_list()->size();
+        }
+        return size;
+    }
+
+    // Run the reuse timer handlers in the db::DBTable task, with the
+    // scheduler stopped so that they are exclusive with the table input.
+    void FireReuseTimers() {
+        task_util::TaskSchedulerStop();
+        {
+            ConcurrencyScope scope("db::DBTable");
+            for (size_t part_id = 0;
+                 part_id < table_->damping_partitions_.size(); part_id++) {
+                if (table_->damping_partitions_[part_id])
+                    table_->ProcessDampingReuse(part_id);
+            }
+        }
+        task_util::TaskSchedulerStart();
+        task_util::WaitForIdle();
+    }
+
+    // Walk the path of the peer as the PeerCloseManager does when the peer
+    // closes.
+    void ProcessRibIn(PeerCloseManager *close_manager, const string &prefix,
+                      MembershipRequest::Action action) {
+        BgpRoute *rt = FindRoute(prefix);
+        ASSERT_TRUE(rt != NULL);
+        task_util::TaskSchedulerStop();
+        {
+            ConcurrencyScope scope("db::DBTable");
+            close_manager->ProcessRibIn(table_->GetTablePartition(rt), rt,
+                                        table_, action);
+        }
+        task_util::TaskSchedulerStart();
+        task_util::WaitForIdle();
+    }
+
+    // Withdraw all paths and let the history paths decay till the table is
+    // empty.
+    void DeleteRoutes(const vector<string> &prefixes) {
+        for (vector<string>::const_iterator it = prefixes.begin();
+             it != prefixes.end(); ++it) {
+            DeleteRoute(&peer_a_, *it);
+            DeleteRoute(&peer_b_, *it);
+        }
+        clock()->Advance(2 * clock()->config().max_suppress_time);
+        FireReuseTimers();
+        EXPECT_EQ(0U, table_->Size());
+        EXPECT_EQ(0U, ReuseListSize());
+    }
+
+    EventManager evm_;
+    BgpServer server_;
+    BgpInstanceConfig instance_config_;
+    BgpPeerMock peer_a_;
+    BgpPeerMock peer_b_;
+    BgpTable *table_;
+    DBTable::ListenerId listener_id_;
+    tbb::atomic<int> notify_count_;
+};
+
+const uint32_t BgpDampingTestClock::kStart;
+
+// Flap the best path till it is suppressed, and check that the route is
+// advertised again with the latest attributes once the penalty decays.
+TEST_F(BgpDampingTableTest, SuppressAndReuse) {
+    const string prefix("10.1.1.0/24");
+    AddRoute(&peer_b_, prefix, 100);
+    AddRoute(&peer_a_, prefix, 200);
+    EXPECT_EQ(&peer_a_, BestPeer(prefix));
+
+    // The withdrawn path is kept as a history path.
+    DeleteRoute(&peer_a_, prefix);
+    BgpPath *path = FindPath(&peer_a_, prefix);
+    ASSERT_TRUE(path != NULL);
+    EXPECT_TRUE(path->IsHistory());
+    EXPECT_FALSE(path->IsDampened());
+    EXPECT_EQ(1000U, path->damping_state().penalty());
+    EXPECT_EQ(&peer_b_, BestPeer(prefix));
+    EXPECT_EQ(1U, ReuseListSize());
+
+    AddRoute(&peer_a_, prefix, 200);
+    path = FindPath(&peer_a_, prefix);
+    EXPECT_FALSE(path->IsHistory());
+    EXPECT_FALSE(path->IsDampened());
+    EXPECT_EQ(1000U, path->damping_state().penalty());
+    EXPECT_EQ(&peer_a_, BestPeer(prefix));
+
+    // The second flap reaches the suppress limit.
+    DeleteRoute(&peer_a_, prefix);
+    path = FindPath(&peer_a_, prefix);
+    EXPECT_TRUE(path->IsHistory());
+    EXPECT_TRUE(path->IsDampened());
+    EXPECT_EQ(2000U, path->damping_state().penalty());
+    EXPECT_EQ(1U, table_->GetDampedPathCount());
+
+    // Updates of the suppressed path are not advertised.
+    int notify_count = notify_count_;
+    uint64_t damped_count = table_->GetDampedUpdateCount();
+    AddRoute(&peer_a_, prefix, 200);
+    AddRoute(&peer_a_, prefix, 300);
+    path = FindPath(&peer_a_, prefix);
+    EXPECT_FALSE(path->IsHistory());
+    EXPECT_TRUE(path->IsDampened());
+    EXPECT_EQ(2500U, path->damping_state().penalty());
+    EXPECT_EQ(&peer_b_, BestPeer(prefix));
+    EXPECT_EQ(notify_count, notify_count_);
+    EXPECT_EQ(damped_count + 2, table_->GetDampedUpdateCount());
+
+    // The route first comes due for the history of the first flap, and is
+    // scheduled again for the reuse of the suppressed path.
+    uint32_t reuse_time = clock()->ReuseTime(path->damping_state());
+    clock()->set_now(reuse_time - 2 * BgpDampingReuseList::kGranularity);
+    FireReuseTimers();
+    path = FindPath(&peer_a_, prefix);
+    EXPECT_TRUE(path->IsDampened());
+    EXPECT_EQ(&peer_b_, BestPeer(prefix));
+    EXPECT_EQ(notify_count, notify_count_);
+    EXPECT_EQ(1U, ReuseListSize());
+
+    clock()->set_now(reuse_time + BgpDampingReuseList::kGranularity);
+    FireReuseTimers();
+    path = FindPath(&peer_a_, prefix);
+    EXPECT_FALSE(path->IsDampened());
+    EXPECT_EQ(300U, path->GetAttr()->local_pref());
+    EXPECT_EQ(&peer_a_, BestPeer(prefix));
+    EXPECT_EQ(notify_count + 1, notify_count_);
+    EXPECT_EQ(0U, ReuseListSize());
+
+    DeleteRoutes(vector<string>(1, prefix));
+}
+
+// A route that only has a history path is not usable, and is deleted once
+// the history is discarded.
+TEST_F(BgpDampingTableTest, HistoryOnlyRoute) {
+    const string prefix("10.1.1.0/24");
+    AddRoute(&peer_a_, prefix, 100);
+    DeleteRoute(&peer_a_, prefix);
+    BgpPath *path = FindPath(&peer_a_, prefix);
+    ASSERT_TRUE(path != NULL);
+    EXPECT_TRUE(path->IsHistory());
+    EXPECT_TRUE(BestPeer(prefix) == NULL);
+
+    // Withdrawing the history path again doesn't add to the penalty.
+    DeleteRoute(&peer_a_, prefix);
+    path = FindPath(&peer_a_, prefix);
+    ASSERT_TRUE(path != NULL);
+    EXPECT_EQ(1000U, path->damping_state().penalty());
+
+    uint32_t discard_time = clock()->DiscardTime(path->damping_state());
+    clock()->set_now(discard_time - 2 * BgpDampingReuseList::kGranularity);
+    FireReuseTimers();
+    EXPECT_TRUE(FindPath(&peer_a_, prefix) != NULL);
+    EXPECT_EQ(1U, ReuseListSize());
+
+    clock()->set_now(discard_time + BgpDampingReuseList::kGranularity);
+    FireReuseTimers();
+    EXPECT_TRUE(FindRoute(prefix) == NULL);
+    EXPECT_EQ(0U, ReuseListSize());
+    EXPECT_EQ(0U, table_->Size());
+}
+
+// When the peer closes, history paths are deleted rather than staled, and
+// suppressed paths keep their damping state till they are swept.
+TEST_F(BgpDampingTableTest, PeerClose) {
+    const string prefix1("10.1.1.0/24");
+    const string prefix2("10.1.2.0/24");
+    AddRoute(&peer_b_, prefix1, 100);
+    AddRoute(&peer_a_, prefix1, 200);
+    DeleteRoute(&peer_a_, prefix1);
+    AddRoute(&peer_a_, prefix1, 200);
+    DeleteRoute(&peer_a_, prefix1);
+    AddRoute(&peer_a_, prefix1, 200);
+    EXPECT_TRUE(FindPath(&peer_a_, prefix1)->IsDampened());
+    AddRoute(&peer_a_, prefix2, 100);
+    DeleteRoute(&peer_a_, prefix2);
+    EXPECT_TRUE(FindPath(&peer_a_, prefix2)->IsHistory());
+    EXPECT_EQ(2U, ReuseListSize());
+
+    PeerCloseManager close_manager(&peer_a_);
+    ProcessRibIn(&close_manager, prefix1, MembershipRequest::RIBIN_STALE);
+    ProcessRibIn(&close_manager, prefix2, MembershipRequest::RIBIN_STALE);
+    BgpPath *path = FindPath(&peer_a_, prefix1);
+    ASSERT_TRUE(path != NULL);
+    EXPECT_TRUE(path->IsStale());
+    EXPECT_TRUE(path->IsDampened());
+    EXPECT_EQ(2000U, path->damping_state().penalty());
+    EXPECT_EQ(&peer_b_, BestPeer(prefix1));
+    EXPECT_TRUE(FindRoute(prefix2) == NULL);
+    EXPECT_EQ(1U, ReuseListSize());
+
+    ProcessRibIn(&close_manager, prefix1, MembershipRequest::RIBIN_SWEEP);
+    EXPECT_TRUE(FindPath(&peer_a_, prefix1) == NULL);
+    EXPECT_EQ(&peer_b_, BestPeer(prefix1));
+
+    DeleteRoutes(vector<string>(1, prefix1));
+}
+
+// Flap the best path of a number of routes every few seconds. Only the
+// first flaps are advertised, and the routes are advertised again once they
+// stop flapping.
+TEST_F(BgpDampingTableTest, FlapStorm) {
+    static const int kRouteCount = 16;
+    static const int kFlapCount = 20;
+    static const uint32_t kFlapPeriod = 10;
+    vector<string> prefixes;
+    for (int idx = 0; idx < kRouteCount; idx++) {
+        ostringstream prefix;
+        prefix << "10.1." << idx << ".0/24";
+        prefixes.push_back(prefix.str());
+        AddRoute(&peer_b_, prefixes.back(), 100);
+        AddRoute(&peer_a_, prefixes.back(), 200);
+    }
+
+    int notify_count = notify_count_;
+    uint64_t damped_count = table_->GetDampedUpdateCount();
+    for (int flap = 0; flap < kFlapCount; flap++) {
+        clock()->Advance(kFlapPeriod);
+        for (int idx = 0; idx < kRouteCount; idx++) {
+            DeleteRoute(&peer_a_, prefixes[idx]);
+        }
+        FireReuseTimers();
+        for (int idx = 0; idx < kRouteCount; idx++) {
+            AddRoute(&peer_a_, prefixes[idx], 200);
+        }
+    }
+
+    // Each route is suppressed on its third withdrawal.
+    for (int idx = 0; idx < kRouteCount; idx++) {
+        EXPECT_TRUE(FindPath(&peer_a_, prefixes[idx])->IsDampened());
+        EXPECT_EQ(&peer_b_, BestPeer(prefixes[idx]));
+    }
+    EXPECT_EQ(kRouteCount * 5, notify_count_ - notify_count);
+    EXPECT_EQ(damped_count + kRouteCount * (2 * kFlapCount - 5),
+              table_->GetDampedUpdateCount());
+    EXPECT_EQ(size_t(kRouteCount), ReuseListSize());
+
+    // The penalty is capped, so the routes are reused within the max
+    // suppress time.
+    notify_count = notify_count_;
+    clock()->Advance(clock()->config().max_suppress_time +
+                     BgpDampingReuseList::kGranularity);
+    FireReuseTimers();
+    for (int idx = 0; idx < kRouteCount; idx++) {
+        EXPECT_FALSE(FindPath(&peer_a_, prefixes[idx])->IsDampened());
+        EXPECT_EQ(&peer_a_, BestPeer(prefixes[idx]));
+    }
+    EXPECT_EQ(kRouteCount, notify_count_ - notify_count);
+    EXPECT_EQ(0U, ReuseListSize());
+
+    DeleteRoutes(prefixes);
+}
+
+static void SetUp() {
+    bgp_log_test::init();
+    ControlNode::SetDefaultSchedulingPolicy();
+    BgpObjectFactory::Register<BgpDamping>(
+        boost::factory<BgpDampingTestClock *>());
+}
+
+static void TearDown() {
+    task_util::WaitForIdle();
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Terminate();
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    SetUp();
+    int result = RUN_ALL_TESTS();
+    TearDown();
+    return result;
+}
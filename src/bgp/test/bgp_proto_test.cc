@@ -4,6 +4,7 @@
 
 #include "base/logging.h"
 #include "base/proto.h"
+#include "base/util.h"
 #include "control-node/control_node.h"
 #include "testing/gunit.h"
 #include <boost/assign/list_of.hpp>
@@ -661,6 +662,246 @@ TEST_F(BgpProtoTest, RandomError) {
         GenerateByteError(data, res);
     }
 }
+
+//
+// Build an UPDATE with the attributes that MX gateways send along with
+// inet-vpn and evpn routes.
+//
+static void BuildVpnUpdate(BgpProto::Update *update, uint16_t afi,
+                           uint8_t safi, int count, bool withdraw) {
+    BgpMpNlri *mp_nlri = new BgpMpNlri(withdraw ?
+        BgpAttribute::MPUnreachNlri : BgpAttribute::MPReachNlri, afi, safi);
+    mp_nlri->flags = BgpAttribute::Optional|BgpAttribute::ExtendedLength;
+    if (!withdraw) {
+        update->path_attributes.push_back(
+            new BgpAttrOrigin(BgpAttrOrigin::IGP));
+
+        AsPathSpec *path_spec = new AsPathSpec;
+        AsPathSpec::PathSegment *ps = new AsPathSpec::PathSegment;
+        ps->path_segment_type = AsPathSpec::PathSegment::AS_SEQUENCE;
+        ps->path_segment.push_back(64512);
+        ps->path_segment.push_back(rand() % 1000);
+        path_spec->path_segments.push_back(ps);
+        update->path_attributes.push_back(path_spec);
+
+        update->path_attributes.push_back(new BgpAttrMultiExitDisc(rand()));
+        update->path_attributes.push_back(new BgpAttrLocalPref(100));
+
+        ExtCommunitySpec *ext_community = new ExtCommunitySpec;
+        ext_community->communities.push_back(0x000200000000fc00ULL + rand());
+        ext_community->communities.push_back(0x030c000000000002ULL);
+        update->path_attributes.push_back(ext_community);
+
+        uint8_t nh[4] = {10, 1, 1, 1};
+        mp_nlri->nexthop.assign(&nh[0], &nh[4]);
+    }
+
+    for (int i = 0; i < count; i++) {
+        BgpProtoPrefix *prefix = new BgpProtoPrefix;
+        int len = (afi == BgpAf::L2Vpn) ? 33 : 15;
+        for (int j = 0; j < len; j++)
+            prefix->prefix.push_back(rand() % 256);
+        prefix->prefixlen = len * 8;
+        if (afi == BgpAf::L2Vpn)
+            prefix->type = 2;
+        mp_nlri->nlri.push_back(prefix);
+    }
+    update->path_attributes.push_back(mp_nlri);
+}
+
+//
+// Decode with the fast path and with the generic decoder and verify that
+// they produce the same result.
+//
+static void VerifyFastDecode(const uint8_t *data, size_t size,
+                             bool expect_fast) {
+    const BgpProto::Update *fast = BgpProto::Update::Decode(data, size);
+    const BgpProto::Update *generic = static_cast<const BgpProto::Update *>(
+        BgpProto::Decode(data, size, NULL, false));
+    if (expect_fast) {
+        EXPECT_TRUE(fast != NULL);
+    }
+    if (fast) {
+        ASSERT_TRUE(generic != NULL);
+        EXPECT_EQ(0, fast->CompareTo(*generic));
+        delete fast;
+    }
+    delete generic;
+}
+
+TEST_F(BgpProtoTest, UpdateFastPath) {
+    uint8_t data[4096];
+    for (int withdraw = 0; withdraw < 2; withdraw++) {
+        BgpProto::Update l3vpn;
+        BuildVpnUpdate(&l3vpn, BgpAf::IPv4, BgpAf::Vpn, 100, withdraw);
+        int res = BgpProto::Encode(&l3vpn, data, sizeof(data));
+        ASSERT_NE(-1, res);
+        VerifyFastDecode(data, res, true);
+
+        BgpProto::Update evpn;
+        BuildVpnUpdate(&evpn, BgpAf::L2Vpn, BgpAf::EVpn, 50, withdraw);
+        res = BgpProto::Encode(&evpn, data, sizeof(data));
+        ASSERT_NE(-1, res);
+        VerifyFastDecode(data, res, true);
+    }
+
+    // Messages with attributes that the fast path doesn't handle decode
+    // the same way through the generic decoder.
+    BgpProto::Update update;
+    BgpMessageTest::GenerateUpdateMessage(&update, BgpAf::IPv4, BgpAf::Vpn);
+    int res = BgpProto::Encode(&update, data, sizeof(data));
+    ASSERT_NE(-1, res);
+    EXPECT_TRUE(BgpProto::Update::Decode(data, res) == NULL);
+    const BgpProto::Update *result =
+        static_cast<const BgpProto::Update *>(BgpProto::Decode(data, res));
+    ASSERT_TRUE(result != NULL);
+    EXPECT_EQ(0, result->CompareTo(update));
+    delete result;
+}
+
+TEST_F(BgpProtoTest, UpdateFastPathRandom) {
+    uint8_t data[4096];
+    for (int i = 0; i < 1000; i++) {
+        BgpProto::Update update;
+        BuildUpdateMessage::Generate(&update);
+        int res = BgpProto::Encode(&update, data, sizeof(data));
+        EXPECT_NE(-1, res);
+        VerifyFastDecode(data, res, false);
+    }
+}
+
+//
+// The fast path must not accept anything that the generic decoder rejects.
+//
+TEST_F(BgpProtoTest, UpdateFastPathError) {
+    uint8_t data[4096];
+    BgpProto::Update update;
+    BuildVpnUpdate(&update, BgpAf::IPv4, BgpAf::Vpn, 10, false);
+    int res = BgpProto::Encode(&update, data, sizeof(data));
+    ASSERT_NE(-1, res);
+
+    for (int i = 0; i < 10000; i++) {
+        uint8_t new_data[4096];
+        memcpy(new_data, data, res);
+        new_data[rand() % res] = rand();
+        BgpProto::Update *fast = BgpProto::Update::Decode(new_data, res);
+        BgpProto::BgpMessage *generic =
+            BgpProto::Decode(new_data, res, NULL, false);
+        if (fast) {
+            EXPECT_TRUE(generic != NULL);
+        }
+        delete fast;
+        delete generic;
+    }
+
+    // Truncated messages, with the length in the header adjusted to match.
+    for (int len = BgpProto::kMinMessageSize; len < res; len++) {
+        uint8_t new_data[4096];
+        memcpy(new_data, data, len);
+        put_value(&new_data[16], 2, len);
+        EXPECT_TRUE(BgpProto::Update::Decode(new_data, len) == NULL);
+    }
+}
+
+//
+// Decode throughput for a stream of inet-vpn and evpn UPDATEs, similar to
+// a full table load from an MX gateway. A capture of raw BGP messages, as
+// sent back to back on the session, can be used instead by setting
+// BGP_PROTO_BENCHMARK_CAPTURE to the name of the file.
+//
+class BgpProtoBenchmarkTest : public BgpProtoTest {
+protected:
+    typedef vector<vector<uint8_t> > MessageList;
+
+    static void Generate(MessageList *messages) {
+        uint8_t data[4096];
+        srand(1);
+        for (int i = 0; i < 2000; i++) {
+            BgpProto::Update update;
+            if (i % 2 == 0) {
+                BuildVpnUpdate(&update, BgpAf::IPv4, BgpAf::Vpn, 100,
+                               i % 10 == 0);
+            } else {
+                BuildVpnUpdate(&update, BgpAf::L2Vpn, BgpAf::EVpn, 50,
+                               i % 10 == 1);
+            }
+            int res = BgpProto::Encode(&update, data, sizeof(data));
+            ASSERT_NE(-1, res);
+            messages->push_back(vector<uint8_t>(data, data + res));
+        }
+    }
+
+    static void Load(const char *filename, MessageList *messages) {
+        FILE *file = fopen(filename, "r");
+        ASSERT_TRUE(file != NULL) << filename;
+        uint8_t header[BgpProto::kMinMessageSize];
+        while (fread(header, sizeof(header), 1, file) == 1) {
+            size_t size = get_value(&header[16], 2);
+            if (size < sizeof(header))
+                break;
+            vector<uint8_t> message(header, header + sizeof(header));
+            message.resize(size);
+            if (size > sizeof(header) &&
+                fread(&message[sizeof(header)], size - sizeof(header), 1,
+                      file) != 1)
+                break;
+            if (header[18] == BgpProto::UPDATE)
+                messages->push_back(message);
+        }
+        fclose(file);
+    }
+
+    static size_t PrefixCount(const BgpProto::Update *update) {
+        size_t count = update->withdrawn_routes.size() + update->nlri.size();
+        for (vector<BgpAttribute *>::const_iterator it =
+             update->path_attributes.begin();
+             it != update->path_attributes.end(); ++it) {
+            if ((*it)->code == BgpAttribute::MPReachNlri ||
+                (*it)->code == BgpAttribute::MPUnreachNlri) {
+                count += static_cast<BgpMpNlri *>(*it)->nlri.size();
+            }
+        }
+        return count;
+    }
+
+    static void Run(const MessageList &messages, bool fast_path) {
+        const int kPasses = 10;
+        size_t message_count = 0, prefix_count = 0;
+        uint64_t start = UTCTimestampUsec();
+        for (int pass = 0; pass < kPasses; pass++) {
+            for (MessageList::const_iterator it = messages.begin();
+                 it != messages.end(); ++it) {
+                const BgpProto::Update *update =
+                    static_cast<const BgpProto::Update *>(BgpProto::Decode(
+                        &(*it)[0], it->size(), NULL, fast_path));
+                if (!update)
+                    continue;
+                message_count++;
+                prefix_count += PrefixCount(update);
+                delete update;
+            }
+        }
+        uint64_t usecs = max(UTCTimestampUsec() - start, uint64_t(1));
+        cout << (fast_path ? "Fast path: " : "Generic: ")
+             << message_count * 1000000 / usecs << " msgs/sec, "
+             << prefix_count * 1000000 / usecs << " prefixes/sec" << endl;
+    }
+};
+
+// Not part of the regular run, use --gtest_also_run_disabled_tests to run it.
+// The UpdateFastPath tests check that both decoders agree.
+TEST_F(BgpProtoBenchmarkTest, DISABLED_Decode) {
+    MessageList messages;
+    const char *capture = getenv("BGP_PROTO_BENCHMARK_CAPTURE");
+    if (capture) {
+        Load(capture, &messages);
+    } else {
+        Generate(&messages);
+    }
+    ASSERT_FALSE(messages.empty());
+    Run(messages, false);
+    Run(messages, true);
+}
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -2206,6 +2206,61 @@ TEST_F(RibOutUpdatesTest, PeerDequeueReady1) {
     }
 }
 
+// Routes:   Default route enqueued to all peers.
+//           Routes x=[0,kRouteCount-1] enqueued to all peers, attr A.
+// Blocking: Peers x=[1,kPeerCount-1] block after STEP_1.
+// Prep:     Tail dequeue with an UpdateCache. The message for attr A gets
+//           built for peer 0 and added to the cache.
+// Action:   Unblock peers x=[1,kPeerCount-1].
+//           Attempt peer dequeue for peer 1.
+// Result:   The cached message for attr A gets sent to peers
+//           x=[1,kPeerCount-1] without building a new message.
+TEST_F(RibOutUpdatesTest, PeerDequeueUpdateCache) {
+    UpdateCache cache;
+    updates_->SetUpdateCache(&cache);
+
+    // Build UpdateInfo for attr A with all peers.
+    UpdateInfoSList uinfo_slist;
+    PrependUpdateInfo(uinfo_slist, attrA_, 0, kPeerCount-1);
+
+    // Build updates for default and all other routes.
+    EnqueueDefaultRoute();
+    for (int idx = 0; idx < kRouteCount; idx++) {
+        UpdateInfoSList temp_uinfo_slist;
+        CloneUpdateInfo(uinfo_slist, temp_uinfo_slist);
+        BuildRouteUpdate(routes_[idx], temp_uinfo_slist);
+    }
+
+    // Dequeue the tail marker.
+    SetPeerBlock(1, kPeerCount-1, STEP_1);
+    UpdateRibOut();
+
+    // Verify update counts and the cache.
+    VerifyUpdateCount(0, COUNT_2);
+    VerifyUpdateCount(1, kPeerCount-1, COUNT_1);
+    VerifyMessageCount(2);
+    EXPECT_EQ(2U, cache.size());
+    EXPECT_EQ(0U, cache.hits());
+
+    // Unblock the peers and dequeue.
+    SetPeerUnblockNow(1, kPeerCount-1);
+    UpdatePeer(peers_[1]);
+
+    // Verify update counts and that the message came from the cache.
+    VerifyUpdateCount(1, kPeerCount-1, COUNT_2);
+    VerifyPeerBlock(1, kPeerCount-1, false);
+    VerifyMessageCount(2);
+    EXPECT_EQ(1U, cache.hits());
+    for (int idx = 0; idx < kRouteCount; idx++) {
+        RouteState *rstate = ExpectRouteState(routes_[idx]);
+        VerifyHistory(rstate, attrA_, 0, kPeerCount-1);
+    }
+
+    // Clean up.
+    DrainAndDeleteDBState();
+    updates_->SetUpdateCache(NULL);
+}
+
 // Routes:   Default route enqueued to all peers.
 //           Routes x=[0,vRouteCount-1] enqueued to all peers, attr x.
 // Blocking: Peers x=[1,kPeerCount-1] block after STEP_1.
@@ -2428,6 +2483,135 @@ static void TearDown() {
     scheduler->Terminate();
 }
 
+// Routes:   Default route enqueued to all peers.
+//           Routes x=[0,kRouteCount-1] enqueued to all peers, attr A.
+// Peers:    Enough peers for 4 send shards, with 4 send workers.
+// Blocking: Even peers block after STEP_1.
+// Action:   Tail dequeue, then unblock the even peers and do peer dequeue
+//           for peer 0.
+// Result:   Same as with a single send worker. The blocked peers from all
+//           shards get split from the tail marker and merge back later.
+TEST_F(RibOutUpdatesTest, SendShards) {
+    const int peer_count = 4 * SchedulingGroup::kMinPeersPerShard;
+    for (int idx = kPeerCount; idx < peer_count; idx++) {
+        CreatePeer();
+    }
+    mgr_.set_send_workers(4);
+    EXPECT_EQ(4, sg_->send_workers());
+
+    // Build updates for default and all other routes.
+    UpdateInfoSList uinfo_slist;
+    PrependUpdateInfo(uinfo_slist, attrA_, 0, peer_count-1);
+    EnqueueDefaultRoute();
+    for (int idx = 0; idx < kRouteCount; idx++) {
+        UpdateInfoSList temp_uinfo_slist;
+        CloneUpdateInfo(uinfo_slist, temp_uinfo_slist);
+        BuildRouteUpdate(routes_[idx], temp_uinfo_slist);
+    }
+
+    // Dequeue the tail marker.
+    SetEvenPeerBlock(0, peer_count-1, STEP_1);
+    UpdateRibOut();
+
+    // Verify update counts and blocked state.
+    VerifyDefaultRoute();
+    VerifyEvenUpdateCount(0, peer_count-1, COUNT_1);
+    VerifyOddUpdateCount(0, peer_count-1, COUNT_2);
+    VerifyEvenPeerBlock(0, peer_count-1, true);
+    VerifyOddPeerBlock(0, peer_count-1, false);
+    VerifyMessageCount(2);
+
+    // Unblock the even peers and dequeue.
+    SetPeerUnblockNow(0, peer_count-1);
+    UpdatePeer(peers_[0]);
+
+    // Verify update counts and blocked state after peer dequeue.
+    VerifyUpdateCount(0, peer_count-1, COUNT_2);
+    VerifyPeerBlock(0, peer_count-1, false);
+    VerifyMessageCount(3);
+    for (int idx = 0; idx < kRouteCount; idx++) {
+        RouteState *rstate = ExpectRouteState(routes_[idx]);
+        VerifyHistory(rstate, attrA_, 0, peer_count-1);
+    }
+
+    DrainAndDeleteDBState();
+}
+
+//
+// Message that formats a per-peer header in front of a payload, like the
+// messages sent to XMPP peers.
+//
+class SendBenchmarkMessage : public Message {
+public:
+    explicit SendBenchmarkMessage(size_t size) : payload_(size, 'x') { }
+    virtual bool AddRoute(const BgpRoute *route, const RibOutAttr *attr) {
+        return true;
+    }
+    virtual void Finish() {
+    }
+    virtual const uint8_t *GetData(IPeerUpdate *peer, size_t *lenp) {
+        return GetDataBuffered(peer, lenp, &data_);
+    }
+    virtual const uint8_t *GetDataBuffered(IPeerUpdate *peer, size_t *lenp,
+                                           std::string *buffer) {
+        *buffer = "<message to=\"" + peer->ToString() + "\">";
+        buffer->append(payload_);
+        *lenp = buffer->size();
+        return reinterpret_cast<const uint8_t *>(buffer->data());
+    }
+
+private:
+    std::string payload_;
+    std::string data_;
+};
+
+//
+// Throughput of sending messages to a large number of peers that share a
+// RibOut, with different numbers of send workers. Not part of the regular
+// run, use --gtest_also_run_disabled_tests to run it.
+//
+TEST_F(RibOutUpdatesTest, DISABLED_SendShardsBenchmark) {
+    const int peer_count = 2000;
+    const int message_count = 200;
+    for (int idx = kPeerCount; idx < peer_count; idx++) {
+        CreatePeer();
+    }
+
+    RibPeerSet dst;
+    for (int idx = 0; idx < peer_count; idx++) {
+        dst.set(ribout_.GetPeerIndex(peers_[idx]));
+    }
+
+    SchedulerStart();
+    SendBenchmarkMessage message(4096);
+    for (int workers = 1; workers <= 8; workers *= 2) {
+        mgr_.set_send_workers(workers);
+        ClearPeerCount(0, peer_count-1);
+
+        uint64_t start = UTCTimestampUsec();
+        for (int idx = 0; idx < message_count; idx++) {
+            RibPeerSet blocked;
+            UpdateSend(&message, dst, &blocked);
+            EXPECT_TRUE(blocked.empty());
+        }
+        uint64_t elapsed = UTCTimestampUsec() - start;
+
+        for (int idx = 0; idx < peer_count; idx++) {
+            EXPECT_EQ(message_count, peers_[idx]->update_count());
+        }
+        std::cout << "Send workers " << workers << ": "
+                  << elapsed / message_count << " usecs/message, "
+                  << (elapsed ? uint64_t(message_count) * peer_count *
+                      1000000 / elapsed : 0)
+                  << " peer updates/sec" << std::endl;
+    }
+    task_util::WaitForIdle();
+    SchedulerStop();
+
+    mgr_.set_send_workers(1);
+    ClearPeerCount(0, peer_count-1);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     SetUp();
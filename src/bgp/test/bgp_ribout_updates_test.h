@@ -665,6 +665,12 @@ protected:
         sg_->UpdatePeer(peer);
     }
 
+    void UpdateSend(Message *message, const RibPeerSet &dst,
+                    RibPeerSet *blocked) {
+        ConcurrencyScope scope("bgp::SendTask");
+        updates_->UpdateSend(message, dst, blocked);
+    }
+
     void UpdateAllPeers() {
         for (int idx = 0; idx < (int) peers_.size(); idx++) {
             UpdatePeer(peers_[idx]);
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_route.h"
+
+#include <iostream>
+#include <vector>
+
+#include "base/util.h"
+#include "base/logging.h"
+#include "base/slab_allocator.h"
+#include "base/test/task_test_util.h"
+#include "bgp/bgp_attr.h"
+#include "bgp/bgp_log.h"
+#include "bgp/bgp_path.h"
+#include "bgp/bgp_server.h"
+#include "bgp/inet/inet_route.h"
+#include "control-node/control_node.h"
+#include "io/event_manager.h"
+
+#include "testing/gunit.h"
+
+using namespace std;
+
+class BgpPeerMock : public IPeer {
+public:
+    explicit BgpPeerMock(const string &name) : name_(name) { }
+    virtual string ToString() const { return name_; }
+    virtual string ToUVEKey() const { return name_; }
+    virtual bool SendUpdate(const uint8_t *msg, size_t msgsize) {
+        return true;
+    }
+    virtual BgpServer *server() { return NULL; }
+    virtual IPeerClose *peer_close() { return NULL; }
+    virtual IPeerDebugStats *peer_stats() { return NULL; }
+    virtual bool IsReady() const { return true; }
+    virtual bool IsXmppPeer() const { return false; }
+    virtual void Close() { }
+    virtual const string GetStateName() const { return "UNKNOWN"; }
+    BgpProto::BgpPeerType PeerType() const { return BgpProto::IBGP; }
+    virtual uint32_t bgp_identifier() const { return 0; }
+    virtual void UpdateRefCount(int count) { }
+    virtual tbb::atomic<int> GetRefCount() const {
+        tbb::atomic<int> count;
+        count = 0;
+        return count;
+    }
+
+private:
+    string name_;
+};
+
+//
+// Report the memory used by routes and paths for a large table, as bytes
+// obtained from the system per route and per path. Each route has a path
+// from each of two peers, as with a pair of route reflectors.
+//
+class BgpRouteMemoryTest : public ::testing::Test {
+protected:
+    static const int kRouteCount = 1000 * 1000;
+
+    BgpRouteMemoryTest()
+        : server_(&evm_), peer1_("peer1"), peer2_("peer2") {
+    }
+
+    void TearDown() {
+        server_.Shutdown();
+        task_util::WaitForIdle();
+    }
+
+    void AddRoutes(int count) {
+        BgpAttrSpec spec;
+        BgpAttrOrigin origin(BgpAttrOrigin::IGP);
+        spec.push_back(&origin);
+        BgpAttrPtr attr = server_.attr_db()->Locate(spec);
+
+        routes_.reserve(count);
+        for (int idx = 0; idx < count; idx++) {
+            Ip4Prefix prefix(Ip4Address(0x0a000000 + idx), 32);
+            InetRoute *route = new InetRoute(prefix);
+            route->InsertPath(
+                new BgpPath(&peer1_, BgpPath::BGP_XMPP, attr, 0, idx));
+            route->InsertPath(
+                new BgpPath(&peer2_, BgpPath::BGP_XMPP, attr, 0, idx));
+            routes_.push_back(route);
+        }
+    }
+
+    void DeleteRoutes() {
+        for (vector<InetRoute *>::iterator it = routes_.begin();
+             it != routes_.end(); ++it) {
+            InetRoute *route = *it;
+            route->RemovePath(&peer1_);
+            route->RemovePath(&peer2_);
+            delete route;
+        }
+        routes_.clear();
+    }
+
+    EventManager evm_;
+    BgpServer server_;
+    BgpPeerMock peer1_;
+    BgpPeerMock peer2_;
+    vector<InetRoute *> routes_;
+};
+
+//
+// Once the routes are deleted, each shard keeps at most one spare slab and
+// all other slabs go back to the system.
+//
+TEST_F(BgpRouteMemoryTest, SlabsReleased) {
+    size_t route_bytes = BgpRoute::AllocatedBytes();
+    size_t path_bytes = BgpPath::AllocatedBytes();
+    AddRoutes(20000);
+    EXPECT_LT(route_bytes, BgpRoute::AllocatedBytes());
+    EXPECT_LT(path_bytes, BgpPath::AllocatedBytes());
+    DeleteRoutes();
+
+    EXPECT_LE(BgpRoute::AllocatedBytes(), route_bytes +
+              SlabAllocator::kSlabSize * SlabAllocator::kShardCount);
+    EXPECT_LE(BgpPath::AllocatedBytes(), path_bytes +
+              SlabAllocator::kSlabSize * SlabAllocator::kShardCount);
+}
+
+// Run with --gtest_also_run_disabled_tests to get the numbers.
+TEST_F(BgpRouteMemoryTest, DISABLED_BytesPerRoute) {
+    size_t route_bytes = BgpRoute::AllocatedBytes();
+    size_t path_bytes = BgpPath::AllocatedBytes();
+    uint64_t start = UTCTimestampUsec();
+    AddRoutes(kRouteCount);
+    uint64_t elapsed = UTCTimestampUsec() - start;
+    size_t route_base = route_bytes;
+    route_bytes = BgpRoute::AllocatedBytes() - route_bytes;
+    path_bytes = BgpPath::AllocatedBytes() - path_bytes;
+
+    // Only the partially used last slab is on top of the object sizes.
+    EXPECT_LE(route_bytes, sizeof(InetRoute) * kRouteCount +
+              SlabAllocator::kSlabSize * SlabAllocator::kShardCount);
+    EXPECT_LE(path_bytes, sizeof(BgpPath) * kRouteCount * 2 +
+              SlabAllocator::kSlabSize * SlabAllocator::kShardCount);
+
+    cout << "sizeof DBEntry " << sizeof(DBEntry)
+         << ", InetRoute " << sizeof(InetRoute)
+         << ", BgpPath " << sizeof(BgpPath) << endl;
+    cout << kRouteCount << " routes: "
+         << double(route_bytes) / kRouteCount << " bytes/route, "
+         << double(path_bytes) / (kRouteCount * 2) << " bytes/path, "
+         << elapsed * 1000 / kRouteCount << " nsecs/route to build" << endl;
+
+    DeleteRoutes();
+
+    // At most one spare slab per shard is kept for reuse.
+    EXPECT_LE(BgpRoute::AllocatedBytes(), route_base +
+              SlabAllocator::kSlabSize * SlabAllocator::kShardCount);
+}
+
+static void SetUp() {
+    bgp_log_test::init();
+    ControlNode::SetDefaultSchedulingPolicy();
+}
+
+static void TearDown() {
+    task_util::WaitForIdle();
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Terminate();
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    SetUp();
+    int result = RUN_ALL_TESTS();
+    TearDown();
+    return result;
+}
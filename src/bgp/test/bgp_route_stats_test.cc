@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_route_stats.h"
+
+#include <pthread.h>
+#include <iostream>
+
+#include "base/logging.h"
+#include "bgp/bgp_log.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+class RouteChangeStatsTest : public ::testing::Test {
+protected:
+    static const int kPartitionCount = 4;
+
+    RouteChangeStatsTest() : stats_(kPartitionCount) {
+    }
+
+    RouteChangeStats stats_;
+};
+
+TEST_F(RouteChangeStatsTest, Counters) {
+    for (int part_id = 0; part_id < kPartitionCount; part_id++) {
+        for (int idx = 0; idx <= part_id; idx++) {
+            stats_.Increment(part_id, RouteChangeStats::ADD);
+        }
+        stats_.Increment(part_id, RouteChangeStats::CHANGE);
+    }
+    stats_.Increment(0, RouteChangeStats::DELETE);
+
+    RouteChangeStats::Counters counters;
+    stats_.GetCounters(&counters);
+    EXPECT_EQ(10U, counters.count[RouteChangeStats::ADD]);
+    EXPECT_EQ(4U, counters.count[RouteChangeStats::CHANGE]);
+    EXPECT_EQ(1U, counters.count[RouteChangeStats::DELETE]);
+}
+
+TEST_F(RouteChangeStatsTest, Rates) {
+    RouteChangeStats::Counters counters, rates;
+    uint64_t now = 1000000000;
+
+    // No rates for the first sample.
+    for (int idx = 0; idx < 100; idx++) {
+        stats_.Increment(idx % kPartitionCount, RouteChangeStats::ADD);
+    }
+    stats_.Sample(now, &counters, &rates);
+    EXPECT_EQ(100U, counters.count[RouteChangeStats::ADD]);
+    EXPECT_EQ(0U, rates.count[RouteChangeStats::ADD]);
+
+    // Rates are for the interval since the previous sample.
+    for (int idx = 0; idx < 500; idx++) {
+        stats_.Increment(idx % kPartitionCount, RouteChangeStats::ADD);
+        stats_.Increment(idx % kPartitionCount, RouteChangeStats::DELETE);
+    }
+    now += 5000000;
+    stats_.Sample(now, &counters, &rates);
+    EXPECT_EQ(600U, counters.count[RouteChangeStats::ADD]);
+    EXPECT_EQ(500U, counters.count[RouteChangeStats::DELETE]);
+    EXPECT_EQ(100U, rates.count[RouteChangeStats::ADD]);
+    EXPECT_EQ(0U, rates.count[RouteChangeStats::CHANGE]);
+    EXPECT_EQ(100U, rates.count[RouteChangeStats::DELETE]);
+
+    now += 5000000;
+    stats_.Sample(now, &counters, &rates);
+    EXPECT_EQ(600U, counters.count[RouteChangeStats::ADD]);
+    EXPECT_EQ(0U, rates.count[RouteChangeStats::ADD]);
+}
+
+TEST(UpdateDwellStatsTest, Sample) {
+    UpdateDwellStats stats;
+    UpdateDwellStats::Snapshot snapshot;
+
+    stats.Sample(&snapshot);
+    EXPECT_EQ(0U, snapshot.samples);
+    EXPECT_EQ(0U, snapshot.average_usecs);
+    EXPECT_EQ(0U, snapshot.max_usecs);
+
+    stats.Record(100);
+    stats.Record(500);
+    stats.Record(300);
+    stats.Sample(&snapshot);
+    EXPECT_EQ(3U, snapshot.samples);
+    EXPECT_EQ(300U, snapshot.average_usecs);
+    EXPECT_EQ(500U, snapshot.max_usecs);
+
+    // The max is for the interval since the previous sample.
+    stats.Record(200);
+    stats.Sample(&snapshot);
+    EXPECT_EQ(1U, snapshot.samples);
+    EXPECT_EQ(200U, snapshot.average_usecs);
+    EXPECT_EQ(200U, snapshot.max_usecs);
+}
+
+//
+// Measure the cost of the counters on the input path, with one thread per
+// partition as with the db::DBTable tasks, against a shared atomic counter.
+// Not part of the regular run, use --gtest_also_run_disabled_tests to run it.
+//
+class RouteChangeStatsBenchmark : public ::testing::Test {
+protected:
+    static const int kThreadCount = 4;
+    static const int kIterations = 4 * 1000 * 1000;
+
+    struct ThreadArgs {
+        RouteChangeStatsBenchmark *test;
+        int part_id;
+    };
+
+    RouteChangeStatsBenchmark() : stats_(kThreadCount) {
+        shared_count_ = 0;
+    }
+
+    static void *IncrementPartition(void *arg) {
+        ThreadArgs *args = static_cast<ThreadArgs *>(arg);
+        for (int idx = 0; idx < kIterations; idx++) {
+            args->test->stats_.Increment(args->part_id,
+                RouteChangeStats::Operation(idx % 3));
+        }
+        return NULL;
+    }
+
+    static void *IncrementShared(void *arg) {
+        ThreadArgs *args = static_cast<ThreadArgs *>(arg);
+        for (int idx = 0; idx < kIterations; idx++) {
+            args->test->shared_count_++;
+        }
+        return NULL;
+    }
+
+    static void *RecordDwell(void *arg) {
+        ThreadArgs *args = static_cast<ThreadArgs *>(arg);
+        for (int idx = 0; idx < kIterations; idx++) {
+            if (idx % UpdateDwellStats::kSampleInterval == 0)
+                args->test->dwell_stats_.Record(idx % 1000);
+        }
+        return NULL;
+    }
+
+    // Returns the nanoseconds per operation.
+    uint64_t Run(void *(*func)(void *)) {
+        pthread_t thread_ids[kThreadCount];
+        ThreadArgs args[kThreadCount];
+        uint64_t start = UTCTimestampUsec();
+        for (int idx = 0; idx < kThreadCount; idx++) {
+            args[idx].test = this;
+            args[idx].part_id = idx;
+            pthread_create(&thread_ids[idx], NULL, func, &args[idx]);
+        }
+        for (int idx = 0; idx < kThreadCount; idx++) {
+            pthread_join(thread_ids[idx], NULL);
+        }
+        uint64_t elapsed = UTCTimestampUsec() - start;
+        return elapsed * 1000 / kIterations;
+    }
+
+    RouteChangeStats stats_;
+    UpdateDwellStats dwell_stats_;
+    tbb::atomic<uint64_t> shared_count_;
+};
+
+TEST_F(RouteChangeStatsBenchmark, DISABLED_Increment) {
+    uint64_t partition_nsecs = Run(&IncrementPartition);
+    uint64_t shared_nsecs = Run(&IncrementShared);
+    uint64_t dwell_nsecs = Run(&RecordDwell);
+
+    RouteChangeStats::Counters counters;
+    stats_.GetCounters(&counters);
+    uint64_t total = 0;
+    for (int op = 0; op < RouteChangeStats::OPERATION_COUNT; op++) {
+        total += counters.count[op];
+    }
+    EXPECT_EQ(uint64_t(kThreadCount) * kIterations, total);
+    EXPECT_EQ(uint64_t(kThreadCount) * kIterations, shared_count_);
+
+    cout << kThreadCount << " threads, " << kIterations << " updates each:"
+         << " partition counters " << partition_nsecs << " nsecs/update,"
+         << " shared atomic " << shared_nsecs << " nsecs/update,"
+         << " sampled dwell " << dwell_nsecs << " nsecs/update" << endl;
+}
+
+int main(int argc, char **argv) {
+    bgp_log_test::init();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
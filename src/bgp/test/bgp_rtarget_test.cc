@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/routing-instance/rtarget_group_mgr.h"
+
+#include "base/logging.h"
+#include "base/parse_object.h"
+#include "base/task.h"
+#include "base/test/task_test_util.h"
+#include "bgp/bgp_attr.h"
+#include "bgp/bgp_config.h"
+#include "bgp/bgp_config_parser.h"
+#include "bgp/bgp_factory.h"
+#include "bgp/bgp_log.h"
+#include "bgp/bgp_peer.h"
+#include "bgp/bgp_session_manager.h"
+#include "bgp/community.h"
+#include "bgp/l3vpn/inetvpn_table.h"
+#include "bgp/rtarget/rtarget_table.h"
+#include "bgp/test/bgp_server_test_util.h"
+#include "control-node/control_node.h"
+#include "io/test/event_manager_test.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+//
+// Fire state machine timers faster and reduce possible delay in this test
+//
+class StateMachineTest : public StateMachine {
+    public:
+        explicit StateMachineTest(BgpPeer *peer) : StateMachine(peer) { }
+        ~StateMachineTest() { }
+
+        void StartConnectTimer(int seconds) {
+            connect_timer_->Start(10,
+                boost::bind(&StateMachine::ConnectTimerExpired, this),
+                boost::bind(&StateMachine::TimerErrorHanlder, this, _1, _2));
+        }
+
+        void StartOpenTimer(int seconds) {
+            open_timer_->Start(10,
+                boost::bind(&StateMachine::OpenTimerExpired, this),
+                boost::bind(&StateMachine::TimerErrorHanlder, this, _1, _2));
+        }
+
+        void StartIdleHoldTimer() {
+            if (idle_hold_time_ <= 0)
+                return;
+
+            idle_hold_timer_->Start(10,
+                boost::bind(&StateMachine::IdleHoldTimerExpired, this),
+                boost::bind(&StateMachine::TimerErrorHanlder, this, _1, _2));
+        }
+};
+
+//
+// A and B exchange inet-vpn and route target membership routes. VPN routes
+// are originated in A, and B signals its interest in route targets with
+// local routes in bgp.rtarget.0, the same way as the route targets that are
+// imported by its routing instances.
+//
+class BgpRTargetTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        evm_.reset(new EventManager());
+        a_.reset(new BgpServerTest(evm_.get(), "A"));
+        b_.reset(new BgpServerTest(evm_.get(), "B"));
+        thread_.reset(new ServerThread(evm_.get()));
+
+        a_->session_manager()->Initialize(0);
+        b_->session_manager()->Initialize(0);
+        thread_->Start();
+
+        string config = GetConfigStr(a_->session_manager()->GetPort(),
+                                     b_->session_manager()->GetPort());
+        a_->Configure(config);
+        task_util::WaitForIdle();
+        b_->Configure(config);
+        task_util::WaitForIdle();
+
+        string uuid = BgpConfigParser::session_uuid("A", "B", 1);
+        TASK_UTIL_EXPECT_NE(static_cast<BgpPeer *>(NULL),
+                a_->FindPeerByUuid(BgpConfigManager::kMasterInstance, uuid));
+        BgpPeer *peer_a = a_->FindPeerByUuid(BgpConfigManager::kMasterInstance,
+                                             uuid);
+        BGP_WAIT_FOR_PEER_STATE(peer_a, StateMachine::ESTABLISHED);
+        TASK_UTIL_EXPECT_NE(static_cast<BgpPeer *>(NULL),
+                b_->FindPeerByUuid(BgpConfigManager::kMasterInstance, uuid));
+        BgpPeer *peer_b = b_->FindPeerByUuid(BgpConfigManager::kMasterInstance,
+                                             uuid);
+        BGP_WAIT_FOR_PEER_STATE(peer_b, StateMachine::ESTABLISHED);
+        TASK_UTIL_EXPECT_TRUE(peer_a->IsRTargetFilterEnabled());
+        TASK_UTIL_EXPECT_TRUE(peer_b->IsRTargetFilterEnabled());
+        task_util::WaitForIdle();
+    }
+
+    virtual void TearDown() {
+        task_util::WaitForIdle();
+        a_->Shutdown();
+        b_->Shutdown();
+        task_util::WaitForIdle();
+        evm_->Shutdown();
+        if (thread_.get() != NULL) {
+            thread_->Join();
+        }
+    }
+
+    string GetConfigStr(unsigned short port_a, unsigned short port_b) {
+        static const char *families =
+            "<address-families>"
+            "<family>inet-vpn</family>"
+            "<family>route-target</family>"
+            "</address-families>";
+        ostringstream config;
+        config << "<config>"
+            "<bgp-router name=\'A\'>"
+            "<identifier>192.168.0.10</identifier>"
+            "<address>127.0.0.1</address>" << families <<
+            "<port>" << port_a << "</port>"
+            "<session to='B'>" << families << "</session>"
+            "</bgp-router>"
+            "<bgp-router name=\'B\'>"
+            "<identifier>192.168.0.11</identifier>"
+            "<address>127.0.0.1</address>" << families <<
+            "<port>" << port_b << "</port>"
+            "<session to='A'>" << families << "</session>"
+            "</bgp-router>"
+            "</config>";
+        return config.str();
+    }
+
+    BgpTable *GetVpnTable(BgpServerTest *server) {
+        return static_cast<BgpTable *>(
+            server->database()->FindTable("bgp.l3vpn.0"));
+    }
+
+    BgpTable *GetRTargetTable(BgpServerTest *server) {
+        return static_cast<BgpTable *>(
+            server->database()->FindTable("bgp.rtarget.0"));
+    }
+
+    void AddVpnRoute(BgpServerTest *server, const string &prefix,
+                     const string &target) {
+        BgpAttrSpec attr_spec;
+        BgpAttrOrigin origin(BgpAttrOrigin::IGP);
+        attr_spec.push_back(&origin);
+        BgpAttrNextHop nexthop(server->bgp_identifier());
+        attr_spec.push_back(&nexthop);
+        BgpAttrLocalPref local_pref(100);
+        attr_spec.push_back(&local_pref);
+        ExtCommunitySpec commspec;
+        const ExtCommunity::ExtCommunityValue &extcomm =
+            RouteTarget::FromString(target).GetExtCommunity();
+        commspec.communities.push_back(
+            get_value(extcomm.data(), extcomm.size()));
+        attr_spec.push_back(&commspec);
+        BgpAttrPtr attr = server->attr_db()->Locate(attr_spec);
+
+        DBRequest req;
+        req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        req.key.reset(new InetVpnTable::RequestKey(
+            InetVpnPrefix::FromString(prefix), NULL));
+        req.data.reset(new BgpTable::RequestData(attr, 0, 16));
+        GetVpnTable(server)->Enqueue(&req);
+        task_util::WaitForIdle();
+    }
+
+    void DeleteVpnRoute(BgpServerTest *server, const string &prefix) {
+        DBRequest req;
+        req.oper = DBRequest::DB_ENTRY_DELETE;
+        req.key.reset(new InetVpnTable::RequestKey(
+            InetVpnPrefix::FromString(prefix), NULL));
+        GetVpnTable(server)->Enqueue(&req);
+        task_util::WaitForIdle();
+    }
+
+    // An empty target adds the default route target constraint route.
+    void AddMembership(BgpServerTest *server, const string &target) {
+        BgpAttrSpec attr_spec;
+        BgpAttrOrigin origin(BgpAttrOrigin::IGP);
+        attr_spec.push_back(&origin);
+        BgpAttrNextHop nexthop(server->bgp_identifier());
+        attr_spec.push_back(&nexthop);
+        BgpAttrPtr attr = server->attr_db()->Locate(attr_spec);
+
+        DBRequest req;
+        req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        req.key.reset(new RTargetTable::RequestKey(
+            MembershipPrefix(server, target), NULL));
+        req.data.reset(new BgpTable::RequestData(attr, 0, 0));
+        GetRTargetTable(server)->Enqueue(&req);
+        task_util::WaitForIdle();
+    }
+
+    void DeleteMembership(BgpServerTest *server, const string &target) {
+        DBRequest req;
+        req.oper = DBRequest::DB_ENTRY_DELETE;
+        req.key.reset(new RTargetTable::RequestKey(
+            MembershipPrefix(server, target), NULL));
+        GetRTargetTable(server)->Enqueue(&req);
+        task_util::WaitForIdle();
+    }
+
+    RTargetPrefix MembershipPrefix(BgpServerTest *server,
+                                   const string &target) {
+        if (target.empty())
+            return RTargetPrefix();
+        return RTargetPrefix(server->autonomous_system(),
+                             RouteTarget::FromString(target));
+    }
+
+    auto_ptr<EventManager> evm_;
+    auto_ptr<ServerThread> thread_;
+    auto_ptr<BgpServerTest> a_;
+    auto_ptr<BgpServerTest> b_;
+};
+
+static const char *kPrefix1 = "10.1.1.1:1:20.1.1.1/32";
+static const char *kPrefix2 = "10.1.1.1:2:20.1.1.2/32";
+static const char *kTarget1 = "target:64512:1";
+static const char *kTarget2 = "target:64512:2";
+
+//
+// B negotiated the route target family without asking for any route target,
+// so it gets no VPN routes.
+//
+TEST_F(BgpRTargetTest, NoMembership) {
+    AddVpnRoute(a_.get(), kPrefix1, kTarget1);
+    AddVpnRoute(a_.get(), kPrefix2, kTarget2);
+
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(a_.get()), 2);
+    task_util::WaitForIdle();
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 0);
+
+    DeleteVpnRoute(a_.get(), kPrefix1);
+    DeleteVpnRoute(a_.get(), kPrefix2);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(a_.get()), 0);
+}
+
+//
+// Only the routes with a route target that B is interested in get exported.
+//
+TEST_F(BgpRTargetTest, MatchingMembership) {
+    AddMembership(b_.get(), kTarget1);
+    BGP_VERIFY_ROUTE_COUNT(GetRTargetTable(a_.get()), 1);
+
+    AddVpnRoute(a_.get(), kPrefix1, kTarget1);
+    AddVpnRoute(a_.get(), kPrefix2, kTarget2);
+
+    const InetVpnTable::RequestKey key1(
+        InetVpnPrefix::FromString(kPrefix1), NULL);
+    const InetVpnTable::RequestKey key2(
+        InetVpnPrefix::FromString(kPrefix2), NULL);
+    BGP_VERIFY_ROUTE_PRESENCE(GetVpnTable(b_.get()), &key1);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 1);
+    BGP_VERIFY_ROUTE_ABSENCE(GetVpnTable(b_.get()), &key2);
+
+    DeleteVpnRoute(a_.get(), kPrefix1);
+    DeleteVpnRoute(a_.get(), kPrefix2);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 0);
+    DeleteMembership(b_.get(), kTarget1);
+    BGP_VERIFY_ROUTE_COUNT(GetRTargetTable(a_.get()), 0);
+}
+
+//
+// Routes that were held back get exported when B shows interest in their
+// route target.
+//
+TEST_F(BgpRTargetTest, PendingRoutes) {
+    AddVpnRoute(a_.get(), kPrefix1, kTarget1);
+    AddVpnRoute(a_.get(), kPrefix2, kTarget2);
+    task_util::WaitForIdle();
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 0);
+
+    AddMembership(b_.get(), kTarget2);
+    const InetVpnTable::RequestKey key2(
+        InetVpnPrefix::FromString(kPrefix2), NULL);
+    BGP_VERIFY_ROUTE_PRESENCE(GetVpnTable(b_.get()), &key2);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 1);
+
+    AddMembership(b_.get(), kTarget1);
+    const InetVpnTable::RequestKey key1(
+        InetVpnPrefix::FromString(kPrefix1), NULL);
+    BGP_VERIFY_ROUTE_PRESENCE(GetVpnTable(b_.get()), &key1);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 2);
+
+    DeleteVpnRoute(a_.get(), kPrefix1);
+    DeleteVpnRoute(a_.get(), kPrefix2);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 0);
+    DeleteMembership(b_.get(), kTarget1);
+    DeleteMembership(b_.get(), kTarget2);
+    BGP_VERIFY_ROUTE_COUNT(GetRTargetTable(a_.get()), 0);
+}
+
+//
+// Routes get withdrawn from B when it loses interest in their route target,
+// and only those routes.
+//
+TEST_F(BgpRTargetTest, WithdrawMembership) {
+    AddMembership(b_.get(), kTarget1);
+    AddMembership(b_.get(), kTarget2);
+    BGP_VERIFY_ROUTE_COUNT(GetRTargetTable(a_.get()), 2);
+
+    AddVpnRoute(a_.get(), kPrefix1, kTarget1);
+    AddVpnRoute(a_.get(), kPrefix2, kTarget2);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 2);
+
+    DeleteMembership(b_.get(), kTarget1);
+    BGP_VERIFY_ROUTE_COUNT(GetRTargetTable(a_.get()), 1);
+    const InetVpnTable::RequestKey key1(
+        InetVpnPrefix::FromString(kPrefix1), NULL);
+    const InetVpnTable::RequestKey key2(
+        InetVpnPrefix::FromString(kPrefix2), NULL);
+    BGP_VERIFY_ROUTE_ABSENCE(GetVpnTable(b_.get()), &key1);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 1);
+    BGP_VERIFY_ROUTE_PRESENCE(GetVpnTable(b_.get()), &key2);
+
+    DeleteMembership(b_.get(), kTarget2);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 0);
+
+    DeleteVpnRoute(a_.get(), kPrefix1);
+    DeleteVpnRoute(a_.get(), kPrefix2);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(a_.get()), 0);
+}
+
+//
+// The default route target constraint route asks for all VPN routes.
+//
+TEST_F(BgpRTargetTest, DefaultMembership) {
+    AddVpnRoute(a_.get(), kPrefix1, kTarget1);
+    AddVpnRoute(a_.get(), kPrefix2, kTarget2);
+    task_util::WaitForIdle();
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 0);
+
+    AddMembership(b_.get(), "");
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 2);
+
+    // A specific route target on top of the default one changes nothing.
+    AddMembership(b_.get(), kTarget1);
+    BGP_VERIFY_ROUTE_COUNT(GetRTargetTable(a_.get()), 2);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 2);
+
+    DeleteMembership(b_.get(), "");
+    const InetVpnTable::RequestKey key2(
+        InetVpnPrefix::FromString(kPrefix2), NULL);
+    BGP_VERIFY_ROUTE_ABSENCE(GetVpnTable(b_.get()), &key2);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 1);
+
+    DeleteMembership(b_.get(), kTarget1);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(b_.get()), 0);
+
+    DeleteVpnRoute(a_.get(), kPrefix1);
+    DeleteVpnRoute(a_.get(), kPrefix2);
+    BGP_VERIFY_ROUTE_COUNT(GetVpnTable(a_.get()), 0);
+}
+
+class TestEnvironment : public ::testing::Environment {
+    virtual ~TestEnvironment() { }
+};
+
+static void SetUp() {
+    ControlNode::SetDefaultSchedulingPolicy();
+    BgpServerTest::GlobalSetUp();
+    BgpObjectFactory::Register<StateMachine>(
+        boost::factory<StateMachineTest *>());
+}
+
+static void TearDown() {
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Terminate();
+}
+
+int main(int argc, char **argv) {
+    bgp_log_test::init();
+    ::testing::InitGoogleTest(&argc, argv);
+    ::testing::AddGlobalTestEnvironment(new TestEnvironment());
+    SetUp();
+    int result = RUN_ALL_TESTS();
+    TearDown();
+    return result;
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_update_cache.h"
+
+#include <vector>
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/test/task_test_util.h"
+#include "bgp/bgp_attr.h"
+#include "bgp/bgp_log.h"
+#include "bgp/bgp_server.h"
+#include "bgp/inet/inet_route.h"
+#include "bgp/message_builder.h"
+#include "control-node/control_node.h"
+#include "io/event_manager.h"
+#include "testing/gunit.h"
+
+using boost::shared_ptr;
+using namespace std;
+
+class MessageMock : public Message {
+public:
+    virtual bool AddRoute(const BgpRoute *route, const RibOutAttr *roattr) {
+        return true;
+    }
+    virtual void Finish() {
+    }
+    virtual const uint8_t *GetData(IPeerUpdate *peer, size_t *lenp) {
+        *lenp = 0;
+        return NULL;
+    }
+};
+
+class BgpUpdateCacheTest : public ::testing::Test {
+protected:
+    static const int kRouteCount = 8;
+
+    BgpUpdateCacheTest() : server_(&evm_) {
+    }
+
+    virtual void SetUp() {
+        for (int idx = 0; idx < kRouteCount; idx++) {
+            Ip4Prefix prefix(Ip4Address(0x0a000000 + (idx << 8)), 24);
+            routes_.push_back(new InetRoute(prefix));
+        }
+        for (int idx = 0; idx < 2; idx++) {
+            BgpAttr *attr = new BgpAttr(server_.attr_db());
+            attr->set_med(100 + idx);
+            roattr_[idx].set_attr(server_.attr_db()->Locate(attr));
+        }
+    }
+
+    virtual void TearDown() {
+        roattr_[0].clear();
+        roattr_[1].clear();
+        STLDeleteValues(&routes_);
+        server_.Shutdown();
+        task_util::WaitForIdle();
+    }
+
+    // Add an entry for the route at start_idx, with the routes up to
+    // end_idx in the packed list.
+    shared_ptr<Message> Add(UpdateCache *cache, int start_idx, int end_idx,
+                            int attr_idx = 0) {
+        UpdateCache::RouteAttrList packed;
+        for (int idx = start_idx + 1; idx <= end_idx; idx++) {
+            packed.push_back(
+                UpdateCache::RouteAttr(routes_[idx], roattr_[attr_idx]));
+        }
+        shared_ptr<Message> message(new MessageMock);
+        cache->Add(RibExportPolicy::BGP, routes_[start_idx],
+                   roattr_[attr_idx], message, packed);
+        return message;
+    }
+
+    UpdateCache::EntryPtr Find(UpdateCache *cache, int idx,
+                               int attr_idx = 0) {
+        return cache->Find(RibExportPolicy::BGP, routes_[idx],
+                           roattr_[attr_idx]);
+    }
+
+    EventManager evm_;
+    BgpServer server_;
+    vector<BgpRoute *> routes_;
+    RibOutAttr roattr_[2];
+};
+
+TEST_F(BgpUpdateCacheTest, FindAndAdd) {
+    UpdateCache cache;
+    EXPECT_TRUE(Find(&cache, 0).get() == NULL);
+
+    shared_ptr<Message> message = Add(&cache, 0, 3);
+    UpdateCache::EntryPtr entry = Find(&cache, 0);
+    ASSERT_TRUE(entry.get() != NULL);
+    EXPECT_EQ(message.get(), entry->message.get());
+    ASSERT_EQ(3U, entry->packed.size());
+    EXPECT_EQ(routes_[1], entry->packed[0].route);
+    EXPECT_EQ(routes_[3], entry->packed[2].route);
+
+    // Packed routes, other attributes and other encodings don't match.
+    EXPECT_TRUE(Find(&cache, 1).get() == NULL);
+    EXPECT_TRUE(Find(&cache, 0, 1).get() == NULL);
+    EXPECT_TRUE(cache.Find(RibExportPolicy::XMPP, routes_[0],
+                           roattr_[0]).get() == NULL);
+
+    EXPECT_EQ(1U, cache.size());
+    EXPECT_EQ(1U, cache.hits());
+    EXPECT_EQ(4U, cache.misses());
+}
+
+TEST_F(BgpUpdateCacheTest, Replace) {
+    UpdateCache cache;
+    Add(&cache, 0, 3);
+    shared_ptr<Message> message = Add(&cache, 0, 1);
+    UpdateCache::EntryPtr entry = Find(&cache, 0);
+    ASSERT_TRUE(entry.get() != NULL);
+    EXPECT_EQ(message.get(), entry->message.get());
+    EXPECT_EQ(1U, entry->packed.size());
+    EXPECT_EQ(1U, cache.size());
+
+    // The replaced entry no longer refers to route 3.
+    cache.Invalidate(routes_[3]);
+    EXPECT_EQ(1U, cache.size());
+    EXPECT_EQ(0U, cache.invalidations());
+}
+
+TEST_F(BgpUpdateCacheTest, Evict) {
+    UpdateCache cache(2);
+    Add(&cache, 0, 0);
+    UpdateCache::EntryPtr entry = Find(&cache, 0);
+    Add(&cache, 1, 1);
+    Add(&cache, 2, 2);
+    EXPECT_EQ(2U, cache.size());
+    EXPECT_EQ(1U, cache.evictions());
+
+    // The oldest entry is gone, but is still usable by the holder.
+    EXPECT_TRUE(Find(&cache, 0).get() == NULL);
+    EXPECT_TRUE(Find(&cache, 1).get() != NULL);
+    EXPECT_TRUE(Find(&cache, 2).get() != NULL);
+    ASSERT_TRUE(entry.get() != NULL);
+    EXPECT_TRUE(entry->message.get() != NULL);
+}
+
+TEST_F(BgpUpdateCacheTest, Disabled) {
+    UpdateCache cache(0);
+    Add(&cache, 0, 3);
+    EXPECT_EQ(0U, cache.size());
+    EXPECT_TRUE(Find(&cache, 0).get() == NULL);
+}
+
+TEST_F(BgpUpdateCacheTest, Invalidate) {
+    UpdateCache cache;
+    Add(&cache, 0, 3);
+    Add(&cache, 2, 5);
+    Add(&cache, 6, 7);
+    Add(&cache, 0, 0, 1);
+    EXPECT_EQ(4U, cache.size());
+
+    // Route 2 is in the first and second entries.
+    cache.Invalidate(routes_[2]);
+    EXPECT_EQ(2U, cache.size());
+    EXPECT_EQ(2U, cache.invalidations());
+    EXPECT_TRUE(Find(&cache, 0).get() == NULL);
+    EXPECT_TRUE(Find(&cache, 2).get() == NULL);
+    EXPECT_TRUE(Find(&cache, 6).get() != NULL);
+    EXPECT_TRUE(Find(&cache, 0, 1).get() != NULL);
+
+    // Route 7 is only in a packed list.
+    cache.Invalidate(routes_[7]);
+    EXPECT_EQ(1U, cache.size());
+    EXPECT_TRUE(Find(&cache, 6).get() == NULL);
+
+    // Routes that aren't in the cache.
+    cache.Invalidate(routes_[4]);
+    EXPECT_EQ(1U, cache.size());
+
+    cache.Clear();
+    EXPECT_EQ(0U, cache.size());
+}
+
+static void SetUp() {
+    ControlNode::SetDefaultSchedulingPolicy();
+}
+
+static void TearDown() {
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Terminate();
+}
+
+int main(int argc, char **argv) {
+    bgp_log_test::init();
+    ::testing::InitGoogleTest(&argc, argv);
+    SetUp();
+    int result = RUN_ALL_TESTS();
+    TearDown();
+    return result;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <sstream>
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <pugixml/pugixml.hpp>
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/task_annotations.h"
+#include "base/test/task_test_util.h"
+#include "testing/gunit.h"
+
+#include "bgp/bgp_attr.h"
+#include "bgp/bgp_config.h"
+#include "bgp/bgp_log.h"
+#include "bgp/bgp_ribout.h"
+#include "bgp/bgp_server.h"
+#include "bgp/bgp_table.h"
+#include "bgp/inet/inet_route.h"
+#include "bgp/xmpp_message_builder.h"
+#include "bgp/routing-instance/routing_instance.h"
+#include "control-node/control_node.h"
+#include "io/event_manager.h"
+#include "schema/xmpp_unicast_types.h"
+#include "xmpp/xmpp_init.h"
+
+using namespace pugi;
+using namespace std;
+
+namespace {
+
+class TestPeer : public IPeerUpdate {
+public:
+    explicit TestPeer(const string &name) : name_(name) { }
+    virtual string ToString() const { return name_; }
+    virtual bool SendUpdate(const uint8_t *msg, size_t msgsize) {
+        return true;
+    }
+
+private:
+    string name_;
+};
+
+class BgpXmppMsgBuilderTest : public testing::Test {
+protected:
+    BgpXmppMsgBuilderTest()
+        : server_(&evm_),
+          instance_config_(BgpConfigManager::kMasterInstance),
+          peer_("agent-a") {
+        ConcurrencyScope scope("bgp::Config");
+        RoutingInstance *rti =
+                server_.routing_instance_mgr()->CreateRoutingInstance(
+                    &instance_config_);
+        table_ = rti->GetTable(Address::INET);
+    }
+
+    virtual void TearDown() {
+        server_.Shutdown();
+        task_util::WaitForIdle();
+    }
+
+    BgpAttrPtr LocateAttr(const string &nexthop) {
+        BgpAttrSpec spec;
+        BgpAttrNextHop nh(Ip4Address::from_string(nexthop).to_ulong());
+        spec.push_back(&nh);
+        BgpAttrOrigin origin(BgpAttrOrigin::IGP);
+        spec.push_back(&origin);
+        return server_.attr_db()->Locate(spec);
+    }
+
+    // Encode the message the way it was done through a pugi DOM, before
+    // the builder moved to XmlWriter.
+    string PugiEncode(const vector<InetRoute *> &routes,
+                      const RibOutAttr *roattr) {
+        xml_document xdoc;
+        xml_node message = xdoc.append_child("message");
+        message.append_attribute("from") = XmppInit::kControlNodeJID;
+        xml_node event = message.append_child("event");
+        event.append_attribute("xmlns") = "http://jabber.org/protocol/pubsub";
+        xml_node items = event.append_child("items");
+        ostringstream node;
+        node << routes[0]->Afi() << "/" << int(routes[0]->Safi()) << "/" <<
+            table_->routing_instance()->name();
+        items.append_attribute("node") = node.str().c_str();
+
+        for (vector<InetRoute *>::const_iterator it = routes.begin();
+             it != routes.end(); ++it) {
+            const InetRoute *route = *it;
+            if (!roattr->IsReachable()) {
+                xml_node retract = items.append_child("retract");
+                retract.append_attribute("id") = route->ToString().c_str();
+                continue;
+            }
+
+            autogen::ItemType item;
+            item.entry.nlri.af = route->Afi();
+            item.entry.nlri.safi = route->Safi();
+            item.entry.nlri.address = route->ToString();
+            item.entry.version = 1;
+            item.entry.virtual_network = "unresolved";
+            BOOST_FOREACH(const RibOutAttr::NextHop &nexthop,
+                          roattr->nexthop_list()) {
+                autogen::NextHopType item_nexthop;
+                item_nexthop.af = route->Afi();
+                item_nexthop.safi = route->Safi();
+                item_nexthop.address = nexthop.address().to_v4().to_string();
+                item_nexthop.label = nexthop.label();
+                item_nexthop.tunnel_encapsulation_list.tunnel_encapsulation.
+                    push_back("gre");
+                item.entry.next_hops.next_hop.push_back(item_nexthop);
+            }
+            xml_node node = items.append_child("item");
+            node.append_attribute("id") = route->ToString().c_str();
+            item.Encode(&node);
+        }
+
+        string to = peer_.ToString() + "/" + XmppInit::kBgpPeer;
+        message.append_attribute("to") = to.c_str();
+        ostringstream oss;
+        xdoc.save(oss);
+        return oss.str();
+    }
+
+    string BuilderEncode(const vector<InetRoute *> &routes,
+                         const RibOutAttr *roattr) {
+        MessageBuilder *builder = BgpXmppMessageBuilder::GetInstance();
+        boost::scoped_ptr<Message> message(
+            builder->Create(table_, roattr, routes[0]));
+        for (size_t idx = 1; idx < routes.size(); idx++) {
+            message->AddRoute(routes[idx], roattr);
+        }
+        message->Finish();
+        size_t length;
+        const uint8_t *data = message->GetData(&peer_, &length);
+        return string(reinterpret_cast<const char *>(data), length);
+    }
+
+    EventManager evm_;
+    BgpServer server_;
+    BgpInstanceConfig instance_config_;
+    BgpTable *table_;
+    TestPeer peer_;
+};
+
+// The encoding of a route add must match the previous pugi output byte for
+// byte, including the layout of the message start tag.
+TEST_F(BgpXmppMsgBuilderTest, RouteAdd) {
+    BgpAttrPtr attr = LocateAttr("10.1.1.1");
+    RibOutAttr roattr(attr.get(), 16);
+    InetRoute route1(Ip4Prefix::FromString("192.168.1.0/24"));
+    InetRoute route2(Ip4Prefix::FromString("192.168.2.1/32"));
+    vector<InetRoute *> routes;
+    routes.push_back(&route1);
+    routes.push_back(&route2);
+
+    string expected = PugiEncode(routes, &roattr);
+    EXPECT_EQ(expected, BuilderEncode(routes, &roattr));
+    EXPECT_NE(string::npos, expected.find("\">\n\t<event xmlns"));
+}
+
+TEST_F(BgpXmppMsgBuilderTest, RouteDelete) {
+    RibOutAttr roattr;
+    InetRoute route1(Ip4Prefix::FromString("192.168.1.0/24"));
+    vector<InetRoute *> routes;
+    routes.push_back(&route1);
+
+    EXPECT_EQ(PugiEncode(routes, &roattr), BuilderEncode(routes, &roattr));
+}
+
+}  // namespace
+
+static void SetUp() {
+    ControlNode::SetDefaultSchedulingPolicy();
+}
+
+static void TearDown() {
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Terminate();
+}
+
+int main(int argc, char **argv) {
+    bgp_log_test::init();
+    ::testing::InitGoogleTest(&argc, argv);
+    SetUp();
+    int result = RUN_ALL_TESTS();
+    TearDown();
+    return result;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/routing-instance/service_chaining.h"
+
+#include <stdlib.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/util.h"
+#include "bgp/bgp_log.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+class ServiceChainAggregateTest : public ::testing::Test {
+protected:
+    static Ip4Prefix Prefix(const string &str) {
+        boost::system::error_code ec;
+        Ip4Prefix prefix = Ip4Prefix::FromString(str, &ec);
+        EXPECT_FALSE(ec);
+        return prefix;
+    }
+
+    static IpAddress ChainAddress() {
+        return IpAddress(Ip4Address::from_string("192.168.0.1"));
+    }
+};
+
+TEST_F(ServiceChainAggregateTest, LongestMatch) {
+    vector<string> subnets;
+    subnets.push_back("10.0.0.0/8");
+    subnets.push_back("10.1.0.0/16");
+    subnets.push_back("10.1.1.0/24");
+    subnets.push_back("20.1.1.0/24");
+    ServiceChain chain(NULL, NULL, subnets, ChainAddress());
+
+    Ip4Prefix match;
+    EXPECT_TRUE(chain.FindAggregateMatch(Prefix("10.1.1.1/32"), &match));
+    EXPECT_EQ(Prefix("10.1.1.0/24"), match);
+    EXPECT_TRUE(chain.FindAggregateMatch(Prefix("10.1.2.1/32"), &match));
+    EXPECT_EQ(Prefix("10.1.0.0/16"), match);
+    EXPECT_FALSE(chain.FindAggregateMatch(Prefix("10.1.1.0/24"), &match));
+    EXPECT_TRUE(chain.FindAggregateMatch(Prefix("10.2.0.0/16"), &match));
+    EXPECT_EQ(Prefix("10.0.0.0/8"), match);
+    EXPECT_TRUE(chain.FindAggregateMatch(Prefix("20.1.1.128/25"), &match));
+    EXPECT_EQ(Prefix("20.1.1.0/24"), match);
+
+    // Less specific or disjoint prefixes don't match.
+    EXPECT_FALSE(chain.FindAggregateMatch(Prefix("20.1.0.0/16"), &match));
+    EXPECT_FALSE(chain.FindAggregateMatch(Prefix("30.1.1.1/32"), &match));
+    EXPECT_FALSE(chain.FindAggregateMatch(Prefix("0.0.0.0/0"), &match));
+}
+
+TEST_F(ServiceChainAggregateTest, DefaultRoute) {
+    vector<string> subnets;
+    subnets.push_back("0.0.0.0/0");
+    ServiceChain chain(NULL, NULL, subnets, ChainAddress());
+
+    Ip4Prefix match;
+    EXPECT_TRUE(chain.FindAggregateMatch(Prefix("1.2.3.4/32"), &match));
+    EXPECT_EQ(Prefix("0.0.0.0/0"), match);
+    EXPECT_FALSE(chain.FindAggregateMatch(Prefix("0.0.0.0/0"), &match));
+}
+
+//
+// Cost of matching a host route against the aggregates of a service chain,
+// compared with a scan of all the aggregates.
+//
+class ServiceChainAggregateBenchmarkTest : public ServiceChainAggregateTest {
+protected:
+    static bool ScanMatch(const vector<Ip4Prefix> &aggregates,
+                          const Ip4Prefix &prefix, Ip4Prefix *match) {
+        for (vector<Ip4Prefix>::const_iterator it = aggregates.begin();
+             it != aggregates.end(); ++it) {
+            if (prefix.IsMoreSpecific(*it) &&
+                prefix.prefixlen() != it->prefixlen()) {
+                *match = *it;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void Run(int count) {
+        vector<string> subnets;
+        vector<Ip4Prefix> aggregates;
+        for (int idx = 0; idx < count; idx++) {
+            ostringstream oss;
+            oss << "10." << (idx >> 8) << "." << (idx & 0xff) << ".0/24";
+            subnets.push_back(oss.str());
+            aggregates.push_back(Prefix(oss.str()));
+        }
+        ServiceChain chain(NULL, NULL, subnets, ChainAddress());
+
+        const int route_count = 100 * 1000;
+        srand(1);
+        vector<Ip4Prefix> routes;
+        for (int idx = 0; idx < route_count; idx++) {
+            const Ip4Prefix &aggregate = aggregates[rand() % count];
+            Ip4Address addr(aggregate.ip4_addr().to_ulong() | (rand() & 0xff));
+            routes.push_back(Ip4Prefix(addr, 32));
+        }
+
+        Ip4Prefix match;
+        int matched = 0;
+        uint64_t start = UTCTimestampUsec();
+        for (int idx = 0; idx < route_count; idx++) {
+            if (chain.FindAggregateMatch(routes[idx], &match))
+                matched++;
+        }
+        uint64_t tree_nsecs = (UTCTimestampUsec() - start) * 1000;
+        EXPECT_EQ(route_count, matched);
+
+        // Keep the scan from taking too long with many aggregates.
+        int scan_count = min(route_count, 10 * 1000 * 1000 / count);
+        matched = 0;
+        start = UTCTimestampUsec();
+        for (int idx = 0; idx < scan_count; idx++) {
+            if (ScanMatch(aggregates, routes[idx], &match))
+                matched++;
+        }
+        uint64_t scan_nsecs = (UTCTimestampUsec() - start) * 1000;
+        EXPECT_EQ(scan_count, matched);
+
+        cout << "Aggregates " << count
+             << ": tree " << tree_nsecs / route_count << " nsecs/route,"
+             << " scan " << scan_nsecs / scan_count << " nsecs/route" << endl;
+    }
+};
+
+// Not part of the regular run, use --gtest_also_run_disabled_tests to run it.
+TEST_F(ServiceChainAggregateBenchmarkTest, DISABLED_Benchmark) {
+    for (int count = 1; count <= 10 * 1000; count *= 10) {
+        Run(count);
+    }
+}
+
+int main(int argc, char **argv) {
+    bgp_log_test::init();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
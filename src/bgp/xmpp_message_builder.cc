@@ -5,7 +5,6 @@
 #include "bgp/xmpp_message_builder.h"
 
 #include <boost/foreach.hpp>
-#include <pugixml/pugixml.hpp>
 
 #include "base/parse_object.h"
 #include "base/logging.h"
@@ -18,43 +17,65 @@
 #include "bgp/origin-vn/origin_vn.h"
 #include "bgp/security_group/security_group.h"
 #include "net/bgp_af.h"
-#include "schema/xmpp_unicast_types.h"
-#include "schema/xmpp_multicast_types.h"
-#include "schema/xmpp_enet_types.h"
+#include "xml/xml_writer.h"
 #include "xmpp/xmpp_init.h"
 
-using namespace pugi;
 using namespace std;
 
+class BgpXmppMessage;
+
+//
+// Item encoders for the address families that are advertised over XMPP.
+//
+// Each encoder writes the body of an <item> element straight into the
+// XmlWriter, following the element order of the corresponding autogen type
+// in the schema (xmpp_unicast.xsd, xmpp_enet.xsd and xmpp_multicast.xsd).
+// This keeps the output identical to what the autogen Encode methods would
+// produce through a pugi DOM.
+//
+struct InetItemEncoder {
+    static void Encode(XmlWriter *writer, const BgpXmppMessage *msg,
+                       const BgpRoute *route, const RibOutAttr *roattr);
+};
+
+struct EnetItemEncoder {
+    static void Encode(XmlWriter *writer, const BgpXmppMessage *msg,
+                       const BgpRoute *route, const RibOutAttr *roattr);
+};
+
+struct McastItemEncoder {
+    static void Encode(XmlWriter *writer, const BgpXmppMessage *msg,
+                       const BgpRoute *route, const RibOutAttr *roattr);
+};
+
 class BgpXmppMessage : public Message {
 public:
+    // Room reserved in front of the payload for the per-peer message header.
+    static const size_t kHeaderRoom = 256;
+
     BgpXmppMessage(const BgpTable *table, const RibOutAttr *roattr)
         : table_(table),
           is_reachable_(roattr->IsReachable()),
+          writer_(kHeaderRoom),
           virtual_network_("unresolved") {
     }
     virtual ~BgpXmppMessage() { }
     void Start(const RibOutAttr *roattr, const BgpRoute *route);
     virtual bool AddRoute(const BgpRoute *route, const RibOutAttr *roattr);
-    virtual void Finish() { }
+    virtual void Finish();
     virtual const uint8_t *GetData(IPeerUpdate *peer, size_t *lenp);
+    virtual const uint8_t *GetDataBuffered(IPeerUpdate *peer, size_t *lenp,
+                                           std::string *buffer);
+
+    const std::string &virtual_network() const { return virtual_network_; }
+    const std::vector<int> &security_group_list() const {
+        return security_group_list_;
+    }
 
 private:
-    void EncodeNextHop(const BgpRoute *route, RibOutAttr::NextHop nexthop,
-                       autogen::ItemType &item);
-    void AddInetReach(const BgpRoute *route, const RibOutAttr *roattr);
-    void AddInetUnreach(const BgpRoute *route);
-    bool AddInetRoute(const BgpRoute *route, const RibOutAttr *roattr);
-
-    void EncodeEnetNextHop(const BgpRoute *route, RibOutAttr::NextHop nexthop,
-                           autogen::EnetItemType &item);
-    void AddEnetReach(const BgpRoute *route, const RibOutAttr *roattr);
-    void AddEnetUnreach(const BgpRoute *route);
-    bool AddEnetRoute(const BgpRoute *route, const RibOutAttr *roattr);
-
-    void AddMcastReach(const BgpRoute *route, const RibOutAttr *roattr);
-    void AddMcastUnreach(const BgpRoute *route);
-    bool AddMcastRoute(const BgpRoute *route, const RibOutAttr *roattr);
+    template <typename ItemEncoder>
+    bool AddItem(const BgpRoute *route, const RibOutAttr *roattr);
+    static void FormatHeader(IPeerUpdate *peer, std::string *header);
 
     void ProcessExtCommunity(const ExtCommunity *ext_community) {
         if (ext_community == NULL)
@@ -79,248 +100,241 @@ private:
 
     const BgpTable *table_;
     bool is_reachable_;
-    xml_document xdoc_;
-    xml_node xitems_;
+    XmlWriter writer_;
     std::string virtual_network_;
     std::vector<int> security_group_list_;
     string repr_;
-    string repr_new_;
-    size_t repr_part1_;
-    size_t repr_part2_;
     DISALLOW_COPY_AND_ASSIGN(BgpXmppMessage);
 };
 
+//
+// The payload starts right after the start tag of the <message> element.
+// The start tag carries the per-peer "to" attribute and is placed into the
+// headroom of the writer when GetData is called for a given peer.
+//
 void BgpXmppMessage::Start(const RibOutAttr *roattr, const BgpRoute *route) {
-    // Build the DOM tree
-    xml_node message = xdoc_.append_child("message");
-    message.append_attribute("from") = XmppInit::kControlNodeJID;
+    writer_.AssumeElement("message");
 
-    xml_node event = message.append_child("event");
-    event.append_attribute("xmlns") = "http://jabber.org/protocol/pubsub";
-    xitems_ = event.append_child("items");
+    writer_.StartElement("event");
+    writer_.AddAttribute("xmlns", "http://jabber.org/protocol/pubsub");
+    writer_.StartElement("items");
 
     if (is_reachable_) {
         const BgpAttr *attr = roattr->attr();
         ProcessExtCommunity(attr->ext_community());
     }
-    
+
     stringstream ss;
     ss << route->Afi() << "/" << int(route->Safi()) << "/" <<
           table_->routing_instance()->name();
-    std::string node(ss.str());
-    if (table_->family() == Address::INETMCAST) {
-        xitems_.append_attribute("node") = node.c_str();
-        AddMcastRoute(route, roattr);
-    } else if (table_->family() == Address::ENET) {
-        xitems_.append_attribute("node") = node.c_str();
-        AddEnetRoute(route, roattr);
-    } else {
-        xitems_.append_attribute("node") = node.c_str();
-        AddInetRoute(route, roattr);
-    }
+    writer_.AddAttribute("node", ss.str());
+    AddRoute(route, roattr);
 }
 
 bool BgpXmppMessage::AddRoute(const BgpRoute *route, const RibOutAttr *roattr) {
     if (table_->family() == Address::INETMCAST) {
-        return AddMcastRoute(route, roattr);
+        return AddItem<McastItemEncoder>(route, roattr);
     } else if (table_->family() == Address::ENET) {
-        return AddEnetRoute(route, roattr);
+        return AddItem<EnetItemEncoder>(route, roattr);
     } else {
-        return AddInetRoute(route, roattr);
+        return AddItem<InetItemEncoder>(route, roattr);
     }
 }
 
-void BgpXmppMessage::EncodeNextHop(const BgpRoute *route,
-                                   RibOutAttr::NextHop nexthop,
-                                   autogen::ItemType &item) {
-    autogen::NextHopType item_nexthop;
-
-    item_nexthop.af = route->Afi();
-    item_nexthop.safi = route->Safi();
-    item_nexthop.address = nexthop.address().to_v4().to_string();
-    item_nexthop.label = nexthop.label();
-    if (nexthop.encap().empty()) {
-        // If encap list is empty, routes from non-control-node, 
-        // use mpls over gre as default encap
-        item_nexthop.tunnel_encapsulation_list.tunnel_encapsulation.push_back(std::string("gre"));
+template <typename ItemEncoder>
+bool BgpXmppMessage::AddItem(const BgpRoute *route, const RibOutAttr *roattr) {
+    if (is_reachable_) {
+        num_reach_route_++;
+        writer_.StartElement("item");
+        writer_.AddAttribute("id", route->ToString());
+        ItemEncoder::Encode(&writer_, this, route, roattr);
+        writer_.EndElement();
     } else {
-        item_nexthop.tunnel_encapsulation_list.tunnel_encapsulation= nexthop.encap();
+        num_unreach_route_++;
+        writer_.StartElement("retract");
+        writer_.AddAttribute("id", route->ToString());
+        writer_.EndElement();
     }
-
-    item.entry.next_hops.next_hop.push_back(item_nexthop);
+    return true;
 }
 
-void BgpXmppMessage::AddInetReach(const BgpRoute *route, const RibOutAttr *roattr) {
-    autogen::ItemType item;
-
-    item.entry.nlri.af = route->Afi();
-    item.entry.nlri.safi = route->Safi();
-    item.entry.nlri.address = route->ToString();
-    item.entry.version = 1;
-    item.entry.virtual_network = virtual_network_;
+void BgpXmppMessage::Finish() {
+    // Close the <items>, <event> and <message> elements.
+    while (writer_.depth() > 0) {
+        writer_.EndElement();
+    }
+}
 
-    assert(!roattr->nexthop_list().empty());
+void BgpXmppMessage::FormatHeader(IPeerUpdate *peer, string *header) {
+    string from, to;
+    XmlWriter::EscapeAttribute(XmppInit::kControlNodeJID, &from);
+    XmlWriter::EscapeAttribute(
+        (peer->ToString() + "/" + XmppInit::kBgpPeer).c_str(), &to);
+    *header = "<?xml version=\"1.0\"?>\n<message from=\"";
+    *header += from;
+    *header += "\" to=\"";
+    *header += to;
+    *header += "\">\n";
+}
 
-    //
-    // Encode all next-hops in the list
-    //
-    BOOST_FOREACH(RibOutAttr::NextHop nexthop, roattr->nexthop_list()) {
-        EncodeNextHop(route, nexthop, item);
-    }
+//
+// Patch the per-peer message header in front of the encoded payload. The
+// payload itself is never copied, unless the header doesn't fit into the
+// headroom reserved for it.
+//
+const uint8_t *BgpXmppMessage::GetData(IPeerUpdate *peer, size_t *lenp) {
+    string header;
+    FormatHeader(peer, &header);
 
-    for (std::vector<int>::iterator it = security_group_list_.begin(); 
-         it !=  security_group_list_.end(); it++) {
-        item.entry.security_group_list.security_group.push_back(*it);
+    writer_.ResetHeadroom();
+    if (writer_.Prepend(header.data(), header.size())) {
+        *lenp = writer_.size();
+        return writer_.data();
     }
 
-    xml_node node = xitems_.append_child("item");
-    node.append_attribute("id") = route->ToString().c_str();
-    item.Encode(&node);
+    repr_ = header;
+    repr_.append(reinterpret_cast<const char *>(writer_.data()),
+                 writer_.size());
+    *lenp = repr_.size();
+    return reinterpret_cast<const uint8_t *>(repr_.c_str());
 }
 
-void BgpXmppMessage::AddInetUnreach(const BgpRoute *route) {
-    xml_node node = xitems_.append_child("retract");
-    node.append_attribute("id") = route->ToString().c_str();
+//
+// Copy the header and the payload into the buffer, without modifying the
+// message, so that the message can be sent to several peers in parallel.
+//
+const uint8_t *BgpXmppMessage::GetDataBuffered(IPeerUpdate *peer,
+        size_t *lenp, string *buffer) {
+    FormatHeader(peer, buffer);
+    buffer->append(reinterpret_cast<const char *>(writer_.payload()),
+                   writer_.payload_size());
+    *lenp = buffer->size();
+    return reinterpret_cast<const uint8_t *>(buffer->data());
 }
 
-bool BgpXmppMessage::AddInetRoute(const BgpRoute *route, const RibOutAttr *roattr) {
-    if (is_reachable_) {
-        num_reach_route_++;
-        AddInetReach(route, roattr);
+static void EncodeInetNextHop(XmlWriter *writer, const BgpRoute *route,
+                              const RibOutAttr::NextHop &nexthop) {
+    writer->StartElement("next-hop");
+    writer->AddTextElement("af", route->Afi());
+    writer->AddTextElement("safi", route->Safi());
+    writer->AddTextElement("address", nexthop.address().to_v4().to_string());
+    writer->AddTextElement("label", nexthop.label());
+
+    writer->StartElement("tunnel-encapsulation-list");
+    if (nexthop.encap().empty()) {
+        // If encap list is empty, routes from non-control-node,
+        // use mpls over gre as default encap
+        writer->AddTextElement("tunnel-encapsulation", "gre");
     } else {
-        num_unreach_route_++;
-        AddInetUnreach(route);
+        BOOST_FOREACH(const string &encap, nexthop.encap()) {
+            writer->AddTextElement("tunnel-encapsulation", encap);
+        }
     }
-    return true;
-}
-
-void BgpXmppMessage::EncodeEnetNextHop(const BgpRoute *route,
-                                       RibOutAttr::NextHop nexthop,
-                                       autogen::EnetItemType &item) {
-    autogen::EnetNextHopType item_nexthop;
+    writer->EndElement();
 
-    item_nexthop.af = BgpAf::IPv4;
-    item_nexthop.address = nexthop.address().to_v4().to_string();
-    item_nexthop.label = nexthop.label();
-
-    item.entry.next_hops.next_hop.push_back(item_nexthop);
+    writer->EndElement();
 }
 
-void BgpXmppMessage::AddEnetReach(const BgpRoute *route, const RibOutAttr *roattr) {
-
-    autogen::EnetItemType item;
-    item.entry.nlri.af = route->Afi();
-    item.entry.nlri.safi = route->Safi();
+void InetItemEncoder::Encode(XmlWriter *writer, const BgpXmppMessage *msg,
+                             const BgpRoute *route,
+                             const RibOutAttr *roattr) {
+    writer->StartElement("entry");
 
-    EnetRoute *enet_route =
-        static_cast<EnetRoute *>(const_cast<BgpRoute *>(route));
-    item.entry.nlri.mac = enet_route->GetPrefix().mac_addr().ToString();
-    item.entry.nlri.address =  enet_route->GetPrefix().ip_prefix().ToString();
+    writer->StartElement("nlri");
+    writer->AddTextElement("af", route->Afi());
+    writer->AddTextElement("safi", route->Safi());
+    writer->AddTextElement("address", route->ToString());
+    writer->EndElement();
 
     assert(!roattr->nexthop_list().empty());
-    BOOST_FOREACH(RibOutAttr::NextHop nexthop, roattr->nexthop_list()) {
-        EncodeEnetNextHop(route, nexthop, item);
-    }
-
-    xml_node node = xitems_.append_child("item");
-    node.append_attribute("id") = route->ToString().c_str();
-    item.Encode(&node);
-}
 
-void BgpXmppMessage::AddEnetUnreach(const BgpRoute *route) {
-    xml_node node = xitems_.append_child("retract");
-    node.append_attribute("id") = route->ToString().c_str();
-}
-
-bool BgpXmppMessage::AddEnetRoute(const BgpRoute *route, const RibOutAttr *roattr) {
-    if (is_reachable_) {
-        num_reach_route_++;
-        AddEnetReach(route, roattr);
-    } else {
-        num_unreach_route_++;
-        AddEnetUnreach(route);
+    //
+    // Encode all next-hops in the list
+    //
+    writer->StartElement("next-hops");
+    BOOST_FOREACH(const RibOutAttr::NextHop &nexthop, roattr->nexthop_list()) {
+        EncodeInetNextHop(writer, route, nexthop);
     }
-    return true;
-}
+    writer->EndElement();
+
+    writer->AddTextElement("version", 1);
+    writer->AddTextElement("virtual-network", msg->virtual_network());
 
-void BgpXmppMessage::AddMcastReach(const BgpRoute *route, const RibOutAttr *roattr) {
-
-    autogen::McastItemType item;
-    item.entry.nlri.af = route->Afi();
-    item.entry.nlri.safi = route->Safi();
-
-    InetMcastRoute *mcast_route =
-        static_cast<InetMcastRoute *>(const_cast<BgpRoute *>(route));
-    item.entry.nlri.group = mcast_route->GetPrefix().group().to_string();
-    item.entry.nlri.source =  mcast_route->GetPrefix().source().to_string();
-    item.entry.nlri.source_label = roattr->label();
-
-    BgpOList *olist = roattr->attr()->olist().get();
-    std::vector<BgpOListElem>::const_iterator iterator;
-    for (iterator = olist->elements.begin();
-         iterator != olist->elements.end(); ++iterator) {
-        BgpOListElem elem = static_cast<BgpOListElem>(*iterator);
-
-        autogen::McastNextHopType nh;
-        nh.af = BgpAf::IPv4;
-        nh.safi = BgpAf::Mcast;
-        nh.address = elem.address.to_string();
-        stringstream label;
-        label << elem.label;
-        nh.label = label.str();
-        item.entry.olist.next_hop.push_back(nh);
+    writer->StartElement("security-group-list");
+    BOOST_FOREACH(int security_group, msg->security_group_list()) {
+        writer->AddTextElement("security-group", security_group);
     }
+    writer->EndElement();
 
-    xml_node node = xitems_.append_child("item");
-    node.append_attribute("id") = route->ToString().c_str();
-    item.Encode(&node);
+    writer->EndElement();
 }
 
-void BgpXmppMessage::AddMcastUnreach(const BgpRoute *route) {
-    xml_node node = xitems_.append_child("retract");
-    node.append_attribute("id") = route->ToString().c_str();
-}
+void EnetItemEncoder::Encode(XmlWriter *writer, const BgpXmppMessage *msg,
+                             const BgpRoute *route,
+                             const RibOutAttr *roattr) {
+    const EnetRoute *enet_route = static_cast<const EnetRoute *>(route);
 
-bool BgpXmppMessage::AddMcastRoute(const BgpRoute *route, const RibOutAttr *roattr) {
-    if (is_reachable_) {
-        num_reach_route_++;
-        AddMcastReach(route, roattr);
-    } else {
-        num_unreach_route_++;
-        AddMcastUnreach(route);
-    }
-    return true;
-}
-
-const uint8_t *BgpXmppMessage::GetData(IPeerUpdate *peer, size_t *lenp) {
-    std::string str = peer->ToString() + "/" + XmppInit::kBgpPeer;
+    writer->StartElement("entry");
 
-    // If the message has already been constructed, just replace the 'to' part.
-    if (!repr_.empty()) {
-        repr_new_ = string(repr_, 0, repr_part1_) + "to=\"" + str + "\">" +
-                    string(repr_, repr_part2_);
+    writer->StartElement("nlri");
+    writer->AddTextElement("af", route->Afi());
+    writer->AddTextElement("safi", route->Safi());
+    writer->AddTextElement("mac",
+                           enet_route->GetPrefix().mac_addr().ToString());
+    writer->AddTextElement("address",
+                           enet_route->GetPrefix().ip_prefix().ToString());
+    writer->EndElement();
 
-        *lenp = repr_new_.size();
-        return reinterpret_cast<const uint8_t *>(repr_new_.c_str());
+    assert(!roattr->nexthop_list().empty());
+    writer->StartElement("next-hops");
+    BOOST_FOREACH(const RibOutAttr::NextHop &nexthop, roattr->nexthop_list()) {
+        writer->StartElement("next-hop");
+        writer->AddTextElement("af", BgpAf::IPv4);
+        writer->AddTextElement("address",
+                               nexthop.address().to_v4().to_string());
+        writer->AddTextElement("label", nexthop.label());
+        writer->EndElement();
     }
+    writer->EndElement();
 
-    xml_node message =  xdoc_.child("message");
-    xml_attribute attr_to = message.attribute("to");
-    if (!attr_to) {
-        attr_to = message.append_attribute("to");
-    }
-    attr_to.set_value(str.c_str());
-    ostringstream oss;
-    xdoc_.save(oss);
-    repr_ = oss.str();
+    writer->EndElement();
+}
 
-    repr_part1_ = repr_.find("to=", 0);
-    assert(repr_part1_ != string::npos);
-    repr_part2_ = repr_.find("\n\t<event xmlns");
-    assert(repr_part2_ != string::npos);
+void McastItemEncoder::Encode(XmlWriter *writer, const BgpXmppMessage *msg,
+                              const BgpRoute *route,
+                              const RibOutAttr *roattr) {
+    const InetMcastRoute *mcast_route =
+        static_cast<const InetMcastRoute *>(route);
+
+    writer->StartElement("entry");
+
+    writer->StartElement("nlri");
+    writer->AddTextElement("af", route->Afi());
+    writer->AddTextElement("safi", route->Safi());
+    writer->AddTextElement("group",
+                           mcast_route->GetPrefix().group().to_string());
+    writer->AddTextElement("source",
+                           mcast_route->GetPrefix().source().to_string());
+    writer->AddTextElement("source-label", roattr->label());
+    writer->EndElement();
+
+    // The next-hops element is not used for routes sent to agents.
+    writer->StartElement("next-hops");
+    writer->EndElement();
+
+    writer->StartElement("olist");
+    const BgpOList *olist = roattr->attr()->olist().get();
+    BOOST_FOREACH(const BgpOListElem &elem, olist->elements()) {
+        writer->StartElement("next-hop");
+        writer->AddTextElement("af", BgpAf::IPv4);
+        writer->AddTextElement("safi", BgpAf::Mcast);
+        writer->AddTextElement("address", elem.address.to_string());
+        writer->AddTextElement("label", elem.label);
+        writer->EndElement();
+    }
+    writer->EndElement();
 
-    *lenp = repr_.size();
-    return reinterpret_cast<const uint8_t *>(repr_.c_str());
+    writer->EndElement();
 }
 
 Message *BgpXmppMessageBuilder::Create(const BgpTable *table,
@@ -28,6 +28,7 @@ void ControlNode::SetDefaultSchedulingPolicy() {
         "bgp::StateMachine",
         "bgp::PeerMembership",
         "db::DBTable",
+        "db::DBTableWalk",
         "io::ReaderTask",
         "ifmap::StateMachine",
         "xmpp::StateMachine",
@@ -51,6 +52,7 @@ void ControlNode::SetDefaultSchedulingPolicy() {
         "bgp::ServiceChain",
         "bgp::StaticRoute",
         "db::DBTable",
+        "db::DBTableWalk",
     };
     arraysize = sizeof(svc_chain_exclusion_task_ids) / sizeof(char *);
     for (int i = 0; i < arraysize; ++i) {
@@ -78,6 +80,7 @@ void ControlNode::SetDefaultSchedulingPolicy() {
     TaskPolicy peer_membership_policy =
         boost::assign::list_of
         (TaskExclusion(scheduler->GetTaskId("db::DBTable")))
+        (TaskExclusion(scheduler->GetTaskId("db::DBTableWalk")))
         (TaskExclusion(scheduler->GetTaskId("bgp::SendTask")))
         (TaskExclusion(scheduler->GetTaskId("bgp::ShowCommand")))
         (TaskExclusion(scheduler->GetTaskId("bgp::StateMachine")))
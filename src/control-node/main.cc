@@ -17,11 +17,14 @@
 #include "bgp/bgp_config_parser.h"
 #include "bgp/bgp_peer.h"
 #include "bgp/bgp_peer_types.h"
+#include "bgp/bgp_route_stats.h"
 #include "bgp/bgp_server.h"
 #include "bgp/bgp_session_manager.h"
 #include "bgp/bgp_xmpp_channel.h"
+#include "bgp/scheduling_group.h"
 #include "bgp/routing-instance/routing_instance.h"
 #include "control-node/control_node.h"
+#include "db/db.h"
 #include "db/db_graph.h"
 #include "ifmap/ifmap_link_table.h"
 #include "ifmap/ifmap_server_parser.h"
@@ -191,6 +194,22 @@ static void FillPeerDebugStats(IPeerDebugStats *peer_state,
     stats.set_tx_proto_stats(proto_stats_tx);
     stats.set_rx_update_stats(rt_stats_rx);
     stats.set_tx_update_stats(rt_stats_tx);
+
+    RouteChangeStats *route_change_stats = peer_state->route_change_stats();
+    if (route_change_stats) {
+        RouteChangeStats::Counters counters, rates;
+        route_change_stats->Sample(UTCTimestampUsec(), &counters, &rates);
+        PeerRouteChangeStats rt_change_stats;
+        rt_change_stats.adds = counters.count[RouteChangeStats::ADD];
+        rt_change_stats.changes = counters.count[RouteChangeStats::CHANGE];
+        rt_change_stats.deletes = counters.count[RouteChangeStats::DELETE];
+        rt_change_stats.adds_per_sec = rates.count[RouteChangeStats::ADD];
+        rt_change_stats.changes_per_sec =
+            rates.count[RouteChangeStats::CHANGE];
+        rt_change_stats.deletes_per_sec =
+            rates.count[RouteChangeStats::DELETE];
+        stats.set_rx_route_change_stats(rt_change_stats);
+    }
 }
 
 void FillXmppPeerStats(BgpServer *server, BgpXmppChannel *channel) {
@@ -225,6 +244,7 @@ bool ControlNodeInfoLogger(BgpSandeshContext &ctx) {
     BgpXmppChannelManager *xmpp_channel_mgr = ctx.xmpp_peer_manager;
 
     LogControlNodePeerStats(server, xmpp_channel_mgr);
+    server->routing_instance_mgr()->SendStatsUve();
 
     BgpRouterState state;
     static BgpRouterState prev_state;
@@ -396,12 +416,16 @@ int main(int argc, char *argv[]) {
         ("bgp-port",
          opt::value<int>()->default_value(BgpConfigManager::kDefaultPort),
          "BGP listener port")
+        ("bgp-send-workers", opt::value<int>()->default_value(1),
+         "Number of parallel workers sending updates for a scheduling group")
         ("collector", opt::value<string>(),
             "IP address of sandesh collector")
         ("collector-port", opt::value<int>(),
             "Port of sandesh collector")
         ("config-file", opt::value<string>()->default_value("bgp_config.xml"),
             "Configuration file")
+        ("db-partition-count", opt::value<int>(),
+            "Number of DB partitions (default is number of hardware threads)")
         ("discovery-server", opt::value<string>(),
             "IP address of Discovery Server")
         ("discovery-port", 
@@ -471,6 +495,15 @@ int main(int argc, char *argv[]) {
         exit(0);
     }
 
+    if (var_map.count("db-partition-count") &&
+        var_map["db-partition-count"].as<int>() <= 0) {
+        cerr << "Invalid db-partition-count "
+             << var_map["db-partition-count"].as<int>()
+             << ": must be a positive number" << endl;
+        cerr << desc << endl;
+        exit(1);
+    }
+
     ControlNode::SetProgramName(argv[0]);
     unsigned long log_file_size = default_log_file_size;
     unsigned long log_file_index = default_log_file_index;
@@ -488,6 +521,9 @@ int main(int argc, char *argv[]) {
     }
     TaskScheduler::Initialize();
     ControlNode::SetDefaultSchedulingPolicy();
+    if (var_map.count("db-partition-count")) {
+        DB::SetPartitionCount(var_map["db-partition-count"].as<int>());
+    }
     BgpSandeshContext sandesh_context;
 
     if (!var_map.count("discovery-server")) { 
@@ -514,6 +550,8 @@ int main(int argc, char *argv[]) {
     }
 
     boost::scoped_ptr<BgpServer> bgp_server(new BgpServer(&evm));
+    bgp_server->scheduling_group_manager()->set_send_workers(
+        var_map["bgp-send-workers"].as<int>());
     sandesh_context.bgp_server = bgp_server.get();
 
     DB config_db;
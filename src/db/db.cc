@@ -37,6 +37,11 @@ int DB::PartitionCount() {
     return partition_count_;
 }
 
+void DB::SetPartitionCount(int count) {
+    assert(count >= 0);
+    partition_count_ = count;
+}
+
 DB::DB() : walker_(new DBTableWalker()) {
     for (int i = 0; i < PartitionCount(); i++) {
         partitions_.push_back(new DBPartition(i));
@@ -71,8 +76,8 @@ void DB::RemoveTable(DBTableBase *tbl_base) {
 }
 
 bool DB::IsDBQueueEmpty() {
-    for (int i = 0; i < PartitionCount(); i++) {
-        if (!GetPartition(i)->IsDBQueueEmpty()) return false;
+    for (size_t i = 0; i < partitions_.size(); i++) {
+        if (!partitions_[i]->IsDBQueueEmpty()) return false;
     }
 
     return true;
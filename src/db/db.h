@@ -48,6 +48,12 @@ public:
     void SetGraph(const std::string &name, DBGraph *graph);
 
     static int PartitionCount();
+
+    // Override the number of partitions, which defaults to the number of
+    // hardware threads. Must be called before any DB is created, since the
+    // partitions of a DB and its tables are allocated at creation time. A
+    // count of 0 restores the default.
+    static void SetPartitionCount(int count);
     static void RegisterFactory(const std::string &prefix,
                                 CreateFunction create_fn);
     static void ClearFactoryRegistry();
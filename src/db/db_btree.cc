@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "db/db_btree.h"
+
+#include <cassert>
+
+#include "db/db_entry.h"
+
+DBEntryBTree::DBEntryBTree() : root_(NULL), head_(NULL), size_(0) {
+}
+
+DBEntryBTree::~DBEntryBTree() {
+    if (root_ != NULL) {
+        FreeNode(root_);
+    }
+}
+
+void DBEntryBTree::FreeNode(Node *node) {
+    if (node->is_leaf) {
+        delete static_cast<Leaf *>(node);
+        return;
+    }
+    Inner *inner = static_cast<Inner *>(node);
+    for (int i = 0; i < inner->count; i++) {
+        FreeNode(inner->children[i]);
+    }
+    delete inner;
+}
+
+//
+// Descend to the leaf that contains the key, or would contain it if it
+// were present.
+//
+DBEntryBTree::Leaf *DBEntryBTree::FindLeaf(const DBEntry *key) const {
+    if (root_ == NULL) {
+        return NULL;
+    }
+    Node *node = root_;
+    while (!node->is_leaf) {
+        const Inner *inner = static_cast<const Inner *>(node);
+        int lo = 0, hi = inner->count - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (key->IsLess(*inner->keys[mid])) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        node = inner->children[lo];
+    }
+    return static_cast<Leaf *>(node);
+}
+
+// Index of the first entry in the leaf that is not less than the key.
+int DBEntryBTree::LeafLowerBound(const Leaf *leaf, const DBEntry *key) {
+    int lo = 0, hi = leaf->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (leaf->entries[mid]->IsLess(*key)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+int DBEntryBTree::ChildIndex(const Inner *inner, const Node *child) {
+    for (int i = 0; i < inner->count; i++) {
+        if (inner->children[i] == child) {
+            return i;
+        }
+    }
+    assert(false);
+    return -1;
+}
+
+bool DBEntryBTree::insert(DBEntry *entry) {
+    if (root_ == NULL) {
+        head_ = new Leaf;
+        root_ = head_;
+    }
+
+    Leaf *leaf = FindLeaf(entry);
+    int pos = LeafLowerBound(leaf, entry);
+    if (pos < leaf->count && !entry->IsLess(*leaf->entries[pos])) {
+        return false;
+    }
+
+    // An entry that goes right after the last entry of the left half is
+    // added to the left leaf, so the separator of the right leaf remains
+    // valid.
+    if (leaf->count == kLeafSize) {
+        Leaf *right = SplitLeaf(leaf);
+        if (pos > leaf->count) {
+            pos -= leaf->count;
+            leaf = right;
+        }
+    }
+
+    for (int i = leaf->count; i > pos; i--) {
+        leaf->entries[i] = leaf->entries[i - 1];
+    }
+    leaf->entries[pos] = entry;
+    leaf->count++;
+    entry->set_index_node(leaf);
+    size_++;
+    return true;
+}
+
+void DBEntryBTree::erase(DBEntry *entry) {
+    Leaf *leaf = static_cast<Leaf *>(entry->index_node());
+    assert(leaf != NULL);
+    int pos = 0;
+    while (leaf->entries[pos] != entry) {
+        pos++;
+        assert(pos < leaf->count);
+    }
+
+    for (int i = pos; i < leaf->count - 1; i++) {
+        leaf->entries[i] = leaf->entries[i + 1];
+    }
+    leaf->count--;
+    entry->set_index_node(NULL);
+    size_--;
+
+    if (leaf->count == 0 && leaf != root_) {
+        if (leaf->prev != NULL) {
+            leaf->prev->next = leaf->next;
+        } else {
+            head_ = leaf->next;
+        }
+        if (leaf->next != NULL) {
+            leaf->next->prev = leaf->prev;
+        }
+        RemoveChild(leaf->parent, ChildIndex(leaf->parent, leaf));
+        delete leaf;
+    } else if (pos == 0 && leaf->count > 0) {
+        UpdateSeparator(leaf, leaf->entries[0]);
+    }
+}
+
+DBEntry *DBEntryBTree::lower_bound(const DBEntry *key) const {
+    Leaf *leaf = FindLeaf(key);
+    if (leaf == NULL) {
+        return NULL;
+    }
+    int pos = LeafLowerBound(leaf, key);
+    if (pos < leaf->count) {
+        return leaf->entries[pos];
+    }
+    return leaf->next ? leaf->next->entries[0] : NULL;
+}
+
+DBEntry *DBEntryBTree::find(const DBEntry *key) const {
+    DBEntry *entry = lower_bound(key);
+    if (entry != NULL && !key->IsLess(*entry)) {
+        return entry;
+    }
+    return NULL;
+}
+
+DBEntry *DBEntryBTree::first() const {
+    if (head_ == NULL || head_->count == 0) {
+        return NULL;
+    }
+    return head_->entries[0];
+}
+
+DBEntry *DBEntryBTree::next(const DBEntry *entry) const {
+    const Leaf *leaf = static_cast<const Leaf *>(entry->index_node());
+    assert(leaf != NULL);
+    int pos = 0;
+    while (leaf->entries[pos] != entry) {
+        pos++;
+        assert(pos < leaf->count);
+    }
+    if (pos + 1 < leaf->count) {
+        return leaf->entries[pos + 1];
+    }
+    return leaf->next ? leaf->next->entries[0] : NULL;
+}
+
+// Move the upper half of a full leaf into a new leaf.
+DBEntryBTree::Leaf *DBEntryBTree::SplitLeaf(Leaf *leaf) {
+    Leaf *right = new Leaf;
+    int half = leaf->count / 2;
+    for (int i = half; i < leaf->count; i++) {
+        DBEntry *entry = leaf->entries[i];
+        right->entries[i - half] = entry;
+        entry->set_index_node(right);
+    }
+    right->count = leaf->count - half;
+    leaf->count = half;
+
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next != NULL) {
+        leaf->next->prev = right;
+    }
+    leaf->next = right;
+
+    AddParent(leaf, right, right->entries[0]);
+    return right;
+}
+
+//
+// Move the upper half of the children of a full inner node into a new inner
+// node. The smallest entry under the new node moves up to the parent.
+//
+DBEntryBTree::Inner *DBEntryBTree::SplitInner(Inner *inner) {
+    Inner *right = new Inner;
+    int half = inner->count / 2;
+    for (int i = half; i < inner->count; i++) {
+        right->children[i - half] = inner->children[i];
+        right->children[i - half]->parent = right;
+    }
+    for (int i = half; i < inner->count - 1; i++) {
+        right->keys[i - half] = inner->keys[i];
+    }
+    right->count = inner->count - half;
+    inner->count = half;
+
+    AddParent(inner, right, inner->keys[half - 1]);
+    return right;
+}
+
+// Add the right sibling created by a split to the parent of the left node.
+void DBEntryBTree::AddParent(Node *left, Node *right, DBEntry *key) {
+    if (left->parent == NULL) {
+        Inner *root = new Inner;
+        root->children[0] = left;
+        root->count = 1;
+        left->parent = root;
+        root_ = root;
+    }
+    Inner *parent = left->parent;
+    InsertChild(parent, ChildIndex(parent, left) + 1, key, right);
+}
+
+// Insert a child at the given index, which is never 0.
+void DBEntryBTree::InsertChild(Inner *inner, int index, DBEntry *key,
+                               Node *child) {
+    if (inner->count == kInnerSize) {
+        int half = inner->count / 2;
+        Inner *right = SplitInner(inner);
+        if (index > half) {
+            index -= half;
+            inner = right;
+        }
+    }
+
+    for (int i = inner->count; i > index; i--) {
+        inner->children[i] = inner->children[i - 1];
+    }
+    for (int i = inner->count - 1; i >= index; i--) {
+        inner->keys[i] = inner->keys[i - 1];
+    }
+    inner->children[index] = child;
+    inner->keys[index - 1] = key;
+    inner->count++;
+    child->parent = inner;
+}
+
+//
+// Remove the child at the given index. Inner nodes that become empty are
+// removed from their parent in turn, and the root is replaced by its only
+// child.
+//
+void DBEntryBTree::RemoveChild(Inner *inner, int index) {
+    DBEntry *first = (index == 0 && inner->count > 1) ? inner->keys[0] : NULL;
+
+    for (int i = index; i < inner->count - 1; i++) {
+        inner->children[i] = inner->children[i + 1];
+    }
+    for (int i = (index == 0) ? 0 : index - 1; i < inner->count - 2; i++) {
+        inner->keys[i] = inner->keys[i + 1];
+    }
+    inner->count--;
+
+    if (inner->count == 0) {
+        assert(inner != root_);
+        Inner *parent = inner->parent;
+        RemoveChild(parent, ChildIndex(parent, inner));
+        delete inner;
+        return;
+    }
+
+    if (first != NULL) {
+        UpdateSeparator(inner, first);
+    }
+
+    // The new root may itself be an inner node with a single child, since
+    // under-full nodes are not merged.
+    while (inner == root_ && inner->count == 1) {
+        root_ = inner->children[0];
+        root_->parent = NULL;
+        delete inner;
+        if (root_->is_leaf)
+            break;
+        inner = static_cast<Inner *>(root_);
+    }
+}
+
+//
+// The smallest entry under a node has changed. Update the separator in the
+// closest ancestor for which the node is not in the leftmost subtree.
+//
+void DBEntryBTree::UpdateSeparator(Node *node, DBEntry *first) {
+    while (node->parent != NULL) {
+        Inner *parent = node->parent;
+        int index = ChildIndex(parent, node);
+        if (index > 0) {
+            parent->keys[index - 1] = first;
+            return;
+        }
+        node = parent;
+    }
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_db_btree_h
+#define ctrlplane_db_btree_h
+
+#include <cstddef>
+
+#include "base/util.h"
+
+class DBEntry;
+
+//
+// B+-tree of DBEntry pointers, ordered by DBEntry::IsLess.
+//
+// Entries are kept in sorted arrays in the leaves, and the leaves are linked
+// in key order. Compared to the red-black tree used by default, a lookup
+// touches far fewer nodes, and a walk reads entry pointers sequentially out
+// of the leaves instead of chasing parent and child pointers.
+//
+// Each entry records the leaf it's stored in through DBEntry::index_node(),
+// so that the successor of an entry is found without searching. This is what
+// allows GetNext() to remain a constant time operation. Entries of tables
+// that use this index must provide storage for it.
+//
+// Nodes are not merged when they become under-full. A node is freed only
+// once it becomes empty.
+//
+class DBEntryBTree {
+public:
+    DBEntryBTree();
+    ~DBEntryBTree();
+
+    // Returns false if an entry with the same key is present.
+    bool insert(DBEntry *entry);
+    void erase(DBEntry *entry);
+
+    DBEntry *find(const DBEntry *key) const;
+    // Returns the matching entry or the next one in key order.
+    DBEntry *lower_bound(const DBEntry *key) const;
+    DBEntry *first() const;
+    DBEntry *next(const DBEntry *entry) const;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    static const int kLeafSize = 32;
+    static const int kInnerSize = 32;
+
+    struct Inner;
+
+    struct Node {
+        explicit Node(bool is_leaf) : is_leaf(is_leaf), count(0), parent(NULL) {
+        }
+        bool is_leaf;
+        // Number of entries in a leaf, or children of an inner node.
+        int count;
+        Inner *parent;
+    };
+
+    struct Leaf : public Node {
+        Leaf() : Node(true), prev(NULL), next(NULL) { }
+        DBEntry *entries[kLeafSize];
+        Leaf *prev;
+        Leaf *next;
+    };
+
+    struct Inner : public Node {
+        Inner() : Node(false) { }
+        // keys[i - 1] is the smallest entry under children[i].
+        DBEntry *keys[kInnerSize - 1];
+        Node *children[kInnerSize];
+    };
+
+    Leaf *FindLeaf(const DBEntry *key) const;
+    static int LeafLowerBound(const Leaf *leaf, const DBEntry *key);
+    static int ChildIndex(const Inner *inner, const Node *child);
+
+    Leaf *SplitLeaf(Leaf *leaf);
+    Inner *SplitInner(Inner *inner);
+    void AddParent(Node *left, Node *right, DBEntry *key);
+    void InsertChild(Inner *inner, int index, DBEntry *key, Node *child);
+    void RemoveChild(Inner *inner, int index);
+    void UpdateSeparator(Node *node, DBEntry *first);
+    void FreeNode(Node *node);
+
+    Node *root_;
+    Leaf *head_;
+    size_t size_;
+
+    DISALLOW_COPY_AND_ASSIGN(DBEntryBTree);
+};
+
+#endif
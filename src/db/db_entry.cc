@@ -2,6 +2,7 @@
  * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
  */
 
+#include <cstdlib>
 #include <tbb/mutex.h>
 #include "base/util.h"
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -10,15 +11,112 @@
 
 using namespace std;
 
+DBEntryBase::StateList::~StateList() {
+    if (!is_inline())
+        free(u_.entries);
+}
+
+//
+// Index of the first entry with an id that is not less than the given id.
+//
+size_t DBEntryBase::StateList::LowerBound(ListenerId id) const {
+    size_t lo = 0, hi = count_;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (u_.entries[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+bool DBEntryBase::StateList::Set(ListenerId id, DBState *state) {
+    if (is_inline()) {
+        if (count_ == 0 || id_ == id) {
+            bool added = (count_ == 0);
+            id_ = id;
+            u_.state = state;
+            count_ = 1;
+            return added;
+        }
+
+        // Move the inline state to an array.
+        Entry *entries = static_cast<Entry *>(malloc(2 * sizeof(Entry)));
+        assert(entries);
+        entries[0].id = id_;
+        entries[0].state = u_.state;
+        u_.entries = entries;
+        capacity_ = 2;
+    }
+
+    size_t index = LowerBound(id);
+    if (index < count_ && u_.entries[index].id == id) {
+        u_.entries[index].state = state;
+        return false;
+    }
+    if (count_ == capacity_) {
+        assert(capacity_ < 0x8000);
+        capacity_ *= 2;
+        u_.entries = static_cast<Entry *>(
+            realloc(u_.entries, capacity_ * sizeof(Entry)));
+        assert(u_.entries);
+    }
+    for (size_t idx = count_; idx > index; --idx) {
+        u_.entries[idx] = u_.entries[idx - 1];
+    }
+    u_.entries[index].id = id;
+    u_.entries[index].state = state;
+    count_++;
+    return true;
+}
+
+DBState *DBEntryBase::StateList::Get(ListenerId id) const {
+    if (is_inline())
+        return (count_ != 0 && id_ == id) ? u_.state : NULL;
+    size_t index = LowerBound(id);
+    if (index < count_ && u_.entries[index].id == id)
+        return u_.entries[index].state;
+    return NULL;
+}
+
+void DBEntryBase::StateList::Clear(ListenerId id) {
+    if (is_inline()) {
+        if (count_ != 0 && id_ == id) {
+            u_.state = NULL;
+            count_ = 0;
+        }
+        return;
+    }
+
+    size_t index = LowerBound(id);
+    if (index == count_ || u_.entries[index].id != id)
+        return;
+    count_--;
+    for (size_t idx = index; idx < count_; ++idx) {
+        u_.entries[idx] = u_.entries[idx + 1];
+    }
+
+    // Go back to the inline state when there's only one left.
+    if (count_ <= 1) {
+        Entry *entries = u_.entries;
+        if (count_ == 1) {
+            id_ = entries[0].id;
+            u_.state = entries[0].state;
+        } else {
+            u_.state = NULL;
+        }
+        capacity_ = 0;
+        free(entries);
+    }
+}
+
 void DBEntryBase::SetState(DBTableBase *tbl_base, ListenerId listener,
                            DBState *state) {
     DBTablePartBase *tpart = tbl_base->GetTablePartition(this);
     tbb::mutex::scoped_lock lock(tpart->dbstate_mutex());
-    pair<StateMap::iterator, bool> res = state_.insert(
-        make_pair(listener, state));
-    if (!res.second) {
-        res.first->second = state;
-    } else {
+    if (state_.Set(listener, state)) {
         assert(!IsDeleted());
     }
 }
@@ -26,11 +124,7 @@ void DBEntryBase::SetState(DBTableBase *tbl_base, ListenerId listener,
 DBState *DBEntryBase::GetState(DBTableBase *tbl_base, ListenerId listener) {
     DBTablePartBase *tpart = tbl_base->GetTablePartition(this);
     tbb::mutex::scoped_lock lock(tpart->dbstate_mutex());
-    StateMap::iterator loc = state_.find(listener);
-    if (loc != state_.end()) {
-        return loc->second;
-    }
-    return NULL;
+    return state_.Get(listener);
 }
 
 const DBState *DBEntryBase::GetState(const DBTableBase *tbl_base,
@@ -38,17 +132,13 @@ const DBState *DBEntryBase::GetState(const DBTableBase *tbl_base,
     DBTableBase *table = const_cast<DBTableBase *>(tbl_base);
     DBTablePartBase *tpart = table->GetTablePartition(this);
     tbb::mutex::scoped_lock lock(tpart->dbstate_mutex());
-    StateMap::const_iterator loc = state_.find(listener);
-    if (loc != state_.end()) {
-        return loc->second;
-    }
-    return NULL;
+    return state_.Get(listener);
 }
 
 void DBEntryBase::ClearState(DBTableBase *tbl_base, ListenerId listener) {
     DBTablePartBase *tpart = tbl_base->GetTablePartition(this);
     tbb::mutex::scoped_lock lock(tpart->dbstate_mutex());
-    state_.erase(listener);
+    state_.Clear(listener);
     if (state_.empty() && IsDeleted() && !is_onlist()) {
         assert(!IsOnRemoveQ());
         tbl_base->EnqueueRemove(this);
@@ -71,3 +161,7 @@ void DBEntryBase::set_last_change_at(uint64_t time) {
 const std::string DBEntryBase::last_change_at_str() const {
     return duration_usecs_to_string(UTCTimestampUsec() - last_change_at_);
 }
+
+void DBEntry::set_index_node(void *node) {
+    assert(false);
+}
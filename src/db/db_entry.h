@@ -5,8 +5,6 @@
 #ifndef ctrlplane_db_entry_h
 #define ctrlplane_db_entry_h
 
-#include <map>
-
 #include "db/db_table.h"
 
 #include <boost/intrusive/list.hpp>
@@ -22,7 +20,8 @@ public:
     typedef DBTableBase::ListenerId ListenerId;
     typedef std::auto_ptr<DBRequestKey> KeyPtr;
 
-    DBEntryBase() : table_(NULL), flags(0), last_change_at_(UTCTimestampUsec()) {
+    DBEntryBase()
+        : table_(NULL), last_change_at_(UTCTimestampUsec()), flags(0) {
     }
     virtual ~DBEntryBase() { }
     virtual std::string ToString() const = 0;
@@ -46,6 +45,11 @@ public:
     void clear_onlist() { flags &= ~Onlist; }
     bool is_onlist() { return (flags & Onlist); }
 
+    // Notified again while its batch is being delivered
+    void set_renotify() { flags |= Renotify; }
+    void clear_renotify() { flags &= ~Renotify; }
+    bool is_renotify() { return (flags & Renotify); }
+
     void SetOnRemoveQ() { flags |= OnRemoveQ; }
     void ClearOnRemoveQ() { flags &= ~OnRemoveQ; }
     bool IsOnRemoveQ() { return (flags & OnRemoveQ); }
@@ -65,12 +69,51 @@ private:
         Onlist       = 1 << 0,
         DeleteMarked = 1 << 1,
         OnRemoveQ    = 1 << 2,
+        Renotify     = 1 << 3,
+    };
+
+    //
+    // Listener states, sorted by listener id. Most entries have at most one
+    // listener state, which is kept inline. Otherwise the states are kept
+    // in an array whose capacity is a power of 2.
+    //
+    class StateList {
+    public:
+        StateList() : count_(0), capacity_(0), id_(0) {
+            u_.state = NULL;
+        }
+        ~StateList();
+
+        // Returns false if the listener already had a state, which is then
+        // replaced.
+        bool Set(ListenerId id, DBState *state);
+        DBState *Get(ListenerId id) const;
+        void Clear(ListenerId id);
+        bool empty() const { return count_ == 0; }
+
+    private:
+        struct Entry {
+            ListenerId id;
+            DBState *state;
+        };
+
+        bool is_inline() const { return capacity_ == 0; }
+        size_t LowerBound(ListenerId id) const;
+
+        union {
+            DBState *state;
+            Entry *entries;
+        } u_;
+        uint16_t count_;
+        uint16_t capacity_;
+        ListenerId id_;
+        DISALLOW_COPY_AND_ASSIGN(StateList);
     };
-    typedef std::map<ListenerId, DBState *> StateMap;
+
     DBTableBase *table_;
-    StateMap state_;
-    uint8_t flags;
     uint64_t last_change_at_; // time at which entry was last 'changed'
+    StateList state_;
+    uint8_t flags;
     DISALLOW_COPY_AND_ASSIGN(DBEntryBase);
 };
 
@@ -93,9 +136,15 @@ public:
         return IsLess(rhs);
     }
 
+    // Leaf that holds the entry when the table uses a DBEntryBTree index.
+    // Entries of such tables must override both accessors.
+    virtual void *index_node() const { return NULL; }
+    virtual void set_index_node(void *node);
+
 private:
     friend class DBTablePartition;
-    boost::intrusive::set_member_hook<> node_;
+    boost::intrusive::set_member_hook<
+        boost::intrusive::optimize_size<true> > node_;
     DISALLOW_COPY_AND_ASSIGN(DBEntry);
 };
 
@@ -5,10 +5,12 @@
 #include "db/db_partition.h"
 
 #include <list>
+#include <vector>
 #include <tbb/atomic.h>
 #include <tbb/concurrent_queue.h>
 #include <tbb/mutex.h>
 
+#include "base/mpsc_ring.h"
 #include "base/task.h"
 #include "db/db_client.h"
 #include "db/db_entry.h"
@@ -20,12 +22,18 @@ int DBPartition::db_partition_task_id_ = -1;
 struct RequestQueueEntry {
     // Constructor takes ownership of DBRequest key, data.
     RequestQueueEntry(DBTablePartBase *tpart, DBClient *client, DBRequest *req)
-        : tpart(tpart), client(client) {
+        : tpart(tpart), client(client), enqueue_time(UTCTimestampUsec()) {
+        request.Swap(req);
+    }
+    RequestQueueEntry(DBTablePartBase *tpart, DBClient *client, DBRequest *req,
+                      uint64_t enqueue_time)
+        : tpart(tpart), client(client), enqueue_time(enqueue_time) {
         request.Swap(req);
     }
     DBTablePartBase *tpart;
     DBClient *client;
     DBRequest request;
+    uint64_t enqueue_time;
 };
 
 struct RemoveQueueEntry {
@@ -36,37 +44,87 @@ struct RemoveQueueEntry {
     DBEntryBase *db_entry;
 };
 
+//
+// Requests are enqueued into a bounded lock-free ring. If the ring fills up
+// because clients ignore the back-pressure indication, requests spill over
+// into an unbounded overflow queue. Producers keep using the overflow queue
+// till the consumer has drained it, so that requests from a given producer
+// are always processed in the order in which they were enqueued.
+//
 class DBPartition::WorkQueue {
 public:
     static const int kThreshold = 1024;
+    static const int kRingSize = 4 * kThreshold;
+    typedef MpscRing<RequestQueueEntry *> RequestRing;
     typedef concurrent_queue<RequestQueueEntry *> RequestQueue;
     typedef concurrent_queue<RemoveQueueEntry *> RemoveQueue;
     typedef std::list<DBTablePartBase *> TablePartList;
+    typedef std::vector<RequestQueueEntry *> RequestEntryList;
 
     explicit WorkQueue(int partition_id) 
-        : db_partition_id_(partition_id), disable_(false), running_(false) {
+        : db_partition_id_(partition_id), disable_(false), running_(false),
+          request_ring_(kRingSize) {
         request_count_ = 0;
+        overflow_count_ = 0;
+        total_request_count_ = 0;
+        total_overflow_count_ = 0;
+        total_batch_count_ = 0;
+        max_request_count_ = 0;
+        total_enqueue_time_ = 0;
+        max_enqueue_time_ = 0;
+        total_wait_time_ = 0;
+        max_wait_time_ = 0;
     }
     ~WorkQueue() {
-        for (RequestQueue::iterator iter = request_queue_.unsafe_begin();
-             iter != request_queue_.unsafe_end();) {
-            RequestQueueEntry *req_entry = *iter;
+        RequestQueueEntry *req_entry;
+        while (request_ring_.TryPop(&req_entry)) {
+            delete req_entry;
+        }
+        for (RequestQueue::iterator iter = overflow_queue_.unsafe_begin();
+             iter != overflow_queue_.unsafe_end();) {
+            req_entry = *iter;
             ++iter;
             delete req_entry;
         }
-        request_queue_.clear();
+        overflow_queue_.clear();
     }
 
     bool EnqueueRequest(RequestQueueEntry *req_entry) {
-        request_queue_.push(req_entry);
+        PushRequest(req_entry);
         MaybeStartRunner();
-        return request_count_.fetch_and_increment() < (kThreshold - 1);
+        long count = request_count_.fetch_and_increment();
+        UpdateEnqueueStats(count + 1, 1, req_entry->enqueue_time);
+        return count < (kThreshold - 1);
     }
 
+    // The entries of a batch are pushed back to back, so they are processed
+    // in order with respect to the other requests from the same producer.
+    bool EnqueueRequestBatch(const RequestEntryList &entries,
+                             uint64_t enqueue_time) {
+        for (RequestEntryList::const_iterator iter = entries.begin();
+             iter != entries.end(); ++iter) {
+            PushRequest(*iter);
+        }
+        MaybeStartRunner();
+        long size = entries.size();
+        long count = request_count_.fetch_and_add(size);
+        total_batch_count_.fetch_and_increment();
+        UpdateEnqueueStats(count + size, size, enqueue_time);
+        return count + size < kThreshold;
+    }
+
+    // Concurrency: called from the DBPartition task.
     bool DequeueRequest(RequestQueueEntry **req_entry) {
-        bool success = request_queue_.try_pop(*req_entry);
+        bool success = request_ring_.TryPop(req_entry);
+        if (!success && overflow_count_ != 0) {
+            success = overflow_queue_.try_pop(*req_entry);
+            if (success) {
+                overflow_count_.fetch_and_decrement();
+            }
+        }
         if (success) {
             request_count_.fetch_and_decrement();
+            UpdateWaitStats((*req_entry)->enqueue_time);
         }
         return success;
     }
@@ -102,22 +160,89 @@ public:
         return db_partition_id_;
     }
 
+    bool IsRequestQueueEmpty() const {
+        return (request_ring_.empty() && overflow_count_ == 0);
+    }
+
     bool IsDBQueueEmpty() {
-        return (request_queue_.empty() && change_list_.empty());
+        return (IsRequestQueueEmpty() && change_list_.empty());
     }
 
     bool disable() { return disable_; }
     void set_disable(bool disable) { disable_ = disable; }
 
+    void GetQueueStats(DBPartition::QueueStats *stats) const {
+        stats->request_queue_len = request_count_;
+        stats->max_request_queue_len = max_request_count_;
+        stats->total_request_count = total_request_count_;
+        stats->overflow_request_count = total_overflow_count_;
+        stats->total_batch_count = total_batch_count_;
+        stats->total_enqueue_usecs = total_enqueue_time_;
+        stats->max_enqueue_usecs = max_enqueue_time_;
+        stats->total_wait_usecs = total_wait_time_;
+        stats->max_wait_usecs = max_wait_time_;
+    }
+
 private:
-    RequestQueue request_queue_;
+    template <typename T>
+    static void UpdateMax(atomic<T> *max_value, T value) {
+        T current = *max_value;
+        while (value > current) {
+            T prev = max_value->compare_and_swap(value, current);
+            if (prev == current)
+                break;
+            current = prev;
+        }
+    }
+
+    // Concurrency: called by multiple producers.
+    void PushRequest(RequestQueueEntry *req_entry) {
+        if (overflow_count_ != 0 || !request_ring_.TryPush(req_entry)) {
+            overflow_count_.fetch_and_increment();
+            total_overflow_count_.fetch_and_increment();
+            overflow_queue_.push(req_entry);
+        }
+    }
+
+    // Concurrency: called by multiple producers.
+    void UpdateEnqueueStats(long count, long size, uint64_t enqueue_time) {
+        uint64_t elapsed = UTCTimestampUsec() - enqueue_time;
+        total_request_count_.fetch_and_add(size);
+        total_enqueue_time_.fetch_and_add(elapsed);
+        UpdateMax(&max_enqueue_time_, elapsed);
+        UpdateMax(&max_request_count_, count);
+    }
+
+    // Concurrency: called from the DBPartition task.
+    void UpdateWaitStats(uint64_t enqueue_time) {
+        uint64_t elapsed = UTCTimestampUsec() - enqueue_time;
+        total_wait_time_ = total_wait_time_ + elapsed;
+        if (elapsed > max_wait_time_)
+            max_wait_time_ = elapsed;
+    }
+
     TablePartList change_list_;
     atomic<long> request_count_;
+    atomic<long> overflow_count_;
     RemoveQueue remove_queue_;
     mutex mutex_;
     int db_partition_id_;
     bool disable_;
     bool running_;
+
+    RequestRing request_ring_;
+    RequestQueue overflow_queue_;
+
+    // Statistics.
+    atomic<uint64_t> total_request_count_;
+    atomic<uint64_t> total_overflow_count_;
+    atomic<uint64_t> total_batch_count_;
+    atomic<long> max_request_count_;
+    atomic<uint64_t> total_enqueue_time_;
+    atomic<uint64_t> max_enqueue_time_;
+    atomic<uint64_t> total_wait_time_;
+    atomic<uint64_t> max_wait_time_;
+
     DISALLOW_COPY_AND_ASSIGN(WorkQueue);
 };
 
@@ -200,7 +325,7 @@ void DBPartition::WorkQueue::MaybeStartRunner() {
 
 bool DBPartition::WorkQueue::RunnerDone() {
     mutex::scoped_lock lock(mutex_);
-    if (request_queue_.empty() && remove_queue_.empty()) {
+    if (IsRequestQueueEmpty() && remove_queue_.empty()) {
         running_ = false;
         return true;
     }
@@ -228,12 +353,32 @@ bool DBPartition::EnqueueRequest(DBTablePartBase *tpart, DBClient *client,
     return work_queue_->EnqueueRequest(entry);
 }
 
+bool DBPartition::EnqueueRequestBatch(DBTablePartBase *tpart, DBClient *client,
+                                      const RequestList &requests) {
+    if (requests.empty())
+        return true;
+    uint64_t enqueue_time = UTCTimestampUsec();
+    WorkQueue::RequestEntryList entries;
+    entries.reserve(requests.size());
+    for (RequestList::const_iterator iter = requests.begin();
+         iter != requests.end(); ++iter) {
+        entries.push_back(
+            new RequestQueueEntry(tpart, client, *iter, enqueue_time));
+        delete *iter;
+    }
+    return work_queue_->EnqueueRequestBatch(entries, enqueue_time);
+}
+
 void DBPartition::EnqueueRemove(DBTablePartBase *tpart, DBEntryBase *db_entry) {
     RemoveQueueEntry *entry = new RemoveQueueEntry(tpart, db_entry);
     db_entry->SetOnRemoveQ();
     work_queue_->EnqueueRemove(entry);
 }
 
+void DBPartition::GetQueueStats(QueueStats *stats) const {
+    work_queue_->GetQueueStats(stats);
+}
+
 // concurrency: called from DBPartition task.
 void DBPartition::OnTableChange(DBTablePartBase *tablepart) {
     work_queue_->SetActive(tablepart);
@@ -5,6 +5,7 @@
 #ifndef ctrlplane_db_partition_h
 #define ctrlplane_db_partition_h
 
+#include <vector>
 #include <boost/function.hpp>
 
 #include "base/util.h"
@@ -21,6 +22,31 @@ class DBPartition {
 public:
     typedef boost::function<void(void)> Callback;
 
+    typedef std::vector<DBRequest *> RequestList;
+
+    // Request queue statistics. Times are in microseconds. The enqueue time
+    // is the time spent by clients in EnqueueRequest, while the wait time is
+    // the time between enqueue and the start of processing. A batch of
+    // requests accounts for a single enqueue time.
+    struct QueueStats {
+        QueueStats()
+            : request_queue_len(0), max_request_queue_len(0),
+              total_request_count(0), overflow_request_count(0),
+              total_batch_count(0),
+              total_enqueue_usecs(0), max_enqueue_usecs(0),
+              total_wait_usecs(0), max_wait_usecs(0) {
+        }
+        uint64_t request_queue_len;
+        uint64_t max_request_queue_len;
+        uint64_t total_request_count;
+        uint64_t overflow_request_count;
+        uint64_t total_batch_count;
+        uint64_t total_enqueue_usecs;
+        uint64_t max_enqueue_usecs;
+        uint64_t total_wait_usecs;
+        uint64_t max_wait_usecs;
+    };
+
     explicit DBPartition(int partition_id);
     ~DBPartition();
 
@@ -29,12 +55,19 @@ public:
     bool EnqueueRequest(DBTablePartBase *tpart, DBClient *client,
                         DBRequest *req);
 
+    // Enqueue a list of requests for the same table partition, starting the
+    // queue runner at most once. Takes ownership of the requests.
+    // Returns false if the client should stop enqueuing updates.
+    bool EnqueueRequestBatch(DBTablePartBase *tpart, DBClient *client,
+                             const RequestList &requests);
+
     void EnqueueRemove(DBTablePartBase *tpart, DBEntryBase *db_entry);
 
     // Enqueue table on change list.
     void OnTableChange(DBTablePartBase *tpart);
     bool IsDBQueueEmpty();
     void SetQueueDisable(bool disable);
+    void GetQueueStats(QueueStats *stats) const;
         
 private:
     class WorkQueue;
@@ -39,33 +39,43 @@ void DBRequest::Swap(DBRequest *rhs) {
 
 class DBTableBase::ListenerInfo {
 public:
-    typedef vector<ChangeCallback> CallbackList;
-
-    DBTableBase::ListenerId Register(ChangeCallback callback) {
+    // A listener is notified either one entry at a time or in batches.
+    struct Listener {
+        Listener() : batch_size(0), max_latency_usecs(0) { }
+        bool empty() const { return callback == NULL && batch_cb == NULL; }
+
+        ChangeCallback callback;
+        BatchCallback batch_cb;
+        size_t batch_size;
+        uint64_t max_latency_usecs;
+    };
+    typedef vector<Listener> ListenerList;
+
+    DBTableBase::ListenerId Register(const Listener &listener) {
         tbb::spin_rw_mutex::scoped_lock write_lock(rw_mutex_, true);
         size_t i = bmap_.find_first();
         if (i == bmap_.npos) {
-            i = callbacks_.size();
-            callbacks_.push_back(callback);
+            i = listeners_.size();
+            listeners_.push_back(listener);
         } else {
             bmap_.reset(i);
             if (bmap_.none()) {
                 bmap_.clear();
             }
-            callbacks_[i] = callback;
+            listeners_[i] = listener;
         }
         return i;
     }
 
     void Unregister(ListenerId listener) {
         tbb::spin_rw_mutex::scoped_lock write_lock(rw_mutex_, true);
-        callbacks_[listener] = NULL;
-        if ((size_t) listener == callbacks_.size() - 1) {
-            while (!callbacks_.empty() && callbacks_.back() == NULL) {
-                callbacks_.pop_back();
+        listeners_[listener] = Listener();
+        if ((size_t) listener == listeners_.size() - 1) {
+            while (!listeners_.empty() && listeners_.back().empty()) {
+                listeners_.pop_back();
             }
-            if (bmap_.size() > callbacks_.size()) {
-                bmap_.resize(callbacks_.size());
+            if (bmap_.size() > listeners_.size()) {
+                bmap_.resize(listeners_.size());
             }
         } else {
             if ((size_t) listener >= bmap_.size()) {
@@ -78,22 +88,66 @@ public:
     // concurrency: called from DBPartition task.
     void RunNotify(DBTablePartBase *tpart, DBEntryBase *entry) {
         tbb::spin_rw_mutex::scoped_lock read_lock(rw_mutex_, false);
-        for (CallbackList::iterator iter = callbacks_.begin();
-             iter != callbacks_.end(); ++iter) {
-            if (*iter != NULL) {
-                ChangeCallback cb = *iter;
+        for (ListenerList::iterator iter = listeners_.begin();
+             iter != listeners_.end(); ++iter) {
+            if (iter->callback != NULL) {
+                ChangeCallback cb = iter->callback;
                 (cb)(tpart, entry);
             }
         }
     }
 
+    // concurrency: called from DBPartition task.
+    //
+    // Listeners with a smaller batch size get the entries in several
+    // consecutive batches.
+    void RunBatchNotify(DBTablePartBase *tpart, const EntryList &entries) {
+        tbb::spin_rw_mutex::scoped_lock read_lock(rw_mutex_, false);
+        for (ListenerList::iterator iter = listeners_.begin();
+             iter != listeners_.end(); ++iter) {
+            if (iter->batch_cb == NULL) {
+                continue;
+            }
+            BatchCallback cb = iter->batch_cb;
+            if (entries.size() <= iter->batch_size) {
+                (cb)(tpart, entries);
+                continue;
+            }
+            EntryList batch;
+            for (size_t start = 0; start < entries.size();
+                 start += iter->batch_size) {
+                size_t end = min(start + iter->batch_size, entries.size());
+                batch.assign(entries.begin() + start, entries.begin() + end);
+                (cb)(tpart, batch);
+            }
+        }
+    }
+
+    void GetBatchParams(size_t *batch_size, uint64_t *max_latency_usecs) {
+        tbb::spin_rw_mutex::scoped_lock read_lock(rw_mutex_, false);
+        *batch_size = 0;
+        *max_latency_usecs = 0;
+        for (ListenerList::const_iterator iter = listeners_.begin();
+             iter != listeners_.end(); ++iter) {
+            if (iter->batch_cb == NULL) {
+                continue;
+            }
+            *batch_size = max(*batch_size, iter->batch_size);
+            if (iter->max_latency_usecs != 0 &&
+                (*max_latency_usecs == 0 ||
+                 iter->max_latency_usecs < *max_latency_usecs)) {
+                *max_latency_usecs = iter->max_latency_usecs;
+            }
+        }
+    }
+
     bool empty() { 
         tbb::spin_rw_mutex::scoped_lock read_lock(rw_mutex_, false);
-        return callbacks_.empty(); 
+        return listeners_.empty(); 
     }
 
 private:
-    CallbackList callbacks_;
+    ListenerList listeners_;
     tbb::spin_rw_mutex rw_mutex_;
     boost::dynamic_bitset<> bmap_;      // free list.
 };
@@ -106,7 +160,19 @@ DBTableBase::~DBTableBase() {
 }
 
 DBTableBase::ListenerId DBTableBase::Register(ChangeCallback callback) {
-    return info_->Register(callback);
+    ListenerInfo::Listener listener;
+    listener.callback = callback;
+    return info_->Register(listener);
+}
+
+DBTableBase::ListenerId DBTableBase::RegisterBatch(BatchCallback callback,
+        size_t batch_size, uint64_t max_latency_usecs) {
+    assert(batch_size > 0);
+    ListenerInfo::Listener listener;
+    listener.batch_cb = callback;
+    listener.batch_size = batch_size;
+    listener.max_latency_usecs = max_latency_usecs;
+    return info_->Register(listener);
 }
 
 void DBTableBase::Unregister(ListenerId listener) {
@@ -119,6 +185,30 @@ bool DBTableBase::Enqueue(DBRequest *req) {
     return partition->EnqueueRequest(tpart, NULL, req);
 }
 
+bool DBTableBase::EnqueueBatch(RequestList *requests) {
+    vector<RequestList> partition_requests(DB::PartitionCount());
+    vector<DBTablePartBase *> tparts(DB::PartitionCount());
+    for (RequestList::iterator iter = requests->begin();
+         iter != requests->end(); ++iter) {
+        DBTablePartBase *tpart = GetTablePartition((*iter)->key.get());
+        partition_requests[tpart->index()].push_back(*iter);
+        tparts[tpart->index()] = tpart;
+    }
+    requests->clear();
+
+    bool success = true;
+    for (int idx = 0; idx < DB::PartitionCount(); idx++) {
+        if (partition_requests[idx].empty())
+            continue;
+        DBPartition *partition = db_->GetPartition(idx);
+        if (!partition->EnqueueRequestBatch(tparts[idx], NULL,
+                                            partition_requests[idx])) {
+            success = false;
+        }
+    }
+    return success;
+}
+
 void DBTableBase::EnqueueRemove(DBEntryBase *db_entry) {
     DBTablePartBase *tpart = GetTablePartition(db_entry);
     DBPartition *partition = db_->GetPartition(tpart->index());
@@ -129,6 +219,16 @@ void DBTableBase::RunNotify(DBTablePartBase *tpart, DBEntryBase *entry) {
     info_->RunNotify(tpart, entry);
 }
 
+void DBTableBase::RunBatchNotify(DBTablePartBase *tpart,
+                                 const EntryList &entries) {
+    info_->RunBatchNotify(tpart, entries);
+}
+
+void DBTableBase::GetBatchParams(size_t *batch_size,
+                                 uint64_t *max_latency_usecs) const {
+    info_->GetBatchParams(batch_size, max_latency_usecs);
+}
+
 bool DBTableBase::HasListeners() const {
     return !info_->empty();
 }
@@ -173,8 +273,18 @@ int DBTable::PartitionCount() const {
     return DB::PartitionCount();
 }
 
-static size_t HashToPartition(size_t hash) {
-    return hash % DB::PartitionCount();
+//
+// Use the 64-bit finalizer from MurmurHash3, which maps 0 to 0. Tables that
+// don't implement Hash() thus continue to use partition 0.
+//
+int DBTable::HashToPartition(size_t hash) const {
+    uint64_t value = hash;
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value % PartitionCount();
 }
 
 DBTablePartBase *DBTable::GetTablePartition(const int index) {
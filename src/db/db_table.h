@@ -50,14 +50,22 @@ private:
 class DBTableBase {
 public:
     typedef boost::function<void(DBTablePartBase *, DBEntryBase *)> ChangeCallback;
+    typedef std::vector<DBEntryBase *> EntryList;
+    typedef boost::function<void(DBTablePartBase *, const EntryList &)> BatchCallback;
+    typedef std::vector<DBRequest *> RequestList;
     typedef int ListenerId;
     static const int kInvalidId = -1;
+    static const size_t kDefaultBatchSize = 256;
 
     DBTableBase(DB *db, const std::string &name);
     virtual ~DBTableBase();
 
     // Enqueue a request to the table. Takes ownership of the data.
     bool Enqueue(DBRequest *req);
+    // Enqueue a list of requests to the table. The requests for each
+    // partition are handed to it in a single operation. Takes ownership of
+    // the requests and clears the list.
+    bool EnqueueBatch(RequestList *requests);
     void EnqueueRemove(DBEntryBase *db_entry);
 
     // Determine the table partition depending on the record key.
@@ -73,9 +81,25 @@ public:
 
     // Register a DB listener.
     ListenerId Register(ChangeCallback callback);
+
+    // Register a DB listener that is notified of changed entries in batches
+    // of up to 'batch_size' entries, all from the same table partition. The
+    // entries are in the order in which the changes were made, and a batch
+    // does not contain the same entry twice. A batch is delivered early if
+    // 'max_latency_usecs' is non-zero and has elapsed since its first entry
+    // was taken off the change list. Batches do not span DBPartition task
+    // runs, so the entries remain valid until the callback returns.
+    ListenerId RegisterBatch(BatchCallback callback,
+                             size_t batch_size = kDefaultBatchSize,
+                             uint64_t max_latency_usecs = 0);
     void Unregister(ListenerId listener);
 
     void RunNotify(DBTablePartBase *tpart, DBEntryBase *entry);
+    void RunBatchNotify(DBTablePartBase *tpart, const EntryList &entries);
+
+    // Largest batch size and smallest non-zero latency bound of the batch
+    // listeners. The batch size is 0 if there are no batch listeners.
+    void GetBatchParams(size_t *batch_size, uint64_t *max_latency_usecs) const;
 
     // Calcuate the size across all partitions.
     virtual size_t Size() const { return 0; }
@@ -105,6 +129,12 @@ private:
 // functionality
 class DBTable : public DBTableBase {
 public:
+    // Index used by the partitions of the table to keep entries in order.
+    enum IndexType {
+        INDEX_RBTREE,
+        INDEX_BTREE
+    };
+
     DBTable(DB *db, const std::string &name);
     virtual ~DBTable();
     void Init();
@@ -122,6 +152,18 @@ public:
     // Hash for key. Used to identify partition
     virtual size_t Hash(const DBRequestKey *key) const {return 0;};
 
+    // Map the hash of an entry or key to a partition id. The default
+    // implementation mixes the bits of the hash before reducing it modulo
+    // the partition count, so that keys which differ only in the high order
+    // bits (e.g. IPv4 prefixes) are still spread evenly. Table families can
+    // override it if they know the distribution of their keys.
+    virtual int HashToPartition(size_t hash) const;
+
+    // Index type of the table partitions. The default red-black tree is
+    // cheap to update, while the B+-tree is faster to search and walk in
+    // large tables.
+    virtual IndexType index_type() const { return INDEX_RBTREE; }
+
     // Alloc a derived DBTablePartBase entry. The default implementation
     // allocates DBTablePart should be good for most common cases.
     // Override if *really* necessary
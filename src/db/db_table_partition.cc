@@ -6,6 +6,7 @@
 
 #include "base/logging.h"
 #include "db/db.h"
+#include "db/db_btree.h"
 #include "db/db_entry.h"
 #include "db/db_partition.h"
 #include "db/db_table.h"
@@ -16,6 +17,11 @@ using namespace std;
 // concurrency: called from DBPartition task.
 void DBTablePartBase::Notify(DBEntryBase *entry) {
     if (entry->is_onlist()) {
+        // Entries stay marked while their batch is delivered. Requeue them
+        // once the batch is done rather than dropping the notification.
+        if (!entry->chg_list_.is_linked()) {
+            entry->set_renotify();
+        }
         return;
     }
     entry->set_onlist();
@@ -30,21 +36,73 @@ void DBTablePartBase::Notify(DBEntryBase *entry) {
 
 // concurrency: called from DBPartition task.
 void DBTablePartBase::RunNotify() {
+    size_t batch_size;
+    uint64_t max_latency_usecs;
+    parent()->GetBatchParams(&batch_size, &max_latency_usecs);
+    if (batch_size > 0) {
+        RunBatchNotify(batch_size, max_latency_usecs);
+        return;
+    }
+
     while (!change_list_.empty()) {
         DBEntryBase *entry = &change_list_.front();
         change_list_.pop_front();
 
         parent()->RunNotify(this, entry);
+        NotifyDone(entry);
+    }
+}
 
-        // If the entry is marked deleted and all DBStates are removed
-        // and it's not already on the remove queue, it can be removed
-        // from the tree right away.
-        if (entry->IsDeleted() && entry->is_state_empty(this) &&
-            !entry->IsOnRemoveQ()) {
-            Remove(entry);
-        } else {
-            entry->clear_onlist();
+//
+// Per-entry listeners are notified as entries are taken off the change list,
+// and batch listeners once the batch is complete. Deleted entries are only
+// removed after the batch has been delivered. Entries notified again while
+// in a batch go back on the change list, so they are delivered once more in
+// a later batch.
+//
+void DBTablePartBase::RunBatchNotify(size_t batch_size,
+                                     uint64_t max_latency_usecs) {
+    DBTableBase::EntryList batch;
+    batch.reserve(min(batch_size, change_list_.size()));
+    while (!change_list_.empty()) {
+        uint64_t start = max_latency_usecs ? UTCTimestampUsec() : 0;
+        while (!change_list_.empty() && batch.size() < batch_size) {
+            DBEntryBase *entry = &change_list_.front();
+            change_list_.pop_front();
+
+            parent()->RunNotify(this, entry);
+            batch.push_back(entry);
+            if (max_latency_usecs &&
+                UTCTimestampUsec() - start >= max_latency_usecs) {
+                break;
+            }
         }
+
+        parent()->RunBatchNotify(this, batch);
+        for (DBTableBase::EntryList::iterator it = batch.begin();
+             it != batch.end(); ++it) {
+            DBEntryBase *entry = *it;
+            if (entry->is_renotify()) {
+                entry->clear_renotify();
+                change_list_.push_back(*entry);
+                continue;
+            }
+            NotifyDone(entry);
+        }
+        batch.clear();
+    }
+}
+
+void DBTablePartBase::NotifyDone(DBEntryBase *entry) {
+    entry->clear_renotify();
+    // If the entry is marked deleted and all DBStates are removed
+    // and it's not already on the remove queue, it can be removed
+    // from the tree right away.
+    if (entry->IsDeleted() && entry->is_state_empty(this) &&
+        !entry->IsOnRemoveQ()) {
+        Remove(entry);
+    } else {
+        entry->clear_onlist();
     }
 }
 
@@ -63,6 +121,12 @@ void DBTablePartBase::Delete(DBEntryBase *entry) {
 
 DBTablePartition::DBTablePartition(DBTable *table, int index)
     : DBTablePartBase(table, index) {
+    if (table->index_type() == DBTable::INDEX_BTREE) {
+        btree_.reset(new DBEntryBTree);
+    }
+}
+
+DBTablePartition::~DBTablePartition() {
 }
 
 void DBTablePartition::Process(DBClient *client, DBRequest *req) {
@@ -72,7 +136,11 @@ void DBTablePartition::Process(DBClient *client, DBRequest *req) {
 
 void DBTablePartition::Add(DBEntry *entry) {
     tbb::mutex::scoped_lock lock(mutex_);
-    tree_.insert(*entry);
+    if (btree_.get()) {
+        btree_->insert(entry);
+    } else {
+        tree_.insert(*entry);
+    }
     entry->set_table(static_cast<DBTableBase *>(table()));
     Notify(entry);
 }
@@ -86,18 +154,25 @@ void DBTablePartition::Remove(DBEntryBase *db_entry) {
     tbb::mutex::scoped_lock lock(mutex_);
     DBEntry *entry = static_cast<DBEntry *>(db_entry);
 
-    tree_.erase(*entry);
+    if (btree_.get()) {
+        btree_->erase(entry);
+    } else {
+        tree_.erase(*entry);
+    }
     delete entry;
 
     //
     // If a table is marked for deletion, then we may trigger the deletion
     // process when the last prefix is deleted
     //
-    table()->MayResumeDelete(tree_.empty());
+    table()->MayResumeDelete(empty());
 }
 
 DBEntry *DBTablePartition::Find(const DBEntry *entry) {
     tbb::mutex::scoped_lock lock(mutex_);
+    if (btree_.get()) {
+        return btree_->find(entry);
+    }
     Tree::iterator loc = tree_.find(*entry);
     if (loc != tree_.end()) {
         return loc.operator->();
@@ -110,6 +185,9 @@ DBEntry *DBTablePartition::Find(const DBRequestKey *key) {
     DBTable *table = static_cast<DBTable *>(parent());
     std::auto_ptr<DBEntry> entry_ptr = table->AllocEntry(key);
 
+    if (btree_.get()) {
+        return btree_->find(entry_ptr.get());
+    }
     Tree::iterator loc = tree_.find(*(entry_ptr.get()));
     if (loc != tree_.end()) {
         return loc.operator->();
@@ -122,6 +200,9 @@ DBEntry *DBTablePartition::lower_bound(const DBEntryBase *key) {
     const DBEntry *entry = static_cast<const DBEntry *>(key);
     tbb::mutex::scoped_lock lock(mutex_);
 
+    if (btree_.get()) {
+        return btree_->lower_bound(entry);
+    }
     Tree::iterator it = tree_.lower_bound(*entry);
     if (it != tree_.end()) {
         return (it.operator->());
@@ -131,6 +212,9 @@ DBEntry *DBTablePartition::lower_bound(const DBEntryBase *key) {
 
 DBEntry *DBTablePartition::GetFirst() {
     tbb::mutex::scoped_lock lock(mutex_);
+    if (btree_.get()) {
+        return btree_->first();
+    }
     Tree::iterator it = tree_.begin();
     if (it == tree_.end()) {
         return NULL;
@@ -143,6 +227,9 @@ DBEntry *DBTablePartition::GetNext(const DBEntryBase *key) {
     const DBEntry *entry = static_cast<const DBEntry *>(key);
     tbb::mutex::scoped_lock lock(mutex_);
 
+    if (btree_.get()) {
+        return btree_->next(entry);
+    }
     Tree::const_iterator it = tree_.iterator_to(*entry);
     it++;
     if (it != tree_.end()) {
@@ -151,6 +238,14 @@ DBEntry *DBTablePartition::GetNext(const DBEntryBase *key) {
     return NULL;
 }
 
+size_t DBTablePartition::size() const {
+    return btree_.get() ? btree_->size() : tree_.size();
+}
+
+bool DBTablePartition::empty() const {
+    return btree_.get() ? btree_->empty() : tree_.empty();
+}
+
 DBTable *DBTablePartition::table() {
     return static_cast<DBTable *>(parent());
 }
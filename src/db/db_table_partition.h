@@ -6,10 +6,12 @@
 #define ctrlplane_db_table_partition_h
 
 #include <boost/intrusive/list.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <tbb/mutex.h>
 
 #include "db/db_entry.h"
 
+class DBEntryBTree;
 class DBTableBase;
 class DBTable;
 
@@ -54,6 +56,9 @@ public:
 
     virtual ~DBTablePartBase() {};
 private:
+    void RunBatchNotify(size_t batch_size, uint64_t max_latency_usecs);
+    void NotifyDone(DBEntryBase *entry);
+
     tbb::mutex dbstate_mutex_;
     DBTableBase *parent_;
     int index_;
@@ -64,11 +69,13 @@ private:
 class DBTablePartition : public DBTablePartBase {
 public:
     typedef boost::intrusive::member_hook<DBEntry,
-        boost::intrusive::set_member_hook<>,
+        boost::intrusive::set_member_hook<
+            boost::intrusive::optimize_size<true> >,
         &DBEntry::node_> SetMember;
     typedef boost::intrusive::set<DBEntry, SetMember> Tree;
     
     DBTablePartition(DBTable *parent, int index);
+    virtual ~DBTablePartition();
 
     ///////////////////////////////////////////////////////////////
     // Virtual functions from DBTableBase implemented by DBTable
@@ -102,11 +109,16 @@ public:
     DBEntry *Find(const DBRequestKey *key);
 
     DBTable *table();
-    size_t size() const { return tree_.size(); }
+    size_t size() const;
 
 private:
+    bool empty() const;
+
     tbb::mutex mutex_;
+    // Exactly one of tree_ and btree_ is used, depending on the index type
+    // of the table.
     Tree tree_;
+    boost::scoped_ptr<DBEntryBTree> btree_;
     DISALLOW_COPY_AND_ASSIGN(DBTablePartition);
 };
 
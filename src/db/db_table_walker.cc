@@ -5,10 +5,13 @@
 #include "db/db_table_walker.h"
 
 #include <list>
+#include <vector>
+#include <boost/assign/list_of.hpp>
 #include <tbb/atomic.h>
 
 #include "base/logging.h"
 #include "base/task.h"
+#include "base/util.h"
 #include "db/db.h"
 #include "db/db_partition.h"
 #include "db/db_table.h"
@@ -17,27 +20,44 @@
 using namespace tbb;
 
 int DBTableWalker::walker_task_id_ = -1;
+int DBTableWalker::range_walker_task_id_ = -1;
 
 DBTableWalker::DBTableWalker() {
     if (walker_task_id_ == -1) {
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
         // Using same task id as DBPartition
         walker_task_id_ = scheduler->GetTaskId("db::DBTable");
+
+        // Key ranges are walked concurrently, while DBPartition processing
+        // is held off.
+        range_walker_task_id_ = scheduler->GetTaskId("db::DBTableWalk");
+        TaskPolicy policy =
+            boost::assign::list_of(TaskExclusion(walker_task_id_));
+        scheduler->SetPolicy(range_walker_task_id_, policy);
     }
     walk_request_count_ = 0;
     walk_complete_count_ = 0;
     walk_cancel_count_ = 0;
+    walk_entry_count_ = 0;
+    walk_duration_usecs_ = 0;
 }
+
 class DBTableWalker::Walker {
 public:
+    typedef std::vector<DBRequestKey *> KeyList;
+
     Walker(WalkId id, DBTableWalker *wkmgr, DBTable *table,
-           const DBRequestKey *key, WalkFn walker, 
+           const DBRequestKey *key, int ranges, WalkFn walker,
            WalkCompleteFn walk_done);
+    ~Walker();
 
     void StopWalk() {
         should_stop_.fetch_and_store(true);
     }
 
+    // Called by each Worker, Splitter and RangeWorker when it's done.
+    void WorkerDone();
+
     WalkId  id_;
 
     // Parent walker manager
@@ -57,6 +77,15 @@ public:
 
     // check whether iteraton is completed on all Table Partition
     tbb::atomic<long> status_;
+
+    // Number of key ranges per table partition
+    int ranges_;
+
+    // Boundaries of the key ranges, per table partition
+    std::vector<KeyList> range_keys_;
+
+    uint64_t start_time_;
+    tbb::atomic<uint64_t> entry_count_;
 };
 
 class DBTableWalker::Worker : public Task {
@@ -137,64 +166,257 @@ bool DBTableWalker::Worker::Run() {
         if (count == GetIterationToYield()) {
             // store the context
             walk_ctx_ = entry->GetDBRequestKey();
+            walker_->entry_count_.fetch_and_add(count);
             return false;
         }
 
         // Invoke walker function
         bool more = walker_->walker_fn_(tbl_partition_, entry);
+        count++;
         if (!more) {
             break;
         }
 
         db_walker_wait();
-        count++;
     }
 
 walk_done:
-    // Check whether all other walks on the table is completed
-    long num_walkers_on_tpart = walker_->status_.fetch_and_decrement();
-    if (num_walkers_on_tpart == 1) {
-        // Invoke Walker_Complete callback
-        if (!walker_->should_stop_) {
-            walker_->wkmgr_->update_walk_complete_count(+1);
+    walker_->entry_count_.fetch_and_add(count);
+    walker_->WorkerDone();
+    return true;
+}
+
+//
+// Picks the boundaries of the key ranges of a table partition by counting
+// the entries in it. The key ranges are then handed over to RangeWorkers.
+//
+class DBTableWalker::Splitter : public Task {
+public:
+    static const int kYieldMultiplier = 16;
+
+    Splitter(Walker *walker, int db_partition_id)
+        : Task(walker_task_id_, db_partition_id), walker_(walker),
+          db_partition_id_(db_partition_id), step_(0), count_(0) {
+        tbl_partition_ = static_cast<DBTablePartition *>(
+            walker_->table_->GetTablePartition(db_partition_id));
+    }
+
+    virtual bool Run();
+
+private:
+    void StartRangeWorkers();
+
+    Walker *walker_;
+    int db_partition_id_;
+    DBTablePartition *tbl_partition_;
+
+    // Store the last visited node to continue counting
+    std::auto_ptr<DBRequestKey> walk_ctx_;
+
+    // Number of entries in each key range
+    size_t step_;
+    size_t count_;
+};
+
+//
+// Walks the entries of a table partition from the start key up to, but not
+// including, the end key. A NULL key denotes the start or end of the table
+// partition.
+//
+class DBTableWalker::RangeWorker : public Task {
+public:
+    RangeWorker(Walker *walker, DBTablePartition *tbl_partition,
+                const DBRequestKey *key_start, const DBRequestKey *key_end)
+        : Task(range_walker_task_id_), walker_(walker),
+          tbl_partition_(tbl_partition), key_start_(key_start) {
+        if (key_end != NULL) {
+            end_ = walker_->table_->AllocEntry(key_end);
+        }
+    }
+
+    virtual bool Run();
+
+private:
+    DBEntry *Resume(const DBRequestKey *key);
+
+    DBTableWalker::Walker *walker_;
+    DBTablePartition *tbl_partition_;
+
+    // Store the last visited node to continue walk
+    std::auto_ptr<DBRequestKey> walk_ctx_;
+    const DBRequestKey *key_start_;
+    std::auto_ptr<DBEntry> end_;
+};
+
+bool DBTableWalker::Splitter::Run() {
+    if (walker_->should_stop_) {
+        walker_->WorkerDone();
+        return true;
+    }
+
+    // A partition that has too few entries to keep the key ranges busy is
+    // walked as a single range.
+    if (step_ == 0) {
+        step_ = tbl_partition_->size() / walker_->ranges_;
+        if (step_ < (size_t) GetIterationToYield()) {
+            StartRangeWorkers();
+            return true;
+        }
+    }
+
+    DBEntry *entry;
+    if (walk_ctx_.get() != NULL) {
+        std::auto_ptr<const DBEntryBase> start;
+        start = walker_->table_->AllocEntry(walk_ctx_.get());
+        entry = tbl_partition_->lower_bound(start.get());
+    } else {
+        entry = tbl_partition_->GetFirst();
+    }
+
+    Walker::KeyList &keys = walker_->range_keys_[db_partition_id_];
+    int limit = GetIterationToYield() * kYieldMultiplier;
+    for (int iter = 0; entry != NULL; iter++) {
+        if (keys.size() + 1 == (size_t) walker_->ranges_) {
+            break;
+        }
+        if (iter == limit) {
+            walk_ctx_ = entry->GetDBRequestKey();
+            return false;
         }
-        if (walker_->done_fn_ != NULL) {
-            if (!walker_->should_stop_) {
-                walker_->done_fn_(walker_->table_);
-            }
+        if (++count_ % step_ == 0) {
+            keys.push_back(entry->GetDBRequestKey().release());
         }
-        // Release the memory for walker and bitmap
-        walker_->wkmgr_->PurgeWalker(walker_->id_);
+        entry = tbl_partition_->GetNext(entry);
     }
+
+    StartRangeWorkers();
+    return true;
+}
+
+void DBTableWalker::Splitter::StartRangeWorkers() {
+    Walker::KeyList &keys = walker_->range_keys_[db_partition_id_];
+    walker_->status_.fetch_and_add(keys.size() + 1);
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    for (size_t i = 0; i <= keys.size(); i++) {
+        const DBRequestKey *key_start = (i == 0) ? NULL : keys[i - 1];
+        const DBRequestKey *key_end = (i == keys.size()) ? NULL : keys[i];
+        scheduler->Enqueue(
+            new RangeWorker(walker_, tbl_partition_, key_start, key_end));
+    }
+    walker_->WorkerDone();
+}
+
+DBEntry *DBTableWalker::RangeWorker::Resume(const DBRequestKey *key) {
+    if (key == NULL) {
+        return tbl_partition_->GetFirst();
+    }
+    std::auto_ptr<const DBEntryBase> start;
+    start = walker_->table_->AllocEntry(key);
+    return tbl_partition_->lower_bound(start.get());
+}
+
+bool DBTableWalker::RangeWorker::Run() {
+    DBEntry *entry = NULL;
+    if (!walker_->should_stop_) {
+        entry = Resume(walk_ctx_.get() ? walk_ctx_.get() : key_start_);
+    }
+
+    uint64_t count = 0;
+    for (DBEntry *next = NULL; entry; entry = next) {
+        if (end_.get() != NULL && !entry->IsLess(*end_)) {
+            break;
+        }
+        next = tbl_partition_->GetNext(entry);
+        if (walker_->should_stop_) {
+            break;
+        }
+        if (count == (uint64_t) GetIterationToYield()) {
+            walk_ctx_ = entry->GetDBRequestKey();
+            walker_->entry_count_.fetch_and_add(count);
+            return false;
+        }
+        bool more = walker_->walker_fn_(tbl_partition_, entry);
+        count++;
+        if (!more) {
+            break;
+        }
+    }
+
+    walker_->entry_count_.fetch_and_add(count);
+    walker_->WorkerDone();
     return true;
 }
 
 DBTableWalker::Walker::Walker(WalkId id, DBTableWalker *wkmgr,
                               DBTable *table, const DBRequestKey *key,
-                              WalkFn walker, WalkCompleteFn walk_done)
+                              int ranges, WalkFn walker,
+                              WalkCompleteFn walk_done)
     : id_(id), wkmgr_(wkmgr), table_(table),
       key_start_(const_cast<DBRequestKey *>(key)), 
-      walker_fn_(walker), done_fn_(walk_done) {
+      walker_fn_(walker), done_fn_(walk_done), ranges_(ranges),
+      start_time_(UTCTimestampUsec()) {
     int num_worker = DB::PartitionCount(); 
     should_stop_ = false;
     status_ = num_worker;
+    entry_count_ = 0;
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    if (ranges_ > 1) {
+        range_keys_.resize(num_worker);
+        for (int i = 0; i < num_worker; i++) {
+            scheduler->Enqueue(new Splitter(this, i));
+        }
+        return;
+    }
     for (int i = 0; i < num_worker; i++) {
         Worker *task = new Worker(this, i, key);
-        TaskScheduler *scheduler = TaskScheduler::GetInstance();
         scheduler->Enqueue(task);
     }
 }
 
-DBTableWalker::WalkId DBTableWalker::WalkTable(DBTable *table, 
-                                               const DBRequestKey *key_start, 
-                                               WalkFn walkerfn , 
-                                               WalkCompleteFn walk_complete) {
+DBTableWalker::Walker::~Walker() {
+    for (size_t i = 0; i < range_keys_.size(); i++) {
+        STLDeleteValues(&range_keys_[i]);
+    }
+}
+
+void DBTableWalker::Walker::WorkerDone() {
+    // Check whether all other walks on the table is completed
+    long num_walkers_on_tpart = status_.fetch_and_decrement();
+    if (num_walkers_on_tpart != 1) {
+        return;
+    }
+
+    WalkStats stats;
+    stats.table_name = table_->name();
+    stats.start_time = start_time_;
+    stats.duration_usecs = UTCTimestampUsec() - start_time_;
+    stats.entry_count = entry_count_;
+    stats.ranges = ranges_;
+    stats.cancelled = should_stop_;
+    wkmgr_->RecordWalk(stats);
+
+    // Invoke Walker_Complete callback
+    if (!should_stop_) {
+        wkmgr_->update_walk_complete_count(+1);
+    }
+    if (done_fn_ != NULL) {
+        if (!should_stop_) {
+            done_fn_(table_);
+        }
+    }
+    // Release the memory for walker and bitmap
+    wkmgr_->PurgeWalker(id_);
+}
+
+DBTableWalker::WalkId DBTableWalker::AllocWalker(DBTable *table,
+        const DBRequestKey *key_start, int ranges, WalkFn walkerfn,
+        WalkCompleteFn walk_complete) {
     tbb::mutex::scoped_lock lock(walkers_mutex_);
     walk_request_count_++;
     size_t i = walker_map_.find_first();
     if (i == walker_map_.npos) {
         i = walkers_.size();
-        Walker *walker = new Walker(i, this, table, key_start, 
+        Walker *walker = new Walker(i, this, table, key_start, ranges,
                                     walkerfn, walk_complete);
         walkers_.push_back(walker);
     } else {
@@ -202,13 +424,26 @@ DBTableWalker::WalkId DBTableWalker::WalkTable(DBTable *table,
         if (walker_map_.none()) {
             walker_map_.clear();
         }
-        Walker *walker = new Walker(i, this, table, key_start, 
+        Walker *walker = new Walker(i, this, table, key_start, ranges,
                                     walkerfn, walk_complete);
         walkers_[i] = walker;
     }
     return i;
 }
 
+DBTableWalker::WalkId DBTableWalker::WalkTable(DBTable *table, 
+                                               const DBRequestKey *key_start, 
+                                               WalkFn walkerfn , 
+                                               WalkCompleteFn walk_complete) {
+    return AllocWalker(table, key_start, 1, walkerfn, walk_complete);
+}
+
+DBTableWalker::WalkId DBTableWalker::WalkTableParallel(DBTable *table,
+        int ranges, WalkFn walkerfn, WalkCompleteFn walk_complete) {
+    assert(ranges > 0);
+    return AllocWalker(table, NULL, ranges, walkerfn, walk_complete);
+}
+
 void DBTableWalker::WalkCancel(WalkId id) {
     tbb::mutex::scoped_lock lock(walkers_mutex_);
     walk_cancel_count_++;
@@ -235,3 +470,18 @@ void DBTableWalker::PurgeWalker(WalkId id) {
         walker_map_.set(id);
     }
 }
+
+void DBTableWalker::RecordWalk(const WalkStats &stats) {
+    tbb::mutex::scoped_lock lock(walkers_mutex_);
+    walk_entry_count_ += stats.entry_count;
+    walk_duration_usecs_ += stats.duration_usecs;
+    walk_history_.push_back(stats);
+    if (walk_history_.size() > kMaxWalkHistory) {
+        walk_history_.pop_front();
+    }
+}
+
+void DBTableWalker::GetWalkHistory(WalkStatsList *history) {
+    tbb::mutex::scoped_lock lock(walkers_mutex_);
+    *history = walk_history_;
+}
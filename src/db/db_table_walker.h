@@ -5,6 +5,7 @@
 #ifndef ctrlplane_db_table_walker_h
 #define ctrlplane_db_table_walker_h
 
+#include <deque>
 #include <boost/function.hpp>
 #include <boost/dynamic_bitset.hpp>
 #include <tbb/task.h>
@@ -32,12 +33,42 @@ public:
 
     static const WalkId kInvalidWalkerId = -1;
 
+    // Number of completed walks for which statistics are retained.
+    static const size_t kMaxWalkHistory = 32;
+
+    // Statistics of a completed or cancelled walk.
+    struct WalkStats {
+        WalkStats()
+            : start_time(0), duration_usecs(0), entry_count(0), ranges(0),
+              cancelled(false) {
+        }
+        std::string table_name;
+        uint64_t start_time;
+        uint64_t duration_usecs;
+        uint64_t entry_count;
+        int ranges;
+        bool cancelled;
+    };
+    typedef std::deque<WalkStats> WalkStatsList;
+
     // Start a walk request on the specified table. If non null, 'key_start'
     // specifies the starting point for the walk. The walk is performed in
     // all table shards in parallel.
     WalkId WalkTable(DBTable *table, const DBRequestKey *key_start,
                      WalkFn walker, WalkCompleteFn walk_complete);
 
+    // Start a walk of the whole table in which each table shard is further
+    // split into up to 'ranges' key ranges that are walked concurrently.
+    //
+    // The key ranges are walked under the db::DBTableWalk task, which is
+    // mutually exclusive with db::DBTable. Entries are thus not added or
+    // removed while the walker function runs, but the walker function may
+    // be invoked concurrently for entries in the same shard. It must not
+    // modify the table or generate change notifications. The completion
+    // callback may be invoked from either task.
+    WalkId WalkTableParallel(DBTable *table, int ranges, WalkFn walker,
+                             WalkCompleteFn walk_complete);
+
     // cancel a walk that may be in progress. This cannot be called from
     // the walker function itself.
     void WalkCancel(WalkId id);
@@ -51,6 +82,11 @@ public:
         walk_complete_count_ += inc;
     }
     uint64_t walk_cancel_count() { return walk_cancel_count_; }
+    uint64_t walk_entry_count() { return walk_entry_count_; }
+    uint64_t walk_duration_usecs() { return walk_duration_usecs_; }
+
+    // Statistics of the most recent walks, oldest first.
+    void GetWalkHistory(WalkStatsList *history);
 
 private:
     static const int kIterationToYield = 1024;
@@ -78,12 +114,24 @@ private:
     // A Job for walking through the DBTablePartition
     class Worker;
 
+    // A Job that splits a DBTablePartition into key ranges
+    class Splitter;
+
+    // A Job for walking through a key range of a DBTablePartition
+    class RangeWorker;
+
     typedef std::vector<Walker *> WalkerList;
     typedef boost::dynamic_bitset<> WalkerMap;
 
+    WalkId AllocWalker(DBTable *table, const DBRequestKey *key_start,
+                       int ranges, WalkFn walkerfn,
+                       WalkCompleteFn walk_complete);
+
     // Purge the walker after the walk is completed/cancelled
     void PurgeWalker(WalkId id);
 
+    void RecordWalk(const WalkStats &stats);
+
     // List of walkers allocated
     tbb::mutex walkers_mutex_;
     WalkerList walkers_;
@@ -92,7 +140,11 @@ private:
     uint64_t walk_request_count_;
     uint64_t walk_complete_count_;
     uint64_t walk_cancel_count_;
+    uint64_t walk_entry_count_;
+    uint64_t walk_duration_usecs_;
+    WalkStatsList walk_history_;
 
     static int walker_task_id_;
+    static int range_walker_task_id_;
 };
 #endif
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "db/db_btree.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/util.h"
+#include "db/db_entry.h"
+#include "db/db_table_partition.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+class TestEntry : public DBEntry {
+public:
+    explicit TestEntry(uint64_t key) : key_(key), index_node_(NULL) { }
+
+    virtual bool IsLess(const DBEntry &rhs) const {
+        return key_ < static_cast<const TestEntry &>(rhs).key_;
+    }
+    virtual void SetKey(const DBRequestKey *key) { }
+    virtual KeyPtr GetDBRequestKey() const { return KeyPtr(); }
+    virtual std::string ToString() const { return "TestEntry"; }
+    virtual void *index_node() const { return index_node_; }
+    virtual void set_index_node(void *node) { index_node_ = node; }
+
+    uint64_t key() const { return key_; }
+
+private:
+    uint64_t key_;
+    void *index_node_;
+    DISALLOW_COPY_AND_ASSIGN(TestEntry);
+};
+
+class DBEntryBTreeTest : public ::testing::Test {
+protected:
+    virtual void TearDown() {
+        STLDeleteValues(&entries_);
+    }
+
+    TestEntry *Entry(uint64_t key) {
+        TestEntry *entry = new TestEntry(key);
+        entries_.push_back(entry);
+        return entry;
+    }
+
+    // Verify the contents of the tree against the set of keys.
+    void Verify(const set<uint64_t> &keys) {
+        EXPECT_EQ(keys.size(), btree_.size());
+        DBEntry *entry = btree_.first();
+        for (set<uint64_t>::const_iterator it = keys.begin();
+             it != keys.end(); ++it) {
+            ASSERT_TRUE(entry != NULL);
+            EXPECT_EQ(*it, static_cast<TestEntry *>(entry)->key());
+            entry = btree_.next(entry);
+        }
+        EXPECT_TRUE(entry == NULL);
+    }
+
+    DBEntryBTree btree_;
+    vector<TestEntry *> entries_;
+};
+
+TEST_F(DBEntryBTreeTest, Empty) {
+    TestEntry key(1);
+    EXPECT_TRUE(btree_.empty());
+    EXPECT_TRUE(btree_.first() == NULL);
+    EXPECT_TRUE(btree_.find(&key) == NULL);
+    EXPECT_TRUE(btree_.lower_bound(&key) == NULL);
+}
+
+TEST_F(DBEntryBTreeTest, Basic) {
+    set<uint64_t> keys;
+    for (uint64_t i = 0; i < 1000; i++) {
+        uint64_t value = i * 2;
+        EXPECT_TRUE(btree_.insert(Entry(value)));
+        keys.insert(value);
+    }
+    Verify(keys);
+
+    // Duplicates are rejected.
+    TestEntry dup(10);
+    EXPECT_FALSE(btree_.insert(&dup));
+
+    TestEntry key(501);
+    EXPECT_TRUE(btree_.find(&key) == NULL);
+    DBEntry *entry = btree_.lower_bound(&key);
+    ASSERT_TRUE(entry != NULL);
+    EXPECT_EQ(502, static_cast<TestEntry *>(entry)->key());
+
+    TestEntry last(1999);
+    EXPECT_TRUE(btree_.lower_bound(&last) == NULL);
+
+    TestEntry found(500);
+    entry = btree_.find(&found);
+    ASSERT_TRUE(entry != NULL);
+    EXPECT_EQ(500, static_cast<TestEntry *>(entry)->key());
+
+    // Remove everything in reverse order.
+    for (vector<TestEntry *>::reverse_iterator it = entries_.rbegin();
+         it != entries_.rend(); ++it) {
+        btree_.erase(*it);
+    }
+    keys.clear();
+    Verify(keys);
+    EXPECT_TRUE(btree_.empty());
+}
+
+//
+// Random inserts and erases, checked against std::set. Erasing the smallest
+// entries of leaves exercises the separator updates in the inner nodes.
+//
+TEST_F(DBEntryBTreeTest, Random) {
+    static const int kIterations = 200000;
+    static const uint64_t kKeySpace = 20000;
+    srand(1);
+
+    set<uint64_t> keys;
+    vector<TestEntry *> present(kKeySpace, static_cast<TestEntry *>(NULL));
+    for (int i = 0; i < kIterations; i++) {
+        uint64_t value = rand() % kKeySpace;
+        if (present[value] == NULL) {
+            present[value] = Entry(value);
+            EXPECT_TRUE(btree_.insert(present[value]));
+            keys.insert(value);
+        } else {
+            btree_.erase(present[value]);
+            present[value] = NULL;
+            keys.erase(value);
+        }
+
+        if (i % 10000 == 0) {
+            Verify(keys);
+            TestEntry key(rand() % kKeySpace);
+            set<uint64_t>::iterator it = keys.lower_bound(key.key());
+            DBEntry *entry = btree_.lower_bound(&key);
+            if (it == keys.end()) {
+                EXPECT_TRUE(entry == NULL);
+            } else {
+                ASSERT_TRUE(entry != NULL);
+                EXPECT_EQ(*it, static_cast<TestEntry *>(entry)->key());
+            }
+        }
+    }
+    Verify(keys);
+
+    for (uint64_t value = 0; value < kKeySpace; value++) {
+        if (present[value] != NULL) {
+            btree_.erase(present[value]);
+        }
+    }
+    EXPECT_TRUE(btree_.empty());
+    EXPECT_TRUE(btree_.first() == NULL);
+}
+
+//
+// Compare the B+-tree with the red-black tree used by DBTablePartition for
+// insert, find and a full walk. Set DB_INDEX_BENCHMARK_LARGE in the
+// environment to include the 5M entry run.
+//
+class DBIndexBenchmarkTest : public ::testing::Test {
+protected:
+    typedef DBTablePartition::Tree Tree;
+
+    struct Result {
+        uint64_t insert_usecs;
+        uint64_t find_usecs;
+        uint64_t walk_usecs;
+    };
+
+    static void MakeEntries(size_t count, vector<TestEntry *> *entries) {
+        srand(1);
+        for (size_t i = 0; i < count; i++) {
+            uint64_t key = (uint64_t(rand()) << 32) | rand();
+            entries->push_back(new TestEntry(key));
+        }
+    }
+
+    static Result RunTree(const vector<TestEntry *> &entries) {
+        Result result;
+        Tree tree;
+        uint64_t start = UTCTimestampUsec();
+        for (size_t i = 0; i < entries.size(); i++) {
+            tree.insert(*entries[i]);
+        }
+        result.insert_usecs = UTCTimestampUsec() - start;
+
+        start = UTCTimestampUsec();
+        size_t found = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (tree.find(*entries[i]) != tree.end())
+                found++;
+        }
+        result.find_usecs = UTCTimestampUsec() - start;
+        EXPECT_EQ(tree.size(), found);
+
+        start = UTCTimestampUsec();
+        size_t walked = 0;
+        for (Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+            walked++;
+        }
+        result.walk_usecs = UTCTimestampUsec() - start;
+        EXPECT_EQ(tree.size(), walked);
+        tree.clear();
+        return result;
+    }
+
+    static Result RunBTree(const vector<TestEntry *> &entries) {
+        Result result;
+        DBEntryBTree btree;
+        uint64_t start = UTCTimestampUsec();
+        for (size_t i = 0; i < entries.size(); i++) {
+            btree.insert(entries[i]);
+        }
+        result.insert_usecs = UTCTimestampUsec() - start;
+
+        start = UTCTimestampUsec();
+        size_t found = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (btree.find(entries[i]) != NULL)
+                found++;
+        }
+        result.find_usecs = UTCTimestampUsec() - start;
+        EXPECT_EQ(btree.size(), found);
+
+        start = UTCTimestampUsec();
+        size_t walked = 0;
+        for (DBEntry *entry = btree.first(); entry != NULL;
+             entry = btree.next(entry)) {
+            walked++;
+        }
+        result.walk_usecs = UTCTimestampUsec() - start;
+        EXPECT_EQ(btree.size(), walked);
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            btree.erase(entries[i]);
+        }
+        return result;
+    }
+
+    static void Print(const char *name, size_t count, const Result &result) {
+        cout << name << " " << count << " entries:"
+             << " insert " << result.insert_usecs << " usecs,"
+             << " find " << result.find_usecs << " usecs,"
+             << " walk " << result.walk_usecs << " usecs" << endl;
+    }
+
+    static void Run(size_t count) {
+        vector<TestEntry *> entries;
+        MakeEntries(count, &entries);
+        Print("RBTree", count, RunTree(entries));
+        Print("BTree ", count, RunBTree(entries));
+        STLDeleteValues(&entries);
+    }
+};
+
+// Not part of the regular run, use --gtest_also_run_disabled_tests to run it.
+TEST_F(DBIndexBenchmarkTest, DISABLED_Benchmark) {
+    Run(100 * 1000);
+    Run(1000 * 1000);
+    if (getenv("DB_INDEX_BENCHMARK_LARGE")) {
+        Run(5 * 1000 * 1000);
+    }
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
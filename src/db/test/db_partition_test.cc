@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <boost/bind.hpp>
+#include <tbb/atomic.h>
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/util.h"
+#include "base/test/task_test_util.h"
+#include "db/db.h"
+#include "db/db_entry.h"
+#include "db/db_partition.h"
+#include "db/db_table.h"
+#include "db/db_table_partition.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+struct PrefixKey : public DBRequestKey {
+    explicit PrefixKey(uint32_t addr) : addr(addr) { }
+    uint32_t addr;
+};
+
+struct PrefixData : public DBRequestData {
+    explicit PrefixData(uint32_t label) : label(label) { }
+    uint32_t label;
+};
+
+class PrefixEntry : public DBEntry {
+public:
+    explicit PrefixEntry(uint32_t addr) : addr_(addr), label_(0) { }
+
+    virtual bool IsLess(const DBEntry &rhs) const {
+        const PrefixEntry &other = static_cast<const PrefixEntry &>(rhs);
+        return addr_ < other.addr_;
+    }
+    virtual void SetKey(const DBRequestKey *key) {
+        addr_ = static_cast<const PrefixKey *>(key)->addr;
+    }
+    virtual KeyPtr GetDBRequestKey() const {
+        return KeyPtr(new PrefixKey(addr_));
+    }
+    virtual std::string ToString() const { return "PrefixEntry"; }
+
+    uint32_t addr() const { return addr_; }
+    void set_label(uint32_t label) { label_ = label; }
+
+private:
+    uint32_t addr_;
+    uint32_t label_;
+    DISALLOW_COPY_AND_ASSIGN(PrefixEntry);
+};
+
+//
+// Table keyed by IPv4 /24 prefixes. As with the BGP inet table, the hash is
+// the address itself, so the low order 8 bits are always 0.
+//
+class PrefixTable : public DBTable {
+public:
+    PrefixTable(DB *db, const std::string &name) : DBTable(db, name) { }
+
+    virtual std::auto_ptr<DBEntry> AllocEntry(const DBRequestKey *key) const {
+        const PrefixKey *pkey = static_cast<const PrefixKey *>(key);
+        return std::auto_ptr<DBEntry>(new PrefixEntry(pkey->addr));
+    }
+    virtual size_t Hash(const DBEntry *entry) const {
+        return static_cast<const PrefixEntry *>(entry)->addr();
+    }
+    virtual size_t Hash(const DBRequestKey *key) const {
+        return static_cast<const PrefixKey *>(key)->addr;
+    }
+    virtual DBEntry *Add(const DBRequest *req) {
+        const PrefixKey *key = static_cast<const PrefixKey *>(req->key.get());
+        const PrefixData *data =
+            static_cast<const PrefixData *>(req->data.get());
+        PrefixEntry *entry = new PrefixEntry(key->addr);
+        entry->set_label(data->label);
+        return entry;
+    }
+    virtual bool OnChange(DBEntry *entry, const DBRequest *req) {
+        const PrefixData *data =
+            static_cast<const PrefixData *>(req->data.get());
+        static_cast<PrefixEntry *>(entry)->set_label(data->label);
+        return true;
+    }
+
+    static DBTableBase *CreateTable(DB *db, const std::string &name) {
+        PrefixTable *table = new PrefixTable(db, name);
+        table->Init();
+        return table;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(PrefixTable);
+};
+
+class DBPartitionTest : public ::testing::Test {
+public:
+    void Notify(DBTablePartBase *tpart, DBEntryBase *entry) {
+        notify_count_++;
+    }
+
+protected:
+    static const int kPrefixCount = 64 * 1024;
+
+    DBPartitionTest() {
+        notify_count_ = 0;
+    }
+
+    virtual void TearDown() {
+        DB::SetPartitionCount(0);
+    }
+
+    static uint32_t PrefixAddress(int idx) {
+        return (10 << 24) + (idx << 8);
+    }
+
+    void EnqueuePrefixes(PrefixTable *table, DBRequest::DBOperation oper) {
+        for (int idx = 0; idx < kPrefixCount; ++idx) {
+            DBRequest req;
+            req.oper = oper;
+            req.key.reset(new PrefixKey(PrefixAddress(idx)));
+            if (oper == DBRequest::DB_ENTRY_ADD_CHANGE)
+                req.data.reset(new PrefixData(idx));
+            table->Enqueue(&req);
+        }
+    }
+
+    // Enqueue the prefixes in batches of batch_size requests.
+    void EnqueuePrefixBatches(PrefixTable *table, DBRequest::DBOperation oper,
+                              int batch_size) {
+        DBTableBase::RequestList requests;
+        for (int idx = 0; idx < kPrefixCount; ++idx) {
+            DBRequest *req = new DBRequest();
+            req->oper = oper;
+            req->key.reset(new PrefixKey(PrefixAddress(idx)));
+            if (oper == DBRequest::DB_ENTRY_ADD_CHANGE)
+                req->data.reset(new PrefixData(idx));
+            requests.push_back(req);
+            if (requests.size() == size_t(batch_size))
+                table->EnqueueBatch(&requests);
+        }
+        table->EnqueueBatch(&requests);
+    }
+
+    // Returns the number of requests processed per second. Requests are
+    // enqueued one at a time if batch_size is 0.
+    uint64_t RunBenchmark(PrefixTable *table, DBRequest::DBOperation oper,
+                          int batch_size = 0) {
+        notify_count_ = 0;
+        uint64_t start = UTCTimestampUsec();
+        if (batch_size) {
+            EnqueuePrefixBatches(table, oper, batch_size);
+        } else {
+            EnqueuePrefixes(table, oper);
+        }
+        task_util::WaitForIdle();
+        TASK_UTIL_EXPECT_EQ(kPrefixCount, notify_count_);
+        uint64_t elapsed = max(UTCTimestampUsec() - start, uint64_t(1));
+        return uint64_t(kPrefixCount) * 1000000 / elapsed;
+    }
+
+    tbb::atomic<long> notify_count_;
+};
+
+//
+// Prefixes that only differ in their high order bits must still be spread
+// evenly across partitions.
+//
+TEST_F(DBPartitionTest, ShardingBalance) {
+    static const int kPartitionCount = 32;
+    DB::SetPartitionCount(kPartitionCount);
+    DB db;
+    PrefixTable *table = static_cast<PrefixTable *>(
+        db.CreateTable("db.test.prefix.0"));
+    ASSERT_TRUE(table != NULL);
+    EXPECT_EQ(kPartitionCount, table->PartitionCount());
+
+    vector<int> load(kPartitionCount, 0);
+    for (int idx = 0; idx < kPrefixCount; ++idx) {
+        PrefixKey key(PrefixAddress(idx));
+        DBTablePartBase *tpart = table->GetTablePartition(&key);
+        load[tpart->index()]++;
+    }
+    int average = kPrefixCount / kPartitionCount;
+    EXPECT_LT(*max_element(load.begin(), load.end()), average * 5 / 4);
+    EXPECT_GT(*min_element(load.begin(), load.end()), average * 3 / 4);
+
+    // An entry and its key must map to the same partition.
+    PrefixEntry entry(PrefixAddress(1234));
+    PrefixKey key(PrefixAddress(1234));
+    EXPECT_EQ(table->GetTablePartition(&key),
+              table->GetTablePartition(&entry));
+
+    // Tables that do not implement Hash() stay on partition 0.
+    EXPECT_EQ(0, table->HashToPartition(0));
+}
+
+//
+// Requests in a batch are spread across partitions and processed in order.
+//
+TEST_F(DBPartitionTest, EnqueueBatch) {
+    static const int kPartitionCount = 4;
+    DB::SetPartitionCount(kPartitionCount);
+    DB db;
+    PrefixTable *table = static_cast<PrefixTable *>(
+        db.CreateTable("db.test.prefix.0"));
+    DBTableBase::ListenerId id = table->Register(
+        boost::bind(&DBPartitionTest::Notify, this, _1, _2));
+
+    DBTableBase::RequestList requests;
+    for (int idx = 0; idx < 256; ++idx) {
+        DBRequest *req = new DBRequest();
+        req->oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        req->key.reset(new PrefixKey(PrefixAddress(idx)));
+        req->data.reset(new PrefixData(idx));
+        requests.push_back(req);
+    }
+
+    // Delete every other prefix in the same batch.
+    for (int idx = 0; idx < 256; idx += 2) {
+        DBRequest *req = new DBRequest();
+        req->oper = DBRequest::DB_ENTRY_DELETE;
+        req->key.reset(new PrefixKey(PrefixAddress(idx)));
+        requests.push_back(req);
+    }
+    EXPECT_TRUE(table->EnqueueBatch(&requests));
+    EXPECT_TRUE(requests.empty());
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(128, table->Size());
+
+    uint64_t request_count = 0;
+    uint64_t batch_count = 0;
+    for (int idx = 0; idx < kPartitionCount; ++idx) {
+        DBPartition::QueueStats stats;
+        db.GetPartition(idx)->GetQueueStats(&stats);
+        request_count += stats.total_request_count;
+        batch_count += stats.total_batch_count;
+    }
+    EXPECT_EQ(384U, request_count);
+    EXPECT_GE(uint64_t(kPartitionCount), batch_count);
+
+    // An empty batch is a no-op.
+    EXPECT_TRUE(table->EnqueueBatch(&requests));
+
+    EnqueuePrefixes(table, DBRequest::DB_ENTRY_DELETE);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, table->Size());
+    table->Unregister(id);
+}
+
+//
+// A full table added and deleted in batches, as done by the benchmark.
+//
+TEST_F(DBPartitionTest, EnqueueBatches) {
+    DB::SetPartitionCount(4);
+    DB db;
+    PrefixTable *table = static_cast<PrefixTable *>(
+        db.CreateTable("db.test.prefix.0"));
+    DBTableBase::ListenerId id = table->Register(
+        boost::bind(&DBPartitionTest::Notify, this, _1, _2));
+
+    EnqueuePrefixBatches(table, DBRequest::DB_ENTRY_ADD_CHANGE, 256);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(kPrefixCount, notify_count_);
+    EXPECT_EQ(kPrefixCount, table->Size());
+
+    notify_count_ = 0;
+    EnqueuePrefixBatches(table, DBRequest::DB_ENTRY_DELETE, 256);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(kPrefixCount, notify_count_);
+    TASK_UTIL_EXPECT_EQ(0, table->Size());
+    table->Unregister(id);
+}
+
+//
+// Measure request throughput as the number of partitions grows. Not part of
+// the regular run, use --gtest_also_run_disabled_tests to run it.
+//
+TEST_F(DBPartitionTest, DISABLED_Benchmark) {
+    int max_count = min(max(TaskScheduler::GetInstance()->HardwareThreadCount(),
+                            1) * 2, 32);
+    for (int count = 1; count <= max_count; count *= 2) {
+        DB::SetPartitionCount(count);
+        DB db;
+        PrefixTable *table = static_cast<PrefixTable *>(
+            db.CreateTable("db.test.prefix.0"));
+        DBTableBase::ListenerId id = table->Register(
+            boost::bind(&DBPartitionTest::Notify, this, _1, _2));
+
+        uint64_t add_rate =
+            RunBenchmark(table, DBRequest::DB_ENTRY_ADD_CHANGE);
+        EXPECT_EQ(kPrefixCount, table->Size());
+        uint64_t delete_rate =
+            RunBenchmark(table, DBRequest::DB_ENTRY_DELETE);
+        task_util::WaitForIdle();
+        TASK_UTIL_EXPECT_EQ(0, table->Size());
+
+        uint64_t batch_add_rate =
+            RunBenchmark(table, DBRequest::DB_ENTRY_ADD_CHANGE, 256);
+        EXPECT_EQ(kPrefixCount, table->Size());
+        uint64_t batch_delete_rate =
+            RunBenchmark(table, DBRequest::DB_ENTRY_DELETE, 256);
+        task_util::WaitForIdle();
+        TASK_UTIL_EXPECT_EQ(0, table->Size());
+
+        uint64_t max_queue_len = 0;
+        for (int idx = 0; idx < count; ++idx) {
+            DBPartition::QueueStats stats;
+            db.GetPartition(idx)->GetQueueStats(&stats);
+            max_queue_len = max(max_queue_len, stats.max_request_queue_len);
+        }
+        cout << "Partitions: " << count
+             << " Add: " << add_rate << " req/sec"
+             << " Delete: " << delete_rate << " req/sec"
+             << " Batch add: " << batch_add_rate << " req/sec"
+             << " Batch delete: " << batch_delete_rate << " req/sec"
+             << " Max queue length: " << max_queue_len << endl;
+
+        table->Unregister(id);
+        task_util::WaitForIdle();
+    }
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    DB::RegisterFactory("db.test.prefix.0", &PrefixTable::CreateTable);
+    return RUN_ALL_TESTS();
+}
@@ -2,10 +2,15 @@
  * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
  */
 
+#include <stdlib.h>
+#include <map>
+#include <set>
+#include <sstream>
 #include <boost/intrusive/avl_set.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/bind.hpp>
 #include <tbb/atomic.h>
+#include <tbb/mutex.h>
 
 #include "db/db.h"
 #include "db/db_table.h"
@@ -131,6 +136,397 @@ public:
 
 #include "db_test_cmn.h"
 
+// To Test:
+// Verify request queue statistics, back-pressure and in-order processing of
+// requests that overflow the request ring while the queue is disabled.
+TEST_F(DBTest, RequestQueueStats) {
+    static const int kRequestCount = 5000;
+    tid_ = itbl->Register(boost::bind(&DBTest::DBTestListener, this, _1, _2));
+    adc_notification = 0;
+    del_notification = 0;
+
+    DBPartition *partition = db_.GetPartition(0);
+    DBPartition::QueueStats stats;
+    partition->GetQueueStats(&stats);
+    uint64_t initial_count = stats.total_request_count;
+
+    // Queue up requests for the same entry so that processing them out of
+    // order would leave behind the wrong description.
+    partition->SetQueueDisable(true);
+    int accepted = 0;
+    for (int i = 0; i < kRequestCount; i++) {
+        DBRequest addReq;
+        addReq.key.reset(new VlanTableReqKey(0));
+        std::ostringstream oss;
+        oss << "DB Test Vlan " << i;
+        addReq.data.reset(new VlanTableReqData(oss.str()));
+        addReq.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        if (itbl->Enqueue(&addReq))
+            accepted++;
+    }
+    EXPECT_GT(kRequestCount, accepted);
+
+    partition->GetQueueStats(&stats);
+    EXPECT_EQ(kRequestCount, stats.request_queue_len);
+    EXPECT_EQ(kRequestCount, stats.max_request_queue_len);
+    EXPECT_EQ(kRequestCount, stats.total_request_count - initial_count);
+    EXPECT_LT(0, stats.overflow_request_count);
+    EXPECT_FALSE(partition->IsDBQueueEmpty());
+
+    partition->SetQueueDisable(false);
+    task_util::WaitForIdle();
+    EXPECT_TRUE(partition->IsDBQueueEmpty());
+
+    partition->GetQueueStats(&stats);
+    EXPECT_EQ(0, stats.request_queue_len);
+    EXPECT_GE(stats.total_wait_usecs, stats.max_wait_usecs);
+    EXPECT_GE(stats.total_enqueue_usecs, stats.max_enqueue_usecs);
+
+    VlanTableReqKey key(0);
+    Vlan *vlan = itbl->Find(&key);
+    ASSERT_TRUE(vlan != NULL);
+    std::ostringstream oss;
+    oss << "DB Test Vlan " << kRequestCount - 1;
+    EXPECT_EQ(oss.str(), vlan->getDesc());
+    EXPECT_LE(1, adc_notification);
+
+    DBRequest delReq;
+    delReq.key.reset(new VlanTableReqKey(0));
+    delReq.oper = DBRequest::DB_ENTRY_DELETE;
+    itbl->Enqueue(&delReq);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, del_notification);
+
+    itbl->Unregister(tid_);
+    adc_notification = 0;
+    del_notification = 0;
+}
+
+//
+// Records the entries visited by a parallel walk, which may run the walker
+// function concurrently for entries of the same table partition.
+//
+class ParallelWalkRecorder {
+public:
+    ParallelWalkRecorder() : duplicates_(0), done_count_(0), stop_after_(0) {
+        visit_count_ = 0;
+    }
+
+    bool Walk(DBTablePartBase *tpart, DBEntryBase *entry) {
+        if (stop_after_ && visit_count_ >= stop_after_) {
+            return false;
+        }
+        visit_count_++;
+        tbb::mutex::scoped_lock lock(mutex_);
+        if (!visited_.insert(static_cast<Vlan *>(entry)->getTag()).second)
+            duplicates_++;
+        return true;
+    }
+
+    void WalkDone(DBTableBase *table) {
+        tbb::mutex::scoped_lock lock(mutex_);
+        done_count_++;
+    }
+
+    tbb::atomic<int> visit_count_;
+    std::set<unsigned short> visited_;
+    int duplicates_;
+    int done_count_;
+    int stop_after_;
+    tbb::mutex mutex_;
+};
+
+// To Test:
+// Walk a table with each table partition split into key ranges, and verify
+// that every entry is visited exactly once and that the completion callback
+// is invoked once, after all the key ranges are walked.
+TEST_F(DBTest, ParallelWalker) {
+    static const int kVlanCount = 16 * 1024;
+    static const int kRanges = 4;
+    tid_ = itbl->Register(boost::bind(&DBTest::DBTestListener, this, _1, _2));
+    adc_notification = 0;
+    del_notification = 0;
+
+    for (int i = 0; i < kVlanCount; i++) {
+        DBRequest addReq;
+        addReq.key.reset(new VlanTableReqKey(i));
+        addReq.data.reset(new VlanTableReqData("DB Test Vlan"));
+        addReq.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        EXPECT_TRUE(itbl->Enqueue(&addReq));
+    }
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(kVlanCount, adc_notification);
+
+    DBTableWalker *walker = db_.GetWalker();
+    uint64_t entry_count = walker->walk_entry_count();
+    ParallelWalkRecorder recorder;
+    walker->WalkTableParallel(itbl, kRanges,
+        boost::bind(&ParallelWalkRecorder::Walk, &recorder, _1, _2),
+        boost::bind(&ParallelWalkRecorder::WalkDone, &recorder, _1));
+    task_util::WaitForIdle();
+    EXPECT_EQ(1, recorder.done_count_);
+    EXPECT_EQ(kVlanCount, recorder.visit_count_);
+    EXPECT_EQ(kVlanCount, recorder.visited_.size());
+    EXPECT_EQ(0, recorder.duplicates_);
+    EXPECT_EQ(kVlanCount, walker->walk_entry_count() - entry_count);
+
+    DBTableWalker::WalkStatsList history;
+    walker->GetWalkHistory(&history);
+    ASSERT_FALSE(history.empty());
+    const DBTableWalker::WalkStats &stats = history.back();
+    EXPECT_EQ(itbl->name(), stats.table_name);
+    EXPECT_EQ(kVlanCount, stats.entry_count);
+    EXPECT_EQ(kRanges, stats.ranges);
+    EXPECT_FALSE(stats.cancelled);
+
+    // A key range whose walker function returns false stops early, while
+    // the completion callback is still invoked once.
+    ParallelWalkRecorder partial;
+    partial.stop_after_ = kVlanCount / 8;
+    walker->WalkTableParallel(itbl, kRanges,
+        boost::bind(&ParallelWalkRecorder::Walk, &partial, _1, _2),
+        boost::bind(&ParallelWalkRecorder::WalkDone, &partial, _1));
+    task_util::WaitForIdle();
+    EXPECT_EQ(1, partial.done_count_);
+    EXPECT_GT(kVlanCount, partial.visit_count_);
+    EXPECT_EQ(0, partial.duplicates_);
+
+    // A single key range walks the table partitions as WalkTable does.
+    ParallelWalkRecorder single;
+    walker->WalkTableParallel(itbl, 1,
+        boost::bind(&ParallelWalkRecorder::Walk, &single, _1, _2),
+        boost::bind(&ParallelWalkRecorder::WalkDone, &single, _1));
+    task_util::WaitForIdle();
+    EXPECT_EQ(1, single.done_count_);
+    EXPECT_EQ(kVlanCount, single.visited_.size());
+    EXPECT_EQ(0, single.duplicates_);
+
+    for (int i = 0; i < kVlanCount; i++) {
+        DBRequest delReq;
+        delReq.key.reset(new VlanTableReqKey(i));
+        delReq.oper = DBRequest::DB_ENTRY_DELETE;
+        EXPECT_TRUE(itbl->Enqueue(&delReq));
+    }
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(kVlanCount, del_notification);
+
+    itbl->Unregister(tid_);
+    adc_notification = 0;
+    del_notification = 0;
+}
+
+//
+// Records the entries delivered to a batch listener. Entries in each table
+// partition must be seen in the order in which they were changed.
+//
+class BatchListener {
+public:
+    explicit BatchListener(size_t batch_size)
+        : batch_size_(batch_size), batch_count_(0), entry_count_(0),
+          delete_count_(0), max_batch_(0), out_of_order_(0) {
+    }
+
+    void Notify(DBTablePartBase *tpart, const DBTableBase::EntryList &entries) {
+        tbb::mutex::scoped_lock lock(mutex_);
+        EXPECT_FALSE(entries.empty());
+        EXPECT_GE(batch_size_, entries.size());
+        batch_count_++;
+        max_batch_ = std::max(max_batch_, entries.size());
+        for (DBTableBase::EntryList::const_iterator it = entries.begin();
+             it != entries.end(); ++it) {
+            Vlan *vlan = static_cast<Vlan *>(*it);
+            if (vlan->IsDeleted()) {
+                delete_count_++;
+                continue;
+            }
+            std::map<int, int>::iterator last = last_tag_.find(tpart->index());
+            if (last != last_tag_.end() && last->second >= vlan->getTag())
+                out_of_order_++;
+            last_tag_[tpart->index()] = vlan->getTag();
+            entry_count_++;
+        }
+    }
+
+    size_t batch_size_;
+    size_t batch_count_;
+    size_t entry_count_;
+    size_t delete_count_;
+    size_t max_batch_;
+    size_t out_of_order_;
+    std::map<int, int> last_tag_;
+    tbb::mutex mutex_;
+};
+
+// To Test:
+// Verify that batch listeners see every change, in order, in batches no
+// larger than requested, alongside a per-entry listener.
+TEST_F(DBTest, BatchListener) {
+    static const int kVlanCount = 4000;
+    static const size_t kBatchSize = 64;
+    BatchListener listener(kBatchSize);
+    tid_ = itbl->Register(boost::bind(&DBTest::DBTestListener, this, _1, _2));
+    DBTableBase::ListenerId batch_id = itbl->RegisterBatch(
+        boost::bind(&BatchListener::Notify, &listener, _1, _2), kBatchSize);
+    adc_notification = 0;
+    del_notification = 0;
+
+    db_.GetPartition(0)->SetQueueDisable(true);
+    for (int i = 0; i < kVlanCount; i++) {
+        DBRequest addReq;
+        addReq.key.reset(new VlanTableReqKey(i));
+        addReq.data.reset(new VlanTableReqData("DB Test Vlan"));
+        addReq.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        itbl->Enqueue(&addReq);
+    }
+    db_.GetPartition(0)->SetQueueDisable(false);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(kVlanCount, adc_notification);
+    EXPECT_EQ(kVlanCount, listener.entry_count_);
+    EXPECT_EQ(0, listener.out_of_order_);
+    EXPECT_EQ(kBatchSize, listener.max_batch_);
+    EXPECT_GT(listener.entry_count_, listener.batch_count_);
+
+    // Deleted entries must remain valid until the batch has been delivered.
+    for (int i = 0; i < kVlanCount; i++) {
+        DBRequest delReq;
+        delReq.key.reset(new VlanTableReqKey(i));
+        delReq.oper = DBRequest::DB_ENTRY_DELETE;
+        itbl->Enqueue(&delReq);
+    }
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(kVlanCount, del_notification);
+    EXPECT_EQ(kVlanCount, listener.delete_count_);
+    EXPECT_EQ(0, itbl->Size());
+
+    itbl->Unregister(batch_id);
+    itbl->Unregister(tid_);
+    adc_notification = 0;
+    del_notification = 0;
+}
+
+//
+// Batch listener that notifies each entry of the batch it is handed once
+// more, the first time it sees it.
+//
+class RenotifyListener {
+public:
+    RenotifyListener() : entry_count_(0) {
+    }
+
+    void Notify(DBTablePartBase *tpart, const DBTableBase::EntryList &entries) {
+        tbb::mutex::scoped_lock lock(mutex_);
+        for (DBTableBase::EntryList::const_iterator it = entries.begin();
+             it != entries.end(); ++it) {
+            Vlan *vlan = static_cast<Vlan *>(*it);
+            entry_count_++;
+            if (seen_[vlan->getTag()]++ == 0)
+                tpart->Notify(vlan);
+        }
+    }
+
+    size_t entry_count_;
+    std::map<int, int> seen_;
+    tbb::mutex mutex_;
+};
+
+// To Test:
+// Verify that an entry notified again from a batch listener, while its batch
+// is being delivered, is delivered in a later batch rather than dropped.
+TEST_F(DBTest, BatchListenerRenotify) {
+    static const int kVlanCount = 200;
+    static const size_t kBatchSize = 16;
+    RenotifyListener listener;
+    DBTableBase::ListenerId batch_id = itbl->RegisterBatch(
+        boost::bind(&RenotifyListener::Notify, &listener, _1, _2), kBatchSize);
+
+    for (int i = 0; i < kVlanCount; i++) {
+        DBRequest addReq;
+        addReq.key.reset(new VlanTableReqKey(i));
+        addReq.data.reset(new VlanTableReqData("DB Test Vlan"));
+        addReq.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        itbl->Enqueue(&addReq);
+    }
+    task_util::WaitForIdle();
+    EXPECT_EQ(2 * kVlanCount, listener.entry_count_);
+    EXPECT_EQ(kVlanCount, listener.seen_.size());
+    for (std::map<int, int>::iterator it = listener.seen_.begin();
+         it != listener.seen_.end(); ++it) {
+        EXPECT_EQ(2, it->second);
+    }
+
+    // Deleted entries notified again are removed after their last batch.
+    listener.seen_.clear();
+    listener.entry_count_ = 0;
+    for (int i = 0; i < kVlanCount; i++) {
+        DBRequest delReq;
+        delReq.key.reset(new VlanTableReqKey(i));
+        delReq.oper = DBRequest::DB_ENTRY_DELETE;
+        itbl->Enqueue(&delReq);
+    }
+    task_util::WaitForIdle();
+    EXPECT_EQ(2 * kVlanCount, listener.entry_count_);
+    EXPECT_EQ(0, itbl->Size());
+
+    itbl->Unregister(batch_id);
+}
+
+// To Test:
+// Verify that listener states are found by listener id as they move between
+// the inline slot and the array, in any order of set and clear.
+TEST_F(DBTest, ListenerState) {
+    static const int kListenerCount = 9;
+    static const int kOrder[kListenerCount] = { 4, 0, 8, 2, 6, 1, 7, 3, 5 };
+    DBState states[kListenerCount];
+    DBState replacement;
+
+    DBRequest addReq;
+    addReq.key.reset(new VlanTableReqKey(1));
+    addReq.data.reset(new VlanTableReqData("DB Test Vlan"));
+    addReq.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+    itbl->Enqueue(&addReq);
+    task_util::WaitForIdle();
+    VlanTableReqKey key(1);
+    Vlan *vlan = itbl->Find(&key);
+    ASSERT_TRUE(vlan != NULL);
+    DBTablePartBase *tpart = itbl->GetTablePartition(vlan);
+
+    EXPECT_TRUE(vlan->GetState(itbl, 0) == NULL);
+    for (int i = 0; i < kListenerCount; i++) {
+        int id = kOrder[i];
+        vlan->SetState(itbl, id, &states[id]);
+        for (int j = 0; j <= i; j++) {
+            EXPECT_EQ(&states[kOrder[j]], vlan->GetState(itbl, kOrder[j]));
+        }
+        EXPECT_TRUE(vlan->GetState(itbl, kListenerCount) == NULL);
+    }
+
+    vlan->SetState(itbl, 3, &replacement);
+    EXPECT_EQ(&replacement, vlan->GetState(itbl, 3));
+    vlan->SetState(itbl, 3, &states[3]);
+
+    // Clear all but the last one, which goes back inline.
+    for (int i = 0; i < kListenerCount - 1; i++) {
+        vlan->ClearState(itbl, kOrder[i]);
+        EXPECT_TRUE(vlan->GetState(itbl, kOrder[i]) == NULL);
+        for (int j = i + 1; j < kListenerCount; j++) {
+            EXPECT_EQ(&states[kOrder[j]], vlan->GetState(itbl, kOrder[j]));
+        }
+        EXPECT_FALSE(vlan->is_state_empty(tpart));
+    }
+    vlan->ClearState(itbl, kListenerCount);
+    EXPECT_EQ(&states[5], vlan->GetState(itbl, 5));
+    vlan->ClearState(itbl, 5);
+    EXPECT_TRUE(vlan->GetState(itbl, 5) == NULL);
+    EXPECT_TRUE(vlan->is_state_empty(tpart));
+
+    DBRequest delReq;
+    delReq.key.reset(new VlanTableReqKey(1));
+    delReq.oper = DBRequest::DB_ENTRY_DELETE;
+    itbl->Enqueue(&delReq);
+    task_util::WaitForIdle();
+    EXPECT_EQ(0, itbl->Size());
+}
+
 void RegisterFactory() {
     DB::RegisterFactory("db.test.vlan.0", &VlanTable::CreateTable);
 }
@@ -139,6 +535,8 @@ int main(int argc, char **argv) {
     LoggingInit();
     ::testing::InitGoogleTest(&argc, argv);
 
+    // Yield often enough for the parallel walk to split table partitions.
+    setenv("DB_ITERATION_TO_YIELD", "128", 0);
     RegisterFactory();
 
     return RUN_ALL_TESTS();
@@ -4,8 +4,11 @@
 
 #include "io/tcp_message_write.h"
 
+#include <algorithm>
+
 #include "base/util.h"
 #include "base/logging.h"
+#include "io/event_manager.h"
 #include "io/tcp_session.h"
 #include "io/io_log.h"
 
@@ -13,14 +16,57 @@ using namespace boost::asio;
 using namespace boost::system;
 using tbb::mutex;
 
+//
+// Free list of write buffers shared by all sessions. Sessions that fan out
+// the same updates tend to queue and drain buffers at the same time, so a
+// common pool is reused far more than a per session one would be.
+//
+class TcpMessageWriter::BufferPool {
+public:
+    static const size_t kMaxFreeBuffers = 1024;
+
+    uint8_t *Alloc() {
+        {
+            mutex::scoped_lock lock(mutex_);
+            if (!free_list_.empty()) {
+                uint8_t *data = free_list_.back();
+                free_list_.pop_back();
+                return data;
+            }
+        }
+        return new uint8_t[kDefaultBufferSize];
+    }
+
+    void Free(uint8_t *data) {
+        {
+            mutex::scoped_lock lock(mutex_);
+            if (free_list_.size() < kMaxFreeBuffers) {
+                free_list_.push_back(data);
+                return;
+            }
+        }
+        delete[] data;
+    }
+
+private:
+    mutex mutex_;
+    std::vector<uint8_t *> free_list_;
+};
+
+// Never freed, so that writers destroyed during exit can still return
+// their buffers.
+TcpMessageWriter::BufferPool *TcpMessageWriter::buffer_pool_ =
+    new TcpMessageWriter::BufferPool;
+
 TcpMessageWriter::TcpMessageWriter(Socket *socket, TcpSession *session) :
-    socket_(socket), offset_(0), session_(session) {
+    buffered_bytes_(0), socket_(socket), offset_(0), coalesce_window_(0),
+    write_blocked_(false), flush_pending_(false), session_(session) {
 }
 
 TcpMessageWriter::~TcpMessageWriter() {
     for (BufferQueue::iterator iter = buffer_queue_.begin();
          iter != buffer_queue_.end(); ++iter) {
-        DeleteBuffer(*iter);
+        buffer_pool_->Free(iter->data);
     }
     buffer_queue_.clear();
 }
@@ -35,10 +81,18 @@ int TcpMessageWriter::Send(const uint8_t *data, size_t len, error_code &ec) {
     session_->server_->stats_.write_calls++;
     session_->server_->stats_.write_bytes += len;
 
-    if (buffer_queue_.empty()) {
+    if (write_blocked_) {
+        TCP_SESSION_LOG_UT_DEBUG(session_, TCP_DIR_OUT,
+            "Write not ready. Enqueue buffer (len = " << len << ") and return");
+        BufferAppend(data, len);
+        return wrote;
+    }
+
+    if (buffer_queue_.empty() && len >= coalesce_window_) {
         wrote = socket_->write_some(boost::asio::buffer(data, len), ec);
         if (TcpSession::IsSocketErrorHard(ec)) return -1;
         assert(wrote >= 0);
+        UpdateWriteStats(wrote);
 
         if ((size_t)wrote != len) {
             TCP_SESSION_LOG_UT_DEBUG(session_, TCP_DIR_OUT,
@@ -47,12 +101,63 @@ int TcpMessageWriter::Send(const uint8_t *data, size_t len, error_code &ec) {
             BufferAppend(data + wrote, len - wrote);
             DeferWrite();
         }
-    } else {
-        TCP_SESSION_LOG_UT_DEBUG(session_, TCP_DIR_OUT,
-            "Write not ready. Enqueue buffer (len = " << len << ") and return");
-        BufferAppend(data, len);
+        return wrote;
     }
-    return wrote;
+
+    // Coalesce with the messages queued since the last write.
+    BufferAppend(data, len);
+    if (buffered_bytes_ < coalesce_window_) {
+        DeferFlush();
+        return len;
+    }
+
+    if (!WriteBuffers(ec)) return -1;
+    if (!buffer_queue_.empty()) {
+        DeferWrite();
+        return wrote;
+    }
+    return len;
+}
+
+void TcpMessageWriter::FlushPending() {
+    if (buffer_queue_.empty())
+        return;
+    error_code ec;
+    WriteBuffers(ec);
+}
+
+//
+// Write as much of the queued data as the socket accepts, up to
+// kMaxWriteBuffers buffers per system call. Returns false on a hard error.
+//
+bool TcpMessageWriter::WriteBuffers(error_code &ec) {
+    while (!buffer_queue_.empty()) {
+        size_t total = 0;
+        size_t offset = offset_;
+        write_buffers_.clear();
+        for (BufferQueue::const_iterator iter = buffer_queue_.begin();
+             iter != buffer_queue_.end() &&
+             write_buffers_.size() < kMaxWriteBuffers; ++iter) {
+            write_buffers_.push_back(
+                const_buffer(iter->data + offset, iter->size - offset));
+            total += iter->size - offset;
+            offset = 0;
+        }
+
+        size_t wrote = socket_->write_some(write_buffers_, ec);
+        if (TcpSession::IsSocketErrorHard(ec)) return false;
+        UpdateWriteStats(wrote);
+        BufferConsume(wrote);
+        if (wrote != total) break;
+    }
+    return true;
+}
+
+void TcpMessageWriter::UpdateWriteStats(size_t wrote) {
+    session_->stats_.write_syscalls++;
+    session_->stats_.write_syscall_bytes += wrote;
+    session_->server_->stats_.write_syscalls++;
+    session_->server_->stats_.write_syscall_bytes += wrote;
 }
 
 void TcpMessageWriter::DeferWrite() {
@@ -60,20 +165,58 @@ void TcpMessageWriter::DeferWrite() {
     // Update socket write block count.
     session_->stats_.write_blocked++;
     session_->server_->stats_.write_blocked++;
+    write_blocked_ = true;
     socket_->async_write_some(
-        boost::asio::null_buffers(), 
+        boost::asio::null_buffers(),
         boost::bind(&TcpMessageWriter::HandleWriteReady, this,
                     TcpSessionPtr(session_),
                     placeholders::error, UTCTimestampUsec()));
     return;
 }
 
-// Socket is ready for write. Flush any pending data and notify 
+// Write the coalesced messages from the event manager thread, unless the
+// window fills up first.
+void TcpMessageWriter::DeferFlush() {
+    if (flush_pending_)
+        return;
+    flush_pending_ = true;
+    EventManager *evm = session_->server_->event_manager();
+    evm->io_service()->post(
+        boost::bind(&TcpMessageWriter::HandleFlush, this,
+                    TcpSessionPtr(session_)));
+}
+
+void TcpMessageWriter::HandleFlush(TcpSessionPtr session_ref) {
+    mutex::scoped_lock lock(session_->mutex());
+    flush_pending_ = false;
+
+    //
+    // Ignore if connection is already closed, or if the data is going to be
+    // written when the socket becomes writable.
+    //
+    if (session_->IsClosedLocked() || write_blocked_) return;
+
+    error_code ec;
+    if (!WriteBuffers(ec)) {
+        lock.release();
+        if (!cb_.empty()) cb_(ec);
+        return;
+    }
+
+    // The sender has been told that the data was sent, and gets notified
+    // when the socket becomes writable again like after a partial send.
+    if (!buffer_queue_.empty()) {
+        DeferWrite();
+    }
+}
+
+// Socket is ready for write. Flush any pending data and notify
 // clients aboout it.
 void TcpMessageWriter::HandleWriteReady(TcpSessionPtr session_ptr,
                                         const error_code &error,
                                         uint64_t block_start_time) {
     mutex::scoped_lock lock(session_->mutex());
+    write_blocked_ = false;
 
     // Update socket write block time.
     uint64_t blocked_usecs = UTCTimestampUsec() - block_start_time;
@@ -89,29 +232,18 @@ void TcpMessageWriter::HandleWriteReady(TcpSessionPtr session_ptr,
     //
     if (session_->IsClosedLocked()) return;
 
-    while (!buffer_queue_.empty()) {
-        boost::asio::mutable_buffer head = buffer_queue_.front();
-        const uint8_t *data = buffer_cast<const uint8_t *>(head) + offset_;
-        int remaining = buffer_size(head) - offset_;
+    {
         error_code ec;
-        int wrote = socket_->write_some(buffer(data, remaining), ec);
-        if (TcpSession::IsSocketErrorHard(ec)) {
+        if (!WriteBuffers(ec)) {
             lock.release();
             if (!cb_.empty()) cb_(ec);
             return;
         }
-        assert(wrote >= 0);
-        if (wrote != remaining) {
-            offset_ += wrote;
+        if (!buffer_queue_.empty()) {
             DeferWrite();
             return;
-        } else {
-            offset_ = 0;
-            DeleteBuffer(head);
-            buffer_queue_.pop_front();
         }
     }
-    buffer_queue_.clear();
 
 done:
     lock.release();
@@ -124,17 +256,38 @@ done:
     return;
 }
 
-void TcpMessageWriter::BufferAppend(const uint8_t *src, int bytes) {
-    u_int8_t *data = new u_int8_t[bytes];
-    memcpy(data, src, bytes);
-    mutable_buffer buffer = mutable_buffer(data, bytes);
-    buffer_queue_.push_back(buffer);
+// Copy data to the end of the queue, filling up the last buffer first.
+void TcpMessageWriter::BufferAppend(const uint8_t *src, size_t bytes) {
+    buffered_bytes_ += bytes;
+    while (bytes > 0) {
+        if (buffer_queue_.empty() ||
+            buffer_queue_.back().size == (size_t)kDefaultBufferSize) {
+            buffer_queue_.push_back(WriteBuffer(buffer_pool_->Alloc()));
+        }
+        WriteBuffer &tail = buffer_queue_.back();
+        size_t count = std::min(bytes, size_t(kDefaultBufferSize) - tail.size);
+        memcpy(tail.data + tail.size, src, count);
+        tail.size += count;
+        src += count;
+        bytes -= count;
+    }
 }
 
-void TcpMessageWriter::DeleteBuffer(mutable_buffer buffer) {
-    const uint8_t *data = buffer_cast<const uint8_t *>(buffer);
-    delete[] data;
-    return;
+// Release data that has been written from the head of the queue.
+void TcpMessageWriter::BufferConsume(size_t bytes) {
+    buffered_bytes_ -= bytes;
+    while (bytes > 0) {
+        WriteBuffer &head = buffer_queue_.front();
+        size_t remaining = head.size - offset_;
+        if (bytes < remaining) {
+            offset_ += bytes;
+            return;
+        }
+        bytes -= remaining;
+        offset_ = 0;
+        buffer_pool_->Free(head.data);
+        buffer_queue_.pop_front();
+    }
 }
 
 void TcpMessageWriter::RegisterNotification(SendReadyCb cb) {
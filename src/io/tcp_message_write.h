@@ -5,7 +5,8 @@
 #ifndef __MESSAGE_WRITE_H__
 #define __MESSAGE_WRITE_H__
 
-#include <list>
+#include <deque>
+#include <vector>
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/asio/buffer.hpp>
@@ -18,32 +19,75 @@ using namespace boost::system;
 
 class TcpSession;
 
+//
+// Data that can't be written right away is copied into fixed size buffers,
+// which are taken from a process wide pool. Queued buffers are written out
+// together with a single scatter-gather write.
+//
+// With a coalescing window, messages smaller than the window are queued
+// even when the socket is writable. They are written once the window fills
+// up, or when the event manager thread gets to run, whichever comes first.
+// This turns a burst of small messages into a few large writes.
+//
+// Concurrency: all methods are called with the session mutex held.
+//
 class TcpMessageWriter {
 public:
     typedef boost::asio::ip::tcp::socket Socket;
     static const int kDefaultBufferSize = 4 * 1024;
+    // Maximum number of buffers handed to one write system call.
+    static const size_t kMaxWriteBuffers = 64;
+
     explicit TcpMessageWriter(Socket *, TcpSession *session);
     ~TcpMessageWriter();
 
-    // return false for send  
+    // return false for send
     int Send(const uint8_t *msg, size_t len, error_code &ec);
 
+    // Try to write out queued data without blocking. Used before the socket
+    // is closed, so that messages waiting for the coalescing window aren't
+    // dropped.
+    void FlushPending();
+
+    // A window of 0 disables coalescing.
+    void set_coalesce_window(size_t bytes) { coalesce_window_ = bytes; }
+    size_t coalesce_window() const { return coalesce_window_; }
+
     typedef boost::function<void(const error_code &ec)> SendReadyCb;
     void RegisterNotification(SendReadyCb);
 
 private:
     typedef boost::intrusive_ptr<TcpSession> TcpSessionPtr;
-    typedef std::list<boost::asio::mutable_buffer> BufferQueue;
-    void BufferAppend(const uint8_t *data, int len);
-    void DeleteBuffer(boost::asio::mutable_buffer buffer); 
+    class BufferPool;
+
+    struct WriteBuffer {
+        WriteBuffer(uint8_t *data) : data(data), size(0) { }
+        uint8_t *data;
+        size_t size;
+    };
+    typedef std::deque<WriteBuffer> BufferQueue;
+
+    void BufferAppend(const uint8_t *data, size_t len);
+    void BufferConsume(size_t len);
+    bool WriteBuffers(error_code &ec);
+    void UpdateWriteStats(size_t wrote);
     void DeferWrite();
+    void DeferFlush();
     void HandleWriteReady(TcpSessionPtr session_ref, const error_code &ec,
                           uint64_t block_start_time);
+    void HandleFlush(TcpSessionPtr session_ref);
+
+    static BufferPool *buffer_pool_;
 
     BufferQueue buffer_queue_;
+    size_t buffered_bytes_;
+    std::vector<boost::asio::const_buffer> write_buffers_;
     SendReadyCb cb_;
     Socket *socket_;
-    int offset_;
+    size_t offset_;
+    size_t coalesce_window_;
+    bool write_blocked_;
+    bool flush_pending_;
     TcpSession *session_;
 };
 
@@ -63,6 +63,8 @@ class TcpServer {
             write_bytes = 0;
             write_blocked = 0;
             write_blocked_duration_usecs = 0;
+            write_syscalls = 0;
+            write_syscall_bytes = 0;
         }
 
         tbb::atomic<uint64_t> read_calls;
@@ -71,6 +73,10 @@ class TcpServer {
         tbb::atomic<uint64_t> write_bytes;
         tbb::atomic<uint64_t> write_blocked;
         tbb::atomic<uint64_t> write_blocked_duration_usecs;
+        // Write system calls and the bytes they wrote. Differs from the
+        // write calls and bytes when messages are coalesced or queued.
+        tbb::atomic<uint64_t> write_syscalls;
+        tbb::atomic<uint64_t> write_syscall_bytes;
     };
     const SocketStats &GetSocketStats() const { return stats_; }
 
@@ -206,6 +206,9 @@ void TcpSession::CloseInternal(bool callObserver) {
     mutex::scoped_lock lock(mutex_);
 
     if (socket_.get() != NULL && !closed_) {
+        if (established_) {
+            writer_->FlushPending();
+        }
         boost::system::error_code err;
         socket_->close(err);
     }
@@ -261,6 +264,11 @@ void TcpSession::AsyncWriteHandler(TcpSessionPtr session,
     }
 }
 
+void TcpSession::SetWriteCoalesceWindow(size_t bytes) {
+    mutex::scoped_lock lock(mutex_);
+    writer_->set_coalesce_window(bytes);
+}
+
 bool TcpSession::Send(const u_int8_t *data, size_t size, size_t *sent) {
     bool ret = true;
     mutex::scoped_lock lock(mutex_);
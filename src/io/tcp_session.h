@@ -36,6 +36,9 @@ class TcpMessageWriter;
 class TcpSession {
   public:
     static const int kDefaultBufferSize = 4 * 1024;
+    // Coalescing window used by sessions that send bursts of small
+    // messages. See TcpMessageWriter.
+    static const size_t kWriteCoalesceWindow = 16 * 1024;
 
     enum Event {
         EVENT_NONE,
@@ -59,6 +62,10 @@ class TcpSession {
     // Performs a non-blocking send operation.
     virtual bool Send(const u_int8_t *data, size_t size, size_t *sent);
 
+    // Messages smaller than the window may be held back and written along
+    // with later ones. The default of 0 writes every message right away.
+    void SetWriteCoalesceWindow(size_t bytes);
+
     // Called by TcpServer to trigger async read.
     virtual bool Connected(Endpoint remote);
     
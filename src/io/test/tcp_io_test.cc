@@ -315,6 +315,51 @@ TEST_F(EchoServerTest, SendAfterClose) {
     TASK_UTIL_ASSERT_NE(0, server_->GetSession()->GetTotal());
 }
 
+//
+// Small messages sent within the coalescing window are written together.
+// Messages still waiting for the window must be written out when the
+// session is closed.
+//
+TEST_F(EchoServerTest, WriteCoalesce) {
+    static const int kMessageCount = 1000;
+    server_->Initialize(0);
+    task_util::WaitForIdle();
+    thread_->Start();
+    int port = server_->GetPort();
+    ASSERT_LT(0, port);
+
+    client_->CreateSession();
+    client_->EchoServer::ConnectTest(port);
+    client_->SetSocketOptions();
+    TASK_UTIL_ASSERT_TRUE((server_->GetSession() != NULL));
+    TASK_UTIL_ASSERT_TRUE(client_->GetSession()->IsEstablished());
+
+    EchoSession *session = client_->GetSession();
+    session->SetWriteCoalesceWindow(TcpSession::kWriteCoalesceWindow);
+
+    char msg[64];
+    memset(msg, 0xcd, sizeof(msg));
+    for (int i = 0; i < kMessageCount; i++) {
+        EXPECT_TRUE(client_->Send((const u_int8_t *) msg, sizeof(msg), NULL));
+    }
+    int total = sizeof(msg) * kMessageCount;
+    TASK_UTIL_ASSERT_EQ(total, server_->GetSession()->GetTotal());
+
+    const TcpServer::SocketStats &stats = session->GetSocketStats();
+    EXPECT_EQ(uint64_t(kMessageCount), stats.write_calls);
+    EXPECT_EQ(uint64_t(total), stats.write_syscall_bytes);
+    EXPECT_LT(uint64_t(stats.write_syscalls), uint64_t(stats.write_calls));
+    TCP_UT_LOG_DEBUG("Write calls: " << stats.write_calls <<
+                     " system calls: " << stats.write_syscalls);
+
+    for (int i = 0; i < 4; i++) {
+        client_->Send((const u_int8_t *) msg, sizeof(msg), NULL);
+    }
+    session->Close();
+    total += sizeof(msg) * 4;
+    TASK_UTIL_ASSERT_EQ(total, server_->GetSession()->GetTotal());
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
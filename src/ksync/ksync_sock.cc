@@ -9,6 +9,7 @@
 #include <linux/genetlink.h>
 #include <linux/sockios.h>
 
+#include <algorithm>
 #include <boost/bind.hpp>
 
 #include <base/logging.h>
@@ -48,6 +49,7 @@ AgentSandeshContext *KSyncSock::agent_sandesh_ctx_;
 std::vector<KSyncSock *> KSyncSock::sock_table_;
 pid_t KSyncSock::pid_;
 tbb::atomic<bool> KSyncSock::shutdown_;
+size_t KSyncSock::tx_batch_size_ = KSyncSock::kBufLen;
 
 const char* IoContext::io_wq_names[IoContext::MAX_WORK_QUEUES] = 
                                                 {"Agent::KSync", "Agent::Uve"};
@@ -129,34 +131,51 @@ bool KSyncSockNetlink::Validate(char *data) {
     return true;
 }
 
-//netlink socket class for interacting with kernel
-void KSyncSockNetlink::AsyncSendTo(IoContext *ioc, mutable_buffers_1 buf,
-                                   HandlerCb cb) {
+// Netlink messages in a buffer are processed one after the other by the
+// kernel, so a batch is written with a single send
+size_t KSyncSockNetlink::Encode(char *buf, size_t buf_len, uint32_t seqno,
+                                const char *msg, size_t msg_len) {
     struct nl_client cl;
     unsigned char *nl_buf;
     uint32_t nl_buf_len;
     int ret;
-    std::vector<mutable_buffers_1> iovec;
 
     nl_init_generic_client_req(&cl, GetNetlinkFamilyId());
 
     if ((ret = nl_build_header(&cl, &nl_buf, &nl_buf_len)) < 0) {
         LOG(ERROR, "Error creating netlink message. Error : " << ret);
         free(cl.cl_buf);
-        return;
+        assert(0);
     }
 
-    iovec.push_back(buffer(cl.cl_buf, cl.cl_buf_offset));
-    iovec.push_back(buf);
+    uint32_t hdr_len = cl.cl_buf_offset;
+    if (NLMSG_ALIGN(hdr_len + msg_len) > buf_len) {
+        free(cl.cl_buf);
+        return 0;
+    }
 
-    nl_update_header(&cl, buffer_size(buf));
+    nl_update_header(&cl, msg_len);
     struct nlmsghdr *nlh = (struct nlmsghdr *)cl.cl_buf;
     nlh->nlmsg_pid = KSyncSock::GetPid();
-    nlh->nlmsg_seq = ioc->GetSeqno();
+    nlh->nlmsg_seq = seqno;
 
-    boost::asio::netlink::raw::endpoint ep;
-    sock_.async_send_to(iovec, ep, cb);
+    memcpy(buf, cl.cl_buf, hdr_len);
+    memcpy(buf + hdr_len, msg, msg_len);
+    size_t len = NLMSG_ALIGN(hdr_len + msg_len);
+    memset(buf + hdr_len + msg_len, 0, len - (hdr_len + msg_len));
     free(cl.cl_buf);
+    return len;
+}
+
+size_t KSyncSockNetlink::EncodeMsg(char *buf, size_t buf_len, uint32_t seqno,
+                                   const char *msg, size_t msg_len) {
+    return Encode(buf, buf_len, seqno, msg, msg_len);
+}
+
+//netlink socket class for interacting with kernel
+void KSyncSockNetlink::AsyncSendTo(mutable_buffers_1 buf, HandlerCb cb) {
+    boost::asio::netlink::raw::endpoint ep;
+    sock_.async_send_to(buf, ep, cb);
 }
 
 size_t KSyncSockNetlink::SendTo(const_buffers_1 buf) {
@@ -240,18 +259,24 @@ bool KSyncSockUdp::Validate(char *data) {
     return true;
 }
 
-void KSyncSockUdp::AsyncSendTo(IoContext *ioc, mutable_buffers_1 buf,
-                               HandlerCb cb) {
+size_t KSyncSockUdp::EncodeMsg(char *buf, size_t buf_len, uint32_t seqno,
+                               const char *msg, size_t msg_len) {
     struct uvr_msg_hdr hdr;
-    std::vector<mutable_buffers_1> iovec;
-    hdr.seq_no = ioc->GetSeqno();
+    if (sizeof(hdr) + msg_len > buf_len) {
+        return 0;
+    }
+
+    hdr.seq_no = seqno;
     hdr.flags = 0;
-    hdr.msg_len = buffer_size(buf);
+    hdr.msg_len = msg_len;
 
-    iovec.push_back(buffer((char *)(&hdr), sizeof(hdr)));
-    iovec.push_back(buf);
+    memcpy(buf, &hdr, sizeof(hdr));
+    memcpy(buf + sizeof(hdr), msg, msg_len);
+    return sizeof(hdr) + msg_len;
+}
 
-    sock_.async_send_to(iovec, server_ep_, cb);
+void KSyncSockUdp::AsyncSendTo(mutable_buffers_1 buf, HandlerCb cb) {
+    sock_.async_send_to(buf, server_ep_, cb);
 }
 
 size_t KSyncSockUdp::SendTo(const_buffers_1 buf) {
@@ -278,13 +303,23 @@ void KSyncSockUdp::Receive(mutable_buffers_1 buf) {
     sock_.receive_from(buf, ep);
 }
 
-KSyncSock::KSyncSock() : tx_count_(0), err_count_(0) {
+KSyncSock::KSyncSock()
+    : tx_buff_(NULL), tx_buff_size_(0), tx_buff_len_(0), tx_batch_count_(0),
+      tx_count_(0), tx_send_count_(0), tx_max_batch_(0), ack_count_(0),
+      err_count_(0) {
     for(int i = 0; i < IoContext::MAX_WORK_QUEUES; i++) {
         work_queue_[i] = new WorkQueue<char *>(TaskScheduler::GetInstance()->
                              GetTaskId(IoContext::io_wq_names[i]), 0,
                              boost::bind(&KSyncSock::ProcessKernelData, this, 
                                          _1));
     }
+    // No instance, so that sockets of different partitions send in
+    // parallel. Runners of the queue may then overlap while one of them is
+    // finishing, so the batch is only touched from the queue callback.
+    tx_queue_ = new WorkQueue<IoContext *>(TaskScheduler::GetInstance()->
+                    GetTaskId("Agent::KSyncTx"), -1,
+                    boost::bind(&KSyncSock::AddToBatch, this, _1), 0,
+                    kTxMaxIterations);
     rx_buff_ = NULL;
     seqno_ = 0;
 }
@@ -297,6 +332,10 @@ KSyncSock::~KSyncSock() {
         rx_buff_ = NULL;
     }
 
+    tx_queue_->Shutdown();
+    delete tx_queue_;
+    delete [] tx_buff_;
+
     for(int i = 0; i < IoContext::MAX_WORK_QUEUES; i++) {
         work_queue_[i]->Shutdown();
         delete work_queue_[i];
@@ -411,9 +450,10 @@ bool KSyncSock::ProcessKernelData(char *data) {
     return true;
 }
     
-// Write handler registered with boost::asio
-void KSyncSock::WriteHandler(const boost::system::error_code& error,
+// Write handler registered with boost::asio. Frees the batch written
+void KSyncSock::WriteHandler(char *buff, const boost::system::error_code& error,
                              size_t bytes_transferred) {
+    delete [] buff;
     if (error) {
         LOG(ERROR, "Ksync sock write error : " <<
             boost::system::system_error(error).what());
@@ -478,8 +518,64 @@ void KSyncSock::SendAsyncImpl(int msg_len, char *msg,
         wait_tree_.insert(*ioc);
     }
 
-    AsyncSendTo(ioc, buffer(msg, msg_len),
-                boost::bind(&KSyncSock::WriteHandler, this,
+    tx_queue_->Enqueue(ioc);
+}
+
+// Copy the message into the current batch. The context is in wait_tree_ and
+// may be released by its response once the batch is sent, so it isn't
+// accessed after this.
+//
+// The batch is sent once the queue is found empty. Only the runner dequeues,
+// so a message left in the batch means the queue still holds one for this
+// runner, which keeps running until it sees the queue empty.
+bool KSyncSock::AddToBatch(IoContext *ioc) {
+    size_t len = 0;
+    if (tx_buff_ != NULL) {
+        len = EncodeMsg(tx_buff_ + tx_buff_len_, tx_buff_size_ - tx_buff_len_,
+                        ioc->GetSeqno(), ioc->msg_, ioc->msg_len_);
+        if (len == 0) {
+            SendBatch();
+        }
+    }
+
+    if (tx_buff_ == NULL) {
+        tx_buff_size_ = std::max(tx_batch_size_,
+                                 (size_t)ioc->msg_len_ + kMsgHdrLen);
+        tx_buff_ = new char[tx_buff_size_];
+        tx_buff_len_ = 0;
+        len = EncodeMsg(tx_buff_, tx_buff_size_, ioc->GetSeqno(), ioc->msg_,
+                        ioc->msg_len_);
+        assert(len != 0);
+    }
+
+    tx_buff_len_ += len;
+    tx_batch_count_++;
+    if (IsBatchSupported() == false || tx_batch_size_ == 0 ||
+        tx_queue_->IsQueueEmpty()) {
+        SendBatch();
+    }
+    return true;
+}
+
+void KSyncSock::SendBatch() {
+    if (tx_buff_ == NULL) {
+        return;
+    }
+
+    tx_count_ += tx_batch_count_;
+    tx_send_count_++;
+    if (tx_batch_count_ > tx_max_batch_) {
+        tx_max_batch_ = tx_batch_count_;
+    }
+
+    char *buff = tx_buff_;
+    size_t len = tx_buff_len_;
+    tx_buff_ = NULL;
+    tx_buff_size_ = 0;
+    tx_buff_len_ = 0;
+    tx_batch_count_ = 0;
+    AsyncSendTo(buffer(buff, len),
+                boost::bind(&KSyncSock::WriteHandler, this, buff,
                             placeholders::error,
                             placeholders::bytes_transferred));
 }
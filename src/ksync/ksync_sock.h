@@ -120,6 +120,10 @@ class KSyncSock {
 public:
     const static int kMsgGrowSize = 16;
     const static unsigned kBufLen = 4096;
+    // Room for the transport header of a message in a batch
+    const static unsigned kMsgHdrLen = 64;
+    // Messages batched by one run of the transmit queue
+    const static size_t kTxMaxIterations = 1024;
 
     typedef boost::function<void(const boost::system::error_code &, size_t)> HandlerCb;
     KSyncSock();
@@ -152,6 +156,17 @@ public:
         agent_sandesh_ctx_ = ctx;
     }
     virtual void Decoder(char *data, SandeshContext *ctxt) = 0;
+
+    // Messages are batched into a buffer of up to tx_batch_size bytes, and
+    // each batch is written in one send. A size of 0 sends every message
+    // on its own.
+    static size_t GetTxBatchSize() {return tx_batch_size_;};
+    static void SetTxBatchSize(size_t size) {tx_batch_size_ = size;};
+
+    // Messages written, and the number of sends they took
+    uint64_t tx_msg_count() const {return tx_count_;};
+    uint64_t tx_send_count() const {return tx_send_count_;};
+    uint32_t tx_max_batch() const {return tx_max_batch_;};
 protected:
     static void Init(int count);
     static void SetSockTableEntry(int i, KSyncSock *sock);
@@ -166,7 +181,7 @@ private:
                      size_t bytes_transferred);
 
     // Write handler registered with boost::asio. Demux done based on seqno_
-    void WriteHandler(const boost::system::error_code& error,
+    void WriteHandler(char *buff, const boost::system::error_code& error,
                       size_t bytes_transferred);
 
     bool ProcessKernelData(char *data);
@@ -174,9 +189,20 @@ private:
     bool ValidateAndEnqueue(char *data);
     void SendAsyncImpl(int msg_len, char *msg, IoContext *ioc);
 
+    // Transmit queue callback. Messages are added to the current batch,
+    // which is sent when full and when the queue is drained.
+    bool AddToBatch(IoContext *ioc);
+    void SendBatch();
+
     virtual void AsyncReceive(boost::asio::mutable_buffers_1, HandlerCb) = 0;
-    virtual void AsyncSendTo(IoContext *, boost::asio::mutable_buffers_1,
-                             HandlerCb) = 0;
+    // Write a batch of messages encoded by EncodeMsg
+    virtual void AsyncSendTo(boost::asio::mutable_buffers_1, HandlerCb) = 0;
+    // Encode a message with its transport header into buf. Returns the
+    // length of the encoded message, or 0 if it doesn't fit in buf_len.
+    virtual size_t EncodeMsg(char *buf, size_t buf_len, uint32_t seqno,
+                             const char *msg, size_t msg_len) = 0;
+    // Whether the other end accepts more than one message in a send
+    virtual bool IsBatchSupported() const {return true;};
     virtual std::size_t SendTo(boost::asio::const_buffers_1) = 0;
     virtual void Receive(boost::asio::mutable_buffers_1) = 0;
 
@@ -189,12 +215,23 @@ private:
     static int vnsw_netlink_family_id_;
     static AgentSandeshContext *agent_sandesh_ctx_;
     static tbb::atomic<bool> shutdown_;
+    static size_t tx_batch_size_;
 
     char *rx_buff_;
     tbb::atomic<int> seqno_;
 
+    // Messages pending transmit, and the batch being filled from them. The
+    // batch is only accessed from the transmit queue task.
+    WorkQueue<IoContext *> *tx_queue_;
+    char *tx_buff_;
+    size_t tx_buff_size_;
+    size_t tx_buff_len_;
+    uint32_t tx_batch_count_;
+
     // Debug stats
-    int tx_count_;
+    uint64_t tx_count_;
+    uint64_t tx_send_count_;
+    uint32_t tx_max_batch_;
     int ack_count_;
     int err_count_;
 
@@ -213,10 +250,16 @@ public:
     virtual void Decoder(char *data, SandeshContext *ctxt);
     virtual bool Validate(char *data);
     virtual void AsyncReceive(boost::asio::mutable_buffers_1, HandlerCb);
-    virtual void AsyncSendTo(IoContext *, boost::asio::mutable_buffers_1,
-                             HandlerCb);
+    virtual void AsyncSendTo(boost::asio::mutable_buffers_1, HandlerCb);
+    virtual size_t EncodeMsg(char *buf, size_t buf_len, uint32_t seqno,
+                             const char *msg, size_t msg_len);
     virtual std::size_t SendTo(boost::asio::const_buffers_1);
     virtual void Receive(boost::asio::mutable_buffers_1);
+
+    // Encode msg as a generic netlink message, padded for the next message
+    // of a batch
+    static size_t Encode(char *buf, size_t buf_len, uint32_t seqno,
+                         const char *msg, size_t msg_len);
 private:
     boost::asio::netlink::raw::socket sock_;
 };
@@ -233,8 +276,11 @@ public:
     virtual void Decoder(char *data, SandeshContext *ctxt);
     virtual bool Validate(char *data);
     virtual void AsyncReceive(boost::asio::mutable_buffers_1, HandlerCb);
-    virtual void AsyncSendTo(IoContext *, boost::asio::mutable_buffers_1,
-                             HandlerCb);
+    virtual void AsyncSendTo(boost::asio::mutable_buffers_1, HandlerCb);
+    virtual size_t EncodeMsg(char *buf, size_t buf_len, uint32_t seqno,
+                             const char *msg, size_t msg_len);
+    // User space vrouter takes one message per datagram
+    virtual bool IsBatchSupported() const {return false;};
     virtual std::size_t SendTo(boost::asio::const_buffers_1);
     virtual void Receive(boost::asio::mutable_buffers_1);
 private:
@@ -9,6 +9,7 @@
 #include <linux/genetlink.h>
 #include <linux/sockios.h>
 
+#include <algorithm>
 #include <boost/bind.hpp>
 
 #include <base/logging.h>
@@ -296,17 +297,36 @@ bool KSyncSockTypeMap::Validate(char *data) {
     return true;
 }
 
-//send or store in map
-void KSyncSockTypeMap::AsyncSendTo(IoContext *ioc, mutable_buffers_1 buf,
-                                   HandlerCb cb) {
-    KSyncUserSockContext ctx(true, ioc->GetSeqno());
-    //parse and store info in map [done in Process() callbacks]
-    ProcessSandesh(buffer_cast<const uint8_t *>(buf), buffer_size(buf), &ctx);
+//messages are batched the same way as for the kernel
+size_t KSyncSockTypeMap::EncodeMsg(char *buf, size_t buf_len, uint32_t seqno,
+                                   const char *msg, size_t msg_len) {
+    return KSyncSockNetlink::Encode(buf, buf_len, seqno, msg, msg_len);
+}
 
-    if (ctx.IsResponseReqd()) {
-        //simulate ok response with the same seq
-        SimulateResponse(ioc->GetSeqno(), 0, 0); 
+//send or store in map, responding to each message of a batch on its seq
+void KSyncSockTypeMap::AsyncSendTo(mutable_buffers_1 buf, HandlerCb cb) {
+    char *data = buffer_cast<char *>(buf);
+    size_t len = buffer_size(buf);
+    while (len >= NLMSG_HDRLEN) {
+        struct nlmsghdr *nlh = (struct nlmsghdr *)data;
+        uint32_t hdr_len = NLMSG_HDRLEN + GENL_HDRLEN + NLA_HDRLEN;
+        assert(nlh->nlmsg_len >= hdr_len && nlh->nlmsg_len <= len);
+
+        KSyncUserSockContext ctx(true, nlh->nlmsg_seq);
+        //parse and store info in map [done in Process() callbacks]
+        ProcessSandesh((const uint8_t *)(data + hdr_len),
+                       nlh->nlmsg_len - hdr_len, &ctx);
+
+        if (ctx.IsResponseReqd()) {
+            //simulate ok response with the same seq
+            SimulateResponse(nlh->nlmsg_seq, 0, 0); 
+        }
+
+        size_t msg_len = std::min((size_t)NLMSG_ALIGN(nlh->nlmsg_len), len);
+        data += msg_len;
+        len -= msg_len;
     }
+    cb(boost::system::error_code(), buffer_size(buf));
 }
 
 //send or store in map
@@ -119,8 +119,9 @@ public:
     virtual void Decoder(char *data, SandeshContext *ctxt);
     virtual bool Validate(char *data);
     virtual void AsyncReceive(boost::asio::mutable_buffers_1, HandlerCb);
-    virtual void AsyncSendTo(IoContext *, boost::asio::mutable_buffers_1,
-                             HandlerCb);
+    virtual void AsyncSendTo(boost::asio::mutable_buffers_1, HandlerCb);
+    virtual size_t EncodeMsg(char *buf, size_t buf_len, uint32_t seqno,
+                             const char *msg, size_t msg_len);
     virtual std::size_t SendTo(boost::asio::const_buffers_1);
     virtual void Receive(boost::asio::mutable_buffers_1);
 
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/test/task_test_util.h"
+#include "testing/gunit.h"
+
+#include "ksync/ksync_entry.h"
+#include "ksync/ksync_sock.h"
+
+using namespace std;
+using boost::asio::buffer_cast;
+using boost::asio::buffer_size;
+
+// Socket that acks every message it is sent, and checks that the batch is
+// never encoded or written from two tasks at once.
+class TestSock : public KSyncSock {
+public:
+    struct MsgHdr {
+        uint32_t seqno;
+        uint32_t len;
+    };
+
+    TestSock() {
+        active_ = 0;
+        overlap_ = 0;
+        acked_ = 0;
+    }
+
+    int overlap() const {return overlap_;};
+    int acked() const {return acked_;};
+    const set<uint32_t> &seqnos() const {return seqnos_;};
+
+private:
+    void Enter() {
+        if (active_.fetch_and_increment() != 0) {
+            overlap_++;
+        }
+    }
+    void Exit() {
+        active_--;
+    }
+
+    virtual size_t EncodeMsg(char *buf, size_t buf_len, uint32_t seqno,
+                             const char *msg, size_t msg_len) {
+        Enter();
+        size_t len = 0;
+        if (sizeof(MsgHdr) + msg_len <= buf_len) {
+            MsgHdr hdr;
+            hdr.seqno = seqno;
+            hdr.len = msg_len;
+            memcpy(buf, &hdr, sizeof(hdr));
+            memcpy(buf + sizeof(hdr), msg, msg_len);
+            len = sizeof(hdr) + msg_len;
+        }
+        Exit();
+        return len;
+    }
+
+    virtual void AsyncSendTo(boost::asio::mutable_buffers_1 buf,
+                             HandlerCb cb) {
+        Enter();
+        char *data = buffer_cast<char *>(buf);
+        size_t len = buffer_size(buf);
+        while (len > 0) {
+            MsgHdr *hdr = (MsgHdr *)data;
+            IoContext key(NULL, 0, hdr->seqno, NULL);
+            IoContext *ioc = NULL;
+            {
+                tbb::mutex::scoped_lock lock(mutex_);
+                Tree::iterator it = wait_tree_.find(key);
+                assert(it != wait_tree_.end());
+                ioc = &(*it);
+                wait_tree_.erase(it);
+                seqnos_.insert(hdr->seqno);
+            }
+            delete ioc;
+            acked_++;
+            data += sizeof(MsgHdr) + hdr->len;
+            len -= sizeof(MsgHdr) + hdr->len;
+        }
+        Exit();
+        cb(boost::system::error_code(), buffer_size(buf));
+    }
+
+    virtual uint32_t GetSeqno(char *data) {return 0;};
+    virtual bool IsMoreData(char *data) {return false;};
+    virtual void Decoder(char *data, SandeshContext *ctxt) {};
+    virtual bool Validate(char *data) {return true;};
+    virtual void AsyncReceive(boost::asio::mutable_buffers_1, HandlerCb) {};
+    virtual std::size_t SendTo(boost::asio::const_buffers_1) {return 0;};
+    virtual void Receive(boost::asio::mutable_buffers_1) {};
+
+    tbb::atomic<int> active_;
+    tbb::atomic<int> overlap_;
+    tbb::atomic<int> acked_;
+    set<uint32_t> seqnos_;
+};
+
+// Sends messages from its own task, so that senders run in parallel
+class SendTask : public Task {
+public:
+    SendTask(int task_id, TestSock *sock, tbb::atomic<uint32_t> *seqno,
+             int count)
+        : Task(task_id), sock_(sock), seqno_(seqno), count_(count) {
+    }
+
+    virtual bool Run() {
+        for (int i = 0; i < count_; i++) {
+            char *msg = (char *)malloc(64);
+            memset(msg, 0, 64);
+            int len = 16 + (i % 48);
+            sock_->GenericSend(len, msg,
+                               new IoContext(msg, len, (*seqno_)++, NULL));
+        }
+        return true;
+    }
+
+private:
+    TestSock *sock_;
+    tbb::atomic<uint32_t> *seqno_;
+    int count_;
+};
+
+class KSyncSockTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        sock_ = new TestSock();
+        seqno_ = 0;
+    }
+
+    virtual void TearDown() {
+        task_util::WaitForIdle();
+        delete sock_;
+        KSyncSock::SetTxBatchSize(KSyncSock::kBufLen);
+    }
+
+    void SendFromTasks(int tasks, int count) {
+        TaskScheduler *scheduler = TaskScheduler::GetInstance();
+        for (int i = 0; i < tasks; i++) {
+            ostringstream name;
+            name << "KSyncSockTest::Send" << i;
+            scheduler->Enqueue(new SendTask(scheduler->GetTaskId(name.str()),
+                                            sock_, &seqno_, count));
+        }
+        task_util::WaitForIdle();
+    }
+
+    TestSock *sock_;
+    tbb::atomic<uint32_t> seqno_;
+};
+
+TEST_F(KSyncSockTest, Basic) {
+    SendFromTasks(1, 1);
+    EXPECT_EQ(1, sock_->acked());
+    EXPECT_EQ(1U, sock_->tx_msg_count());
+    EXPECT_EQ(1U, sock_->tx_send_count());
+}
+
+TEST_F(KSyncSockTest, Unbatched) {
+    KSyncSock::SetTxBatchSize(0);
+    SendFromTasks(1, 100);
+    EXPECT_EQ(100, sock_->acked());
+    EXPECT_EQ(100U, sock_->tx_send_count());
+    EXPECT_EQ(1U, sock_->tx_max_batch());
+}
+
+// Senders on several tasks race with the transmit queue runner starting and
+// finishing. Every message must be sent once, with the batch only ever used
+// by one runner.
+TEST_F(KSyncSockTest, ParallelSend) {
+    const int kTasks = 8;
+    const int kCount = 10000;
+    SendFromTasks(kTasks, kCount);
+    EXPECT_EQ(0, sock_->overlap());
+    EXPECT_EQ(kTasks * kCount, sock_->acked());
+    EXPECT_EQ((size_t)(kTasks * kCount), sock_->seqnos().size());
+    EXPECT_EQ((uint64_t)(kTasks * kCount), sock_->tx_msg_count());
+    EXPECT_TRUE(sock_->tx_send_count() <= sock_->tx_msg_count());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    LoggingInit();
+    return RUN_ALL_TESTS();
+}
@@ -35,6 +35,9 @@ std::string BgpAf::ToString(uint8_t afi, uint16_t safi) {
         case Vpn:
             out << "Vpn";
             break;
+        case RTarget:
+            out << "RTarget";
+            break;
         case Enet:
             out << "Enet";
             break;
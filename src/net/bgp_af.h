@@ -20,6 +20,7 @@ public:
         McastVpn = 5,
         EVpn = 70,
         Vpn = 128,
+        RTarget = 132,
         Mcast = 241,
         Enet = 242,
     };
@@ -106,6 +106,7 @@ DBEntry *AclTable::Add(const DBRequest *req) {
          ++it) {
         acl->AddAclEntry(*it, acl->acl_entries_);
     }
+    acl->CompileAclEntries();
     return acl;
 }
 
@@ -115,6 +116,7 @@ bool AclTable::OnChange(DBEntry *entry, const DBRequest *req) {
 
     if (data->ace_id_to_del_) {
         acl->DeleteAclEntry(data->ace_id_to_del_);
+        acl->CompileAclEntries();
         return true;
     }
 
@@ -137,6 +139,7 @@ bool AclTable::OnChange(DBEntry *entry, const DBRequest *req) {
         acl->DeleteAllAclEntries();
         acl->SetAclEntries(entries);
     }
+    acl->CompileAclEntries();
     return true;
 }
 
@@ -540,6 +543,7 @@ void AclDBEntry::SetAclEntries(AclEntries &entries)
         entries.erase(tmp);
         acl_entries_.insert(acl_entries_.end(), *ae);
     }
+    classifier_.Clear();
 }
 
 AclEntry *AclDBEntry::AddAclEntry(const AclEntrySpec &acl_entry_spec, AclEntries &entries)
@@ -584,6 +588,9 @@ AclEntry *AclDBEntry::AddAclEntry(const AclEntrySpec &acl_entry_spec, AclEntries
         }
     }
     entries.insert(iter, *entry);
+    if (&entries == &acl_entries_) {
+        classifier_.Clear();
+    }
     ACL_TRACE(Info, "acl entry " + integerToString(acl_entry_spec.id) + " added");
     return entry;
 }
@@ -596,6 +603,7 @@ bool AclDBEntry::DeleteAclEntry(const uint32_t acl_entry_id)
         if (acl_entry_id == iter->id()) {
             AclEntry *ae = iter.operator->();
             acl_entries_.erase(acl_entries_.iterator_to(*iter));
+            classifier_.Clear();
             ACL_TRACE(Info, "acl entry " + integerToString(acl_entry_id) + " deleted");
             delete ae;
             return true;
@@ -607,6 +615,7 @@ bool AclDBEntry::DeleteAclEntry(const uint32_t acl_entry_id)
 
 void AclDBEntry::DeleteAllAclEntries()
 {
+    classifier_.Clear();
     AclEntries::iterator iter;
     iter = acl_entries_.begin();
     while (iter != acl_entries_.end()) {
@@ -617,37 +626,70 @@ void AclDBEntry::DeleteAllAclEntries()
     return;
 }
 
+void AclDBEntry::CompileAclEntries()
+{
+    AclClassifier::EntryList entries;
+    AclEntries::const_iterator iter;
+    for (iter = acl_entries_.begin(); iter != acl_entries_.end(); ++iter) {
+        entries.push_back(iter.operator->());
+    }
+    if (!classifier_.Compile(entries)) {
+        ACL_TRACE(Info, "acl " + UuidToString(uuid_) + " with " +
+                  integerToString(entries.size()) + " entries not compiled");
+    }
+}
+
+// Accumulate the actions of an entry that matched the packet
+void AclDBEntry::AddMatchedEntry(const AclEntry *entry, MatchAclParams &m_acl)
+{
+    const AclEntry::ActionList &al = entry->Actions();
+    AclEntry::ActionList::const_iterator al_it;
+    for (al_it = al.begin(); al_it != al.end(); ++al_it) {
+        TrafficAction *ta = static_cast<TrafficAction *>(*al_it.operator->());
+        m_acl.action_info.action |= 1 << ta->GetAction();
+        if (ta->GetActionType() == TrafficAction::MIRROR_ACTION) {
+            MirrorAction *a = static_cast<MirrorAction *>(*al_it.operator->());
+            MirrorActionSpec as;
+            as.ip = a->GetIp();
+            as.port = a->GetPort();
+            as.vrf_name = a->GetVrfName();
+            as.analyzer_name = a->GetAnalyzerName();
+            as.encap = a->GetEncap();
+            m_acl.action_info.mirror_l.push_back(as);
+        }
+    }
+    m_acl.ace_id_list.push_back((int32_t)(entry->id()));
+    if (entry->IsTerminal()) {
+        m_acl.terminal_rule = true;
+    }
+}
+
 bool AclDBEntry::PacketMatch(const PacketHeader &packet_header, 
 			     MatchAclParams &m_acl) const
 {
+    m_acl.terminal_rule = false;
+    m_acl.action_info.action = 0;
+
+    if (classifier_.compiled()) {
+        AclClassifier::EntryList matches;
+        classifier_.Match(packet_header, &matches);
+        AclClassifier::EntryList::const_iterator it;
+        for (it = matches.begin(); it != matches.end(); ++it) {
+            AddMatchedEntry(*it, m_acl);
+        }
+        return !matches.empty();
+    }
+
     AclEntries::const_iterator iter;
     bool ret_val = false;
-    m_acl.terminal_rule = false;
-	m_acl.action_info.action = 0;
     for (iter = acl_entries_.begin();
          iter != acl_entries_.end();
          ++iter) {
         const AclEntry::ActionList &al = iter->PacketMatch(packet_header);
-	AclEntry::ActionList::const_iterator al_it;
-	for (al_it = al.begin(); al_it != al.end(); ++al_it) {
-	     TrafficAction *ta = static_cast<TrafficAction *>(*al_it.operator->());
-	     m_acl.action_info.action |= 1 << ta->GetAction();
-	     if (ta->GetActionType() == TrafficAction::MIRROR_ACTION) {
-	         MirrorAction *a = static_cast<MirrorAction *>(*al_it.operator->());
-                 MirrorActionSpec as;
-		 as.ip = a->GetIp();
-		 as.port = a->GetPort();
-                 as.vrf_name = a->GetVrfName();
-                 as.analyzer_name = a->GetAnalyzerName();
-                 as.encap = a->GetEncap();
-                 m_acl.action_info.mirror_l.push_back(as);
-	     }
-	}
         if (!(al.empty())) {
             ret_val = true;
-            m_acl.ace_id_list.push_back((int32_t)(iter->id()));
+            AddMatchedEntry(iter.operator->(), m_acl);
             if (iter->IsTerminal()) {
-	        m_acl.terminal_rule = true;
                 return ret_val;
             }
         }
@@ -7,6 +7,7 @@
 
 #include "vnsw/agent/filter/acl_entry.h"
 #include "vnsw/agent/filter/acl_entry_spec.h"
+#include "vnsw/agent/filter/acl_classifier.h"
 
 #include <boost/intrusive/list.hpp>
 #include <boost/uuid/uuid.hpp>
@@ -124,15 +125,23 @@ public:
     void SetDynamicAcl(bool dyn) {dynamic_acl_ = dyn;};
     bool GetDynamicAcl () const {return dynamic_acl_;};
 
+    // Compile the entries into the classifier used by PacketMatch. Any
+    // change to the entries reverts PacketMatch to walking them in order
+    // until they are compiled again.
+    void CompileAclEntries();
+    bool IsCompiled() const {return classifier_.compiled();};
+
     // Packet Match
     bool PacketMatch(const PacketHeader &packet_header, 
 		     MatchAclParams &m_acl) const;
 private:
     friend class AclTable;
+    static void AddMatchedEntry(const AclEntry *entry, MatchAclParams &m_acl);
     uuid uuid_;
     bool dynamic_acl_;
     std::string name_;
     AclEntries acl_entries_;
+    AclClassifier classifier_;
     DISALLOW_COPY_AND_ASSIGN(AclDBEntry);
 };
 
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "vnsw/agent/filter/acl_classifier.h"
+
+#include <algorithm>
+#include "vnsw/agent/filter/packet_header.h"
+
+static const size_t kBitsPerWord = 64;
+
+static inline void SetBit(uint64_t *bits, size_t index) {
+    bits[index / kBitsPerWord] |= (1ULL << (index % kBitsPerWord));
+}
+
+void AclClassifier::RangeField::Init(size_t words) {
+    words_ = words;
+    ranges_.clear();
+    wildcard_.assign(words, 0);
+    starts_.clear();
+    bits_.clear();
+}
+
+void AclClassifier::RangeField::Add(size_t index, uint32_t min,
+                                    uint32_t max) {
+    if (min > max)
+        return;
+    EntryRange range;
+    range.index = index;
+    range.min = min;
+    range.max = max;
+    ranges_.push_back(range);
+}
+
+void AclClassifier::RangeField::AddWildcard(size_t index) {
+    SetBit(&wildcard_[0], index);
+}
+
+//
+// Split the value space at the bounds of all the ranges and mark each entry
+// in the intervals covered by its ranges. Bounds are kept as 64 bit values
+// since the end of a range may be one past the largest 32 bit value.
+//
+void AclClassifier::RangeField::Build() {
+    starts_.push_back(0);
+    for (std::vector<EntryRange>::const_iterator it = ranges_.begin();
+         it != ranges_.end(); ++it) {
+        starts_.push_back(it->min);
+        starts_.push_back(uint64_t(it->max) + 1);
+    }
+    std::sort(starts_.begin(), starts_.end());
+    starts_.erase(std::unique(starts_.begin(), starts_.end()), starts_.end());
+    if (starts_.back() > 0xFFFFFFFFULL)
+        starts_.pop_back();
+
+    bits_.resize(starts_.size() * words_);
+    for (size_t idx = 0; idx < starts_.size(); ++idx) {
+        std::copy(wildcard_.begin(), wildcard_.end(),
+                  bits_.begin() + idx * words_);
+    }
+    for (std::vector<EntryRange>::const_iterator it = ranges_.begin();
+         it != ranges_.end(); ++it) {
+        size_t first = std::lower_bound(starts_.begin(), starts_.end(),
+                                        uint64_t(it->min)) - starts_.begin();
+        size_t last = std::upper_bound(starts_.begin(), starts_.end(),
+                                       uint64_t(it->max)) - starts_.begin();
+        for (size_t idx = first; idx < last; ++idx) {
+            SetBit(&bits_[idx * words_], it->index);
+        }
+    }
+    ranges_.clear();
+}
+
+const uint64_t *AclClassifier::RangeField::Lookup(uint32_t value) const {
+    size_t idx = std::upper_bound(starts_.begin(), starts_.end(),
+                                  uint64_t(value)) - starts_.begin() - 1;
+    return &bits_[idx * words_];
+}
+
+void AclClassifier::AddressField::Init(size_t words) {
+    words_ = words;
+    ip_.Init(words);
+    has_ip_ = false;
+    wildcard_.assign(words, 0);
+    networks_.clear();
+    sgs_.clear();
+    sg_any_.assign(words, 0);
+}
+
+AclClassifier::BitVector *AclClassifier::AddressField::Bits(BitVector *bits) {
+    if (bits->empty())
+        bits->assign(words_, 0);
+    return bits;
+}
+
+//
+// Mirrors AddressMatch::Match. An IP address matches if the masked packet
+// address equals it, so an address with bits outside of the mask never
+// matches, and a contiguous mask makes a range.
+//
+void AclClassifier::AddressField::Add(size_t index,
+                                      const AclMatchFields::Address &address,
+                                      bool *verify) {
+    if (!address.present || address.policy_id == "any") {
+        SetBit(&wildcard_[0], index);
+        return;
+    }
+
+    switch (address.type) {
+    case AddressMatch::IP_ADDR: {
+        if (!address.ip_addr.is_v4())
+            break;
+        if (!address.ip_mask.is_v4()) {
+            SetBit(&wildcard_[0], index);
+            *verify = true;
+            break;
+        }
+        uint32_t addr = address.ip_addr.to_v4().to_ulong();
+        uint32_t host_mask = ~address.ip_mask.to_v4().to_ulong();
+        if ((host_mask & (host_mask + 1)) != 0) {
+            SetBit(&wildcard_[0], index);
+            *verify = true;
+            break;
+        }
+        if ((addr & host_mask) != 0)
+            break;
+        ip_.Add(index, addr, addr | host_mask);
+        has_ip_ = true;
+        break;
+    }
+    case AddressMatch::NETWORK_ID: {
+        BitVector *bits = Bits(&networks_[address.policy_id]);
+        SetBit(&(*bits)[0], index);
+        break;
+    }
+    case AddressMatch::SG:
+        if (address.sg_id == AddressMatch::kAny) {
+            SetBit(&sg_any_[0], index);
+        } else {
+            BitVector *bits = Bits(&sgs_[address.sg_id]);
+            SetBit(&(*bits)[0], index);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void AclClassifier::AddressField::Build() {
+    ip_.Build();
+}
+
+void AclClassifier::AddressField::Lookup(uint32_t ip,
+                                         const std::string *policy_id,
+                                         const SecurityGroupList *sg_list,
+                                         uint64_t *result,
+                                         BitVector *scratch) const {
+    scratch->assign(wildcard_.begin(), wildcard_.end());
+    uint64_t *match = &(*scratch)[0];
+
+    if (has_ip_) {
+        const uint64_t *bits = ip_.Lookup(ip);
+        for (size_t idx = 0; idx < words_; ++idx) {
+            match[idx] |= bits[idx];
+        }
+    }
+
+    if (policy_id && !networks_.empty()) {
+        NetworkMap::const_iterator loc = networks_.find(*policy_id);
+        if (loc != networks_.end()) {
+            for (size_t idx = 0; idx < words_; ++idx) {
+                match[idx] |= loc->second[idx];
+            }
+        }
+    }
+
+    if (sg_list) {
+        for (size_t idx = 0; idx < words_; ++idx) {
+            match[idx] |= sg_any_[idx];
+        }
+    }
+
+    if (sg_list && !sgs_.empty()) {
+        for (SecurityGroupList::const_iterator it = sg_list->begin();
+             it != sg_list->end(); ++it) {
+            SgMap::const_iterator loc = sgs_.find(*it);
+            if (loc == sgs_.end())
+                continue;
+            for (size_t idx = 0; idx < words_; ++idx) {
+                match[idx] |= loc->second[idx];
+            }
+        }
+    }
+
+    for (size_t idx = 0; idx < words_; ++idx) {
+        result[idx] &= match[idx];
+    }
+}
+
+AclClassifier::AclClassifier() : compiled_(false), words_(0) {
+}
+
+AclClassifier::~AclClassifier() {
+}
+
+void AclClassifier::Clear() {
+    compiled_ = false;
+    words_ = 0;
+    entries_.clear();
+    verify_.clear();
+    protocol_.Init(0);
+    src_port_.Init(0);
+    dst_port_.Init(0);
+    src_addr_.Init(0);
+    dst_addr_.Init(0);
+}
+
+void AclClassifier::AddRanges(RangeField *field, size_t index, bool present,
+                              const AclMatchFields::RangeList &ranges) {
+    if (!present) {
+        field->AddWildcard(index);
+        return;
+    }
+    for (AclMatchFields::RangeList::const_iterator it = ranges.begin();
+         it != ranges.end(); ++it) {
+        field->Add(index, it->first, it->second);
+    }
+}
+
+bool AclClassifier::Compile(const EntryList &entries) {
+    Clear();
+
+    // Entries without actions never take effect.
+    for (EntryList::const_iterator it = entries.begin();
+         it != entries.end(); ++it) {
+        if (!(*it)->Actions().empty())
+            entries_.push_back(*it);
+    }
+    if (entries_.size() > kMaxEntries) {
+        entries_.clear();
+        return false;
+    }
+
+    words_ = (entries_.size() + kBitsPerWord - 1) / kBitsPerWord;
+    verify_.assign(entries_.size(), false);
+    protocol_.Init(words_);
+    src_port_.Init(words_);
+    dst_port_.Init(words_);
+    src_addr_.Init(words_);
+    dst_addr_.Init(words_);
+
+    for (size_t index = 0; index < entries_.size(); ++index) {
+        AclMatchFields fields;
+        entries_[index]->GetMatchFields(&fields);
+        AddRanges(&protocol_, index, fields.has_protocol, fields.protocol);
+        AddRanges(&src_port_, index, fields.has_src_port, fields.src_port);
+        AddRanges(&dst_port_, index, fields.has_dst_port, fields.dst_port);
+        bool verify = false;
+        src_addr_.Add(index, fields.src, &verify);
+        dst_addr_.Add(index, fields.dst, &verify);
+        verify_[index] = verify;
+    }
+
+    protocol_.Build();
+    src_port_.Build();
+    dst_port_.Build();
+    src_addr_.Build();
+    dst_addr_.Build();
+    compiled_ = true;
+    return true;
+}
+
+void AclClassifier::Match(const PacketHeader &packet_header,
+                          EntryList *matches) const {
+    if (entries_.empty())
+        return;
+
+    const uint64_t *protocol = protocol_.Lookup(packet_header.protocol);
+    const uint64_t *src_port = src_port_.Lookup(packet_header.src_port);
+    const uint64_t *dst_port = dst_port_.Lookup(packet_header.dst_port);
+    BitVector result(words_);
+    for (size_t idx = 0; idx < words_; ++idx) {
+        result[idx] = protocol[idx] & src_port[idx] & dst_port[idx];
+    }
+
+    BitVector scratch;
+    src_addr_.Lookup(packet_header.src_ip, packet_header.src_policy_id,
+                     packet_header.src_sg_id_l, &result[0], &scratch);
+    dst_addr_.Lookup(packet_header.dst_ip, packet_header.dst_policy_id,
+                     packet_header.dst_sg_id_l, &result[0], &scratch);
+
+    for (size_t word = 0; word < words_; ++word) {
+        uint64_t bits = result[word];
+        while (bits) {
+            size_t index = word * kBitsPerWord + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            const AclEntry *entry = entries_[index];
+            if (verify_[index] && entry->PacketMatch(packet_header).empty())
+                continue;
+            matches->push_back(entry);
+            if (entry->IsTerminal())
+                return;
+        }
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __AGENT_ACL_CLASSIFIER_H__
+#define __AGENT_ACL_CLASSIFIER_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include "vnsw/agent/filter/acl_entry.h"
+
+struct PacketHeader;
+
+//
+// Packet classifier for the entries of an ACL, compiled when the ACL
+// changes so that flow setup doesn't have to walk every entry.
+//
+// Each field of the packet header is looked up separately. The value space
+// of a field is split into the elementary intervals formed by the bounds of
+// all the entries, and each interval has a bit vector of the entries that
+// match it. The bit vectors for all the fields are ANDed, and the set bits
+// are the matching entries in order of evaluation, so the first terminal
+// entry still wins.
+//
+// Entries with a match that doesn't map onto intervals, e.g. an address
+// with a non-contiguous mask, are treated as wildcards for that field and
+// verified with AclEntry::PacketMatch when they are candidates.
+//
+class AclClassifier {
+public:
+    typedef std::vector<const AclEntry *> EntryList;
+
+    // Compiling takes time and memory quadratic in the number of entries,
+    // so larger ACLs are left to the linear walk.
+    static const size_t kMaxEntries = 4096;
+
+    AclClassifier();
+    ~AclClassifier();
+
+    // Compile the entries, which are given in order of evaluation. Returns
+    // false, leaving the classifier empty, if there are too many entries.
+    bool Compile(const EntryList &entries);
+    void Clear();
+
+    bool compiled() const { return compiled_; }
+    size_t size() const { return entries_.size(); }
+
+    // Append the entries that match the packet, in order of evaluation, up
+    // to and including the first terminal one.
+    void Match(const PacketHeader &packet_header, EntryList *matches) const;
+
+private:
+    typedef std::vector<uint64_t> BitVector;
+
+    class RangeField {
+    public:
+        RangeField() : words_(0) { }
+        void Init(size_t words);
+        void Add(size_t index, uint32_t min, uint32_t max);
+        void AddWildcard(size_t index);
+        void Build();
+        const uint64_t *Lookup(uint32_t value) const;
+
+    private:
+        struct EntryRange {
+            size_t index;
+            uint32_t min;
+            uint32_t max;
+        };
+
+        size_t words_;
+        std::vector<EntryRange> ranges_;
+        BitVector wildcard_;
+        std::vector<uint64_t> starts_;
+        BitVector bits_;
+    };
+
+    class AddressField {
+    public:
+        AddressField() : words_(0), has_ip_(false) { }
+        void Init(size_t words);
+        void Add(size_t index, const AclMatchFields::Address &address,
+                 bool *verify);
+        void Build();
+
+        // AND the entries that match the address into result, using
+        // scratch for the entries that match on any of its attributes.
+        void Lookup(uint32_t ip, const std::string *policy_id,
+                    const SecurityGroupList *sg_list, uint64_t *result,
+                    BitVector *scratch) const;
+
+    private:
+        typedef std::map<std::string, BitVector> NetworkMap;
+        typedef std::map<int, BitVector> SgMap;
+
+        BitVector *Bits(BitVector *bits);
+
+        size_t words_;
+        RangeField ip_;
+        bool has_ip_;
+        BitVector wildcard_;
+        NetworkMap networks_;
+        SgMap sgs_;
+        BitVector sg_any_;
+    };
+
+    void AddRanges(RangeField *field, size_t index, bool present,
+                   const AclMatchFields::RangeList &ranges);
+
+    bool compiled_;
+    size_t words_;
+    EntryList entries_;
+    std::vector<bool> verify_;
+    RangeField protocol_;
+    RangeField src_port_;
+    RangeField dst_port_;
+    AddressField src_addr_;
+    AddressField dst_addr_;
+
+    DISALLOW_COPY_AND_ASSIGN(AclClassifier);
+};
+
+#endif
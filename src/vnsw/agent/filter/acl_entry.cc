@@ -168,6 +168,13 @@ void AclEntry::SetAclEntrySandeshData(AclEntrySandeshData &data) const {
     data.ace_id = integerToString(id_);
 }
 
+void AclEntry::GetMatchFields(AclMatchFields *fields) const {
+    std::vector<AclEntryMatch *>::const_iterator it;
+    for (it = matches_.begin(); it != matches_.end(); it++) {
+        (*it)->GetMatchFields(fields);
+    }
+}
+
 bool AclEntry::IsTerminal() const
 {
     if (type_ == TERMINAL) {
@@ -310,6 +317,19 @@ void AddressMatch::SetAclEntryMatchSandeshData(AclEntrySandeshData &data)
 
 }
 
+void AddressMatch::GetMatchFields(AclMatchFields *fields) const
+{
+    AclMatchFields::Address *address = src_ ? &fields->src : &fields->dst;
+    address->present = true;
+    address->type = addr_type_;
+    address->ip_addr = ip_addr_;
+    address->ip_mask = ip_mask_;
+    address->policy_id = policy_id_s_;
+    if (addr_type_ == SG) {
+        address->sg_id = sg_id_;
+    }
+}
+
 void ProtocolMatch::SetProtocolRange(const uint16_t min_protocol, 
                                      const uint16_t max_protocol)
 {
@@ -343,6 +363,15 @@ void ProtocolMatch::SetAclEntryMatchSandeshData(AclEntrySandeshData &data)
 }
 
 
+void ProtocolMatch::GetMatchFields(AclMatchFields *fields) const
+{
+    fields->has_protocol = true;
+    for (RangeSList::const_iterator it = protocol_ranges_.begin();
+         it != protocol_ranges_.end(); it++) {
+        fields->protocol.push_back(std::make_pair((*it).min, (*it).max));
+    }
+}
+
 void PortMatch::SetPortRange(const uint16_t min_port, const uint16_t max_port)
 {
     Range *port_range = new Range(min_port, max_port);
@@ -375,6 +404,15 @@ void SrcPortMatch::SetAclEntryMatchSandeshData(AclEntrySandeshData &data)
 }
 
 
+void SrcPortMatch::GetMatchFields(AclMatchFields *fields) const
+{
+    fields->has_src_port = true;
+    for (RangeSList::const_iterator it = port_ranges_.begin();
+         it != port_ranges_.end(); it++) {
+        fields->src_port.push_back(std::make_pair((*it).min, (*it).max));
+    }
+}
+
 bool DstPortMatch::Match(const PacketHeader *packet_header) const
 {
     for (RangeSList::const_iterator it = port_ranges_.begin(); 
@@ -399,3 +437,12 @@ void DstPortMatch::SetAclEntryMatchSandeshData(AclEntrySandeshData &data)
         data.dst_port_l.push_back(port);
     }
 }
+
+void DstPortMatch::GetMatchFields(AclMatchFields *fields) const
+{
+    fields->has_dst_port = true;
+    for (RangeSList::const_iterator it = port_ranges_.begin();
+         it != port_ranges_.end(); it++) {
+        fields->dst_port.push_back(std::make_pair((*it).min, (*it).max));
+    }
+}
@@ -17,6 +17,7 @@
 
 struct PacketHeader;
 struct AclEntrySpec;
+struct AclMatchFields;
 typedef std::vector<int32_t> AclEntryIDList;
 
 class AclEntryMatch {
@@ -24,6 +25,7 @@ public:
     virtual ~AclEntryMatch() { };
     virtual bool Match(const PacketHeader *packet_header) const = 0;
     virtual void SetAclEntryMatchSandeshData(AclEntrySandeshData &data) = 0;
+    virtual void GetMatchFields(AclMatchFields *fields) const = 0;
 };
 
 struct Range {
@@ -56,6 +58,7 @@ public:
     void SetPortRange(const uint16_t min_port, const uint16_t max_port);
     void SetAclEntryMatchSandeshData(AclEntrySandeshData &data) = 0;
     virtual bool Match(const PacketHeader *packet_header) const = 0;
+    virtual void GetMatchFields(AclMatchFields *fields) const = 0;
 protected:
     RangeSList port_ranges_;
 };
@@ -64,11 +67,13 @@ class SrcPortMatch : public PortMatch {
 public:
     bool Match(const PacketHeader *packet_header) const;
     void SetAclEntryMatchSandeshData(AclEntrySandeshData &data);
+    void GetMatchFields(AclMatchFields *fields) const;
 };
 class DstPortMatch : public PortMatch {
 public:
     bool Match(const PacketHeader *packet_header) const;
     void SetAclEntryMatchSandeshData(AclEntrySandeshData &data);
+    void GetMatchFields(AclMatchFields *fields) const;
 };
 
 class ProtocolMatch : public AclEntryMatch {
@@ -78,6 +83,7 @@ public:
     void SetProtocolRange(const uint16_t min, const uint16_t max);
     bool Match(const PacketHeader *packet_header) const;
     void SetAclEntryMatchSandeshData(AclEntrySandeshData &data);
+    void GetMatchFields(AclMatchFields *fields) const;
 private:
     RangeSList protocol_ranges_;
 };
@@ -109,6 +115,7 @@ public:
     // Match packet header for address
     bool Match(const PacketHeader *packet_header) const;
     void SetAclEntryMatchSandeshData(AclEntrySandeshData &data);
+    void GetMatchFields(AclMatchFields *fields) const;
 private:
     AddressType addr_type_;
     bool src_;
@@ -126,6 +133,35 @@ private:
     bool SGMatch(const SecurityGroupList *sg_l, int id) const;
 };
 
+// Match conditions of an AclEntry as plain data, for compiling the entries
+// of an ACL into an AclClassifier. A field without a matcher is a wildcard.
+struct AclMatchFields {
+    typedef std::vector<std::pair<uint16_t, uint16_t> > RangeList;
+
+    struct Address {
+        Address() : present(false), type(AddressMatch::UNKNOWN_TYPE),
+            sg_id(0) { }
+        bool present;
+        AddressMatch::AddressType type;
+        IpAddress ip_addr;
+        IpAddress ip_mask;
+        std::string policy_id;
+        int sg_id;
+    };
+
+    AclMatchFields() : has_protocol(false), has_src_port(false),
+        has_dst_port(false) { }
+
+    Address src;
+    Address dst;
+    bool has_protocol;
+    RangeList protocol;
+    bool has_src_port;
+    RangeList src_port;
+    bool has_dst_port;
+    RangeList dst_port;
+};
+
 class AclEntry {
 public:
     enum AclType {
@@ -154,6 +190,7 @@ public:
     const ActionList &Actions() const {return actions_;};
 
     void SetAclEntrySandeshData(AclEntrySandeshData &data) const;
+    void GetMatchFields(AclMatchFields *fields) const;
 
     bool IsTerminal() const;
 
@@ -0,0 +1,363 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "base/logging.h"
+#include "testing/gunit.h"
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <iostream>
+
+#include "vnsw/agent/filter/acl_classifier.h"
+#include "vnsw/agent/filter/acl_entry.h"
+#include "vnsw/agent/filter/acl_entry_spec.h"
+#include "vnsw/agent/filter/packet_header.h"
+#include "vnsw/agent/filter/traffic_action.h"
+
+#include "net/address.h"
+
+using namespace std;
+
+namespace {
+
+static uint64_t NowUsecs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return uint64_t(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+class AclClassifierTest : public ::testing::Test {
+protected:
+    static const int kSgCount = 8;
+
+    AclClassifierTest() {
+        srand(1);
+        policy_ids_.push_back("vn1");
+        policy_ids_.push_back("vn2");
+        policy_ids_.push_back("vn3");
+        for (int sg = 1; sg <= 3; sg++) {
+            sg_list_.push_back(sg);
+        }
+    }
+
+    ~AclClassifierTest() {
+        ClearEntries();
+    }
+
+    void ClearEntries() {
+        for (AclClassifier::EntryList::iterator it = entries_.begin();
+             it != entries_.end(); ++it) {
+            delete *it;
+        }
+        entries_.clear();
+    }
+
+    void AddEntry(const AclEntrySpec &spec) {
+        AclEntry *entry = new AclEntry();
+        entry->PopulateAclEntry(spec);
+        entries_.push_back(entry);
+    }
+
+    static RangeSpec MakeRange(uint16_t min, uint16_t max) {
+        RangeSpec range;
+        range.min = min;
+        range.max = max;
+        return range;
+    }
+
+    // Addresses are from 10.0.0.0/16 so that random packets hit them. Some
+    // have bits outside of the mask, and never match.
+    void RandomAddress(AddressMatch::AddressType *type, IpAddress *ip,
+                       IpAddress *mask, string *policy_id, int *sg_id) {
+        switch (rand() % 4) {
+        case 0:
+            *type = AddressMatch::UNKNOWN_TYPE;
+            break;
+        case 1: {
+            *type = AddressMatch::IP_ADDR;
+            int plen = 16 + rand() % 17;
+            uint32_t mask_value = plen == 32 ? 0xFFFFFFFF :
+                ~((1U << (32 - plen)) - 1);
+            uint32_t addr = 0x0A000000 | (rand() & 0xFFFF);
+            if (rand() % 8 != 0) {
+                addr &= mask_value;
+            }
+            *ip = IpAddress(Ip4Address(addr));
+            *mask = IpAddress(Ip4Address(mask_value));
+            break;
+        }
+        case 2:
+            *type = AddressMatch::NETWORK_ID;
+            *policy_id = rand() % 8 == 0 ? "any" :
+                policy_ids_[rand() % policy_ids_.size()];
+            break;
+        case 3:
+            *type = AddressMatch::SG;
+            *sg_id = rand() % 8 == 0 ? AddressMatch::kAny :
+                1 + rand() % kSgCount;
+            break;
+        }
+    }
+
+    void RandomRanges(vector<RangeSpec> *ranges, uint16_t max_value) {
+        int count = rand() % 3;
+        for (int idx = 0; idx < count; idx++) {
+            uint16_t min = rand() % max_value;
+            uint16_t max = min + rand() % (max_value - min);
+            ranges->push_back(MakeRange(min, max));
+        }
+    }
+
+    void AddRandomEntry(uint32_t id) {
+        AclEntrySpec spec;
+        spec.id = id;
+        RandomAddress(&spec.src_addr_type, &spec.src_ip_addr,
+                      &spec.src_ip_mask, &spec.src_policy_id_str,
+                      &spec.src_sg_id);
+        RandomAddress(&spec.dst_addr_type, &spec.dst_ip_addr,
+                      &spec.dst_ip_mask, &spec.dst_policy_id_str,
+                      &spec.dst_sg_id);
+        RandomRanges(&spec.protocol, 20);
+        RandomRanges(&spec.src_port, 1024);
+        RandomRanges(&spec.dst_port, 1024);
+        spec.terminal = (rand() % 4 == 0);
+        ActionSpec action;
+        action.ta_type = TrafficAction::SIMPLE_ACTION;
+        action.simple_action = (rand() % 2) ? TrafficAction::PASS :
+            TrafficAction::DENY;
+        if (rand() % 16 != 0) {
+            spec.action_l.push_back(action);
+        }
+
+        AddEntry(spec);
+    }
+
+    void RandomPacket(PacketHeader *packet) {
+        packet->src_ip = 0x0A000000 | (rand() & 0xFFFF);
+        packet->dst_ip = 0x0A000000 | (rand() & 0xFFFF);
+        packet->protocol = rand() % 20;
+        packet->src_port = rand() % 1024;
+        packet->dst_port = rand() % 1024;
+        packet->src_policy_id = &policy_ids_[rand() % policy_ids_.size()];
+        packet->dst_policy_id = &policy_ids_[rand() % policy_ids_.size()];
+        packet->src_sg_id_l = (rand() % 4 == 0) ? NULL : &sg_list_;
+        packet->dst_sg_id_l = (rand() % 4 == 0) ? NULL : &sg_list_;
+    }
+
+    // The entries that match in order, up to the first terminal one, as
+    // found by AclDBEntry::PacketMatch without a classifier.
+    void LinearMatch(const PacketHeader &packet,
+                     AclClassifier::EntryList *matches) {
+        for (AclClassifier::EntryList::const_iterator it = entries_.begin();
+             it != entries_.end(); ++it) {
+            if ((*it)->PacketMatch(packet).empty())
+                continue;
+            matches->push_back(*it);
+            if ((*it)->IsTerminal())
+                return;
+        }
+    }
+
+    vector<string> policy_ids_;
+    SecurityGroupList sg_list_;
+    AclClassifier::EntryList entries_;
+};
+
+TEST_F(AclClassifierTest, Empty) {
+    AclClassifier classifier;
+    EXPECT_FALSE(classifier.compiled());
+    EXPECT_TRUE(classifier.Compile(entries_));
+    EXPECT_TRUE(classifier.compiled());
+
+    PacketHeader packet;
+    RandomPacket(&packet);
+    AclClassifier::EntryList matches;
+    classifier.Match(packet, &matches);
+    EXPECT_TRUE(matches.empty());
+}
+
+TEST_F(AclClassifierTest, FirstTerminalMatchWins) {
+    AclEntrySpec spec;
+    spec.src_addr_type = AddressMatch::IP_ADDR;
+    spec.src_ip_addr = IpAddress::from_string("10.1.0.0");
+    spec.src_ip_mask = IpAddress::from_string("255.255.0.0");
+    spec.dst_port.push_back(MakeRange(80, 80));
+    ActionSpec action;
+    action.ta_type = TrafficAction::SIMPLE_ACTION;
+    action.simple_action = TrafficAction::PASS;
+    spec.action_l.push_back(action);
+
+    // Non-terminal entry for the subnet, then terminal for port 80, then
+    // terminal for everything.
+    spec.id = 1;
+    spec.terminal = false;
+    AclEntrySpec spec1 = spec;
+    spec1.dst_port.clear();
+    AddEntry(spec1);
+    spec.id = 2;
+    spec.terminal = true;
+    AddEntry(spec);
+    AclEntrySpec spec3;
+    spec3.id = 3;
+    spec3.action_l.push_back(action);
+    AddEntry(spec3);
+
+    AclClassifier classifier;
+    EXPECT_TRUE(classifier.Compile(entries_));
+    EXPECT_EQ(3U, classifier.size());
+
+    PacketHeader packet;
+    packet.src_ip = 0x0A010203;
+    packet.dst_port = 80;
+    AclClassifier::EntryList matches;
+    classifier.Match(packet, &matches);
+    ASSERT_EQ(2U, matches.size());
+    EXPECT_EQ(1U, matches[0]->id());
+    EXPECT_EQ(2U, matches[1]->id());
+
+    matches.clear();
+    packet.dst_port = 81;
+    classifier.Match(packet, &matches);
+    ASSERT_EQ(2U, matches.size());
+    EXPECT_EQ(1U, matches[0]->id());
+    EXPECT_EQ(3U, matches[1]->id());
+
+    matches.clear();
+    packet.src_ip = 0x0A020203;
+    classifier.Match(packet, &matches);
+    ASSERT_EQ(1U, matches.size());
+    EXPECT_EQ(3U, matches[0]->id());
+}
+
+TEST_F(AclClassifierTest, NonContiguousMask) {
+    AclEntrySpec spec;
+    spec.id = 1;
+    spec.dst_addr_type = AddressMatch::IP_ADDR;
+    spec.dst_ip_addr = IpAddress::from_string("10.0.0.1");
+    spec.dst_ip_mask = IpAddress::from_string("255.0.0.255");
+    ActionSpec action;
+    action.ta_type = TrafficAction::SIMPLE_ACTION;
+    action.simple_action = TrafficAction::DENY;
+    spec.action_l.push_back(action);
+    AddEntry(spec);
+
+    AclClassifier classifier;
+    EXPECT_TRUE(classifier.Compile(entries_));
+    PacketHeader packet;
+    packet.dst_ip = 0x0A050601;
+    AclClassifier::EntryList matches;
+    classifier.Match(packet, &matches);
+    EXPECT_EQ(1U, matches.size());
+
+    matches.clear();
+    packet.dst_ip = 0x0A050602;
+    classifier.Match(packet, &matches);
+    EXPECT_EQ(0U, matches.size());
+}
+
+// Compare against the linear walk for random entries and packets.
+TEST_F(AclClassifierTest, Random) {
+    static const int kRounds = 20;
+    static const int kPacketCount = 2000;
+
+    for (int round = 0; round < kRounds; round++) {
+        ClearEntries();
+        int count = 1 + rand() % 300;
+        for (int idx = 0; idx < count; idx++) {
+            AddRandomEntry(idx + 1);
+        }
+        AclClassifier classifier;
+        EXPECT_TRUE(classifier.Compile(entries_));
+
+        for (int idx = 0; idx < kPacketCount; idx++) {
+            PacketHeader packet;
+            RandomPacket(&packet);
+            AclClassifier::EntryList expected, matches;
+            LinearMatch(packet, &expected);
+            classifier.Match(packet, &matches);
+            EXPECT_TRUE(expected == matches);
+        }
+    }
+}
+
+//
+// Flow setup cost of matching one ACL, for the linear walk and the
+// classifier, as the number of entries grows. The entries look like a
+// security group: remote SG or subnet, protocol and a destination port.
+// Not part of the regular run, use --gtest_also_run_disabled_tests to run it.
+//
+TEST_F(AclClassifierTest, DISABLED_Benchmark) {
+    static const int kEntryCounts[] = { 10, 50, 100, 500, 1000, 2000 };
+    static const int kPacketCount = 20000;
+
+    for (size_t step = 0;
+         step < sizeof(kEntryCounts) / sizeof(kEntryCounts[0]); step++) {
+        ClearEntries();
+        int count = kEntryCounts[step];
+        for (int idx = 0; idx < count; idx++) {
+            AclEntrySpec spec;
+            spec.id = idx + 1;
+            if (idx % 2) {
+                spec.src_addr_type = AddressMatch::SG;
+                spec.src_sg_id = 1 + idx % kSgCount;
+            } else {
+                spec.src_addr_type = AddressMatch::IP_ADDR;
+                spec.src_ip_addr = IpAddress(Ip4Address(0x0A000000 | idx << 8));
+                spec.src_ip_mask = IpAddress::from_string("255.255.255.0");
+            }
+            spec.protocol.push_back(MakeRange(6, 6));
+            spec.dst_port.push_back(MakeRange(1000 + idx, 1000 + idx));
+            ActionSpec action;
+            action.ta_type = TrafficAction::SIMPLE_ACTION;
+            action.simple_action = TrafficAction::PASS;
+            spec.action_l.push_back(action);
+            AddEntry(spec);
+        }
+
+        uint64_t start = NowUsecs();
+        AclClassifier classifier;
+        classifier.Compile(entries_);
+        uint64_t compile_usecs = NowUsecs() - start;
+
+        vector<PacketHeader> packets(kPacketCount);
+        for (int idx = 0; idx < kPacketCount; idx++) {
+            RandomPacket(&packets[idx]);
+            packets[idx].protocol = 6;
+            packets[idx].src_ip = 0x0A000000 | (rand() % count) << 8;
+            packets[idx].dst_port = 1000 + rand() % (count + count / 4);
+        }
+
+        size_t linear_matches = 0;
+        start = NowUsecs();
+        for (int idx = 0; idx < kPacketCount; idx++) {
+            AclClassifier::EntryList matches;
+            LinearMatch(packets[idx], &matches);
+            linear_matches += matches.size();
+        }
+        uint64_t linear_usecs = NowUsecs() - start;
+
+        size_t classifier_matches = 0;
+        start = NowUsecs();
+        for (int idx = 0; idx < kPacketCount; idx++) {
+            AclClassifier::EntryList matches;
+            classifier.Match(packets[idx], &matches);
+            classifier_matches += matches.size();
+        }
+        uint64_t classifier_usecs = NowUsecs() - start;
+        EXPECT_EQ(linear_matches, classifier_matches);
+
+        cout << count << " entries: linear "
+             << linear_usecs * 1000 / kPacketCount << " nsecs/flow,"
+             << " classifier " << classifier_usecs * 1000 / kPacketCount
+             << " nsecs/flow, compile " << compile_usecs << " usecs" << endl;
+    }
+}
+
+} // namespace
+
+int main (int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -464,7 +464,8 @@ bool FlowTableKSyncObject::AuditProcess(FlowTableKSyncObject *obj) {
                         ntohs(vflow_entry->fe_key.key_src_port),
                         ntohs(vflow_entry->fe_key.key_dst_port));
             FlowEntryPtr flow(FlowTable::GetFlowTableObject()->Allocate(key));
-            flow->flow_handle = flow_idx;
+            FlowTable::GetFlowTableObject()->SetFlowHandle(flow.get(),
+                                                           flow_idx);
             flow->short_flow = true;
             flow->data.source_vn = *FlowHandler::UnknownVn();
             flow->data.dest_vn = *FlowHandler::UnknownVn();
@@ -73,7 +73,8 @@ void KSyncSandeshContext::FlowMsgHandler(vr_flow_req *r) {
                        << " dst = " << dst_str << ":" << key.dst_port
                        << " proto = " << (int)key.protocol);
             if (entry && (int)entry->flow_handle == r->get_fr_index()) {
-                entry->flow_handle = FlowEntry::kInvalidFlowHandle;
+                FlowTable::GetFlowTableObject()->SetFlowHandle
+                    (entry, FlowEntry::kInvalidFlowHandle);
             }
             
             // When NAT forward flow is deleted, vrouter will delete reverse
@@ -98,7 +99,8 @@ void KSyncSandeshContext::FlowMsgHandler(vr_flow_req *r) {
                         << "> to <" << r->get_fr_rindex() << ">");
                 }
             }
-            entry->flow_handle = r->get_fr_rindex();
+            FlowTable::GetFlowTableObject()->SetFlowHandle
+                (entry, r->get_fr_rindex());
         }
     } else {
         assert(!("Invalid Flow operation"));
@@ -154,7 +154,7 @@ void Inet4UcRouteTable::DeleteRoute(DBTablePartBase *part,
         RemoveUnresolvedRoute(rt);
         rt->UpdateGatewayRoutes();
         rt->UpdateNH();
-        tree_.Remove(rt);
+        RemoveRoute(rt);
         part->Delete(rt);
         return;
     } else if (notify) {
@@ -226,7 +226,7 @@ void Inet4UcRouteTable::Input(DBTablePartition *part, DBClient *client,
 
         if (rt && rt->IsDeleted()) {
             rt->ClearDelete();
-            tree_.Insert(rt);
+            InsertRoute(rt);
             notify = true;
         }
 
@@ -247,7 +247,7 @@ void Inet4UcRouteTable::Input(DBTablePartition *part, DBClient *client,
                 part->Add(rt);
                 // Mark path as NULL so that its allocated below
                 path = NULL;
-                tree_.Insert(rt);
+                InsertRoute(rt);
                 rt->FillTrace(rt_info, Inet4Route::ADD, NULL);
                 OPER_TRACE(Route, rt_info);
                 route_added = true;
@@ -322,10 +322,25 @@ bool Inet4UcRouteTable::DelExplicitRoute(DBTablePartBase *part,
     return true;
 }
 
+void Inet4UcRouteTable::InsertRoute(Inet4UcRoute *rt) {
+    tree_.Insert(rt);
+    index_.Insert(rt);
+}
+
+// The slots of the index that pointed to the route go to the longest route
+// still covering it
+void Inet4UcRouteTable::RemoveRoute(Inet4UcRoute *rt) {
+    tree_.Remove(rt);
+    Inet4UcRoute *cover = NULL;
+    if (rt->GetPlen() > 0) {
+        Inet4UcRoute key(NULL, rt->GetIpAddress(), rt->GetPlen() - 1);
+        cover = tree_.LPMFind(&key);
+    }
+    index_.Remove(rt, cover);
+}
+
 Inet4UcRoute *Inet4UcRouteTable::FindLPM(const Ip4Address &ip) {
-    Ip4Address addr = ip::address_v4(ip.to_ulong());
-    Inet4UcRoute key(NULL, addr, 32);
-    return tree_.LPMFind(&key);
+    return index_.LPMFind(ip.to_ulong());
 }
 
 Inet4UcRoute *Inet4UcRouteTable::FindRoute(const string &vrf_name, 
@@ -9,6 +9,7 @@
 #include <base/dependency.h>
 #include <base/lifetime.h>
 #include <base/patricia.h>
+#include <base/lpm_index.h>
 #include <cmn/agent_cmn.h>
 #include <route/route.h>
 #include <route/table.h>
@@ -238,6 +239,7 @@ public:
 
 
     typedef Patricia::Tree<Inet4UcRoute, &Inet4UcRoute::rtnode_, Inet4UcRoute::Rtkey> RouteTree;
+    typedef LpmIndex<Inet4UcRoute, Inet4UcRoute::Rtkey> RouteIndex;
     Inet4UcRouteTable(DB *db, const std::string &name);
     virtual ~Inet4UcRouteTable();
     virtual void Input(DBTablePartition *root, DBClient *client,
@@ -335,7 +337,8 @@ public:
                                 const Ip4Address &gw_ip);
     static void RouteResyncReq(const string &vrf, const Ip4Address &ip, 
                                uint8_t plen);
-    // Find a matching route for the IP address
+    // Find a matching route for the IP address. Served from the LPM index,
+    // which flow setup hits several times for every new flow.
     Inet4UcRoute *FindLPM(const Ip4Address &ip);
     static Inet4UcRoute *FindRoute(const string &vrf_name, const Ip4Address &ip);
     Inet4UcRoute *FindResolveRoute(const Ip4Address &ip);
@@ -366,11 +369,16 @@ public:
 
     virtual Inet4Route *FindRoute(const Ip4Address &ip) { return FindLPM(ip); };
 private:
+    // Keep tree_ and index_ in sync
+    void InsertRoute(Inet4UcRoute *rt);
+    void RemoveRoute(Inet4UcRoute *rt);
+
     static Inet4UcRouteTable *uc_route_table_;
     UnresolvedRouteTree unresolved_rt_tree_;
     UnresolvedNHTree unresolved_nh_tree_;
     Patricia::Node rtnode_;
     RouteTree tree_; //LPM tree for unicast
+    RouteIndex index_; //Read optimized copy of tree_ for FindLPM
     DBTableWalker::WalkId walkid_;
 };
 
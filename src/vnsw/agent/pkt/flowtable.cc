@@ -37,11 +37,60 @@
 #include "pkt/pkt_types.h"
 #include "uve/flow_uve.h"
 #include "pkt/pkt_sandesh_flow.h"
+#include "base/slab_allocator.h"
 
 FlowTable* FlowTable::singleton_;
 boost::uuids::random_generator FlowTable::rand_gen_ = boost::uuids::random_generator();
 tbb::atomic<int> FlowEntry::alloc_count_;
 
+//
+// Intentionally never destroyed, since flows may still be released while
+// static objects are being destroyed at exit.
+//
+static SlabAllocator *FlowAllocator() {
+    static SlabAllocator *allocator = new SlabAllocator(sizeof(FlowEntry));
+    return allocator;
+}
+
+void *FlowEntry::operator new(size_t size) {
+    assert(size == sizeof(FlowEntry));
+    return FlowAllocator()->Alloc();
+}
+
+void FlowEntry::operator delete(void *ptr) {
+    FlowAllocator()->Free(ptr);
+}
+
+size_t FlowEntry::AllocatedBytes() {
+    return FlowAllocator()->capacity();
+}
+
+// Take a reference to each flow on a list, since resyncing or deleting a
+// flow unlinks it from the lists it's on.
+template <class FlowList>
+static void CopyFlowList(FlowList &list, FlowTable::FlowEntryPtrList *flows) {
+    flows->reserve(flows->size() + list.size());
+    for (typename FlowList::iterator it = list.begin(); it != list.end();
+         ++it) {
+        flows->push_back(FlowEntryPtr(&*it));
+    }
+}
+
+// Flows of a route, with the flows that have the route as both source and
+// destination route listed once.
+static void CopyRouteFlowList(const RouteFlowKey &key, RouteFlowInfo *info,
+                              FlowTable::FlowEntryPtrList *flows) {
+    CopyFlowList(info->src_fet, flows);
+    FlowTable::DstRouteFlowList::iterator it;
+    for (it = info->dst_fet.begin(); it != info->dst_fet.end(); ++it) {
+        if (it->data.flow_source_vrf == key.vrf &&
+            it->key.src.ipv4 == key.ip.ipv4) {
+            continue;
+        }
+        flows->push_back(FlowEntryPtr(&*it));
+    }
+}
+
 static bool ShouldDrop(uint32_t action) {
     if ((action & TrafficAction::DROP_FLAGS) || (action & TrafficAction::IMPLICIT_DENY_FLAGS))
         return true;
@@ -544,7 +593,13 @@ FlowEntry *FlowTable::Allocate(const FlowKey &key) {
         flow->flow_uuid = FlowTable::rand_gen_();
         flow->egress_uuid = FlowTable::rand_gen_();
         flow->setup_time = UTCTimestampUsec();
-        flow_entry_map_.insert(std::pair<FlowKey, FlowEntry*>(key, flow));
+        // The table holds a reference until the flow is deleted
+        intrusive_ptr_add_ref(flow);
+        flow_entry_map_.insert(*flow);
+        if (flow_entry_map_.size() > flow_buckets_.size()) {
+            Rehash();
+        }
+        IndexFlow(flow);
         AgentStats::GetInstance()->IncrFlowActive();
         AgentStats::GetInstance()->IncrFlowCreated();
     } else {
@@ -557,18 +612,97 @@ FlowEntry *FlowTable::Allocate(const FlowKey &key) {
 FlowEntry *FlowTable::Find(const FlowKey &key) {
     FlowEntryMap::iterator it;
 
-    it = flow_entry_map_.find(key);
+    it = flow_entry_map_.find(key, FlowKeyHash(), FlowKeyEqual());
+    if (it != flow_entry_map_.end()) {
+        return &*it;
+    } else {
+        return NULL;
+    }
+}
+
+// If the flow with key is gone, continue with the bucket following its
+// bucket
+FlowEntry *FlowTable::FindNext(const FlowKey *key) {
+    FlowEntryMap::iterator it;
+
+    if (key == NULL) {
+        it = flow_entry_map_.begin();
+    } else {
+        it = flow_entry_map_.find(*key, FlowKeyHash(), FlowKeyEqual());
+        if (it != flow_entry_map_.end()) {
+            ++it;
+        } else {
+            size_t bucket = flow_entry_map_.bucket(*key, FlowKeyHash());
+            while (++bucket < flow_entry_map_.bucket_count()) {
+                if (flow_entry_map_.bucket_size(bucket) != 0) {
+                    it = flow_entry_map_.iterator_to
+                        (*flow_entry_map_.begin(bucket));
+                    break;
+                }
+            }
+        }
+    }
+
     if (it != flow_entry_map_.end()) {
-        return it->second;
+        return &*it;
     } else {
         return NULL;
     }
 }
 
+void FlowTable::Rehash() {
+    FlowEntryBuckets buckets(flow_buckets_.size() * 2);
+    flow_entry_map_.rehash(FlowEntryMap::bucket_traits(&buckets[0],
+                                                       buckets.size()));
+    flow_buckets_.swap(buckets);
+}
+
+void FlowTable::SetFlowHandle(FlowEntry *flow, uint32_t flow_handle) {
+    if (flow->flow_handle == flow_handle &&
+        !flow->unindexed_node_.is_linked()) {
+        return;
+    }
+    UnindexFlow(flow);
+    flow->flow_handle = flow_handle;
+    IndexFlow(flow);
+}
+
+// If vrouter has given the index to another flow, the index belongs to the
+// latest flow and the previous owner is left for aging to pick up from
+// unindexed_flows_
+void FlowTable::IndexFlow(FlowEntry *flow) {
+    uint32_t idx = flow->flow_handle;
+    if (idx == FlowEntry::kInvalidFlowHandle) {
+        unindexed_flows_.push_back(*flow);
+        return;
+    }
+
+    if (idx >= flow_index_list_.size()) {
+        flow_index_list_.resize(idx + 1, NULL);
+    }
+    FlowEntry *prev = flow_index_list_[idx];
+    if (prev != NULL && prev != flow) {
+        unindexed_flows_.push_back(*prev);
+    }
+    flow_index_list_[idx] = flow;
+}
+
+void FlowTable::UnindexFlow(FlowEntry *flow) {
+    if (flow->unindexed_node_.is_linked()) {
+        unindexed_flows_.erase(unindexed_flows_.iterator_to(*flow));
+        return;
+    }
+
+    uint32_t idx = flow->flow_handle;
+    if (idx < flow_index_list_.size() && flow_index_list_[idx] == flow) {
+        flow_index_list_[idx] = NULL;
+    }
+}
+
 void FlowTable::DeleteInternal(FlowEntryMap::iterator &it)
 {
     FlowInfo flow_info;
-    FlowEntry *fe = it->second;
+    FlowEntry *fe = &*it;
     fe->FillFlowInfo(flow_info);
     FLOW_TRACE(Trace, "Delete", flow_info);
 
@@ -584,6 +718,7 @@ void FlowTable::DeleteInternal(FlowEntryMap::iterator &it)
     fe->data.reverse_flow = NULL;
 
     DeleteFlowInfo(fe);
+    UnindexFlow(fe);
     flow_entry_map_.erase(it);
 
     FlowTableKSyncEntry *ksync_entry = 
@@ -600,6 +735,9 @@ void FlowTable::DeleteInternal(FlowEntryMap::iterator &it)
 
     AgentStats::GetInstance()->DecrFlowActive();
     AgentStats::GetInstance()->IncrFlowAged();
+
+    // Release the reference of the table, see Allocate
+    intrusive_ptr_release(fe);
 }
 
 bool FlowTable::DeleteRevFlow(FlowKey &key, bool rev_flow)
@@ -608,11 +746,11 @@ bool FlowTable::DeleteRevFlow(FlowKey &key, bool rev_flow)
     FlowEntryPtr pfe;
 
     // Find the flow, get the reverse flow and delete flow. 
-    it = flow_entry_map_.find(key);
+    it = flow_entry_map_.find(key, FlowKeyHash(), FlowKeyEqual());
     if (it == flow_entry_map_.end()) {
         return false;
     }
-    pfe = it->second;
+    pfe = &*it;
     FlowEntryPtr reverse_flow;
     reverse_flow = pfe->data.reverse_flow;
     DeleteInternal(it);
@@ -626,7 +764,8 @@ bool FlowTable::DeleteRevFlow(FlowKey &key, bool rev_flow)
         return true;
     }
 
-    it = flow_entry_map_.find(reverse_flow.get()->key);
+    it = flow_entry_map_.find(reverse_flow.get()->key, FlowKeyHash(),
+                              FlowKeyEqual());
     if (it == flow_entry_map_.end()) {
         return false;
     }
@@ -639,25 +778,20 @@ bool FlowTable::Delete(FlowEntryMap::iterator &it, bool rev_flow)
     FlowEntry *fe;
     FlowEntryMap::iterator rev_it;
 
-    fe = it->second;
-    FlowEntry *reverse_flow = NULL;
+    fe = &*it;
+    // Hold the reverse flow, DeleteInternal unlinks it from the flow
+    FlowEntryPtr reverse_flow;
     if (fe->nat || rev_flow) {
-        reverse_flow = fe->data.reverse_flow.get();
+        reverse_flow = fe->data.reverse_flow;
     }
     DeleteInternal(it);
 
     if (!reverse_flow) {
         return true;
     }
-    /* If reverse-flow is valid and the present iterator is pointing to it,
-     * use that iterator to delete reverse flow
-     */
-    if (reverse_flow == it->second) {
-        DeleteInternal(it);
-        return true;
-    }
 
-    rev_it = flow_entry_map_.find(reverse_flow->key);
+    rev_it = flow_entry_map_.find(reverse_flow->key, FlowKeyHash(),
+                                  FlowKeyEqual());
     if (rev_it != flow_entry_map_.end()) {
         DeleteInternal(rev_it);
         return true;
@@ -670,15 +804,16 @@ bool FlowTable::DeleteNatFlow(FlowKey &key, bool del_nat_flow)
     FlowEntryMap::iterator it;
     FlowEntry *fe;
 
-    it = flow_entry_map_.find(key);
+    it = flow_entry_map_.find(key, FlowKeyHash(), FlowKeyEqual());
     if (it == flow_entry_map_.end()) {
         return false;
     }
-    fe = it->second;
+    fe = &*it;
 
-    FlowEntry *reverse_flow = NULL;
+    // Hold the reverse flow, DeleteInternal unlinks it from the flow
+    FlowEntryPtr reverse_flow;
     if (del_nat_flow) {
-        reverse_flow = fe->data.reverse_flow.get();
+        reverse_flow = fe->data.reverse_flow;
     }
 
     /* Delete the forward flow */
@@ -688,7 +823,8 @@ bool FlowTable::DeleteNatFlow(FlowKey &key, bool del_nat_flow)
         return true;
     }
 
-    it = flow_entry_map_.find(reverse_flow->key);
+    it = flow_entry_map_.find(reverse_flow->key, FlowKeyHash(),
+                              FlowKeyEqual());
     if (it != flow_entry_map_.end()) {
         DeleteInternal(it);
         return true;
@@ -702,7 +838,7 @@ void FlowTable::DeleteAll()
 
     it = flow_entry_map_.begin();
     while (it != flow_entry_map_.end()) {
-        FlowKey fekey = it->second->key;
+        FlowKey fekey = it->key;
         DeleteNatFlow(fekey, true);
         it = flow_entry_map_.begin();
     }
@@ -993,12 +1129,11 @@ void FlowTable::ResyncVnFlows(const VnEntry *vn) {
         return;
     }
 
-    FlowEntryTree fet = vn_it->second->fet;
-    FlowEntryTree::iterator fet_it, it;
-    it = fet.begin();
-    while (it != fet.end()) {
-        fet_it = it++;
-        FlowEntry *fe = (*fet_it).get();
+    FlowEntryPtrList fet;
+    CopyFlowList(vn_it->second->fet, &fet);
+    FlowEntryPtrList::iterator fet_it;
+    for (fet_it = fet.begin(); fet_it != fet.end(); ++fet_it) {
+        FlowEntry *fe = fet_it->get();
         DeleteFlowInfo(fe);
         MatchPolicy policy;
         fe->GetPolicy(vn, &policy);
@@ -1044,12 +1179,11 @@ void FlowTable::ResyncRouteFlows(RouteFlowKey &key, SecurityGroupList &sg_l)
     if (rf_it == route_flow_tree_.end()) {
         return;
     }
-    FlowEntryTree fet = rf_it->second->fet;
-    FlowEntryTree::iterator fet_it, it;
-    it = fet.begin();
-    while (it != fet.end()) {
-        fet_it = it++;
-        FlowEntry *fe = (*fet_it).get();
+    FlowEntryPtrList fet;
+    CopyRouteFlowList(key, rf_it->second, &fet);
+    FlowEntryPtrList::iterator fet_it;
+    for (fet_it = fet.begin(); fet_it != fet.end(); ++fet_it) {
+        FlowEntry *fe = fet_it->get();
         DeleteFlowInfo(fe);
         MatchPolicy policy;
         fe->GetPolicy(fe->data.vn_entry.get(), &policy);
@@ -1080,12 +1214,11 @@ void FlowTable::ResyncVmPortFlows(const VmPortInterface *intf) {
         return;
     }
 
-    FlowEntryTree fet = intf_it->second->fet;
-    FlowEntryTree::iterator fet_it, it;
-    it = fet.begin();
-    while (it != fet.end()) {
-        fet_it = it++;
-        FlowEntry *fe = (*fet_it).get();
+    FlowEntryPtrList fet;
+    CopyFlowList(intf_it->second->fet, &fet);
+    FlowEntryPtrList::iterator fet_it;
+    for (fet_it = fet.begin(); fet_it != fet.end(); ++fet_it) {
+        FlowEntry *fe = fet_it->get();
         DeleteFlowInfo(fe);
         MatchPolicy policy;
         fe->GetPolicy(intf->GetVnEntry(), &policy);
@@ -1107,12 +1240,11 @@ void FlowTable::DeleteRouteFlows(const RouteFlowKey &key)
         return;
     }
     FLOW_TRACE(ModuleInfo, "Delete Route flows");
-    FlowEntryTree fet = rf_it->second->fet;
-    FlowEntryTree::iterator fet_it, it;
-    it = fet.begin();
-    while (it != fet.end()) {
-        fet_it = it++;
-        FlowEntry *fe = (*fet_it).get();
+    FlowEntryPtrList fet;
+    CopyRouteFlowList(key, rf_it->second, &fet);
+    FlowEntryPtrList::iterator fet_it;
+    for (fet_it = fet.begin(); fet_it != fet.end(); ++fet_it) {
+        FlowEntry *fe = fet_it->get();
         DeleteNatFlow(fe->key, true);
     }
 }
@@ -1168,11 +1300,11 @@ void FlowTable::DeleteFlowInfo(FlowEntry *fe)
 void FlowTable::DeleteVnFlowInfo(FlowEntry *fe)
 {
     VnFlowTree::iterator vn_it;
-    if (fe->data.vn_entry) {
+    if (fe->vn_node_.is_linked()) {
         vn_it = vn_flow_tree_.find(fe->data.vn_entry.get());
         if (vn_it != vn_flow_tree_.end()) {
             VnFlowInfo *vn_flow_info = vn_it->second;
-            vn_flow_info->fet.erase(fe);
+            vn_flow_info->fet.erase(vn_flow_info->fet.iterator_to(*fe));
             if (vn_flow_info->fet.empty()) {
                 delete vn_flow_info;
                 vn_flow_tree_.erase(vn_it);
@@ -1205,11 +1337,12 @@ void FlowTable::DeleteAclFlowInfo(const AclDBEntry *acl, FlowEntry* flow, AclEnt
 void FlowTable::DeleteIntfFlowInfo(FlowEntry *fe)
 {
     IntfFlowTree::iterator intf_it;
-    if (fe->data.intf_entry) {
+    if (fe->intf_node_.is_linked()) {
         intf_it = intf_flow_tree_.find(fe->data.intf_entry.get());
         if (intf_it != intf_flow_tree_.end()) {
             IntfFlowInfo *intf_flow_info = intf_it->second;
-            intf_flow_info->fet.erase(fe);
+            intf_flow_info->fet.erase
+                (intf_flow_info->fet.iterator_to(*fe));
             if (intf_flow_info->fet.empty()) {
                 delete intf_flow_info;
                 intf_flow_tree_.erase(intf_it);
@@ -1221,11 +1354,11 @@ void FlowTable::DeleteIntfFlowInfo(FlowEntry *fe)
 void FlowTable::DeleteVmFlowInfo(FlowEntry *fe)
 {
     VmFlowTree::iterator vm_it;
-    if (fe->data.vm_entry) {
+    if (fe->vm_node_.is_linked()) {
         vm_it = vm_flow_tree_.find(fe->data.vm_entry.get());
         if (vm_it != vm_flow_tree_.end()) {
             VmFlowInfo *vm_flow_info = vm_it->second;
-            vm_flow_info->fet.erase(fe);
+            vm_flow_info->fet.erase(vm_flow_info->fet.iterator_to(*fe));
             if (vm_flow_info->fet.empty()) {
                 delete vm_flow_info;
                 vm_flow_tree_.erase(vm_it);
@@ -1237,24 +1370,26 @@ void FlowTable::DeleteVmFlowInfo(FlowEntry *fe)
 void FlowTable::DeleteRouteFlowInfo (FlowEntry *fe)
 {
     RouteFlowTree::iterator rf_it;
-    RouteFlowKey skey(fe->data.flow_source_vrf, fe->key.src.ipv4);
-    rf_it = route_flow_tree_.find(skey);
     RouteFlowInfo *route_flow_info;
-    if (rf_it != route_flow_tree_.end()) {
+    RouteFlowKey skey(fe->data.flow_source_vrf, fe->key.src.ipv4);
+    if (fe->src_route_node_.is_linked() &&
+        (rf_it = route_flow_tree_.find(skey)) != route_flow_tree_.end()) {
         route_flow_info = rf_it->second;
-        route_flow_info->fet.erase(fe);
-        if (route_flow_info->fet.empty()) {
+        route_flow_info->src_fet.erase
+            (route_flow_info->src_fet.iterator_to(*fe));
+        if (route_flow_info->empty()) {
             delete route_flow_info;
             route_flow_tree_.erase(rf_it);
         }
     }
 
     RouteFlowKey dkey(fe->data.flow_dest_vrf, fe->key.dst.ipv4);
-    rf_it = route_flow_tree_.find(dkey);
-    if (rf_it != route_flow_tree_.end()) {
+    if (fe->dst_route_node_.is_linked() &&
+        (rf_it = route_flow_tree_.find(dkey)) != route_flow_tree_.end()) {
         route_flow_info = rf_it->second;
-        route_flow_info->fet.erase(fe);
-        if (route_flow_info->fet.empty()) {
+        route_flow_info->dst_fet.erase
+            (route_flow_info->dst_fet.iterator_to(*fe));
+        if (route_flow_info->empty()) {
             delete route_flow_info;
             route_flow_tree_.erase(rf_it);
         }
@@ -1354,12 +1489,14 @@ void FlowTable::AddIntfFlowInfo (FlowEntry *fe)
     if (it == intf_flow_tree_.end()) {
         intf_flow_info = new IntfFlowInfo();
         intf_flow_info->intf_entry = fe->data.intf_entry;
-        intf_flow_info->fet.insert(fe);
+        intf_flow_info->fet.push_back(*fe);
         intf_flow_tree_.insert(IntfFlowPair(fe->data.intf_entry.get(), intf_flow_info));
     } else {
         intf_flow_info = it->second;
         /* fe can already exist. In that case it won't be inserted */
-        intf_flow_info->fet.insert(fe);
+        if (!fe->intf_node_.is_linked()) {
+            intf_flow_info->fet.push_back(*fe);
+        }
     }
 }
 
@@ -1374,12 +1511,14 @@ void FlowTable::AddVmFlowInfo (FlowEntry *fe)
     if (it == vm_flow_tree_.end()) {
         vm_flow_info = new VmFlowInfo();
         vm_flow_info->vm_entry = fe->data.vm_entry;
-        vm_flow_info->fet.insert(fe);
+        vm_flow_info->fet.push_back(*fe);
         vm_flow_tree_.insert(VmFlowPair(fe->data.vm_entry.get(), vm_flow_info));
     } else {
         vm_flow_info = it->second;
         /* fe can already exist. In that case it won't be inserted */
-        vm_flow_info->fet.insert(fe);
+        if (!fe->vm_node_.is_linked()) {
+            vm_flow_info->fet.push_back(*fe);
+        }
     }
 }
 
@@ -1394,12 +1533,14 @@ void FlowTable::AddVnFlowInfo (FlowEntry *fe)
     if (it == vn_flow_tree_.end()) {
         vn_flow_info = new VnFlowInfo();
         vn_flow_info->vn_entry = fe->data.vn_entry;
-        vn_flow_info->fet.insert(fe);
+        vn_flow_info->fet.push_back(*fe);
         vn_flow_tree_.insert(VnFlowPair(fe->data.vn_entry.get(), vn_flow_info));
     } else {
         vn_flow_info = it->second;
         /* fe can already exist. In that case it won't be inserted */
-        vn_flow_info->fet.insert(fe);
+        if (!fe->vn_node_.is_linked()) {
+            vn_flow_info->fet.push_back(*fe);
+        }
     }
 }
 
@@ -1418,29 +1559,31 @@ void FlowTable::AddRouteFlowInfo (FlowEntry *fe)
 {
     RouteFlowTree::iterator it;
     RouteFlowInfo *route_flow_info;
-    if (fe->data.flow_source_vrf != VrfEntry::kInvalidIndex) {
+    if (fe->data.flow_source_vrf != VrfEntry::kInvalidIndex &&
+        !fe->src_route_node_.is_linked()) {
         RouteFlowKey skey(fe->data.flow_source_vrf, fe->key.src.ipv4);
         it = route_flow_tree_.find(skey);
         if (it == route_flow_tree_.end()) {
             route_flow_info = new RouteFlowInfo();
-            route_flow_info->fet.insert(fe);
+            route_flow_info->src_fet.push_back(*fe);
             route_flow_tree_.insert(RouteFlowPair(skey, route_flow_info));
         } else {
             route_flow_info = it->second;
-            route_flow_info->fet.insert(fe);
+            route_flow_info->src_fet.push_back(*fe);
         }
     }
 
-    if (fe->data.flow_dest_vrf != VrfEntry::kInvalidIndex) {
+    if (fe->data.flow_dest_vrf != VrfEntry::kInvalidIndex &&
+        !fe->dst_route_node_.is_linked()) {
         RouteFlowKey dkey(fe->data.flow_dest_vrf, fe->key.dst.ipv4);
         it = route_flow_tree_.find(dkey);
         if (it == route_flow_tree_.end()) {
             route_flow_info = new RouteFlowInfo();
-            route_flow_info->fet.insert(fe);
+            route_flow_info->dst_fet.push_back(*fe);
             route_flow_tree_.insert(RouteFlowPair(dkey, route_flow_info));
         } else {
             route_flow_info = it->second;
-            route_flow_info->fet.insert(fe);
+            route_flow_info->dst_fet.push_back(*fe);
         }
     }
 }
@@ -1496,8 +1639,9 @@ void FlowTable::DeleteVnFlows(const VnEntry *vn)
         return;
     }
     FLOW_TRACE(ModuleInfo, "Delete Vn Flows");
-    FlowEntryTree fet = vn_it->second->fet;
-    FlowEntryTree::iterator fet_it;
+    FlowEntryPtrList fet;
+    CopyFlowList(vn_it->second->fet, &fet);
+    FlowEntryPtrList::iterator fet_it;
     for (fet_it = fet.begin(); fet_it != fet.end(); ++fet_it) {
         DeleteNatFlow((*fet_it)->key, true);
     }
@@ -1511,8 +1655,9 @@ void FlowTable::DeleteVmFlows(const VmEntry *vm)
         return;
     }
     FLOW_TRACE(ModuleInfo, "Delete VM flows");
-    FlowEntryTree fet = vm_it->second->fet;
-    FlowEntryTree::iterator fet_it;
+    FlowEntryPtrList fet;
+    CopyFlowList(vm_it->second->fet, &fet);
+    FlowEntryPtrList::iterator fet_it;
     for (fet_it = fet.begin(); fet_it != fet.end(); ++fet_it) {
         DeleteNatFlow((*fet_it)->key, true);
     }
@@ -1526,8 +1671,9 @@ void FlowTable::DeleteVmIntfFlows(const Interface *intf)
         return;
     }
     FLOW_TRACE(ModuleInfo, "Delete Interface Flows");
-    FlowEntryTree fet = intf_it->second->fet;
-    FlowEntryTree::iterator fet_it;
+    FlowEntryPtrList fet;
+    CopyFlowList(intf_it->second->fet, &fet);
+    FlowEntryPtrList::iterator fet_it;
     for (fet_it = fet.begin(); fet_it != fet.end(); ++fet_it) {
         DeleteNatFlow((*fet_it)->key, true);
     }
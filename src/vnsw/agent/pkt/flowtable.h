@@ -6,9 +6,13 @@
 #define __AGENT_FLOW_TABLE_H__
 
 #include <map>
+#include <vector>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/intrusive_ptr.hpp>
+#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/unordered_set.hpp>
+#include <boost/functional/hash.hpp>
 #include <tbb/atomic.h>
 #include <tbb/mutex.h>
 #include <base/util.h>
@@ -189,7 +193,7 @@ struct FlowKey {
     uint16_t src_port;
     uint16_t dst_port;
     uint8_t protocol;
-    bool CompareKey(const FlowKey &key) {
+    bool CompareKey(const FlowKey &key) const {
         return (key.vrf == vrf &&
                 key.src.ipv4 == src.ipv4 &&
                 key.dst.ipv4 == dst.ipv4 &&
@@ -349,13 +353,33 @@ class FlowEntry {
     bool DoPolicy(const PacketHeader &hdr, MatchPolicy *policy, bool ingress);
     uint32_t MatchAcl(const PacketHeader &hdr, MatchPolicy *policy,
                       std::list<MatchAclParams> &acl, bool add_implicit_deny);
+
+    // Flows are allocated from slabs, see FlowTable::Allocate.
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr);
+
+    // Bytes obtained from the system for flows.
+    static size_t AllocatedBytes();
 private:
     friend class FlowTable;
+    friend class FlowStatsCollector;
     friend void intrusive_ptr_add_ref(FlowEntry *fe);
     friend void intrusive_ptr_release(FlowEntry *fe);
     static tbb::atomic<int> alloc_count_;
     // atomic refcount
     tbb::atomic<int> refcount_;
+    // Linked while the flow isn't in FlowTable's index list
+    boost::intrusive::list_member_hook<> unindexed_node_;
+    // Hook for FlowTable's flow_entry_map_
+    boost::intrusive::unordered_set_member_hook<
+        boost::intrusive::store_hash<true> > flow_node_;
+    // Hooks for the flow lists of the VN, interface, VM and routes of the
+    // flow, see AddFlowInfo
+    boost::intrusive::list_member_hook<> vn_node_;
+    boost::intrusive::list_member_hook<> intf_node_;
+    boost::intrusive::list_member_hook<> vm_node_;
+    boost::intrusive::list_member_hook<> src_route_node_;
+    boost::intrusive::list_member_hook<> dst_route_node_;
 };
  
 inline void intrusive_ptr_add_ref(FlowEntry *fe) {
@@ -368,6 +392,34 @@ inline void intrusive_ptr_release(FlowEntry *fe) {
     }
 }
 
+struct FlowKeyHash {
+    size_t operator()(const FlowKey &key) const {
+        size_t hash = 0;
+        boost::hash_combine(hash, key.vrf);
+        boost::hash_combine(hash, key.src.ipv4);
+        boost::hash_combine(hash, key.dst.ipv4);
+        boost::hash_combine(hash, key.src_port);
+        boost::hash_combine(hash, key.dst_port);
+        boost::hash_combine(hash, key.protocol);
+        return hash;
+    }
+    size_t operator()(const FlowEntry &flow) const {
+        return (*this)(flow.key);
+    }
+};
+
+struct FlowKeyEqual {
+    bool operator()(const FlowKey &lhs, const FlowEntry &rhs) const {
+        return lhs.CompareKey(rhs.key);
+    }
+    bool operator()(const FlowEntry &lhs, const FlowKey &rhs) const {
+        return lhs.key.CompareKey(rhs);
+    }
+    bool operator()(const FlowEntry &lhs, const FlowEntry &rhs) const {
+        return lhs.key.CompareKey(rhs.key);
+    }
+};
+
 struct FlowEntryCmp {
     bool operator()(const FlowEntryPtr &l, const FlowEntryPtr &r) {
         FlowKey lhs = l.get()->key;
@@ -399,9 +451,50 @@ struct FlowEntryCmp {
 class FlowTable {
 public:
     static const int MaxResponses = 100;
-    typedef std::map<FlowKey, FlowEntry *, FlowKeyCmp> FlowEntryMap;
+    static const size_t kInitialBuckets = 1024;
+    typedef boost::intrusive::member_hook<FlowEntry,
+            boost::intrusive::unordered_set_member_hook<
+                boost::intrusive::store_hash<true> >,
+            &FlowEntry::flow_node_> FlowEntryNode;
+    typedef boost::intrusive::unordered_set<FlowEntry, FlowEntryNode,
+            boost::intrusive::hash<FlowKeyHash>,
+            boost::intrusive::equal<FlowKeyEqual>,
+            boost::intrusive::power_2_buckets<true> > FlowEntryMap;
+    typedef std::vector<FlowEntryMap::bucket_type> FlowEntryBuckets;
+    // Flows by the index of their entry in the vrouter flow table
+    typedef std::vector<FlowEntry *> FlowIndexList;
+    typedef boost::intrusive::member_hook<FlowEntry,
+            boost::intrusive::list_member_hook<>,
+            &FlowEntry::unindexed_node_> FlowUnindexedNode;
+    typedef boost::intrusive::list<FlowEntry, FlowUnindexedNode>
+        FlowUnindexedList;
+
+    // Flows of a VN, interface, VM or route. The lists don't hold a
+    // reference, flows are unlinked by DeleteFlowInfo.
+    typedef boost::intrusive::list<FlowEntry,
+            boost::intrusive::member_hook<FlowEntry,
+                boost::intrusive::list_member_hook<>,
+                &FlowEntry::vn_node_> > VnFlowList;
+    typedef boost::intrusive::list<FlowEntry,
+            boost::intrusive::member_hook<FlowEntry,
+                boost::intrusive::list_member_hook<>,
+                &FlowEntry::intf_node_> > IntfFlowList;
+    typedef boost::intrusive::list<FlowEntry,
+            boost::intrusive::member_hook<FlowEntry,
+                boost::intrusive::list_member_hook<>,
+                &FlowEntry::vm_node_> > VmFlowList;
+    typedef boost::intrusive::list<FlowEntry,
+            boost::intrusive::member_hook<FlowEntry,
+                boost::intrusive::list_member_hook<>,
+                &FlowEntry::src_route_node_> > SrcRouteFlowList;
+    typedef boost::intrusive::list<FlowEntry,
+            boost::intrusive::member_hook<FlowEntry,
+                boost::intrusive::list_member_hook<>,
+                &FlowEntry::dst_route_node_> > DstRouteFlowList;
+    typedef std::vector<FlowEntryPtr> FlowEntryPtrList;
 
     typedef std::map<int, int> AceIdFlowCntMap;
+    // Kept ordered by key, since the ACL flow sandesh pages through it
     typedef std::set<FlowEntryPtr, FlowEntryCmp> FlowEntryTree;
     typedef std::map<const AclDBEntry *, AclFlowInfo *> AclFlowTree;
     typedef std::pair<const AclDBEntry *, AclFlowInfo *> AclFlowPair;
@@ -450,7 +543,10 @@ public:
     };
 
     FlowTable() : 
-        flow_entry_map_(), acl_flow_tree_(), acl_listener_id_(), intf_listener_id_(),
+        flow_buckets_(kInitialBuckets),
+        flow_entry_map_(FlowEntryMap::bucket_traits(&flow_buckets_[0],
+                                                    flow_buckets_.size())),
+        acl_flow_tree_(), acl_listener_id_(), intf_listener_id_(),
         vn_listener_id_(), vm_listener_id_(), vrf_listener_id_() {};
     virtual ~FlowTable();
     
@@ -461,6 +557,12 @@ public:
     FlowEntry *Allocate(const FlowKey &key);
     void Add(FlowEntry *flow, FlowEntry *rflow);
     FlowEntry *Find(const FlowKey &key);
+    // Flow following the flow with key in iteration order, or the first
+    // flow if key is NULL. Iteration order is only stable as long as the
+    // table isn't resized.
+    FlowEntry *FindNext(const FlowKey *key);
+    // Set the index of the flow in the vrouter flow table
+    void SetFlowHandle(FlowEntry *flow, uint32_t flow_handle);
 
     bool DeleteNatFlow(FlowKey &key, bool del_nat_flow);
     bool DeleteRevFlow(FlowKey &key, bool del_reverse_flow);
@@ -483,7 +585,15 @@ public:
     friend class Inet4RouteUpdate;
 private:
     static FlowTable* singleton_;
+    // Buckets of flow_entry_map_, doubled when the number of flows exceeds
+    // the number of buckets
+    FlowEntryBuckets flow_buckets_;
     FlowEntryMap flow_entry_map_;
+    // Flows indexed by flow_handle, so that aging can walk the vrouter flow
+    // table in order. Flows without a valid handle, or whose handle was
+    // taken over by another flow, are kept in unindexed_flows_.
+    FlowIndexList flow_index_list_;
+    FlowUnindexedList unindexed_flows_;
 
     AclFlowTree acl_flow_tree_;
     VnFlowTree vn_flow_tree_;
@@ -532,8 +642,11 @@ private:
     void DeleteAclFlows(const AclDBEntry *acl);
     void DeleteInternal(FlowEntryMap::iterator &it);
     bool Delete(FlowEntryMap::iterator &it, bool rev_flow);
+    void Rehash();
 
     void UpdateReverseFlow(FlowEntry *flow, FlowEntry *rflow);
+    void IndexFlow(FlowEntry *flow);
+    void UnindexFlow(FlowEntry *flow);
 
     DISALLOW_COPY_AND_ASSIGN(FlowTable);
 };
@@ -577,7 +690,7 @@ struct VnFlowInfo {
     ~VnFlowInfo() {};
 
     VnEntryConstRef vn_entry;
-    FlowTable::FlowEntryTree fet;
+    FlowTable::VnFlowList fet;
 };
 
 struct IntfFlowInfo {
@@ -585,7 +698,7 @@ struct IntfFlowInfo {
     ~IntfFlowInfo() {};
 
     InterfaceConstRef intf_entry;
-    FlowTable::FlowEntryTree fet;
+    FlowTable::IntfFlowList fet;
 };
 
 struct VmFlowInfo {
@@ -593,13 +706,16 @@ struct VmFlowInfo {
     ~VmFlowInfo() {};
 
     VmEntryConstRef vm_entry;
-    FlowTable::FlowEntryTree fet;
+    FlowTable::VmFlowList fet;
 };
 
 struct RouteFlowInfo {
     RouteFlowInfo() {};
     ~RouteFlowInfo() {};
-    FlowTable::FlowEntryTree fet;
+    bool empty() const { return src_fet.empty() && dst_fet.empty(); }
+    // Flows with the route as source and as destination route
+    FlowTable::SrcRouteFlowList src_fet;
+    FlowTable::DstRouteFlowList dst_fet;
 };
 
 extern SandeshTraceBufferPtr FlowTraceBuf;
@@ -874,7 +874,8 @@ void PktFlowInfo::InitFwdFlow(FlowEntry *flow, const PktInfo *pkt,
             LOG(DEBUG, "Flow index changed from " << flow->flow_handle 
                 << " to " << pkt->GetAgentHdr().cmd_param);
         }
-        flow->flow_handle = pkt->GetAgentHdr().cmd_param;
+        FlowTable::GetFlowTableObject()->SetFlowHandle
+            (flow, pkt->GetAgentHdr().cmd_param);
     }
 
     if (InitFlowCmn(flow, ctrl, rev_ctrl) == false) {
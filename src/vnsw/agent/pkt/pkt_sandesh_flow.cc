@@ -204,14 +204,26 @@ bool PktSandeshFlow::Run() {
     FlowTable *flow_obj = FlowTable::GetFlowTableObject();
 
     if (key_valid_) {
-        it = flow_obj->flow_entry_map_.upper_bound(flow_iteration_key_);
+        // Flows are listed in the iteration order of the flow table, which
+        // starts over from the first flow for start_key
+        FlowEntry *first;
+        if (flow_iteration_key_.CompareKey(FlowKey())) {
+            first = flow_obj->FindNext(NULL);
+        } else {
+            first = flow_obj->FindNext(&flow_iteration_key_);
+        }
+        if (first) {
+            it = flow_obj->flow_entry_map_.iterator_to(*first);
+        } else {
+            it = flow_obj->flow_entry_map_.end();
+        }
     } else {
         FlowErrorResp *resp = new FlowErrorResp();
         SendResponse(resp);
         return true;
     }
     while (it != flow_obj->flow_entry_map_.end()) {
-        FlowEntry *fe = it->second;
+        FlowEntry *fe = &*it;
         SetSandeshFlowData(list, fe);
         ++it;
         count++;
@@ -257,13 +269,10 @@ void FetchFlowRecord::HandleRequest() const {
     key.dst_port = (unsigned)get_dst_port();
     key.protocol = get_protocol();
 
-    FlowTable::FlowEntryMap::iterator it;
-    FlowTable *flow_obj = FlowTable::GetFlowTableObject();
-    it = flow_obj->flow_entry_map_.find(key);
+    FlowEntry *fe = FlowTable::GetFlowTableObject()->Find(key);
     SandeshResponse *resp;
-    if (it != flow_obj->flow_entry_map_.end()) {
+    if (fe != NULL) {
         FlowRecordResp *flow_resp = new FlowRecordResp();
-        FlowEntry *fe = it->second;
         SandeshFlowData data;
         SET_SANDESH_FLOW_DATA(data, fe);
         flow_resp->set_record(data);
@@ -2,6 +2,9 @@
  * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
  */
 
+#include <malloc.h>
+#include <sys/time.h>
+
 #include "test/test_cmn_util.h"
 #include "test_pkt_util.h"
 #include "pkt/pkt_flow.h"
@@ -74,6 +77,72 @@ TEST_F(FlowTest, FlowScaling_1) {
              (count == flow_count + FlowTable::GetFlowTableObject()->Size()));
 }
 
+static uint64_t NowUsec() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static size_t HeapBytes() {
+    struct mallinfo info = mallinfo();
+    return (size_t)(unsigned)info.uordblks + (size_t)(unsigned)info.hblkhd;
+}
+
+// Adds and deletes flow pairs directly through the FlowTable API and
+// reports the rate of each along with the memory used per flow.
+TEST_F(FlowTest, FlowTableBenchmark_1) {
+    char env[100];
+    int count = 1000000;
+    if (getenv("AGENT_FLOW_BENCH_COUNT")) {
+        strcpy(env, getenv("AGENT_FLOW_BENCH_COUNT"));
+        count = strtoul(env, NULL, 0);
+    }
+    FlowTable *table = FlowTable::GetFlowTableObject();
+    VrfEntry *vrf = vnet->GetVrf();
+    uint32_t vnet_ip = vnet->GetIpAddr().to_ulong();
+    size_t heap = HeapBytes();
+    size_t slab = FlowEntry::AllocatedBytes();
+
+    uint64_t start = NowUsec();
+    for (int i = 0; i < count; i++) {
+        uint32_t addr = 0x05000000 + i;
+        FlowKey key(vrf->GetVrfId(), vnet_ip, addr, IPPROTO_UDP, 1000, 2000);
+        FlowKey rkey(vrf->GetVrfId(), addr, vnet_ip, IPPROTO_UDP, 2000, 1000);
+        FlowEntry *flow = table->Allocate(key);
+        FlowEntry *rflow = table->Allocate(rkey);
+        flow->data.intf_entry = vnet;
+        flow->data.vn_entry = vnet->GetVnEntry();
+        flow->data.vm_entry = vnet->GetVmEntry();
+        rflow->data.intf_entry = vnet;
+        rflow->data.vn_entry = vnet->GetVnEntry();
+        rflow->data.vm_entry = vnet->GetVmEntry();
+        table->Add(flow, rflow);
+    }
+    uint64_t add_usec = NowUsec() - start;
+    client->WaitForIdle(count / 10000 + 1);
+    EXPECT_EQ((size_t)count * 2, table->Size());
+
+    size_t flows = (size_t)count * 2;
+    cout << flows << " flows: add " << flows * 1000000ULL / (add_usec + 1)
+         << " flows/sec, " << (HeapBytes() - heap) / flows
+         << " bytes/flow, flow entries "
+         << (FlowEntry::AllocatedBytes() - slab) / flows << " bytes/flow"
+         << endl;
+
+    start = NowUsec();
+    for (int i = 0; i < count; i++) {
+        FlowKey key(vrf->GetVrfId(), vnet_ip, 0x05000000 + i, IPPROTO_UDP,
+                    1000, 2000);
+        table->DeleteRevFlow(key, true);
+    }
+    uint64_t delete_usec = NowUsec() - start;
+    client->WaitForIdle(count / 10000 + 1);
+    EXPECT_EQ(0U, table->Size());
+
+    cout << flows << " flows: delete "
+         << flows * 1000000ULL / (delete_usec + 1) << " flows/sec" << endl;
+}
+
 int main(int argc, char *argv[]) {
     int ret = 0;
 
@@ -937,6 +937,60 @@ TEST_F(FlowTest, ScaleFlowAge_2) {
         GetFlowStatsCollector()->SetFlowAgeTime(bkp_age_time);
 }
 
+// Pass size adapts to the number of flows, so that a scan over all of them
+// completes within the scan time
+TEST_F(FlowTest, ScaleFlowAge_3) {
+    int tmp_age_time = 10 * 1000;
+    FlowStatsCollector *collector =
+        AgentUve::GetInstance()->GetFlowStatsCollector();
+    int bkp_age_time = collector->GetFlowAgeTime();
+    uint64_t bkp_scan_time = collector->GetFlowScanTime();
+    collector->SetFlowAgeTime(tmp_age_time);
+    //Visit all the flows in every run
+    collector->SetFlowScanTime(collector->GetExpiryTime() * 1000ULL);
+    int count_per_pass = FlowStatsCollector::FlowCountPerPass;
+    int flow_count = 2 * count_per_pass;
+    EXPECT_LE((uint32_t)(2 * flow_count),
+              collector->FlowCountPerRun(2 * flow_count));
+
+    for (int i = 0; i < flow_count; i++) {
+        Ip4Address dip(0x1010101 + i);
+        //Add route for all of them
+        CreateRemoteRoute("vrf5", dip.to_string().c_str(), remote_router_ip, 
+                          10, "vn5");
+        TestFlow flow[]=  {
+            {
+                TestFlowPkt(vm1_ip, dip.to_string(), 1, 0, 0, "vrf5", 
+                        flow0->GetInterfaceId(), i),
+                { }
+            },
+            {
+                TestFlowPkt(dip.to_string(), vm1_ip, 1, 0, 0, "vrf5",
+                        flow1->GetInterfaceId(), i + flow_count),
+                { }
+            }
+        };
+        CreateFlow(flow, 2);
+    }
+    EXPECT_EQ((flow_count * 2U), FlowTable::GetFlowTableObject()->Size());
+
+    // Flow entries are created with #pkts = 1, a single run picks up the
+    // stats of all of them
+    client->EnqueueFlowAge();
+    client->WaitForIdle();
+    EXPECT_EQ((flow_count * 2U), FlowTable::GetFlowTableObject()->Size());
+
+    usleep(tmp_age_time + 10);
+    client->EnqueueFlowAge();
+    client->WaitForIdle();
+    WAIT_FOR(100, 1, (0U == FlowTable::GetFlowTableObject()->Size()));
+    EXPECT_EQ(0U, FlowTable::GetFlowTableObject()->Size());
+
+    //Restore flow aging and scan time
+    collector->SetFlowAgeTime(bkp_age_time);
+    collector->SetFlowScanTime(bkp_scan_time);
+}
+
 TEST_F(FlowTest, Nat_FlowAge_1) {
     int tmp_age_time = 10 * 1000;
     int bkp_age_time = 
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <sys/time.h>
+
+#include "test_cmn_util.h"
+#include <oper/mpls.h>
+#include <ksync/ksync_sock.h>
+#include <ksync/ksync_sock_user.h>
+
+std::string eth_itf;
+
+void RouterIdDepInit() {
+}
+
+static uint64_t NowUsec() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+class KSyncScaleTest : public ::testing::Test {
+protected:
+    KSyncScaleTest() : vrf_name_("vrf1"), eth_name_(eth_itf) {
+        server_ip_ = Ip4Address::from_string("10.1.1.11");
+    }
+
+    virtual void SetUp() {
+        client->Reset();
+        VrfAddReq(vrf_name_.c_str());
+        EthInterface::CreateReq(eth_name_,
+                                Agent::GetInstance()->GetDefaultVrf());
+        Agent::GetInstance()->GetDefaultInet4UcRouteTable()->AddResolveRoute(
+                Agent::GetInstance()->GetDefaultVrf(), server_ip_, 24);
+        client->WaitForIdle();
+        //Resolve the server so that the routes have a valid tunnel nexthop
+        AddArp(server_ip_.to_string().c_str(), "0a:0b:0c:0d:0e:0f",
+               eth_name_.c_str());
+        client->WaitForIdle();
+    }
+
+    virtual void TearDown() {
+        Agent::GetInstance()->GetDefaultInet4UcRouteTable()->DeleteReq(
+                Agent::GetInstance()->GetLocalPeer(),
+                Agent::GetInstance()->GetDefaultVrf(), server_ip_, 32);
+        Agent::GetInstance()->GetDefaultInet4UcRouteTable()->DeleteReq(
+                Agent::GetInstance()->GetLocalPeer(),
+                Agent::GetInstance()->GetDefaultVrf(), server_ip_, 24);
+        VrfDelReq(vrf_name_.c_str());
+        client->WaitForIdle();
+        WAIT_FOR(100, 100, (VrfFind(vrf_name_.c_str()) != true));
+    }
+
+    std::string vrf_name_;
+    std::string eth_name_;
+    Ip4Address server_ip_;
+};
+
+// Adds remote VM routes in bulk and times until all of them are programmed
+// in the mock vrouter, once sending each ksync message on its own and once
+// batched, reporting the messages written per send.
+TEST_F(KSyncScaleTest, RouteBatch_1) {
+    char env[100];
+    int count = 10000;
+    if (getenv("AGENT_ROUTE_SCALE_COUNT")) {
+        strcpy(env, getenv("AGENT_ROUTE_SCALE_COUNT"));
+        count = strtoul(env, NULL, 0);
+    }
+    Inet4UcRouteTable *table =
+        Agent::GetInstance()->GetDefaultInet4UcRouteTable();
+    KSyncSock *sock = KSyncSock::Get(0);
+    size_t batch_size = KSyncSock::GetTxBatchSize();
+    size_t sizes[] = {0, batch_size};
+
+    for (int run = 0; run < 2; run++) {
+        KSyncSock::SetTxBatchSize(sizes[run]);
+        int routes = KSyncSockTypeMap::RouteCount();
+        uint64_t msgs = sock->tx_msg_count();
+        uint64_t sends = sock->tx_send_count();
+
+        uint64_t start = NowUsec();
+        for (int i = 0; i < count; i++) {
+            Ip4Address addr(0x03000000 + i);
+            table->AddRemoteVmRoute(NULL, vrf_name_, addr, 32, server_ip_,
+                                    TunnelType::AllType(),
+                                    MplsTable::kStartLabel, vrf_name_);
+        }
+        client->WaitForIdle(count / 1000 + 1);
+        WAIT_FOR(10000, 1000,
+                 (KSyncSockTypeMap::RouteCount() == routes + count));
+        uint64_t usec = NowUsec() - start;
+        EXPECT_EQ(routes + count, KSyncSockTypeMap::RouteCount());
+
+        msgs = sock->tx_msg_count() - msgs;
+        sends = sock->tx_send_count() - sends;
+        EXPECT_TRUE(msgs >= (uint64_t)count);
+        if (sizes[run] == 0) {
+            EXPECT_EQ(msgs, sends);
+        }
+        cout << "Batch size " << sizes[run] << ": " << count << " routes in "
+             << usec / 1000 << " msec, "
+             << count * 1000000ULL / (usec + 1) << " routes/sec, "
+             << (double)msgs / (sends ? sends : 1) << " messages/send"
+             << endl;
+
+        for (int i = 0; i < count; i++) {
+            Ip4Address addr(0x03000000 + i);
+            table->DeleteReq(NULL, vrf_name_, addr, 32);
+        }
+        client->WaitForIdle(count / 1000 + 1);
+        WAIT_FOR(10000, 1000, (KSyncSockTypeMap::RouteCount() == routes));
+    }
+    KSyncSock::SetTxBatchSize(batch_size);
+    EXPECT_TRUE(sock->tx_max_batch() > 1);
+}
+
+int main(int argc, char *argv[]) {
+    GETUSERARGS();
+    client = TestInit(init_file, ksync_init, true, false);
+    if (vm.count("config")) {
+        eth_itf = Agent::GetInstance()->GetIpFabricItfName();
+    } else {
+        eth_itf = "eth0";
+    }
+
+    int ret = RUN_ALL_TESTS();
+    TestShutdown();
+    delete client;
+    return ret;
+}
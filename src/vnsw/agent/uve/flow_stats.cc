@@ -130,101 +130,121 @@ bool FlowStatsCollector::ShouldBeAged(FlowEntry *entry,
     return true;
 }
 
-bool FlowStatsCollector::Run() {
-    FlowTable::FlowEntryMap::iterator it;
-    FlowEntry *entry = NULL, *reverse_flow;
+// Visit a flow, aging it out or exporting its stats. Returns the number of
+// flows visited, which includes the reverse flow if it's aged out as well.
+uint32_t FlowStatsCollector::AgeFlow(FlowEntry *entry, uint64_t curr_time) {
+    FlowTableKSyncObject *ksync_obj = FlowTableKSyncObject::GetKSyncObject();
+    FlowTable *flow_obj = FlowTable::GetFlowTableObject();
+    FlowEntry *reverse_flow = entry->data.reverse_flow.get();
+    bool deleted = false;
+
+    const vr_flow_entry *k_flow =
+        ksync_obj->GetKernelFlowEntry(entry->flow_handle, false);
+    // Can the flow be aged?
+    if (ShouldBeAged(entry, k_flow, curr_time)) {
+        // If reverse_flow is present, wait till both are aged
+        if (reverse_flow) {
+            const vr_flow_entry *k_flow_rev =
+                ksync_obj->GetKernelFlowEntry(reverse_flow->flow_handle,
+                                              false);
+            if (ShouldBeAged(reverse_flow, k_flow_rev, curr_time)) {
+                deleted = true;
+            }
+        } else {
+            deleted = true;
+        }
+    }
+
+    if (deleted == true) {
+        flow_obj->DeleteRevFlow(entry->key, reverse_flow != NULL);
+        return reverse_flow ? 2 : 1;
+    }
+
+    if (k_flow && entry->data.bytes != k_flow->fe_stats.flow_bytes) {
+        uint64_t diff_bytes = k_flow->fe_stats.flow_bytes - entry->data.bytes;
+        uint64_t diff_pkts =
+            k_flow->fe_stats.flow_packets - entry->data.packets;
+        //Update Inter-VN stats
+        AgentUve::GetInstance()->GetInterVnStatsCollector()->UpdateVnStats(entry, 
+                                                            diff_bytes, diff_pkts);
+        entry->data.bytes = k_flow->fe_stats.flow_bytes;
+        entry->data.packets = k_flow->fe_stats.flow_packets;
+        entry->last_modified_time = curr_time;
+        FlowExport(entry, diff_bytes, diff_pkts);
+    }
+
+    if (entry->ShortFlow()) {
+        flow_obj->DeleteRevFlow(entry->key, false);
+    }
+    return 1;
+}
+
+// Flows without an index of their own are few, and are visited once per
+// scan of the index list. Take a reference on them since aging a flow can
+// delete its reverse flow as well.
+uint32_t FlowStatsCollector::AgeUnindexedFlows(uint64_t curr_time) {
+    FlowTable *flow_obj = FlowTable::GetFlowTableObject();
+    std::vector<FlowEntryPtr> flows;
+    for (FlowTable::FlowUnindexedList::iterator it =
+         flow_obj->unindexed_flows_.begin();
+         it != flow_obj->unindexed_flows_.end(); ++it) {
+        flows.push_back(FlowEntryPtr(&*it));
+    }
+
     uint32_t count = 0;
-    bool key_updation_reqd = true, deleted;
-    uint64_t diff_bytes, diff_pkts;
+    for (std::vector<FlowEntryPtr>::iterator it = flows.begin();
+         it != flows.end(); ++it) {
+        if (!(*it)->unindexed_node_.is_linked())
+            continue;
+        count += AgeFlow(it->get(), curr_time);
+    }
+    return count;
+}
+
+// Visit enough flows per run to get through all of them in flow_scan_time_
+uint32_t FlowStatsCollector::FlowCountPerRun(size_t flow_count) {
+    uint64_t interval = GetExpiryTime() * 1000ULL;
+    uint64_t runs = interval ? flow_scan_time_ / interval : 1;
+    if (runs == 0) {
+        runs = 1;
+    }
+    uint64_t count = (flow_count + runs - 1) / runs;
+    if (count < FlowCountPerPass) {
+        return FlowCountPerPass;
+    }
+    return count;
+}
+
+// Walk the flows in the order of their index in the vrouter flow table, so
+// that the stats are read from the mmapped table sequentially.
+bool FlowStatsCollector::Run() {
     FlowTable *flow_obj = FlowTable::GetFlowTableObject();
+    const FlowTable::FlowIndexList &index_list = flow_obj->flow_index_list_;
    
     run_counter_++;
     if (!flow_obj->Size()) {
+        flow_index_ = 0;
         return true;
     }
     uint64_t curr_time = UTCTimestampUsec();
-    it = flow_obj->flow_entry_map_.upper_bound(flow_iteration_key_);
-    if (it == flow_obj->flow_entry_map_.end()) {
-        it = flow_obj->flow_entry_map_.begin();
-    }
-
-    while (it != flow_obj->flow_entry_map_.end()) {
-        entry = it->second;
-        it++;
-        assert(entry);
-        deleted = false;
-
-        const vr_flow_entry *k_flow = 
-            FlowTableKSyncObject::GetKSyncObject()->GetKernelFlowEntry
-            (entry->flow_handle, false);
-        // Can the flow be aged?
-        if (ShouldBeAged(entry, k_flow, curr_time)) {
-            reverse_flow = entry->data.reverse_flow.get();
-            // If reverse_flow is present, wait till both are aged
-            if (reverse_flow) {
-                const vr_flow_entry *k_flow_rev;
-                k_flow_rev = 
-                    FlowTableKSyncObject::GetKSyncObject()->GetKernelFlowEntry
-                    (reverse_flow->flow_handle, false);
-                if (ShouldBeAged(reverse_flow, k_flow_rev, curr_time)) {
-                    deleted = true;
-                }
-            } else {
-                deleted = true;
-            }
-        }
-
-        if (deleted == true) {
-            if (it != flow_obj->flow_entry_map_.end()) {
-                if (it->second == reverse_flow) {
-                    it++;
-                }
-            }
-            FlowTable::GetFlowTableObject()->DeleteRevFlow
-                (entry->key, reverse_flow != NULL? true : false);
-            if (reverse_flow) {
-                count++;
-                if (count == FlowCountPerPass) {
-                    break;
-                }
-            }
-        }
-
-        if (deleted == false && k_flow) {
-            if (entry->data.bytes != k_flow->fe_stats.flow_bytes) {
-                diff_bytes = k_flow->fe_stats.flow_bytes - entry->data.bytes;
-                diff_pkts = k_flow->fe_stats.flow_packets - entry->data.packets;
-                //Update Inter-VN stats
-                AgentUve::GetInstance()->GetInterVnStatsCollector()->UpdateVnStats(entry, 
-                                                                    diff_bytes, diff_pkts);
-                entry->data.bytes = k_flow->fe_stats.flow_bytes;
-                entry->data.packets = k_flow->fe_stats.flow_packets;
-                entry->last_modified_time = curr_time;
-                FlowExport(entry, diff_bytes, diff_pkts);
-            }
-        }
-
-        if ((!deleted) && entry->ShortFlow()) {
-            deleted = true;
-            FlowTable::GetFlowTableObject()->DeleteRevFlow(entry->key, false);
-        }
+    uint32_t pass_count = FlowCountPerRun(flow_obj->Size());
+    uint32_t count = 0;
 
-        count++;
-        if (count == FlowCountPerPass) {
-            break;
-        }
+    if (flow_index_ == 0) {
+        count += AgeUnindexedFlows(curr_time);
     }
-    
-    if (count == FlowCountPerPass) {
-        if (it != flow_obj->flow_entry_map_.end()) {
-            flow_iteration_key_ = entry->key;
-            key_updation_reqd = false;
+
+    while (flow_index_ < index_list.size() && count < pass_count) {
+        FlowEntry *entry = index_list[flow_index_++];
+        if (entry == NULL) {
+            continue;
         }
+        count += AgeFlow(entry, curr_time);
     }
 
-    /* Reset the iteration key if we are done with all the elements */
-    if (key_updation_reqd) {
-        flow_iteration_key_.Reset();
+    /* Start over if we are done with all the elements */
+    if (flow_index_ >= index_list.size()) {
+        flow_index_ = 0;
     }
     return true;
 }
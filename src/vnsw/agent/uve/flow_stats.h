@@ -18,13 +18,17 @@ struct FlowKey;
 class FlowStatsCollector : public StatsCollector {
 public:
     static const uint64_t FlowAgeTime = 1000000 * 180;
+    // Time to visit every flow once, in microseconds
+    static const uint64_t FlowScanTime = 1000000 * 30;
+    // Minimum number of flows visited per run
     static const uint32_t FlowCountPerPass = 100;
     static const uint32_t FlowStatsInterval = (2000); // time in milliseconds
 
     FlowStatsCollector(boost::asio::io_service &io, int intvl) :
         StatsCollector(StatsCollector::FlowStatsCollector, io, intvl, "Flow stats collector") {
-        flow_iteration_key_.Reset();
+        flow_index_ = 0;
         flow_age_time_intvl_ = FlowAgeTime;
+        flow_scan_time_ = FlowScanTime;
     }
     virtual ~FlowStatsCollector() { };
 
@@ -32,12 +36,19 @@ public:
     bool Run();
     uint64_t GetFlowAgeTime() { return flow_age_time_intvl_; }
     void SetFlowAgeTime(uint64_t usecs) { flow_age_time_intvl_ = usecs; }
+    uint64_t GetFlowScanTime() { return flow_scan_time_; }
+    void SetFlowScanTime(uint64_t usecs) { flow_scan_time_ = usecs; }
+    uint32_t FlowCountPerRun(size_t flow_count);
 private:
     bool ShouldBeAged(FlowEntry *entry, const vr_flow_entry *k_flow,
                       uint64_t curr_time);
+    uint32_t AgeFlow(FlowEntry *entry, uint64_t curr_time);
+    uint32_t AgeUnindexedFlows(uint64_t curr_time);
     static void SourceIpOverride(FlowEntry *flow, FlowDataIpv4 &s_flow);
-    FlowKey flow_iteration_key_;
+    // Next index of FlowTable::flow_index_list_ to visit
+    uint32_t flow_index_;
     uint64_t flow_age_time_intvl_;
+    uint64_t flow_scan_time_;
     DISALLOW_COPY_AND_ASSIGN(FlowStatsCollector);
 };
 
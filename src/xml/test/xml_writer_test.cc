@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "xml/xml_writer.h"
+
+#include <sstream>
+#include <pugixml/pugixml.hpp>
+
+#include "base/logging.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+class XmlWriterTest : public ::testing::Test {
+protected:
+    static string PugiString(const pugi::xml_document &xdoc) {
+        ostringstream oss;
+        xdoc.save(oss);
+        return oss.str();
+    }
+
+    static string WriterString(const XmlWriter &writer) {
+        return string(reinterpret_cast<const char *>(writer.data()),
+                      writer.size());
+    }
+};
+
+TEST_F(XmlWriterTest, EmptyElement) {
+    pugi::xml_document xdoc;
+    pugi::xml_node node = xdoc.append_child("message");
+    node.append_attribute("from") = "a";
+
+    XmlWriter writer;
+    writer.AddDeclaration();
+    writer.StartElement("message");
+    writer.AddAttribute("from", "a");
+    writer.EndElement();
+
+    EXPECT_EQ(PugiString(xdoc), WriterString(writer));
+}
+
+TEST_F(XmlWriterTest, NestedElements) {
+    pugi::xml_document xdoc;
+    pugi::xml_node message = xdoc.append_child("message");
+    message.append_attribute("from") = "network-control@contrailsystems.com";
+    message.append_attribute("to") = "agent/bgp-peer";
+    pugi::xml_node event = message.append_child("event");
+    event.append_attribute("xmlns") = "http://jabber.org/protocol/pubsub";
+    pugi::xml_node items = event.append_child("items");
+    items.append_attribute("node") = "1/1/blue";
+    for (int idx = 0; idx < 3; ++idx) {
+        pugi::xml_node item = items.append_child("item");
+        item.append_attribute("id") = "10.1.1.1/32";
+        pugi::xml_node entry = item.append_child("entry");
+        pugi::xml_node nlri = entry.append_child("nlri");
+        nlri.append_child("af").text().set(1);
+        nlri.append_child("address").text().set("10.1.1.1/32");
+        entry.append_child("label").text().set(idx + 16);
+        entry.append_child("virtual-network").text().set("");
+        entry.append_child("security-group-list");
+    }
+    pugi::xml_node retract = items.append_child("retract");
+    retract.append_attribute("id") = "10.1.1.2/32";
+
+    XmlWriter writer;
+    writer.AddDeclaration();
+    writer.StartElement("message");
+    writer.AddAttribute("from", "network-control@contrailsystems.com");
+    writer.AddAttribute("to", "agent/bgp-peer");
+    writer.StartElement("event");
+    writer.AddAttribute("xmlns", "http://jabber.org/protocol/pubsub");
+    writer.StartElement("items");
+    writer.AddAttribute("node", "1/1/blue");
+    for (int idx = 0; idx < 3; ++idx) {
+        writer.StartElement("item");
+        writer.AddAttribute("id", "10.1.1.1/32");
+        writer.StartElement("entry");
+        writer.StartElement("nlri");
+        writer.AddTextElement("af", 1);
+        writer.AddTextElement("address", "10.1.1.1/32");
+        writer.EndElement();
+        writer.AddTextElement("label", static_cast<unsigned int>(idx + 16));
+        writer.AddTextElement("virtual-network", "");
+        writer.StartElement("security-group-list");
+        writer.EndElement();
+        writer.EndElement();
+        writer.EndElement();
+    }
+    writer.StartElement("retract");
+    writer.AddAttribute("id", "10.1.1.2/32");
+    writer.EndElement();
+    writer.EndElement();
+    writer.EndElement();
+    writer.EndElement();
+    EXPECT_EQ(0, writer.depth());
+
+    EXPECT_EQ(PugiString(xdoc), WriterString(writer));
+}
+
+TEST_F(XmlWriterTest, Escape) {
+    const char *value = "a&b<c>d\"e'f";
+
+    pugi::xml_document xdoc;
+    pugi::xml_node node = xdoc.append_child("node");
+    node.append_attribute("attr") = value;
+    node.append_child("text").text().set(value);
+
+    XmlWriter writer;
+    writer.AddDeclaration();
+    writer.StartElement("node");
+    writer.AddAttribute("attr", value);
+    writer.AddTextElement("text", value);
+    writer.EndElement();
+
+    EXPECT_EQ(PugiString(xdoc), WriterString(writer));
+
+    string escaped;
+    XmlWriter::EscapeAttribute(value, &escaped);
+    EXPECT_EQ(string::npos, escaped.find('"'));
+}
+
+//
+// Encode the payload first and patch different headers in front of it.
+// The payload must stay in place.
+//
+TEST_F(XmlWriterTest, Prepend) {
+    XmlWriter writer(32);
+    writer.AssumeElement("message");
+    writer.StartElement("event");
+    writer.EndElement();
+    writer.EndElement();
+    const uint8_t *payload = writer.data();
+    size_t payload_size = writer.size();
+    EXPECT_EQ("\t<event />\n</message>\n", WriterString(writer));
+
+    string header1("<message to=\"a\">\n");
+    EXPECT_TRUE(writer.Prepend(header1.data(), header1.size()));
+    EXPECT_EQ(header1.size() + payload_size, writer.size());
+    EXPECT_EQ(payload, writer.data() + header1.size());
+    EXPECT_EQ("<message to=\"a\">\n\t<event />\n</message>\n",
+              WriterString(writer));
+
+    writer.ResetHeadroom();
+    string header2("<message to=\"bb\">\n");
+    EXPECT_TRUE(writer.Prepend(header2.data(), header2.size()));
+    EXPECT_EQ(payload, writer.data() + header2.size());
+    EXPECT_EQ("<message to=\"bb\">\n\t<event />\n</message>\n",
+              WriterString(writer));
+
+    writer.ResetHeadroom();
+    string header3(33, ' ');
+    EXPECT_FALSE(writer.Prepend(header3.data(), header3.size()));
+    EXPECT_EQ(payload, writer.data());
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
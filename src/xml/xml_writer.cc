@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "xml/xml_writer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cassert>
+
+using namespace std;
+
+XmlWriter::XmlWriter(size_t headroom, size_t capacity)
+    : headroom_(headroom), start_(headroom) {
+    buffer_.reserve(headroom + capacity);
+    buffer_.resize(headroom);
+}
+
+void XmlWriter::Append(const char *str) {
+    Append(str, strlen(str));
+}
+
+//
+// Mirror the escaping rules used by pugi when saving a document. Text
+// escapes &, < and >, while attribute values escape &, < and the double
+// quote. Control characters other than tab are written as character
+// references, except that newline and carriage return are left alone in
+// text.
+//
+void XmlWriter::AppendEscaped(const char *value, bool attribute) {
+    const char *run = value;
+    const char *s = value;
+    for (; *s != '\0'; ++s) {
+        unsigned char ch = static_cast<unsigned char>(*s);
+        const char *ref = NULL;
+        switch (ch) {
+        case '&':
+            ref = "&amp;";
+            break;
+        case '<':
+            ref = "&lt;";
+            break;
+        case '>':
+            if (!attribute)
+                ref = "&gt;";
+            break;
+        case '"':
+            if (attribute)
+                ref = "&quot;";
+            break;
+        case '\t':
+            break;
+        case '\n':
+        case '\r':
+            if (!attribute)
+                break;
+            // Fall through.
+        default:
+            if (ch < 32) {
+                Append(run, s - run);
+                char num[8];
+                snprintf(num, sizeof(num), "&#%c%c;", '0' + ch / 10,
+                         '0' + ch % 10);
+                Append(num);
+                run = s + 1;
+            }
+            break;
+        }
+        if (ref) {
+            Append(run, s - run);
+            Append(ref);
+            run = s + 1;
+        }
+    }
+    Append(run, s - run);
+}
+
+void XmlWriter::EscapeAttribute(const char *value, string *out) {
+    XmlWriter writer(0, strlen(value) + 16);
+    writer.AppendEscaped(value, true);
+    out->assign(reinterpret_cast<const char *>(writer.data()), writer.size());
+}
+
+void XmlWriter::AddDeclaration() {
+    assert(stack_.empty());
+    Append("<?xml version=\"1.0\"?>\n");
+}
+
+//
+// Terminate the start tag of the current element, if this is the first child
+// being added to it.
+//
+void XmlWriter::OpenChild() {
+    if (stack_.empty())
+        return;
+    ElementState &parent = stack_.back();
+    if (!parent.has_children) {
+        Append(">\n", 2);
+        parent.has_children = true;
+    }
+}
+
+void XmlWriter::StartElement(const char *name) {
+    OpenChild();
+    AppendIndent(stack_.size());
+    Append('<');
+    Append(name);
+    stack_.push_back(ElementState(name));
+}
+
+void XmlWriter::AddAttribute(const char *name, const char *value) {
+    assert(!stack_.empty() && !stack_.back().has_children);
+    Append(' ');
+    Append(name);
+    Append("=\"", 2);
+    AppendEscaped(value, true);
+    Append('"');
+}
+
+void XmlWriter::EndElement() {
+    assert(!stack_.empty());
+    const ElementState &element = stack_.back();
+    if (element.has_children) {
+        AppendIndent(stack_.size() - 1);
+        Append("</", 2);
+        Append(element.name);
+        Append(">\n", 2);
+    } else {
+        Append(" />\n", 4);
+    }
+    stack_.pop_back();
+}
+
+void XmlWriter::AddTextElement(const char *name, const char *value) {
+    OpenChild();
+    AppendIndent(stack_.size());
+    Append('<');
+    Append(name);
+    Append('>');
+    AppendEscaped(value, false);
+    Append("</", 2);
+    Append(name);
+    Append(">\n", 2);
+}
+
+void XmlWriter::AddTextElement(const char *name, int value) {
+    char num[16];
+    snprintf(num, sizeof(num), "%d", value);
+    AddTextElement(name, num);
+}
+
+void XmlWriter::AddTextElement(const char *name, unsigned int value) {
+    char num[16];
+    snprintf(num, sizeof(num), "%u", value);
+    AddTextElement(name, num);
+}
+
+void XmlWriter::AssumeElement(const char *name) {
+    stack_.push_back(ElementState(name));
+    stack_.back().has_children = true;
+}
+
+bool XmlWriter::Prepend(const char *data, size_t len) {
+    if (len > start_)
+        return false;
+    start_ -= len;
+    memcpy(&buffer_[start_], data, len);
+    return true;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __XML_WRITER_H__
+#define __XML_WRITER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "base/util.h"
+
+//
+// Append-only XML serializer that writes directly into a contiguous buffer.
+//
+// The output is byte for byte identical to what pugi::xml_document::save()
+// generates with the default format i.e. one element per line, indented by
+// a tab per nesting level, and elements that only hold text kept on a single
+// line. This lets the hot encoding paths skip building a DOM tree without
+// changing what goes out on the wire.
+//
+// The buffer optionally starts with some headroom. Prepend() fills it from
+// the end so that a small, variable header can be placed in front of the
+// already encoded payload without moving the payload.
+//
+class XmlWriter {
+public:
+    static const size_t kDefaultCapacity = 4096;
+
+    explicit XmlWriter(size_t headroom = 0,
+                       size_t capacity = kDefaultCapacity);
+
+    // Write the XML declaration emitted by pugi at the top of a document.
+    void AddDeclaration();
+
+    // Open a new element. Attributes can be added until a child element,
+    // text or the end of the element is written.
+    void StartElement(const char *name);
+    void AddAttribute(const char *name, const char *value);
+    void AddAttribute(const char *name, const std::string &value) {
+        AddAttribute(name, value.c_str());
+    }
+    void EndElement();
+
+    // Write a complete element that contains just the given text.
+    void AddTextElement(const char *name, const char *value);
+    void AddTextElement(const char *name, const std::string &value) {
+        AddTextElement(name, value.c_str());
+    }
+    void AddTextElement(const char *name, int value);
+    void AddTextElement(const char *name, unsigned int value);
+
+    // Pretend that an element with the given name has already been opened
+    // and has children. Used when the start tag is emitted separately via
+    // Prepend(), but the closing tag is written by EndElement().
+    void AssumeElement(const char *name);
+
+    // Place the data immediately in front of the current content. Returns
+    // false if there isn't enough headroom left.
+    bool Prepend(const char *data, size_t len);
+
+    // Discard any data placed in the headroom.
+    void ResetHeadroom() { start_ = headroom_; }
+
+    const uint8_t *data() const {
+        if (buffer_.empty())
+            return NULL;
+        return reinterpret_cast<const uint8_t *>(&buffer_[0] + start_);
+    }
+    size_t size() const { return buffer_.size() - start_; }
+
+    // The content without any data placed in the headroom.
+    const uint8_t *payload() const {
+        if (buffer_.empty())
+            return NULL;
+        return reinterpret_cast<const uint8_t *>(&buffer_[0] + headroom_);
+    }
+    size_t payload_size() const { return buffer_.size() - headroom_; }
+    size_t headroom() const { return headroom_; }
+    size_t depth() const { return stack_.size(); }
+
+    static void EscapeAttribute(const char *value, std::string *out);
+
+private:
+    struct ElementState {
+        explicit ElementState(const char *name)
+            : name(name), has_children(false) {
+        }
+        const char *name;
+        bool has_children;
+    };
+
+    void Append(const char *data, size_t len) {
+        buffer_.insert(buffer_.end(), data, data + len);
+    }
+    void Append(const char *str);
+    void Append(char c) { buffer_.push_back(c); }
+    void AppendIndent(size_t depth) {
+        buffer_.insert(buffer_.end(), depth, '\t');
+    }
+    void AppendEscaped(const char *value, bool attribute);
+    void OpenChild();
+
+    std::vector<char> buffer_;
+    std::vector<ElementState> stack_;
+    size_t headroom_;
+    size_t start_;
+
+    DISALLOW_COPY_AND_ASSIGN(XmlWriter);
+};
+
+#endif
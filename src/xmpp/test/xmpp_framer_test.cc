@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "xmpp/xmpp_framer.h"
+
+#include <string.h>
+#include <boost/regex.hpp>
+
+#include "base/logging.h"
+#include "base/util.h"
+#include "xmpp/xmpp_str.h"
+
+#include "testing/gunit.h"
+
+using namespace std;
+
+static const char *kStreamHeader =
+    "<?xml version='1.0'?><stream:stream from='agent' to='control-node' "
+    "version='1.0' xml:lang='en' xmlns='jabber:client' "
+    "xmlns:stream='http://etherx.jabber.org/streams' >";
+
+//
+// Regex based framing as done by XmppSession before the introduction of
+// XmppFramer. Used as the baseline in the benchmark.
+//
+class XmppRegexFramer {
+public:
+    XmppRegexFramer()
+        : patt_(rXMPP_MESSAGE), tag_known_(false) {
+        offset_ = buf_.begin();
+    }
+
+    // Returns the number of frames found in the data.
+    int Parse(const uint8_t *data, size_t size) {
+        string str(data, data + size);
+        if (buf_.empty()) {
+            buf_ = str;
+            offset_ = buf_.begin();
+        } else {
+            int pos = offset_ - buf_.begin();
+            buf_ += str;
+            offset_ = buf_.begin() + pos;
+        }
+
+        int count = 0;
+        while (Match()) {
+            string xml(string::const_iterator(buf_.begin()), offset_);
+            count++;
+            if (offset_ == buf_.end()) {
+                buf_.clear();
+                break;
+            }
+            buf_ = string(offset_, string::const_iterator(buf_.end()));
+            offset_ = buf_.begin();
+        }
+        return count;
+    }
+
+private:
+    bool Match() {
+        while (true) {
+            if (!tag_known_) {
+                size_t pos = buf_.find_first_not_of(sXMPP_VALIDWS);
+                if (pos != 0) {
+                    if (pos == string::npos) pos = buf_.size();
+                    offset_ = buf_.begin() + pos;
+                    return true;
+                }
+            }
+            boost::regex patt = tag_known_ ? close_patt_ : patt_;
+            string::const_iterator end = buf_.end();
+            if (regex_search(offset_, end, res_, patt,
+                    boost::match_default | boost::match_partial) == 0) {
+                return false;
+            }
+            if (!res_[0].matched) {
+                offset_ = res_[0].first;
+                return false;
+            }
+            offset_ = res_[0].second;
+            if (!tag_known_) {
+                string tag(res_[0].first + 1, res_[0].second);
+                close_patt_ = boost::regex("</" + tag + "[\\s\\t\\r\\n]*>");
+            }
+            tag_known_ = !tag_known_;
+            if (!tag_known_)
+                return true;
+        }
+    }
+
+    boost::regex patt_;
+    boost::regex close_patt_;
+    bool tag_known_;
+    string buf_;
+    string::const_iterator offset_;
+    boost::match_results<string::const_iterator> res_;
+};
+
+class XmppFramerTest : public ::testing::Test {
+protected:
+    XmppFramerTest() {
+        framer_.set_mode(XmppFramer::STANZA);
+    }
+
+    static string FrameString(const XmppFramer &framer) {
+        boost::asio::const_buffer frame = framer.frame();
+        const char *cp = boost::asio::buffer_cast<const char *>(frame);
+        return string(cp, boost::asio::buffer_size(frame));
+    }
+
+    static string RouteStanza(int idx) {
+        ostringstream oss;
+        oss << "<iq type=\"set\" from=\"agent\" to=\"control-node/bgp-peer\" "
+            << "id=\"pubsub" << idx << "\">"
+            << "<pubsub xmlns=\"http://jabber.org/protocol/pubsub\">"
+            << "<publish node=\"1/1/blue/10.1." << (idx / 256) % 256 << "."
+            << idx % 256 << "/32\"><item><entry><nlri><af>1</af>"
+            << "<safi>1</safi><address>10.1." << (idx / 256) % 256 << "."
+            << idx % 256 << "/32</address></nlri><next-hops><next-hop>"
+            << "<af>1</af><address>192.168.1.1</address><label>"
+            << 16 + idx << "</label></next-hop></next-hops></entry></item>"
+            << "</publish></pubsub></iq>";
+        return oss.str();
+    }
+
+    vector<string> ParseAll(const string &data, size_t chunk) {
+        vector<string> frames;
+        const uint8_t *cp = reinterpret_cast<const uint8_t *>(data.data());
+        for (size_t start = 0; start < data.size(); start += chunk) {
+            size_t size = min(chunk, data.size() - start);
+            size_t offset = 0;
+            while (offset < size) {
+                size_t consumed;
+                bool complete = framer_.Parse(cp + start + offset,
+                                              size - offset, &consumed);
+                offset += consumed;
+                if (!complete)
+                    break;
+                frames.push_back(FrameString(framer_));
+            }
+        }
+        return frames;
+    }
+
+    XmppFramer framer_;
+};
+
+TEST_F(XmppFramerTest, SingleBuffer) {
+    string msg("<iq type='set'><pubsub/></iq>");
+    const uint8_t *cp = reinterpret_cast<const uint8_t *>(msg.data());
+    size_t consumed;
+    EXPECT_TRUE(framer_.Parse(cp, msg.size(), &consumed));
+    EXPECT_EQ(msg.size(), consumed);
+    EXPECT_EQ(msg, FrameString(framer_));
+
+    // The frame refers to the input buffer.
+    EXPECT_EQ(cp, boost::asio::buffer_cast<const uint8_t *>(framer_.frame()));
+    EXPECT_EQ(0, framer_.pending_size());
+    EXPECT_FALSE(framer_.in_frame());
+}
+
+TEST_F(XmppFramerTest, MultipleStanzas) {
+    string msg1("<iq type='set'><pubsub/></iq>");
+    string msg2("<message from='a'><body>x</body></message >");
+    string msg3("<iq type='get'><a/></iq\n>");
+    vector<string> frames = ParseAll(msg1 + msg2 + msg3, 4096);
+    ASSERT_EQ(3, frames.size());
+    EXPECT_EQ(msg1, frames[0]);
+    EXPECT_EQ(msg2, frames[1]);
+    EXPECT_EQ(msg3, frames[2]);
+}
+
+//
+// Split the data at every possible offset.
+//
+TEST_F(XmppFramerTest, SpanBuffers) {
+    string msg1("<iq type='set'><pubsub><iqx/></pubsub></iq>");
+    string msg2("<message from='a'><body>x</body></message>");
+    string data = msg1 + msg2;
+    const uint8_t *cp = reinterpret_cast<const uint8_t *>(data.data());
+    for (size_t split = 1; split < data.size(); ++split) {
+        vector<string> frames;
+        size_t offset = 0;
+        while (offset < data.size()) {
+            size_t end = offset < split ? split : data.size();
+            size_t consumed;
+            bool complete = framer_.Parse(cp + offset, end - offset,
+                                          &consumed);
+            offset += consumed;
+            if (complete)
+                frames.push_back(FrameString(framer_));
+        }
+        ASSERT_EQ(2, frames.size()) << "split at " << split;
+        EXPECT_EQ(msg1, frames[0]);
+        EXPECT_EQ(msg2, frames[1]);
+    }
+}
+
+TEST_F(XmppFramerTest, NearMissCloseTag) {
+    string msg("<iq><a></iqx></iq x></iq></b></iq   >");
+    vector<string> frames = ParseAll(msg + "<iq/>", 4096);
+    ASSERT_EQ(1, frames.size());
+    EXPECT_EQ("<iq><a></iqx></iq x></iq>", frames[0]);
+    EXPECT_TRUE(framer_.in_frame());
+}
+
+//
+// Stanza delivered in several buffers, with the start of the next frame in
+// the last one.
+//
+TEST_F(XmppFramerTest, TrailingData) {
+    const char *chunks[] = {
+        "<message a = '2'> ", "<item> blah blah ", "</item></message><iq>"
+    };
+    vector<string> frames;
+    for (size_t idx = 0; idx < sizeof(chunks) / sizeof(chunks[0]); ++idx) {
+        const uint8_t *cp = reinterpret_cast<const uint8_t *>(chunks[idx]);
+        size_t size = strlen(chunks[idx]);
+        size_t offset = 0;
+        while (offset < size) {
+            size_t consumed;
+            bool complete = framer_.Parse(cp + offset, size - offset,
+                                          &consumed);
+            offset += consumed;
+            if (complete)
+                frames.push_back(FrameString(framer_));
+        }
+    }
+    ASSERT_EQ(1, frames.size());
+    EXPECT_EQ("<message a = '2'> <item> blah blah </item></message>",
+              frames[0]);
+    EXPECT_TRUE(framer_.in_frame());
+    EXPECT_EQ(4, framer_.pending_size());
+}
+
+TEST_F(XmppFramerTest, Whitespace) {
+    string msg("<iq></iq>");
+    vector<string> frames = ParseAll(" \n" + msg + "\t " + msg, 4096);
+    ASSERT_EQ(4, frames.size());
+    EXPECT_EQ(" \n", frames[0]);
+    EXPECT_EQ(msg, frames[1]);
+    EXPECT_EQ("\t ", frames[2]);
+    EXPECT_EQ(msg, frames[3]);
+}
+
+TEST_F(XmppFramerTest, StreamHeader) {
+    framer_.set_mode(XmppFramer::STREAM_HEADER);
+    string header(kStreamHeader);
+    string features("<stream:features/>");
+    for (size_t chunk = 1; chunk <= header.size(); chunk += 7) {
+        vector<string> frames = ParseAll(header + features, chunk);
+        ASSERT_EQ(1, frames.size());
+        EXPECT_EQ(header, frames[0]);
+        framer_.Reset();
+    }
+
+    // Namespace without the closing quote does not terminate the header.
+    string bad("<stream:stream xmlns='http://etherx.jabber.org/streams>");
+    vector<string> frames = ParseAll(bad, 4096);
+    EXPECT_EQ(0, frames.size());
+    EXPECT_TRUE(framer_.in_frame());
+}
+
+//
+// Compare the framer against regex based framing for a stream of route
+// updates delivered in TcpSession sized buffers. Not part of the regular
+// run, use --gtest_also_run_disabled_tests to run it.
+//
+TEST_F(XmppFramerTest, DISABLED_Benchmark) {
+    static const int kStanzaCount = 20000;
+    static const size_t kChunkSize = 4096;
+
+    string data;
+    for (int idx = 0; idx < kStanzaCount; ++idx) {
+        data += RouteStanza(idx);
+        if (idx % 10 == 0)
+            data += " ";
+    }
+    const uint8_t *cp = reinterpret_cast<const uint8_t *>(data.data());
+
+    uint64_t start = UTCTimestampUsec();
+    vector<string> frames = ParseAll(data, kChunkSize);
+    uint64_t framer_usecs = UTCTimestampUsec() - start;
+
+    XmppRegexFramer regex_framer;
+    int regex_count = 0;
+    start = UTCTimestampUsec();
+    for (size_t offset = 0; offset < data.size(); offset += kChunkSize) {
+        regex_count += regex_framer.Parse(cp + offset,
+            min(kChunkSize, data.size() - offset));
+    }
+    uint64_t regex_usecs = UTCTimestampUsec() - start;
+
+    EXPECT_EQ(kStanzaCount + kStanzaCount / 10, frames.size());
+    EXPECT_EQ(frames.size(), regex_count);
+
+    double mbytes = data.size() / (1024.0 * 1024.0);
+    cout << "Framed " << frames.size() << " messages, " << mbytes << " MB"
+         << endl;
+    cout << "XmppFramer: " << framer_usecs << " usecs, "
+         << mbytes * 1000000 / max(framer_usecs, uint64_t(1)) << " MB/sec"
+         << endl;
+    cout << "Regex:      " << regex_usecs << " usecs, "
+         << mbytes * 1000000 / max(regex_usecs, uint64_t(1)) << " MB/sec"
+         << endl;
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "xmpp/xmpp_framer.h"
+
+#include <string.h>
+
+#include "xmpp/xmpp_str.h"
+
+using namespace std;
+using boost::asio::const_buffer;
+
+// Whitespace allowed as filler between frames.
+static inline bool IsFillerSpace(uint8_t ch) {
+    return ch != '\0' && strchr(sXMPP_VALIDWS, ch) != NULL;
+}
+
+// Whitespace allowed before the '>' that terminates a tag.
+static inline bool IsTagSpace(uint8_t ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' ||
+           ch == '\f' || ch == '\v';
+}
+
+XmppFramer::Literal::Literal(const char *str)
+    : str_(str), failure_(str_.size(), 0), matched_(0) {
+    for (size_t idx = 1, len = 0; idx < str_.size(); ++idx) {
+        while (len > 0 && str_[idx] != str_[len]) {
+            len = failure_[len - 1];
+        }
+        if (str_[idx] == str_[len])
+            len++;
+        failure_[idx] = len;
+    }
+}
+
+//
+// Advance the partial match by one character. Returns true when the last
+// character of the literal has been matched.
+//
+bool XmppFramer::Literal::Match(uint8_t ch) {
+    while (matched_ > 0 && static_cast<uint8_t>(str_[matched_]) != ch) {
+        matched_ = failure_[matched_ - 1];
+    }
+    if (static_cast<uint8_t>(str_[matched_]) == ch)
+        matched_++;
+    if (matched_ == str_.size()) {
+        matched_ = 0;
+        return true;
+    }
+    return false;
+}
+
+XmppFramer::XmppFramer()
+    : mode_(STREAM_HEADER),
+      state_(IDLE),
+      iq_open_(sXMPP_IQ),
+      message_open_(sXMPP_MESSAGE),
+      iq_close_("</" sXMPP_IQ_KEY),
+      message_close_("</" sXMPP_MESSAGE_KEY),
+      close_(NULL),
+      stream_open_("<" sXMPP_STREAM_O),
+      stream_ns_("http://etherx.jabber.org/streams"),
+      frame_done_(false) {
+}
+
+void XmppFramer::set_mode(Mode mode) {
+    assert(!in_frame());
+    mode_ = mode;
+}
+
+void XmppFramer::ResetState() {
+    state_ = IDLE;
+    iq_open_.Reset();
+    message_open_.Reset();
+    iq_close_.Reset();
+    message_close_.Reset();
+    close_ = NULL;
+    stream_open_.Reset();
+    stream_ns_.Reset();
+}
+
+void XmppFramer::Reset() {
+    ResetState();
+    pending_.clear();
+    frame_done_ = false;
+    frame_ = const_buffer();
+}
+
+//
+// Run the state machine for one character. Returns false if the character
+// does not belong to the current state and must be looked at again in the
+// new state. Sets complete when the character terminates the frame.
+//
+bool XmppFramer::Consume(uint8_t ch, bool *complete) {
+    switch (state_) {
+    case IDLE:
+        if (IsFillerSpace(ch)) {
+            state_ = WHITESPACE;
+            return true;
+        }
+        state_ = (mode_ == STANZA) ? STANZA_OPEN : STREAM_OPEN;
+        return false;
+
+    case WHITESPACE:
+        if (IsFillerSpace(ch))
+            return true;
+        *complete = true;
+        return false;
+
+    case STANZA_OPEN:
+        if (iq_open_.Match(ch)) {
+            close_ = &iq_close_;
+            state_ = STANZA_CLOSE;
+        } else if (message_open_.Match(ch)) {
+            close_ = &message_close_;
+            state_ = STANZA_CLOSE;
+        }
+        return true;
+
+    case STANZA_CLOSE:
+        if (close_->Match(ch))
+            state_ = STANZA_CLOSE_END;
+        return true;
+
+    case STANZA_CLOSE_END:
+        if (IsTagSpace(ch))
+            return true;
+        if (ch == '>') {
+            *complete = true;
+            return true;
+        }
+        state_ = STANZA_CLOSE;
+        return false;
+
+    case STREAM_OPEN:
+        if (stream_open_.Match(ch))
+            state_ = STREAM_NS;
+        return true;
+
+    case STREAM_NS:
+        if (stream_ns_.Match(ch))
+            state_ = STREAM_NS_QUOTE;
+        return true;
+
+    case STREAM_NS_QUOTE:
+        if (ch == '"' || ch == '\'') {
+            state_ = STREAM_NS_END;
+            return true;
+        }
+        state_ = STREAM_NS;
+        return false;
+
+    case STREAM_NS_END:
+        if (IsTagSpace(ch))
+            return true;
+        if (ch == '>') {
+            *complete = true;
+            return true;
+        }
+        state_ = STREAM_NS;
+        return false;
+    }
+
+    assert(false);
+    return true;
+}
+
+//
+// Returns the number of leading characters that can't start a match of the
+// literals that the current state looks for. This lets the bulk of a stanza
+// be skipped with memchr instead of going through the state machine.
+//
+size_t XmppFramer::Skip(const uint8_t *data, size_t size) const {
+    const Literal *literal = NULL;
+    switch (state_) {
+    case STANZA_OPEN:
+        if (iq_open_.idle() && message_open_.idle())
+            literal = &iq_open_;
+        break;
+    case STANZA_CLOSE:
+        literal = close_;
+        break;
+    case STREAM_OPEN:
+        literal = &stream_open_;
+        break;
+    default:
+        break;
+    }
+    if (literal == NULL || !literal->idle())
+        return 0;
+
+    const void *next = memchr(data, literal->first(), size);
+    if (next == NULL)
+        return size;
+    return static_cast<const uint8_t *>(next) - data;
+}
+
+void XmppFramer::SetFrame(const uint8_t *data, size_t size) {
+    frame_ = const_buffer(data, size);
+    frame_done_ = true;
+}
+
+bool XmppFramer::Parse(const uint8_t *data, size_t size, size_t *consumed) {
+    // Discard the previous frame.
+    if (frame_done_) {
+        pending_.clear();
+        frame_done_ = false;
+        frame_ = const_buffer();
+    }
+
+    size_t offset = 0;
+    bool complete = false;
+    while (offset < size && !complete) {
+        offset += Skip(data + offset, size - offset);
+        if (offset == size)
+            break;
+        if (Consume(data[offset], &complete))
+            offset++;
+    }
+
+    // A run of whitespace ends with the data that has been read so far.
+    if (!complete && state_ == WHITESPACE)
+        complete = true;
+
+    *consumed = offset;
+    if (!complete) {
+        pending_.append(reinterpret_cast<const char *>(data), offset);
+        return false;
+    }
+
+    ResetState();
+    if (pending_.empty()) {
+        SetFrame(data, offset);
+    } else {
+        pending_.append(reinterpret_cast<const char *>(data), offset);
+        SetFrame(reinterpret_cast<const uint8_t *>(pending_.data()),
+                 pending_.size());
+    }
+    return true;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __XMPP_FRAMER_H__
+#define __XMPP_FRAMER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <boost/asio/buffer.hpp>
+
+#include "base/util.h"
+
+//
+// Resumable state machine that finds XMPP frame boundaries in a byte stream.
+//
+// A frame is one of:
+// - a run of whitespace between stanzas (used as keepalive).
+// - the stream header, up to the '>' that terminates the <stream:stream>
+//   start tag, while the session is being opened.
+// - an <iq> or <message> stanza, up to and including its end tag, once the
+//   stream is open.
+//
+// The framer scans the buffers handed to it by the TcpSession in place. A
+// frame that lies entirely within one buffer is exposed as a slice of that
+// buffer. Data is copied only for frames that span buffers, in which case
+// the slice refers to the internal pending buffer.
+//
+class XmppFramer {
+public:
+    enum Mode {
+        STREAM_HEADER,
+        STANZA
+    };
+
+    XmppFramer();
+
+    // The mode can only be changed between frames.
+    void set_mode(Mode mode);
+    Mode mode() const { return mode_; }
+    bool in_frame() const { return state_ != IDLE; }
+
+    // Scan the data for the end of the current frame. Returns true if the
+    // frame was completed, in which case it's available via frame() until
+    // the next call. The number of bytes that were consumed is returned in
+    // consumed. Bytes belonging to an incomplete frame are all consumed and
+    // retained internally.
+    bool Parse(const uint8_t *data, size_t size, size_t *consumed);
+
+    boost::asio::const_buffer frame() const { return frame_; }
+    size_t pending_size() const { return pending_.size(); }
+
+    void Reset();
+
+private:
+    enum State {
+        IDLE,
+        WHITESPACE,
+        STANZA_OPEN,
+        STANZA_CLOSE,
+        STANZA_CLOSE_END,
+        STREAM_OPEN,
+        STREAM_NS,
+        STREAM_NS_QUOTE,
+        STREAM_NS_END
+    };
+
+    //
+    // Incremental Knuth-Morris-Pratt matcher for a literal string, which
+    // keeps the partial match across calls.
+    //
+    class Literal {
+    public:
+        explicit Literal(const char *str);
+        bool Match(uint8_t ch);
+        void Reset() { matched_ = 0; }
+        bool idle() const { return matched_ == 0; }
+        uint8_t first() const { return str_[0]; }
+
+    private:
+        std::string str_;
+        std::vector<size_t> failure_;
+        size_t matched_;
+    };
+
+    void ResetState();
+    size_t Skip(const uint8_t *data, size_t size) const;
+    bool Consume(uint8_t ch, bool *complete);
+    void SetFrame(const uint8_t *data, size_t size);
+
+    Mode mode_;
+    State state_;
+    Literal iq_open_;
+    Literal message_open_;
+    Literal iq_close_;
+    Literal message_close_;
+    Literal *close_;
+    Literal stream_open_;
+    Literal stream_ns_;
+    std::string pending_;
+    bool frame_done_;
+    boost::asio::const_buffer frame_;
+
+    DISALLOW_COPY_AND_ASSIGN(XmppFramer);
+};
+
+#endif // __XMPP_FRAMER_H__